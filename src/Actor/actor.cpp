@@ -2,9 +2,12 @@
 
 #include "actor_context.h"
 #include "actor.h"
+#include "actor_exec_list.h"
 
 namespace mana{
 
+std::atomic<uint32_t> actor::nTreeVersion_(0);
+
 bool actor::init(actor_context& ctx)
 {
 	if(!init_self(ctx)) return false;
@@ -37,6 +40,33 @@ void actor::exec(actor_context& ctx)
 	ctx.valid(bValid);
 }
 
+actor* actor::remove_child(uint32_t nPriority, bool bDelete)
+{
+	actor_exec_list* pList = actor_exec_list::executing_list(this);
+	if(pList)
+	{
+		actor* pChild = base_type::child(nPriority);
+		if(pChild) pList->defer_remove(this, pChild, bDelete);
+		return bDelete ? nullptr : pChild;
+	}
+
+	++nTreeVersion_;
+	return base_type::remove_child(nPriority, bDelete);
+}
+
+void actor::clear_child(bool bDelete)
+{
+	actor_exec_list* pList = actor_exec_list::executing_list(this);
+	if(pList)
+	{
+		pList->defer_clear(this, bDelete);
+		return;
+	}
+
+	++nTreeVersion_;
+	base_type::clear_child(bDelete);
+}
+
 bool actor::is_exec(actor_context& ctx)
 {
 	uint32_t nPauseFlag = pause_flag() & ctx.pause_flag();
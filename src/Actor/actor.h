@@ -5,18 +5,23 @@
 namespace mana{
 
 class actor_context;
+class actor_exec_list;
 
 
 /*! @brief actorクラス。ゲーム制御の基本となる
  *
  *  ポーズフラグ(16個)に応じて動作制御できる。ポーズフラグは16bitのビットマスク。 
  *  actor_contextに設定されたポーズフラグと一致した場合、exec_selfを呼ばない
+ *
+ *  actor_machineは、実行中のactor以下をactor_exec_listに並べて実行する。
+ *  その間のremove_child/clear_childは、並びの実行が終わるまで保留される
  */
 class actor : private utility::node<actor>
 {
 public:
 	typedef utility::node<actor> base_type;
 	friend base_type;
+	friend class actor_exec_list;
 
 public:
 	enum pause_flag : uint16_t
@@ -44,13 +49,32 @@ public:
 
 public:
 	actor():nPauseFlag_(PAUSE_ALL),bValid_(true),nType_(0),nAttr_(0),nState_(0){}
-	virtual ~actor(){ clear_child(); }
+	virtual ~actor(){ base_type::clear_child(); ++nTreeVersion_; }
 
 public:
 	virtual bool	init(actor_context& ctx);
 	virtual void	reset(actor_context& ctx);
 	virtual void	exec(actor_context& ctx);
 
+public:
+	//! @defgroup actor_prepare 非同期準備。actor_machine::call_actor_asyncやwarm_up_actorで使われる
+	//! @{
+	//! @brief initの前に、ワーカースレッドで呼ばれる
+	/*! ファイル読み込みやデータ構築など、重い処理をここで済ませておく。
+	 *  メインスレッドと並行して動くので、ノードツリーやレンダラーなど共有しているものには触らないこと */
+	virtual void	prepare(actor_context& ctx){}
+	//! @brief prepareが終わった後、メインスレッドで毎フレーム呼ばれる。trueを返すとinitが呼ばれる
+	/*! テクスチャのロード待ちなどに使う */
+	virtual bool	is_ready(actor_context& ctx){ return true; }
+	//! 準備の進み具合。0.0～1.0。ロード表示などに使う
+	virtual float	prepare_progress()const{ return 1.0f; }
+	//! @}
+
+	//! @brief actor_exec_listに並べて、exec_selfを直接呼んでよいか
+	/*! 並べるとexecは呼ばれないので、execをオーバーライドしていないactorだけがtrueを返すこと。
+	 *  falseだと子を並べずに、execを呼ぶ */
+	virtual bool	is_flat_exec()const{ return false; }
+
 protected:
 	// 自分自身の動作
 	virtual bool	init_self(actor_context& ctx){ return true; }
@@ -82,28 +106,36 @@ public:
 	actor&			set_id(uint32_t nID){ base_type::set_id(nID); return *this;}
 
 	uint32_t		priority()const{ return base_type::priority(); }
-	actor&			set_priority(uint32_t nPriority){ base_type::set_priority(nPriority); return *this; }
+	actor&			set_priority(uint32_t nPriority){ base_type::set_priority(nPriority); ++nTreeVersion_; return *this; }
 
 	const actor*	parent()const{ return base_type::parent(); }
 		  actor*	parent(){ return base_type::parent(); }
-	actor&			set_parent(actor* pParent){ base_type::set_parent(pParent); return *this; }
+	actor&			set_parent(actor* pParent){ base_type::set_parent(pParent); ++nTreeVersion_; return *this; }
 
 	//! @defgroup actor_child_ctrl actorの子操作
 	//! @{
-	virtual bool			add_child(actor* pChild, uint32_t nPriority){ return base_type::add_child(pChild,nPriority,this); }
-	virtual actor*			remove_child(uint32_t nPriority, bool bDelete){ return base_type::remove_child(nPriority, bDelete); }
+	virtual bool			add_child(actor* pChild, uint32_t nPriority){ ++nTreeVersion_; return base_type::add_child(pChild,nPriority,this); }
+	//! @brief actor_exec_listの実行中は保留される。bDeleteがfalseなら、保留中でも外す子が返る
+	/*! 返った子は、保留中に別の親へ付け替えてよい。deleteするのは実行が終わってから */
+	virtual actor*			remove_child(uint32_t nPriority, bool bDelete);
 	virtual const actor*	child(uint32_t nPriority)const{ return base_type::child(nPriority); }
 	virtual actor*			child(uint32_t nPriority){ return base_type::child(nPriority); }
-	virtual void			clear_child(bool bDelete=true){ base_type::clear_child(bDelete); }
-	virtual void			sort_child(bool bChild=false){ base_type::sort_child(bChild); }
+	virtual bool			change_child_priority(uint32_t nPriority, uint32_t nNewPriority){ ++nTreeVersion_; return base_type::change_child_priority(nPriority, nNewPriority); }
+	//! actor_exec_listの実行中は保留される
+	virtual void			clear_child(bool bDelete=true);
+	virtual void			sort_child(bool bChild=false){ ++nTreeVersion_; base_type::sort_child(bChild); }
 
-	base_type::child_vector&		children(){ return vecChildren_; }
-	const base_type::child_vector&	children()const{ return vecChildren_; }
+	base_type::child_vector&		children(){ return base_type::children(); }
+	const base_type::child_vector&	children()const{ return base_type::children(); }
 
 	uint32_t						count_children()const{ return base_type::count_children(); }
 	void							shrink_children(){ base_type::shrink_children(); }
 	//! @}
 
+	//! @brief actorのツリーのどこかで親子関係が変わると増える
+	/*! actor_exec_listが並びを作り直すかどうかの判定に使う */
+	static uint32_t		tree_version(){ return nTreeVersion_.load(); }
+
 protected:
 	//! あらゆる状況をチェックして実行して良いかを判断する
 	bool is_exec(actor_context& ctx);
@@ -124,6 +156,10 @@ protected:
 	//! 状態
 	uint32_t	nState_;
 
+private:
+	//! ワーカースレッドのprepareからも変わるのでatomic
+	static std::atomic<uint32_t> nTreeVersion_;
+
 #ifdef MANA_DEBUG
 public:
 	const string&	debug_name()const{ return base_type::debug_name(); }
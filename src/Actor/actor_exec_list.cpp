@@ -0,0 +1,156 @@
+﻿#include "../mana_common.h"
+
+#include "actor_context.h"
+#include "actor.h"
+#include "actor_exec_list.h"
+
+namespace mana{
+
+actor_exec_list* actor_exec_list::pExecuting_ = nullptr;
+
+actor_exec_list::actor_exec_list(uint32_t nReserve):pRoot_(nullptr),nVersion_(0),pOuter_(nullptr)
+{
+	vecEntry_.reserve(nReserve);
+	vecDeferred_.reserve(16);
+
+#ifdef MANA_ACTOR_EXEC_LIST_COUNT
+	nBuildCount_=0;
+	nMaxSize_=0;
+	nSkipCount_=0;
+#endif
+}
+
+actor_exec_list::~actor_exec_list()
+{
+#ifdef MANA_ACTOR_EXEC_LIST_COUNT
+	logger::infoln("[actor_exec_list]作り直し回数 : " + to_str_s(nBuildCount_) + "最大actor数 : " + to_str_s(nMaxSize_) + "飛ばしたactor数 : " + to_str(nSkipCount_));
+#endif
+}
+
+void actor_exec_list::exec(actor* pRoot, actor_context& ctx)
+{
+	if(pRoot==nullptr || !ctx.is_valid()) return;
+
+	if(pRoot!=pRoot_ || nVersion_!=actor::tree_version())
+		build(pRoot);
+
+	pOuter_		= pExecuting_;
+	pExecuting_	= this;
+
+	for(uint32_t i=0; i<vecEntry_.size(); )
+	{
+		const entry& e = vecEntry_[i];
+
+		if(!e.bFlat_)
+		{
+			e.pActor_->exec(ctx);
+			i = e.nEnd_;
+			continue;
+		}
+
+		if(!e.pActor_->is_exec(ctx))
+		{
+		#ifdef MANA_ACTOR_EXEC_LIST_COUNT
+			nSkipCount_ += e.nEnd_-i;
+		#endif
+
+			i = e.nEnd_;
+			continue;
+		}
+
+		e.pActor_->exec_self(ctx);
+
+		// actor::execと同じく、exec_selfで無効になったら子孫は動かさない
+		if(!e.pActor_->is_valid())
+		{
+		#ifdef MANA_ACTOR_EXEC_LIST_COUNT
+			nSkipCount_ += e.nEnd_-i-1;
+		#endif
+
+			i = e.nEnd_;
+			continue;
+		}
+
+		++i;
+	}
+
+	pExecuting_	= pOuter_;
+	pOuter_		= nullptr;
+
+	flush_deferred();
+}
+
+actor_exec_list* actor_exec_list::executing_list(const actor* pActor)
+{
+	if(pExecuting_==nullptr) return nullptr;
+
+	// 並びの根はactor_machineの子なので、一番上ではなく、途中の親のどれかと一致するかを見る
+	for(actor_exec_list* p=pExecuting_; p; p=p->pOuter_)
+	{
+		for(const actor* a=pActor; a; a=a->parent())
+		{
+			if(a==p->pRoot_) return p;
+		}
+	}
+
+	return nullptr;
+}
+
+void actor_exec_list::build(actor* pRoot)
+{
+	vecEntry_.clear();
+	build_inner(pRoot);
+
+	pRoot_		= pRoot;
+	nVersion_	= actor::tree_version();
+
+#ifdef MANA_ACTOR_EXEC_LIST_COUNT
+	++nBuildCount_;
+	nMaxSize_ = (std::max)(nMaxSize_, static_cast<uint32_t>(vecEntry_.size()));
+#endif
+}
+
+void actor_exec_list::build_inner(actor* pActor)
+{
+	const uint32_t nIndex	= vecEntry_.size();
+	const bool bFlat		= pActor->is_flat_exec();
+	vecEntry_.emplace_back(pActor, bFlat);
+
+	if(bFlat)
+	{
+		for(auto child : pActor->children())
+			build_inner(child);
+	}
+
+	vecEntry_[nIndex].nEnd_ = vecEntry_.size();
+}
+
+void actor_exec_list::flush_deferred()
+{
+	if(vecDeferred_.empty()) return;
+
+	// tree_versionは最後にまとめて進めるので、base_typeを直接使う
+	for(auto& d : vecDeferred_)
+	{
+		actor::base_type* pParent = d.pParent_;
+		if(d.bClear_)
+		{
+			pParent->clear_child(d.bDelete_);
+			continue;
+		}
+
+		if(!pParent->erase_child(d.pChild_)) continue;
+
+		// 保留中に別の親へ付け替えられていたら、新しい親に任せる
+		actor::base_type* pChild = d.pChild_;
+		if(pChild->parent()!=d.pParent_) continue;
+
+		pChild->set_parent(nullptr);
+		if(d.bDelete_) delete d.pChild_;
+	}
+
+	vecDeferred_.clear();
+	++actor::nTreeVersion_;
+}
+
+} // namespace mana end
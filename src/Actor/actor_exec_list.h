@@ -0,0 +1,116 @@
+﻿#pragma once
+
+#ifdef MANA_DEBUG
+#define MANA_ACTOR_EXEC_LIST_COUNT
+#endif
+
+namespace mana{
+
+class actor;
+class actor_context;
+
+/*! @brief actorツリーを並べて実行するクラス
+ *
+ *  actor::execと同じ順番(自分、子をpriority順)で、ツリーを1本の配列に並べておき、
+ *  配列を先頭から見てexec_selfを呼ぶ。再帰もしないし、子の並びの確認もしない。
+ *  並びはactor::tree_versionが変わった時と、根が変わった時だけ作り直す
+ *
+ *  配列の要素は、自分の子孫の最後の次の位置を持つ。
+ *  ポーズ中や無効なactorは、そこまで一度に飛ばすので、止まっているサブツリーはほぼタダになる
+ *
+ *  実行中のremove_child/clear_childは保留して、実行が終わってから反映する。
+ *  保留中のactorはそのフレームの間は動き続ける。保留した操作は積んだ順に反映するので、
+ *  同じフレームで、deleteする子のさらに子を操作しないこと。
+ *  add_childはもともと子の並びに混ぜるのが遅れるので、追加されたactorは次のフレームから動く
+ *
+ *  is_flat_execがfalseのactor(actorの既定。actor_machineなど)は、子を並べずにexecを呼ぶ
+ *
+ *  作り直した回数をカウントする時は、
+ *  MANA_ACTOR_EXEC_LIST_COUNTをdefineする
+ */
+class actor_exec_list
+{
+private:
+	struct entry
+	{
+	public:
+		entry(actor* pActor, bool bFlat):pActor_(pActor),nEnd_(0),bFlat_(bFlat){}
+
+	public:
+		actor*		pActor_;
+		uint32_t	nEnd_;	//!< 子孫の最後の次の位置
+		bool		bFlat_;	//!< falseだとexecを呼ぶ
+	};
+
+	//! 保留中の子の操作
+	struct deferred
+	{
+	public:
+		deferred(actor* pParent, actor* pChild, bool bDelete, bool bClear):pParent_(pParent),pChild_(pChild),bDelete_(bDelete),bClear_(bClear){}
+
+	public:
+		actor*		pParent_;
+		actor*		pChild_;	//!< priorityは保留中に変わるかもしれないので、ポインタで持つ
+		bool		bDelete_;
+		bool		bClear_;	//!< trueだとclear_child
+	};
+
+public:
+	actor_exec_list(uint32_t nReserve=64);
+	~actor_exec_list();
+
+public:
+	//! pRoot以下を実行する。pRootにexecを呼ぶのと同じ
+	void		exec(actor* pRoot, actor_context& ctx);
+
+	//! 次のexecで並びを作り直させる
+	void		invalidate(){ pRoot_=nullptr; }
+
+	//! 並んでいるactorの数
+	uint32_t	size()const{ return vecEntry_.size(); }
+
+public:
+	//! @defgroup actor_exec_list_defer 保留
+	//! @{
+	//! @brief pActorを含む並びを実行中なら、その並びを返す
+	/*! actorの子操作から呼ばれる */
+	static actor_exec_list*	executing_list(const actor* pActor);
+
+	void		defer_remove(actor* pParent, actor* pChild, bool bDelete){ vecDeferred_.emplace_back(pParent, pChild, bDelete, false); }
+	void		defer_clear(actor* pParent, bool bDelete){ vecDeferred_.emplace_back(pParent, nullptr, bDelete, true); }
+	//! @}
+
+private:
+	void		build(actor* pRoot);
+	void		build_inner(actor* pActor);
+
+	//! 保留した子の操作を反映する
+	void		flush_deferred();
+
+private:
+	vector<entry>		vecEntry_;
+	vector<deferred>	vecDeferred_;
+
+	actor*				pRoot_;
+	uint32_t			nVersion_;	//!< 並びを作った時のactor::tree_version
+
+	actor_exec_list*	pOuter_;	//!< 実行中に、入れ子で実行され始めた時の外側の並び
+
+	static actor_exec_list* pExecuting_; //!< 実行中の一番内側の並び
+
+#ifdef MANA_ACTOR_EXEC_LIST_COUNT
+public:
+	uint32_t	build_count()const{ return nBuildCount_; }
+	uint32_t	skip_count()const{ return nSkipCount_; }
+
+private:
+	uint32_t	nBuildCount_;
+	uint32_t	nMaxSize_;
+	uint32_t	nSkipCount_;	//!< ポーズや無効で飛ばしたactorの数
+#endif
+
+private:
+	NON_COPIABLE(actor_exec_list);
+};
+
+} // namespace mana end
@@ -1,11 +1,37 @@
 ﻿#include "../mana_common.h"
 
+#include "../Concurrent/worker.h"
+#include "../Draw/renderer_2d.h"
+#include "../Draw/texture_residency.h"
+#include "../Graphic/draw_context.h"
+
+#include "actor_context.h"
 #include "actor_machine.h"
 
 namespace mana{
 
+actor_machine::actor_machine():nextCmd_(CMD_NONE,0),pCurrentActor_(nullptr),nWarmUpBudget_(0),nWarmUpDebt_(0)
+{
+#ifdef MANA_ACTOR_MACHINE_COUNT
+	nMaxSwitchMicro_=0;
+	nMaxAsyncSwitchMicro_=0;
+	nSwitchCount_=0;
+	nAsyncSwitchCount_=0;
+	nWarmUpCount_=0;
+#endif
+}
+
 actor_machine::~actor_machine()
 {
+#ifdef MANA_ACTOR_MACHINE_COUNT
+	logger::infoln("[actor_machine]切り替え回数 : " + to_str_s(nSwitchCount_) + "最大時間(us) : " + to_str(nMaxSwitchMicro_));
+	logger::infoln("[actor_machine]非同期切り替え回数 : " + to_str_s(nAsyncSwitchCount_) + "最大時間(us) : " + to_str_s(nMaxAsyncSwitchMicro_) + "warm up数 : " + to_str(nWarmUpCount_));
+#endif
+
+	// ワーカーで動いているprepareを待ってから消す
+	discard_prepare(prepare_);
+	discard_prepare(warmUp_);
+
 	pCurrentActor_=nullptr;
 	clear_cache();
 }
@@ -19,20 +45,49 @@ bool actor_machine::init(actor_context& ctx)
 
 void actor_machine::reset(actor_context& ctx)
 {
+	discard_prepare(prepare_);
+	discard_prepare(warmUp_);
+	deqWarmUp_.clear();
+	nWarmUpDebt_=0;
+
 	init(ctx);
 	clear_cache();
 	clear_child();
+	execList_.invalidate();
 }
 
 void actor_machine::exec(actor_context& ctx)
 {
 	if(!is_exec(ctx)) return;
 
+	// 準備中の切り替えを追い越す切り替えが来たら、準備中のものはキャッシュに入れる
+	if(nextCmd_.get<0>()!=CMD_NONE && is_preparing())
+		cancel_prepare(ctx);
+
 	switch(nextCmd_.get<0>())
 	{
 	case CMD_CALL:
+	{
+	#ifdef MANA_ACTOR_MACHINE_COUNT
+		timer::elapsed_timer t;
+		t.start();
+	#endif
+
 		push_actor(nextCmd_.get<1>(), ctx);
 		nextCmd_.get<0>() = CMD_NONE;
+
+	#ifdef MANA_ACTOR_MACHINE_COUNT
+		t.end();
+		nMaxSwitchMicro_ = (std::max)(nMaxSwitchMicro_, t.elasped_micro());
+		++nSwitchCount_;
+	#endif
+	}
+	break;
+
+	case CMD_CALL_ASYNC:
+		if(!start_prepare(nextCmd_.get<1>(), prepare_, ctx))
+			logger::warnln("[actor_machine]actorを準備できませんでした。: " + to_str(nextCmd_.get<1>()));
+		nextCmd_.get<0>() = CMD_NONE;
 	break;
 
 	case CMD_RETURN:
@@ -41,7 +96,7 @@ void actor_machine::exec(actor_context& ctx)
 			actor* pActor = pCurrentActor_;
 			cacheActor_.emplace(pActor->id(), pActor);
 
-			pop_actor();
+			pop_actor(ctx);
 		}
 		nextCmd_.get<0>() = CMD_NONE;
 	break;
@@ -50,9 +105,9 @@ void actor_machine::exec(actor_context& ctx)
 		if(children().size()>0)
 		{
 			actor* pActor = pCurrentActor_;
-			delete pActor;
+			pop_actor(ctx);
 
-			pop_actor();
+			delete pActor;
 		}
 		nextCmd_.get<0>() = CMD_NONE;
 	break;
@@ -60,7 +115,180 @@ void actor_machine::exec(actor_context& ctx)
 	default: break;
 	}
 
-	if(is_exec_actor()) pCurrentActor_->exec(ctx);
+	update_prepare(ctx);
+	update_warm_up(ctx);
+
+	if(is_exec_actor()) execList_.exec(pCurrentActor_, ctx);
+}
+
+/////////////////////////////////
+
+void actor_machine::cancel_prepare(actor_context& ctx)
+{
+	if(!is_preparing()) return;
+
+	uint32_t nID	= prepare_.nID_;
+	actor* pActor	= finish_prepare(prepare_, ctx);
+	cacheActor_.emplace(nID, pActor);
+
+#ifdef MANA_DEBUG
+	logger::debugln("[actor_machine][" + debug_name() + "] cancel_prepare : " + to_str(nID));
+#endif
+}
+
+void actor_machine::update_prepare(actor_context& ctx)
+{
+	if(!is_preparing() || !is_prepared(prepare_, ctx)) return;
+
+#ifdef MANA_ACTOR_MACHINE_COUNT
+	timer::elapsed_timer t;
+	t.start();
+#endif
+
+	push_actor_inner(finish_prepare(prepare_, ctx), ctx);
+
+#ifdef MANA_ACTOR_MACHINE_COUNT
+	t.end();
+	nMaxAsyncSwitchMicro_ = (std::max)(nMaxAsyncSwitchMicro_, t.elasped_micro());
+	++nAsyncSwitchCount_;
+#endif
+
+#ifdef MANA_DEBUG
+	logger::debugln("[actor_machine][" + debug_name() + "] push_actor async : " + to_str(pCurrentActor_->id()));
+#endif
+}
+
+void actor_machine::update_warm_up(actor_context& ctx)
+{
+	// 前のフレームまでに予算を越えた分を、今フレームの予算で返す
+	nWarmUpDebt_ = (std::max)(nWarmUpDebt_-nWarmUpBudget_, static_cast<int64_t>(0));
+
+	while(!warmUp_.pActor_ && !deqWarmUp_.empty())
+	{
+		uint32_t nID = deqWarmUp_.front();
+		deqWarmUp_.pop_front();
+
+		// すでにあるものは作らない
+		if(cacheActor_.find(nID)!=cacheActor_.end()) continue;
+		if(is_preparing() && prepare_.nID_==nID) continue;
+		if(std::any_of(children().begin(), children().end(), [nID](const actor* p){ return p->id()==nID; })) continue;
+
+		if(start_prepare(nID, warmUp_, ctx))
+			prefetch_actor(nID, ctx);
+	}
+
+	if(!warmUp_.pActor_ || nWarmUpDebt_>0 || !is_prepared(warmUp_, ctx)) return;
+
+	timer::elapsed_timer t;
+	t.start();
+
+	uint32_t nID	= warmUp_.nID_;
+	actor* pActor	= finish_prepare(warmUp_, ctx);
+	cacheActor_.emplace(nID, pActor);
+
+	t.end();
+	nWarmUpDebt_ = (std::max)(t.elasped_micro()-nWarmUpBudget_, static_cast<int64_t>(0));
+
+#ifdef MANA_ACTOR_MACHINE_COUNT
+	++nWarmUpCount_;
+#endif
+}
+
+bool actor_machine::start_prepare(uint32_t nID, prepare_state& state, actor_context& ctx)
+{
+	state.nID_ = nID;
+
+	auto it = cacheActor_.find(nID);
+	if(it!=cacheActor_.end())
+	{// キャッシュにあるものは準備済み
+		state.pActor_	= it->second;
+		state.bCache_	= true;
+		cacheActor_.erase(it);
+		return true;
+	}
+
+	if(&state!=&warmUp_ && warmUp_.pActor_ && warmUp_.nID_==nID)
+	{// warm upで準備中だったら、それを引き継ぐ
+		state	= warmUp_;
+		warmUp_	= prepare_state();
+		return true;
+	}
+
+	state.pActor_ = create_actor_factory(nID, ctx, false);
+	if(!state.pActor_) return false;
+
+	state.bCache_ = false;
+
+	// テクスチャはprepareと並行して読ませておく
+	hint_texture_group(nID, draw::texture_residency::PRIORITY_NORMAL, &state==&prepare_, ctx);
+
+	actor* pActor = state.pActor_;
+	if(pWorker_ && !pWorker_->is_fin())
+	{
+		shared_ptr<std::atomic_bool> pDone = make_shared<std::atomic_bool>(false);
+		state.future_ = pWorker_->request([pActor, pDone, &ctx](){ pActor->prepare(ctx); pDone->store(true, std::memory_order_release); });
+
+		// ワークは終わるまで消えないので、消えていてprepareも終わっていないなら積めなかった
+		if(!state.future_.expired() || pDone->load(std::memory_order_acquire))
+		{
+			state.pDone_ = pDone;
+			return true;
+		}
+	}
+
+	// ワーカーが無いので、ここで準備する
+	pActor->prepare(ctx);
+	return true;
+}
+
+bool actor_machine::is_prepared(prepare_state& state, actor_context& ctx)
+{
+	if(state.bCache_) return true;
+
+	if(state.pDone_ && !state.pDone_->load(std::memory_order_acquire))
+	{
+		if(!state.future_.expired()) return false;
+
+		// ワークは終わると消えるので、消えた後でも終わっていないならワーカーの終了で捨てられた
+		if(!state.pDone_->load(std::memory_order_acquire))
+			state.pActor_->prepare(ctx);
+		state.pDone_.reset();
+	}
+
+	return state.pActor_->is_ready(ctx);
+}
+
+bool actor_machine::wait_prepare(prepare_state& state)
+{
+	if(!state.pDone_) return true;
+
+	while(!state.pDone_->load(std::memory_order_acquire))
+	{
+		if(state.future_.expired()) return state.pDone_->load(std::memory_order_acquire);
+		std::this_thread::yield();
+	}
+	return true;
+}
+
+actor* actor_machine::finish_prepare(prepare_state& state, actor_context& ctx)
+{
+	if(!wait_prepare(state)) state.pActor_->prepare(ctx);
+
+	actor* pActor = state.pActor_;
+	if(state.bCache_)	pActor->reset(ctx);
+	else				pActor->init(ctx);
+
+	state = prepare_state();
+	return pActor;
+}
+
+void actor_machine::discard_prepare(prepare_state& state)
+{
+	if(!state.pActor_) return;
+
+	wait_prepare(state);
+	delete state.pActor_;
+	state = prepare_state();
 }
 
 /////////////////////////////////
@@ -77,7 +305,13 @@ void actor_machine::cache_create_actor(uint32_t nID, actor_context& ctx)
 	}
 
 	actor* pActor = create_actor_factory(nID, ctx);
-	if(pActor) cacheActor_.emplace(nID, pActor);
+	if(pActor)
+	{
+		cacheActor_.emplace(nID, pActor);
+
+		// キャッシュに作ったなら、そのうち実行されるはず
+		prefetch_actor(nID, ctx);
+	}
 }
 
 void actor_machine::cache_destory_actor(uint32_t nID)
@@ -97,9 +331,36 @@ void actor_machine::clear_cache()
 	cacheActor_.clear();
 }
 
+void actor_machine::prefetch_actor(uint32_t nID, actor_context& ctx)
+{
+	auto it = texGroup_.find(nID);
+	if(it==texGroup_.end() || !ctx.draw_context()) return;
+
+	const shared_ptr<draw::renderer_2d>& pRenderer = ctx.draw_context()->renderer();
+	if(!pRenderer) return;
+
+	for(auto& sGroup : it->second)
+		pRenderer->request_tex_prefetch_group(sGroup);
+}
+
+void actor_machine::hint_texture_group(uint32_t nID, uint32_t nPriority, bool bPreload, actor_context& ctx)
+{
+	auto it = texGroup_.find(nID);
+	if(it==texGroup_.end() || !ctx.draw_context()) return;
+
+	const shared_ptr<draw::renderer_2d>& pRenderer = ctx.draw_context()->renderer();
+	if(!pRenderer) return;
+
+	for(auto& sGroup : it->second)
+	{
+		pRenderer->request_tex_group_priority(sGroup, nPriority);
+		if(bPreload) pRenderer->request_tex_preload_group(sGroup);
+	}
+}
+
 //////////////////////////////////
 
-actor* actor_machine::create_actor_factory(uint32_t nID, actor_context& ctx)
+actor* actor_machine::create_actor_factory(uint32_t nID, actor_context& ctx, bool bInit)
 {
 	if(pFct_)
 	{
@@ -109,7 +370,7 @@ actor* actor_machine::create_actor_factory(uint32_t nID, actor_context& ctx)
 		{
 			pActor->set_parent(this);
 			pActor->set_id(nID);
-			pActor->init(ctx);
+			if(bInit) pActor->init(ctx);
 		}
 
 		return pActor;
@@ -135,19 +396,30 @@ void actor_machine::push_actor(uint32_t nID, actor_context& ctx)
 		pActor = create_actor_factory(nID,ctx);
 	}
 	
-	if(pActor)
-	{
-		pCurrentActor_ = pActor;
-		children().emplace_back(pCurrentActor_);
-	}
+	if(pActor) push_actor_inner(pActor, ctx);
 
 #ifdef MANA_DEBUG
 	logger::debugln("[actor_machine][" + debug_name() + "] push_actor : " + to_str(nID));
 #endif
 }
 
-void actor_machine::pop_actor()
+void actor_machine::push_actor_inner(actor* pActor, actor_context& ctx)
 {
+	// 積まれる方は戻ってくるので、追い出されにくさは普通にしておく。
+	// 同じグループを使っていたら、後で送るHIGHが勝つ
+	if(pCurrentActor_) hint_texture_group(pCurrentActor_->id(), draw::texture_residency::PRIORITY_NORMAL, false, ctx);
+
+	pCurrentActor_ = pActor;
+	children().emplace_back(pCurrentActor_);
+
+	hint_texture_group(pActor->id(), draw::texture_residency::PRIORITY_HIGH, true, ctx);
+}
+
+void actor_machine::pop_actor(actor_context& ctx)
+{
+	// 降ろした方は真っ先に追い出してよい
+	if(pCurrentActor_) hint_texture_group(pCurrentActor_->id(), draw::texture_residency::PRIORITY_LOW, false, ctx);
+
 	children().pop_back();
 
 	if(children().size()>0)
@@ -155,6 +427,8 @@ void actor_machine::pop_actor()
 	else
 		pCurrentActor_ = nullptr;
 
+	if(pCurrentActor_) hint_texture_group(pCurrentActor_->id(), draw::texture_residency::PRIORITY_HIGH, true, ctx);
+
 #ifdef MANA_DEBUG
 	logger::debugln("[actor_machine][" + debug_name() + "] pop_actor");
 #endif
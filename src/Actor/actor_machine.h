@@ -1,9 +1,19 @@
 ﻿#pragma once
 
 #include "actor.h"
+#include "actor_exec_list.h"
+
+#ifdef MANA_DEBUG
+#define MANA_ACTOR_MACHINE_COUNT
+#endif
 
 namespace mana{
 
+namespace concurrent{
+class worker;
+class future;
+} // namespace concurrent end
+
 class actor_context;
 class actor_factory;
 
@@ -14,10 +24,33 @@ class actor_factory;
  *
  *  常に一つのActorを実行し、call/returnが出来る
  *  actorの切り替えはexecのタイミングに行われる 
+ *  実行中のActor以下は、actor_exec_listに並べて実行する
  *
  *  このクラスによって管理されるactorは、
  *    factoryから生成された時にinitが呼ばれ
  *    キャッシュから取得された時はresetが呼ばれる
+ *
+ *  add_texture_groupでactorが使うテクスチャグループを登録しておくと、
+ *  切り替えの時にレンダラーへ常駐優先度と先読みのヒントを送る
+ *    実行を始めるactor     : HIGH。preloadする
+ *    callで積まれたactor   : NORMAL
+ *    returnで降ろしたactor : LOW
+ *    キャッシュに作ったactor、prefetch_actor : prefetchする
+ *
+ *  call_actor_asyncを使うと、次のactorを裏で準備してから切り替える。
+ *    1. factoryで生成し、テクスチャグループをpreloadさせ、ワーカーでactor::prepareを動かす
+ *    2. prepareが終わったら、毎フレームactor::is_readyを呼ぶ
+ *    3. trueが返ったらinitを呼んで切り替える
+ *  その間も今のactorは動き続けるので、切り替えのフレームで止まるのはinitの分だけになる。
+ *  キャッシュにあるactorは準備済みなので、すぐ切り替わる
+ *
+ *  warm_up_actorを使うと、同じ手順でキャッシュにactorを作っておける。
+ *  メインスレッドでのinitは1フレームに1つまでで、set_warm_up_budgetの時間を越えた分は次のフレーム以降に回す
+ *
+ *  prepareにはexecに渡されたactor_contextが渡されるので、actor_contextは切り替えが終わるまで生きていること
+ *
+ *  切り替えにかかった時間をカウントする時は、
+ *  MANA_ACTOR_MACHINE_COUNTをdefineする
  */
 class actor_machine : public actor
 {
@@ -26,13 +59,28 @@ protected:
 		CMD_CALL,
 		CMD_RETURN,
 		CMD_RETURN_DELETE,
+		CMD_CALL_ASYNC,
 		CMD_NONE,
 	};
 
 	typedef tuple<cmd, uint32_t> cmd_tuple;
 
+	//! 裏で準備しているactor
+	struct prepare_state
+	{
+	public:
+		prepare_state():nID_(0),pActor_(nullptr),bCache_(false){}
+
+	public:
+		uint32_t						nID_;
+		actor*							pActor_;
+		bool							bCache_;	//!< キャッシュから取り出した。準備済みなので、initの代わりにresetする
+		weak_ptr<concurrent::future>	future_;	//!< prepareのワーク
+		shared_ptr<std::atomic_bool>	pDone_;		//!< ワークでprepareが終わるとtrue。ワーカーを使っていない時はnullptr
+	};
+
 public:
-	actor_machine():nextCmd_(CMD_NONE,0),pCurrentActor_(nullptr){}
+	actor_machine();
 	virtual ~actor_machine();
 
 public:
@@ -54,31 +102,128 @@ public:
 	//! 実行するActorが存在している
 	bool is_exec_actor()const{ return pCurrentActor_!=nullptr; }
 
+	//! @defgroup actor_machine_async 非同期切り替え
+	//! @{
+	//! prepareを動かすワーカー。設定されていない時は、prepareもメインスレッドで呼ぶ
+	void		set_worker(const shared_ptr<concurrent::worker>& pWorker){ pWorker_=pWorker; }
+
+	//! @brief 次のActorを裏で準備して、準備ができたらcallする
+	/*! 準備している間も、現在実行中のActorは動き続ける。
+	 *  準備中に別の切り替えをすると、準備中のActorは準備が終わるのを待ってキャッシュに入る */
+	void		call_actor_async(uint32_t nID){ nextCmd_.get<0>()=CMD_CALL_ASYNC; nextCmd_.get<1>()=nID; }
+
+	//! call_actor_asyncで準備中のActorがいる
+	bool		is_preparing()const{ return prepare_.pActor_!=nullptr; }
+	uint32_t	preparing_id()const{ return prepare_.nID_; }
+	//! 準備中のActorの進み具合。0.0～1.0。準備中でなければ1.0
+	float		prepare_progress()const{ return is_preparing() ? prepare_.pActor_->prepare_progress() : 1.0f; }
+	//! 準備をやめる。準備中のActorは、準備が終わるのを待ってinitしてキャッシュに入れる
+	void		cancel_prepare(actor_context& ctx);
+	//! @}
+
+	//! @defgroup actor_machine_warm_up キャッシュの裏での作成
+	//! @{
+	//! 裏で準備してキャッシュに作る。積んだ順に1つずつ準備する
+	void		warm_up_actor(uint32_t nID){ deqWarmUp_.emplace_back(nID); }
+	//! warm up待ちと準備中のものを数える
+	uint32_t	warm_up_num()const{ return deqWarmUp_.size() + (warmUp_.pActor_ ? 1 : 0); }
+	//! @brief 1フレームでwarm upのinitに使ってよい時間(マイクロ秒)
+	/*! 1つのinitが越えた分は、次のフレーム以降のwarm upを止めて返す */
+	void		set_warm_up_budget(uint32_t nMicroSec){ nWarmUpBudget_=nMicroSec; }
+	//! @}
+
 	//! キャッシュとしてをactorを作る
 	void cache_create_actor(uint32_t nID, actor_context& ctx);
 	void cache_destory_actor(uint32_t nID);
 	void clear_cache();
 
+	//! @defgroup actor_machine_texture テクスチャグループのヒント
+	//! @{
+	//! actorが使うテクスチャグループを登録する
+	void add_texture_group(uint32_t nID, const string& sGroup){ texGroup_[nID].emplace_back(sGroup); }
+	void clear_texture_group(uint32_t nID){ texGroup_.erase(nID); }
+
+	//! 次に実行するactorのテクスチャグループを先読みさせる
+	void prefetch_actor(uint32_t nID, actor_context& ctx);
+	//! @}
+
 public:
 	// actor_machineでは、通常の子Actor操作は禁止なので何も動作しないようにしておく
 	bool			add_child(actor* pChild, uint32_t nID)final{ return false; }
 	actor*			remove_child(uint32_t nID, bool bDelete)final{ return nullptr; }
 	const actor*	child(uint32_t nID)const final{ return nullptr; }
 	void			sort_child(bool bChild=false)final{}
+	bool			change_child_priority(uint32_t nID, uint32_t nNewID)final{ return false; }
 
 protected:
 	void	push_actor(uint32_t nID, actor_context& ctx);
-	void	pop_actor();
-
-	actor*	create_actor_factory(uint32_t nID, actor_context& ctx);
+	//! 作成・準備済みのactorを実行中にする
+	void	push_actor_inner(actor* pActor, actor_context& ctx);
+	void	pop_actor(actor_context& ctx);
+
+	//! @defgroup actor_machine_prepare 裏での準備
+	//! @{
+	//! キャッシュから取り出すか、生成してprepareを動かす
+	bool	start_prepare(uint32_t nID, prepare_state& state, actor_context& ctx);
+	//! prepareが終わって、is_readyがtrueを返したか
+	bool	is_prepared(prepare_state& state, actor_context& ctx);
+	//! @brief prepareが終わるまで待つ
+	/*! @return ワーカーが終了してprepareが動かなかった時はfalse */
+	bool	wait_prepare(prepare_state& state);
+	//! init/resetを呼んで、準備したactorを取り出す
+	actor*	finish_prepare(prepare_state& state, actor_context& ctx);
+	//! prepareが終わるのを待って、actorを削除する
+	void	discard_prepare(prepare_state& state);
+
+	//! call_actor_asyncの準備ができていたら切り替える
+	void	update_prepare(actor_context& ctx);
+	//! warm upを進める
+	void	update_warm_up(actor_context& ctx);
+	//! @}
+
+	//! @brief actorのテクスチャグループの常駐優先度をレンダラーに送る
+	/*! @param[in] nPriority texture_residency::priority
+	 *  @param[in] bPreload trueならpreloadもする */
+	void	hint_texture_group(uint32_t nID, uint32_t nPriority, bool bPreload, actor_context& ctx);
+
+	//! @param[in] bInit falseだとinitを呼ばない。裏で準備する時に使う
+	actor*	create_actor_factory(uint32_t nID, actor_context& ctx, bool bInit=true);
 
 protected:
 	cmd_tuple					nextCmd_;
 
 	actor*						pCurrentActor_;
+	actor_exec_list				execList_;		//!< pCurrentActor_以下の並び
 
 	flat_map<uint32_t, actor*>	cacheActor_;
 	shared_ptr<actor_factory>	pFct_;
+
+	flat_map<uint32_t, vector<string>> texGroup_; //!< actorが使うテクスチャグループ
+
+	shared_ptr<concurrent::worker>	pWorker_;
+	prepare_state					prepare_;		//!< call_actor_asyncで準備中のactor
+
+	deque<uint32_t>					deqWarmUp_;		//!< warm up待ちのactor ID
+	prepare_state					warmUp_;		//!< warm upで準備中のactor
+	int64_t							nWarmUpBudget_;	//!< マイクロ秒
+	int64_t							nWarmUpDebt_;	//!< 予算を越えてinitに使った時間。0になるまでwarm upのinitをしない
+
+#ifdef MANA_ACTOR_MACHINE_COUNT
+public:
+	//! 切り替えのフレームで、メインスレッドが使った最大時間(マイクロ秒)
+	int64_t		max_switch_micro()const{ return nMaxSwitchMicro_; }
+	int64_t		max_async_switch_micro()const{ return nMaxAsyncSwitchMicro_; }
+	uint32_t	switch_count()const{ return nSwitchCount_; }
+	uint32_t	async_switch_count()const{ return nAsyncSwitchCount_; }
+	uint32_t	warm_up_count()const{ return nWarmUpCount_; }
+
+private:
+	int64_t		nMaxSwitchMicro_;
+	int64_t		nMaxAsyncSwitchMicro_;
+	uint32_t	nSwitchCount_;
+	uint32_t	nAsyncSwitchCount_;
+	uint32_t	nWarmUpCount_;
+#endif
 };
 
 //! @brief actor_machineに設定するファクトリーのインターフェイスクラス
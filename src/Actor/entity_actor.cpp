@@ -0,0 +1,33 @@
+﻿#include "../mana_common.h"
+
+#include "actor_context.h"
+#include "entity_actor.h"
+
+namespace mana{
+
+bool entity_actor::add_system(uint32_t nPriority, const system_func& func)
+{
+	if(!mapSystem_.emplace(nPriority, func).second)
+	{
+		logger::warnln("[entity_actor]システムの優先度が重複しています。: " + to_str(nPriority));
+		return false;
+	}
+
+	return true;
+}
+
+void entity_actor::reset_self(actor_context& ctx)
+{
+	world_.clear();
+}
+
+void entity_actor::exec_self(actor_context& ctx)
+{
+	for(auto& it : mapSystem_)
+	{
+		it.second(world_, ctx);
+		world_.flush();
+	}
+}
+
+} // namespace mana end
@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include "actor.h"
+#include "entity_world.h"
+
+namespace mana{
+
+/*! @brief entity::entity_worldを持つactor
+ *
+ *  弾やパーティクルなど大量のものを、1つのactorとしてactorツリーに置くために使う。
+ *  中身はactorの子ではなく、エンティティとして持つ
+ *
+ *  exec_selfで、登録したシステムを優先度の小さい順に呼ぶ。
+ *  システムを1つ呼ぶごとにworld().flush()するので、
+ *  システム内でのdestroy_laterは次のシステムからは見えなくなっている
+ */
+class entity_actor : public actor
+{
+public:
+	//! システム。ワールドのエンティティを処理する
+	typedef function<void(entity::entity_world&, actor_context&)> system_func;
+
+public:
+	entity_actor(){}
+	virtual ~entity_actor(){}
+
+public:
+	entity::entity_world&		world(){ return world_; }
+	const entity::entity_world&	world()const{ return world_; }
+
+	//! @defgroup entity_actor_system システム操作
+	//! @{
+	//! @brief システムを登録する
+	/*! @param[in] nPriority 小さいほど先に呼ばれる。同じ優先度があったら失敗する */
+	bool	add_system(uint32_t nPriority, const system_func& func);
+	void	remove_system(uint32_t nPriority){ mapSystem_.erase(nPriority); }
+	void	clear_system(){ mapSystem_.clear(); }
+	//! @}
+
+	//! world().each_parallelで使うワーカー
+	void	set_worker(const shared_ptr<concurrent::worker>& pWorker){ world_.set_worker(pWorker); }
+
+	//! execをオーバーライドしていないので並べてよい。execをオーバーライドする派生クラスはfalseを返すこと
+	virtual bool	is_flat_exec()const override{ return true; }
+
+protected:
+	virtual void	reset_self(actor_context& ctx)override;
+	virtual void	exec_self(actor_context& ctx)override;
+
+protected:
+	entity::entity_world				world_;
+	flat_map<uint32_t, system_func>		mapSystem_;
+};
+
+} // namespace mana end
+
+/* 使用例
+
+	struct position{ float fX, fY; };
+	struct velocity{ float fX, fY; };
+
+	// actor_machineには直接つなげないので、シーンのactorの子にする
+	class game_scene : public actor
+	{
+	protected:
+		bool init_self(actor_context& ctx)override
+		{
+			entity_actor* pBullets = new_ entity_actor();
+
+			pBullets->add_system(0, [](entity::entity_world& world, actor_context& ctx)
+			{
+				world.each_parallel<position, velocity>([](entity::entity_id id, position& pos, const velocity& vel)
+				{
+					pos.fX += vel.fX;
+					pos.fY += vel.fY;
+				});
+			});
+
+			pBullets->add_system(1, [](entity::entity_world& world, actor_context& ctx)
+			{
+				world.each<position>([&world](entity::entity_id id, const position& pos)
+				{
+					if(pos.fY>480.f) world.destroy_later(id);
+				});
+			});
+
+			pBullets->world().create(position{320.f,0.f}, velocity{0.f,4.f});
+
+			add_child(pBullets, 10);
+			return true;
+		}
+	};
+
+	// game_sceneをactor_factoryに登録して、machine.call_actorで実行する
+*/
@@ -0,0 +1,404 @@
+﻿#include "../mana_common.h"
+
+#include <cstdlib>
+#include <thread>
+
+#include "../Concurrent/worker.h"
+
+#include "entity_world.h"
+
+namespace mana{
+namespace entity{
+
+////////////////////////////
+// component_type
+////////////////////////////
+namespace{
+
+std::atomic<uint32_t>	nComponentTypeNum(0);
+uint32_t				anComponentSize[component_type::MAX_COMPONENT];
+uint32_t				anComponentAlign[component_type::MAX_COMPONENT];
+
+uint32_t align_up(uint32_t n, uint32_t nAlign){ return (n+(nAlign-1)) & ~(nAlign-1); }
+
+} // namespace end
+
+uint32_t component_type::regist(uint32_t nSize, uint32_t nAlign)
+{
+	uint32_t nID = nComponentTypeNum.fetch_add(1);
+	if(nID>=MAX_COMPONENT)
+	{
+		// 既存の型の枠に重ねるとチャンクの配置が壊れるので続行しない
+		logger::fatalln("[component_type]コンポーネントの型が多すぎます。最大 : " + to_str(MAX_COMPONENT));
+		std::abort();
+	}
+
+	anComponentSize[nID]  = nSize;
+	anComponentAlign[nID] = nAlign;
+	return nID;
+}
+
+uint32_t component_type::size(uint32_t nID){ return anComponentSize[nID]; }
+uint32_t component_type::align(uint32_t nID){ return anComponentAlign[nID]; }
+
+////////////////////////////
+// entity_world
+////////////////////////////
+entity_world::entity_world():nEntityNum_(0)
+{
+#ifdef MANA_ENTITY_WORLD_COUNT
+	nChunkAllocCount_=0;
+	nMoveCount_=0;
+#endif
+}
+
+entity_world::~entity_world()
+{
+#ifdef MANA_ENTITY_WORLD_COUNT
+	logger::infoln("[entity_world]アーキタイプ数 : " + to_str_s(vecArchetype_.size()) + "チャンク確保数 : " + to_str_s(nChunkAllocCount_) + "アーキタイプ移動数 : " + to_str(nMoveCount_));
+#endif
+
+	for(auto& a : vecArchetype_)
+	{
+		for(auto& c : a.vecChunk_)
+			delete[] c.pRaw_;
+	}
+}
+
+////////////////////////////
+// エンティティ操作
+////////////////////////////
+entity_id entity_world::create_inner(uint32_t nMask)
+{
+	uint32_t nIndex;
+	if(!vecFreeIndex_.empty())
+	{
+		nIndex = vecFreeIndex_.back();
+		vecFreeIndex_.pop_back();
+	}
+	else
+	{
+		nIndex = vecRecord_.size();
+		if(nIndex>INDEX_MASK)
+		{
+			logger::warnln("[entity_world]エンティティが多すぎます。");
+			return INVALID_ENTITY;
+		}
+		vecRecord_.emplace_back();
+	}
+
+	record& rec = vecRecord_[nIndex];
+	const entity_id id = nIndex | (static_cast<uint32_t>(rec.nGen_)<<INDEX_BITS);
+
+	rec.nArchetype_ = find_archetype(nMask);
+	alloc_row(rec.nArchetype_, rec.nChunk_, rec.nRow_);
+	rec.bAlive_ = true;
+
+	const archetype& a	= vecArchetype_[rec.nArchetype_];
+	const chunk& c		= a.vecChunk_[rec.nChunk_];
+	c.ids()[rec.nRow_] = id;
+
+	for(uint32_t t=0; t<component_type::MAX_COMPONENT; ++t)
+	{
+		if(!a.has(t)) continue;
+		const uint32_t nSize = component_type::size(t);
+		::memset(c.pData_+a.anOffset_[t]+rec.nRow_*nSize, 0, nSize);
+	}
+
+	++nEntityNum_;
+	return id;
+}
+
+void entity_world::destroy(entity_id id)
+{
+	if(!is_alive(id)) return;
+
+	const uint32_t nIndex = id & INDEX_MASK;
+	record& rec = vecRecord_[nIndex];
+
+	free_row(rec.nArchetype_, rec.nChunk_, rec.nRow_);
+
+	rec.bAlive_ = false;
+	release_index(nIndex);
+	--nEntityNum_;
+}
+
+void entity_world::destroy_later(entity_id id)
+{
+	std::lock_guard<std::mutex> lock(mutexLater_);
+	vecDestroyLater_.emplace_back(id);
+}
+
+void entity_world::flush()
+{
+	std::lock_guard<std::mutex> lock(mutexLater_);
+
+	// 同じエンティティが複数回積まれていても、is_aliveで弾かれる
+	for(auto id : vecDestroyLater_)
+		destroy(id);
+
+	vecDestroyLater_.clear();
+}
+
+bool entity_world::is_alive(entity_id id)const
+{
+	if(id==INVALID_ENTITY) return false;
+
+	const uint32_t nIndex = id & INDEX_MASK;
+	if(nIndex>=vecRecord_.size()) return false;
+
+	const record& rec = vecRecord_[nIndex];
+	return rec.bAlive_ && rec.nGen_==((id>>INDEX_BITS) & GEN_MASK);
+}
+
+void entity_world::clear()
+{
+	for(auto& a : vecArchetype_)
+	{
+		for(uint32_t c=0; c<a.nChunkNum_; ++c)
+			a.vecChunk_[c].nCount_=0;
+		a.nChunkNum_=0;
+	}
+
+	for(uint32_t i=0; i<vecRecord_.size(); ++i)
+	{
+		record& rec = vecRecord_[i];
+		if(!rec.bAlive_) continue;
+
+		rec.bAlive_ = false;
+		release_index(i);
+	}
+
+	nEntityNum_=0;
+
+	std::lock_guard<std::mutex> lock(mutexLater_);
+	vecDestroyLater_.clear();
+}
+
+void entity_world::release_index(uint32_t nIndex)
+{
+	record& rec = vecRecord_[nIndex];
+
+	// 世代が一周すると古いIDがまた生きていることになるので、そのインデックスはもう使わない
+	if(++rec.nGen_>=GEN_MASK) return;
+
+	vecFreeIndex_.emplace_back(nIndex);
+}
+
+////////////////////////////
+// コンポーネント操作
+////////////////////////////
+void* entity_world::component_ptr(entity_id id, uint32_t nType)
+{
+	if(!is_alive(id)) return nullptr;
+
+	const record& rec	= vecRecord_[id & INDEX_MASK];
+	const archetype& a	= vecArchetype_[rec.nArchetype_];
+	if(!a.has(nType)) return nullptr;
+
+	return a.vecChunk_[rec.nChunk_].pData_ + a.anOffset_[nType] + rec.nRow_*component_type::size(nType);
+}
+
+bool entity_world::move_entity(entity_id id, uint32_t nMask)
+{
+	record& rec = vecRecord_[id & INDEX_MASK];
+
+	const uint32_t nSrc = rec.nArchetype_;
+	const uint32_t nDst = find_archetype(nMask);
+	if(nSrc==nDst) return true;
+
+	uint32_t nChunk, nRow;
+	alloc_row(nDst, nChunk, nRow);
+
+	const archetype& src	= vecArchetype_[nSrc];
+	const archetype& dst	= vecArchetype_[nDst];
+	const chunk& srcChunk	= src.vecChunk_[rec.nChunk_];
+	const chunk& dstChunk	= dst.vecChunk_[nChunk];
+
+	dstChunk.ids()[nRow] = id;
+
+	for(uint32_t t=0; t<component_type::MAX_COMPONENT; ++t)
+	{
+		if(!dst.has(t)) continue;
+
+		const uint32_t nSize = component_type::size(t);
+		BYTE* pDst = dstChunk.pData_+dst.anOffset_[t]+nRow*nSize;
+
+		if(src.has(t))	::memcpy(pDst, srcChunk.pData_+src.anOffset_[t]+rec.nRow_*nSize, nSize);
+		else			::memset(pDst, 0, nSize);
+	}
+
+	free_row(nSrc, rec.nChunk_, rec.nRow_);
+
+	rec.nArchetype_ = nDst;
+	rec.nChunk_		= nChunk;
+	rec.nRow_		= nRow;
+
+#ifdef MANA_ENTITY_WORLD_COUNT
+	++nMoveCount_;
+#endif
+
+	return true;
+}
+
+////////////////////////////
+// アーキタイプ操作
+////////////////////////////
+uint32_t entity_world::find_archetype(uint32_t nMask)
+{
+	auto it = mapArchetype_.find(nMask);
+	if(it!=mapArchetype_.end()) return it->second;
+
+	archetype* pArchetype = new_ archetype();
+	archetype& a = *pArchetype;
+	a.nMask_ = nMask;
+
+	// 1エンティティあたりのサイズから、チャンクに入る数の見当をつけてから詰めていく
+	uint32_t nEntityByte = sizeof(entity_id);
+	for(uint32_t t=0; t<component_type::MAX_COMPONENT; ++t)
+	{
+		a.anOffset_[t] = 0;
+		if(a.has(t)) nEntityByte += component_type::size(t);
+	}
+
+	uint32_t nCapacity = (std::max)(CHUNK_BYTE/nEntityByte, 1u);
+	uint32_t nByte;
+	for(;;)
+	{
+		nByte = align_up(nCapacity*sizeof(entity_id), CHUNK_ALIGN);
+		for(uint32_t t=0; t<component_type::MAX_COMPONENT; ++t)
+		{
+			if(!a.has(t)) continue;
+
+			a.anOffset_[t] = nByte;
+			nByte = align_up(nByte+nCapacity*component_type::size(t), CHUNK_ALIGN);
+		}
+
+		if(nByte<=CHUNK_BYTE || nCapacity==1) break;
+		--nCapacity;
+	}
+
+	a.nCapacity_	= nCapacity;
+	a.nChunkByte_	= (std::max)(nByte, static_cast<uint32_t>(CHUNK_BYTE));
+
+	const uint32_t nIndex = vecArchetype_.size();
+	vecArchetype_.push_back(pArchetype);
+	mapArchetype_.emplace(nMask, nIndex);
+
+	return nIndex;
+}
+
+void entity_world::alloc_row(uint32_t nArchetype, uint32_t& nChunk, uint32_t& nRow)
+{
+	archetype& a = vecArchetype_[nArchetype];
+
+	if(a.nChunkNum_==0 || a.vecChunk_[a.nChunkNum_-1].nCount_>=a.nCapacity_)
+	{
+		if(a.nChunkNum_==a.vecChunk_.size())
+		{
+			chunk c;
+			c.pRaw_  = new_ BYTE[a.nChunkByte_+CHUNK_ALIGN-1];
+			c.pData_ = reinterpret_cast<BYTE*>((reinterpret_cast<uintptr_t>(c.pRaw_)+(CHUNK_ALIGN-1)) & ~static_cast<uintptr_t>(CHUNK_ALIGN-1));
+			a.vecChunk_.emplace_back(c);
+
+#ifdef MANA_ENTITY_WORLD_COUNT
+			++nChunkAllocCount_;
+#endif
+		}
+
+		++a.nChunkNum_;
+	}
+
+	nChunk	= a.nChunkNum_-1;
+	nRow	= a.vecChunk_[nChunk].nCount_++;
+}
+
+void entity_world::free_row(uint32_t nArchetype, uint32_t nChunk, uint32_t nRow)
+{
+	archetype& a = vecArchetype_[nArchetype];
+
+	const uint32_t nLastChunk	= a.nChunkNum_-1;
+	chunk& last					= a.vecChunk_[nLastChunk];
+	const uint32_t nLastRow		= last.nCount_-1;
+
+	if(nChunk!=nLastChunk || nRow!=nLastRow)
+	{
+		const chunk& hole = a.vecChunk_[nChunk];
+
+		for(uint32_t t=0; t<component_type::MAX_COMPONENT; ++t)
+		{
+			if(!a.has(t)) continue;
+
+			const uint32_t nSize = component_type::size(t);
+			::memcpy(hole.pData_+a.anOffset_[t]+nRow*nSize, last.pData_+a.anOffset_[t]+nLastRow*nSize, nSize);
+		}
+
+		const entity_id moved = last.ids()[nLastRow];
+		hole.ids()[nRow] = moved;
+
+		record& rec	= vecRecord_[moved & INDEX_MASK];
+		rec.nChunk_	= nChunk;
+		rec.nRow_	= nRow;
+	}
+
+	if(--last.nCount_==0)
+		--a.nChunkNum_;
+}
+
+////////////////////////////
+// 並列実行
+////////////////////////////
+namespace{
+
+//! exec_parallelでワーカーと共有する状態。ワーカーのジョブが後から動き出しても大丈夫なように、shared_ptrで持つ
+struct parallel_state
+{
+	std::atomic<uint32_t>				nNext_;
+	std::atomic<uint32_t>				nDone_;
+	uint32_t							nNum_;
+	const function<void(uint32_t)>*		pFunc_; //!< 全て終わった後は触らない
+
+	void run()
+	{
+		for(;;)
+		{
+			const uint32_t n = nNext_.fetch_add(1, std::memory_order_relaxed);
+			if(n>=nNum_) break;
+
+			(*pFunc_)(n);
+			nDone_.fetch_add(1, std::memory_order_release);
+		}
+	}
+};
+
+} // namespace end
+
+void entity_world::exec_parallel(uint32_t nNum, const function<void(uint32_t)>& func)
+{
+	if(nNum==0) return;
+
+	if(!pWorker_ || pWorker_->is_fin() || nNum==1)
+	{
+		for(uint32_t i=0; i<nNum; ++i) func(i);
+		return;
+	}
+
+	auto pState = make_shared<parallel_state>();
+	pState->nNext_	= 0;
+	pState->nDone_	= 0;
+	pState->nNum_	= nNum;
+	pState->pFunc_	= &func;
+
+	const uint32_t nJob = (std::min)(nNum-1, static_cast<uint32_t>(PARALLEL_JOB_NUM));
+	for(uint32_t i=0; i<nJob; ++i)
+		pWorker_->request([pState](){ pState->run(); });
+
+	// 自分も処理する。積んだジョブが動かなくても、ここで全て処理される
+	pState->run();
+
+	while(pState->nDone_.load(std::memory_order_acquire)<nNum)
+		std::this_thread::yield();
+}
+
+} // namespace entity end
+} // namespace mana end
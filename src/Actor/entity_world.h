@@ -0,0 +1,371 @@
+﻿#pragma once
+
+#include <type_traits>
+
+#ifdef MANA_DEBUG
+#define MANA_ENTITY_WORLD_COUNT
+#endif
+
+namespace mana{
+
+namespace concurrent{
+class worker;
+} // namespace concurrent end
+
+namespace entity{
+
+//! エンティティID。下位20bitがインデックス、上位12bitが世代
+typedef uint32_t entity_id;
+
+//! 無効なエンティティID
+static const entity_id INVALID_ENTITY = UINT_MAX;
+
+/*! @brief コンポーネントの型に番号を振るクラス
+ *
+ *  番号は型ごとにプログラム全体で1つ。最初にidが呼ばれた時に振られる。
+ *  コンポーネントはmemcpyで移動するので、コピーしてよい型(POD)のみ使える
+ */
+class component_type
+{
+public:
+	enum component_type_const : uint32_t
+	{
+		MAX_COMPONENT = 32, //!< コンポーネントの型の最大数。マスクを32bitで持つため
+	};
+
+public:
+	template<class T>
+	static uint32_t id()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "component must be trivially copyable");
+		static_assert(__alignof(T)<=16, "component alignment must be 16 or less");
+		static const uint32_t nID = regist(sizeof(T), __alignof(T));
+		return nID;
+	}
+
+	static uint32_t size(uint32_t nID);
+	static uint32_t align(uint32_t nID);
+
+	//! 型のマスクを作る
+	template<class... T>
+	static uint32_t mask()
+	{
+		uint32_t nMask=0;
+		int anDummy[] = { 0, (nMask |= 1u<<id<T>(), 0)... };
+		(void)anDummy;
+		return nMask;
+	}
+
+private:
+	static uint32_t regist(uint32_t nSize, uint32_t nAlign);
+};
+
+/*! @brief エンティティとコンポーネントを格納するワールド
+ *
+ *  大量の弾や敵、パーティクルなど、寿命が短く数が多いものをactorの代わりに扱う。
+ *  エンティティはIDだけを持ち、データはコンポーネントとして型ごとに格納する
+ *
+ *  同じコンポーネントの組み合わせ(アーキタイプ)を持つエンティティは、
+ *  固定サイズのチャンクに型ごとの配列として詰められる。
+ *  消したエンティティの穴はアーキタイプの最後のエンティティで埋めるので、
+ *  最後のチャンク以外は常に埋まっている。チャンクは解放せずに使い回す
+ *
+ *  eachで、指定したコンポーネントを全て持つエンティティを、チャンクの順に処理する。
+ *  仮想関数呼び出しもノードをたどることもなく、配列を先頭から読むだけになる。
+ *  each_parallelはチャンク単位でワーカーに分けて処理する
+ *
+ *  each中にエンティティを作ったり消したり、コンポーネントを増減すると並びが変わるので、
+ *  destroy_laterで予約してflushで反映すること。destroy_laterは別スレッドから呼んでよい
+ *
+ *  チャンク確保数やアーキタイプ間の移動数をカウントする時は、
+ *  MANA_ENTITY_WORLD_COUNTをdefineする
+ */
+class entity_world
+{
+public:
+	enum entity_world_const : uint32_t
+	{
+		CHUNK_BYTE	= 16*1024,	//!< チャンクのサイズ
+		CHUNK_ALIGN	= 16,		//!< チャンク内の配列のアライメント
+
+		INDEX_BITS	= 20,
+		INDEX_MASK	= (1u<<INDEX_BITS)-1,
+		GEN_MASK	= (1u<<(32-INDEX_BITS))-1,	//!< 世代がここまで来たインデックスは使わない。古いIDが生き返らないように
+
+		PARALLEL_JOB_NUM = 8,	//!< each_parallelでワーカーに積むジョブの最大数
+	};
+
+private:
+	//! 同じアーキタイプのエンティティを詰めるメモリ
+	struct chunk
+	{
+	public:
+		chunk():pRaw_(nullptr),pData_(nullptr),nCount_(0){}
+
+		entity_id*	ids()const{ return reinterpret_cast<entity_id*>(pData_); }
+
+	public:
+		BYTE*		pRaw_;		//!< 確保したメモリ
+		BYTE*		pData_;		//!< CHUNK_ALIGNに合わせた先頭
+		uint32_t	nCount_;	//!< 詰められているエンティティ数
+	};
+
+	//! コンポーネントの組み合わせ
+	struct archetype
+	{
+	public:
+		archetype():nMask_(0),nCapacity_(0),nChunkByte_(0),nChunkNum_(0){}
+
+		bool		has(uint32_t nType)const{ return (nMask_ & (1u<<nType))!=0; }
+
+		//! チャンク内のコンポーネント配列
+		template<class T>
+		T*			array(const chunk& c)const{ return reinterpret_cast<T*>(c.pData_+anOffset_[component_type::id<T>()]); }
+
+	public:
+		uint32_t		nMask_;
+		uint32_t		nCapacity_;	//!< 1チャンクに詰められるエンティティ数
+		uint32_t		nChunkByte_;//!< チャンクのサイズ。大きなコンポーネントがあるとCHUNK_BYTEより大きくなる
+		uint32_t		anOffset_[component_type::MAX_COMPONENT]; //!< チャンク内の配列の位置
+
+		vector<chunk>	vecChunk_;	//!< 確保したチャンク。使い回すので解放しない
+		uint32_t		nChunkNum_;	//!< 使っているチャンク数。最後のもの以外は埋まっている
+	};
+
+	//! エンティティのインデックスごとの情報
+	struct record
+	{
+	public:
+		record():nArchetype_(0),nChunk_(0),nRow_(0),nGen_(0),bAlive_(false){}
+
+	public:
+		uint32_t	nArchetype_;
+		uint32_t	nChunk_;
+		uint32_t	nRow_;
+		uint16_t	nGen_;
+		bool		bAlive_;
+	};
+
+public:
+	entity_world();
+	~entity_world();
+
+public:
+	//! @defgroup entity_world_entity エンティティ操作
+	//! @{
+	//! コンポーネントを持たないエンティティを作る
+	entity_id	create(){ return create_inner(0); }
+
+	//! コンポーネントを指定してエンティティを作る
+	template<class... T>
+	entity_id	create(const T&... comp)
+	{
+		entity_id id = create_inner(component_type::mask<T...>());
+		if(id==INVALID_ENTITY) return id;
+
+		int anDummy[] = { 0, (*static_cast<T*>(component_ptr(id, component_type::id<T>())) = comp, 0)... };
+		(void)anDummy;
+		return id;
+	}
+
+	//! エンティティを消す。each中は使わないこと
+	void		destroy(entity_id id);
+	//! flushで消すように予約する。別スレッドから呼んでよい
+	void		destroy_later(entity_id id);
+	//! 予約を反映する
+	void		flush();
+
+	bool		is_alive(entity_id id)const;
+
+	//! 全て消す。チャンクは残す
+	void		clear();
+
+	uint32_t	entity_num()const{ return nEntityNum_; }
+	//! @}
+
+	//! @defgroup entity_world_component コンポーネント操作
+	//! @{
+	//! コンポーネントを追加する。すでに持っていたら上書きする
+	template<class T>
+	bool		add(entity_id id, const T& comp)
+	{
+		const uint32_t nType = component_type::id<T>();
+		if(!is_alive(id)) return false;
+
+		if(!has_type(id, nType) && !move_entity(id, mask_of(id) | (1u<<nType))) return false;
+
+		*static_cast<T*>(component_ptr(id, nType)) = comp;
+		return true;
+	}
+
+	template<class T>
+	bool		remove(entity_id id)
+	{
+		const uint32_t nType = component_type::id<T>();
+		if(!is_alive(id) || !has_type(id, nType)) return false;
+
+		return move_entity(id, mask_of(id) & ~(1u<<nType));
+	}
+
+	//! コンポーネントを取得する。持っていなければnullptr。ポインタはエンティティを作ったり消したりするまで有効
+	template<class T>
+	T*			get(entity_id id){ return static_cast<T*>(component_ptr(id, component_type::id<T>())); }
+	template<class T>
+	const T*	get(entity_id id)const{ return static_cast<const T*>(const_cast<entity_world*>(this)->component_ptr(id, component_type::id<T>())); }
+
+	template<class T>
+	bool		has(entity_id id)const{ return is_alive(id) && has_type(id, component_type::id<T>()); }
+	//! @}
+
+	//! @defgroup entity_world_query クエリ
+	//! @{
+	//! @brief 指定したコンポーネントを全て持つエンティティを処理する
+	/*! func(entity_id, T&...) */
+	template<class... T, class F>
+	void		each(F func)
+	{
+		const uint32_t nMask = component_type::mask<T...>();
+		for(auto& a : vecArchetype_)
+		{
+			if((a.nMask_ & nMask)!=nMask) continue;
+
+			for(uint32_t c=0; c<a.nChunkNum_; ++c)
+			{
+				const chunk& ch = a.vecChunk_[c];
+				each_row(func, ch.nCount_, ch.ids(), a.array<T>(ch)...);
+			}
+		}
+	}
+
+	//! @brief チャンク単位で処理する。配列をまとめて処理する時に使う
+	/*! func(uint32_t nNum, const entity_id*, T*...) */
+	template<class... T, class F>
+	void		each_chunk(F func)
+	{
+		const uint32_t nMask = component_type::mask<T...>();
+		for(auto& a : vecArchetype_)
+		{
+			if((a.nMask_ & nMask)!=nMask) continue;
+
+			for(uint32_t c=0; c<a.nChunkNum_; ++c)
+			{
+				const chunk& ch = a.vecChunk_[c];
+				func(ch.nCount_, static_cast<const entity_id*>(ch.ids()), a.array<T>(ch)...);
+			}
+		}
+	}
+
+	//! @brief eachをチャンク単位でワーカーに分けて処理する
+	/*! funcは複数のスレッドから同時に呼ばれる。ワーカーが無い時はeachと同じ */
+	template<class... T, class F>
+	void		each_parallel(F func)
+	{
+		const uint32_t nMask = component_type::mask<T...>();
+
+		vecQueryChunk_.clear();
+		for(uint32_t i=0; i<vecArchetype_.size(); ++i)
+		{
+			const archetype& a = vecArchetype_[i];
+			if((a.nMask_ & nMask)!=nMask) continue;
+
+			for(uint32_t c=0; c<a.nChunkNum_; ++c)
+				vecQueryChunk_.emplace_back(i, c);
+		}
+
+		exec_parallel(static_cast<uint32_t>(vecQueryChunk_.size()), [this, &func](uint32_t n)
+		{
+			const archetype& a	= vecArchetype_[vecQueryChunk_[n].first];
+			const chunk& ch		= a.vecChunk_[vecQueryChunk_[n].second];
+			each_row(func, ch.nCount_, ch.ids(), a.array<T>(ch)...);
+		});
+	}
+
+	//! each_parallelで使うワーカー
+	void		set_worker(const shared_ptr<concurrent::worker>& pWorker){ pWorker_=pWorker; }
+	//! @}
+
+private:
+	template<class F, class... T>
+	static void	each_row(F& func, uint32_t nNum, const entity_id* pID, T*... p)
+	{
+		for(uint32_t i=0; i<nNum; ++i)
+			func(pID[i], p[i]...);
+	}
+
+	entity_id	create_inner(uint32_t nMask);
+	void*		component_ptr(entity_id id, uint32_t nType);
+	bool		has_type(entity_id id, uint32_t nType)const{ return vecArchetype_[vecRecord_[id & INDEX_MASK].nArchetype_].has(nType); }
+	uint32_t	mask_of(entity_id id)const{ return vecArchetype_[vecRecord_[id & INDEX_MASK].nArchetype_].nMask_; }
+
+	//! エンティティを別のアーキタイプに移す。共通のコンポーネントはコピーされる
+	bool		move_entity(entity_id id, uint32_t nMask);
+
+	//! 世代を進めてインデックスを空ける。世代が使い切ったインデックスは空けずに捨てる
+	void		release_index(uint32_t nIndex);
+
+	//! @defgroup entity_world_inner アーキタイプ操作
+	//! @{
+	uint32_t	find_archetype(uint32_t nMask);
+	//! アーキタイプの最後に1つ分の場所を確保する
+	void		alloc_row(uint32_t nArchetype, uint32_t& nChunk, uint32_t& nRow);
+	//! 場所を空けて、最後のエンティティで埋める
+	void		free_row(uint32_t nArchetype, uint32_t nChunk, uint32_t nRow);
+	//! @}
+
+	//! [0,nNum)をワーカーで分けて処理する。全て終わるまで戻らない
+	void		exec_parallel(uint32_t nNum, const function<void(uint32_t)>& func);
+
+private:
+	ptr_vector<archetype>			vecArchetype_;
+	flat_map<uint32_t, uint32_t>	mapArchetype_;	//!< マスクからvecArchetype_の番号
+
+	vector<record>					vecRecord_;
+	vector<uint32_t>				vecFreeIndex_;
+	uint32_t						nEntityNum_;
+
+	std::mutex						mutexLater_;
+	vector<entity_id>				vecDestroyLater_;
+
+	shared_ptr<concurrent::worker>			pWorker_;
+	vector<std::pair<uint32_t, uint32_t>>	vecQueryChunk_; //!< each_parallelで処理するアーキタイプとチャンク
+
+#ifdef MANA_ENTITY_WORLD_COUNT
+public:
+	uint32_t	chunk_alloc_count()const{ return nChunkAllocCount_; }
+	uint32_t	move_count()const{ return nMoveCount_; }
+
+private:
+	uint32_t	nChunkAllocCount_;
+	uint32_t	nMoveCount_;
+#endif
+
+private:
+	NON_COPIABLE(entity_world);
+};
+
+} // namespace entity end
+} // namespace mana end
+
+/* 使用例
+
+	struct position{ float fX, fY; };
+	struct velocity{ float fX, fY; };
+
+	entity::entity_world world;
+
+	for(uint32_t i=0; i<10000; ++i)
+		world.create(position{0.f,0.f}, velocity{1.f,2.f});
+
+	world.each<position, velocity>([](entity::entity_id id, position& pos, velocity& vel)
+	{
+		pos.fX += vel.fX;
+		pos.fY += vel.fY;
+	});
+
+	// 画面外に出たら消す
+	world.each_parallel<position>([&world](entity::entity_id id, position& pos)
+	{
+		if(pos.fY>480.f) world.destroy_later(id);
+	});
+	world.flush();
+*/
@@ -14,10 +14,11 @@ namespace audio{
 audio::audio(uint32_t nReserve):base_type(nReserve),
 								nSoundID_(0),eCmd_(sound::MODE_NONE),ePastCmd_(sound::MODE_NONE),
 								bLoop_(false),
-								nFadeFrame_(0),nFadeCounter_(0),
-								eEvent_(sound::EV_END),
+								nFadeFrame_(0),nFadeCounter_(0),eFadeCurve_(sound::gain_envelope::CURVE_LINEAR),
+								pEvent_(make_shared<event_state>()),nPlayReq_(0),
 								paramFlag_(PARAM_NONE),fSpeed_(1.0f),fPos_(0.0f),
 								worldFlag_(PARAM_NONE),
+								fWorldFadeSec_(0.0f),eWorldFadeCurve_(sound::gain_envelope::CURVE_LINEAR),bFollowFade_(false),
 								eExecPlayMode_(sound::MODE_NONE)
 {}
 
@@ -71,6 +72,13 @@ void audio::exec_parent()
 	{
 		worldFlag_  = parent()->world_param_flag();
 		worldVol_	= parent()->worldVol_;
+
+		if(bit_test<uint32_t>(worldFlag_, PARAM_FADE))
+		{
+			worldFadeVol_		= parent()->worldFadeVol_;
+			fWorldFadeSec_		= parent()->fWorldFadeSec_;
+			eWorldFadeCurve_	= parent()->eWorldFadeCurve_;
+		}
 	}
 	else
 	{// 親がいないならリセット
@@ -79,9 +87,43 @@ void audio::exec_parent()
 	}
 }
 
+bool audio::world_fade(float fFrameSec, sound::volume& end, float& fSec, sound::gain_envelope::curve& eCurve)const
+{
+	sound::volume parentEnd;
+	parentEnd.set_per(100);
+
+	bool bFade	= false;
+	fSec		= 0.0f;
+	eCurve		= sound::gain_envelope::CURVE_LINEAR;
+
+	if(parent())
+	{
+		bFade = parent()->world_fade(fFrameSec, parentEnd, fSec, eCurve);
+		if(!bFade) parentEnd = parent()->worldVol_;
+	}
+
+	if(is_fade())
+	{// 親と自分の両方がフェード中なら、長い方に合わせる
+		float fSelfSec = (std::max)(nFadeFrame_-nFadeCounter_, 1)*fFrameSec;
+		if(!bFade || fSelfSec>fSec)
+		{
+			fSec	= fSelfSec;
+			eCurve	= eFadeCurve_;
+		}
+		bFade = true;
+	}
+
+	if(!bFade) return false;
+
+	const sound::volume& selfEnd = is_fade() ? volFade_ : vol_;
+	end.set_per((parentEnd.per()*selfEnd.per())/100);
+	return true;
+}
+
 void audio::exec_fade()
 {// フェードなどボリューム合成
-	if((ePastCmd_==sound::MODE_PLAY || ePastCmd_==sound::MODE_PLAY_LOOP) && is_fade())
+	// サウンドを持たないまとめ用のaudioは、再生していなくてもフェードを進める
+	if((nSoundID_==0 || ePastCmd_==sound::MODE_PLAY || ePastCmd_==sound::MODE_PLAY_LOOP) && is_fade())
 	{// フェードあり
 		if(nFadeCounter_<=nFadeFrame_)
 		{
@@ -90,17 +132,12 @@ void audio::exec_fade()
 
 			//logger::traceln("[audio]" + to_str_s(volFadeBase_.per()) + to_str_s(volFade_.per()) + to_str_s(cur) + to_str(sound_id()));
 
+			// サウンド側はPARAM_FADEでフェードしてるので、ここではボリュームを送らない
 			if(nFadeCounter_ >= nFadeFrame_)
 			{// フェード終了
 				vol_.set_per(volFade_.per());
-				paramFlag_ |= PARAM_VOL;
-
 				nFadeFrame_ = 0;
 			}
-			else if(nFadeCounter_%2)
-			{
-				paramFlag_ |= PARAM_VOL;
-			}
 			++nFadeCounter_;
 		}
 	}
@@ -130,6 +167,7 @@ void audio::exec_param_flag(audio_context& ctx)
 	}
 
 	// ボリュームの合成は必ずやる
+	sound::volume parentVol = worldVol_;
 	worldVol_.set_per((worldVol_.per()*vol_.per())/100);
 
 	if(bit_test<uint32_t>(paramFlag_, PARAM_VOL)
@@ -148,6 +186,45 @@ void audio::exec_param_flag(audio_context& ctx)
 		}
 	}
 
+	if(bit_test<uint32_t>(paramFlag_, PARAM_FADE)
+	|| bit_test<uint32_t>(worldFlag_, PARAM_FADE))
+	{// フェード先の合成ボリュームを作って、サウンドには1回だけフェードを送る
+		bool bSelf = bit_test<uint32_t>(paramFlag_, PARAM_FADE);
+
+		const sound::volume& parentEnd	= bit_test<uint32_t>(worldFlag_, PARAM_FADE) ? worldFadeVol_ : parentVol;
+		const sound::volume& selfEnd	= bSelf ? volFade_ : vol_;
+		worldFadeVol_.set_per((parentEnd.per()*selfEnd.per())/100);
+
+		if(bSelf)
+		{
+			fWorldFadeSec_		= nFadeFrame_*ctx.frame_sec();
+			eWorldFadeCurve_	= eFadeCurve_;
+		}
+
+		worldFlag_ |= PARAM_FADE;
+
+		if(nSoundID_>0)
+		{
+			volume_fade_cmd cmd;
+			cmd.nID_	= nSoundID_;
+			cmd.vol_	= worldFadeVol_;
+			cmd.fSec_	= fWorldFadeSec_;
+			cmd.eCurve_	= eWorldFadeCurve_;
+
+			ctx.player()->request(cmd);
+		}
+	}
+	else if(nSoundID_>0
+		&& (bFollowFade_ || bit_test<uint32_t>(paramFlag_, PARAM_VOL) || bit_test<uint32_t>(worldFlag_, PARAM_VOL)))
+	{// フェードの途中で音量が変わったり、途中から加わった時は、サウンドのフェードが止まるので残りを送り直す
+		volume_fade_cmd cmd;
+		if(world_fade(ctx.frame_sec(), cmd.vol_, cmd.fSec_, cmd.eCurve_))
+		{
+			cmd.nID_ = nSoundID_;
+			ctx.player()->request(cmd);
+		}
+	}
+
 	if(bit_test<uint32_t>(paramFlag_, PARAM_SPEED))
 	{
 		if(nSoundID_>0)
@@ -180,7 +257,12 @@ void audio::exec_param_flag(audio_context& ctx)
 		{
 			event_cmd cmd;
 			cmd.nID_ = nSoundID_;
-			cmd.handler_ = [this](sound::play_event e){ eEvent_.store(e, std::memory_order_release); };
+			shared_ptr<event_state> pEvent = pEvent_;
+			cmd.handler_ = [pEvent](sound::play_event e)
+			{
+				if(e==sound::EV_PLAY) pEvent->nPlayAck_.fetch_add(1, std::memory_order_release);
+				pEvent->eEvent_.store(e, std::memory_order_release);
+			};
 
 			ctx.player()->request(cmd);
 		}
@@ -201,6 +283,7 @@ void audio::exec_cmd(audio_context& ctx)
 			cmd.bLoop_All_	= bLoop_;
 
 			ctx.player()->request(cmd);
+			++nPlayReq_;
 
 			bLRU_ = true;
 		}
@@ -240,6 +323,7 @@ void audio::exec_reset()
 	if(eCmd_!=sound::MODE_NONE) ePastCmd_ = eCmd_;
 	eCmd_		= sound::MODE_NONE;
 	paramFlag_	= PARAM_NONE;
+	bFollowFade_= false;
 }
 
 ////////////////////////
@@ -266,13 +350,14 @@ void audio::pause(bool bChildren)
 	if(bChildren) paramFlag_ |= PARAM_PAUSE;
 }
 
-void audio::fade_volume(const sound::volume& start, const sound::volume& end, int32_t nFadeFrame)
+void audio::fade_volume(const sound::volume& start, const sound::volume& end, int32_t nFadeFrame, sound::gain_envelope::curve eCurve)
 {
 	vol_ = start;
-	fade_volume(end, nFadeFrame);
+	paramFlag_ |= PARAM_VOL; // 開始ボリュームはすぐに設定する
+	fade_volume(end, nFadeFrame, eCurve);
 }
 
-void audio::fade_volume(const sound::volume& end, int32_t nFadeFrame)
+void audio::fade_volume(const sound::volume& end, int32_t nFadeFrame, sound::gain_envelope::curve eCurve)
 {
 	if(nFadeFrame<=0) nFadeFrame=1;
 
@@ -280,7 +365,8 @@ void audio::fade_volume(const sound::volume& end, int32_t nFadeFrame)
 	volFade_		= end;
 	nFadeFrame_		= nFadeFrame;
 	nFadeCounter_	= 0;
-	paramFlag_	   |= PARAM_VOL;
+	eFadeCurve_		= eCurve;
+	paramFlag_	   |= PARAM_FADE;
 }
 
 void audio::set_volume(const sound::volume& vol)
@@ -2,6 +2,7 @@
 
 #include "../Utility/node.h"
 #include "../Sound/sound_util.h"
+#include "../Sound/gain_envelope.h"
 
 #include "audio_util.h"
 
@@ -47,8 +48,12 @@ public:
 	void		pause(bool bChildren=false);
 
 	uint32_t	param_flag()const{ return paramFlag_; }
-	void		fade_volume(const sound::volume& start, const sound::volume& end, int32_t nFadeFrame);
-	void		fade_volume(const sound::volume& end, int32_t nFadeFrame);
+	//! @brief フェード
+	/*! 時間はフレーム数で指定するが、サウンド側ではaudio_context::frame_secで秒数に換算して
+	 *  サンプル単位でフェードする
+	 *  @param[in] eCurve フェードカーブ。クロスフェードにはCURVE_EQUAL_POWERを使う */
+	void		fade_volume(const sound::volume& start, const sound::volume& end, int32_t nFadeFrame, sound::gain_envelope::curve eCurve=sound::gain_envelope::CURVE_LINEAR);
+	void		fade_volume(const sound::volume& end, int32_t nFadeFrame, sound::gain_envelope::curve eCurve=sound::gain_envelope::CURVE_LINEAR);
 	void		set_volume(const sound::volume& vol);
 	void		set_speed(float fSpeed);
 	void		set_pos(float fSec);
@@ -61,8 +66,16 @@ public:
 	//! フェード実行中かどうか
 	bool		is_fade()const{ return nFadeFrame_>0; }
 
+	//! @brief 自分か親がフェード中なら、次のexecで残りのフェードをサウンドに送る
+	/*! 親のフェードの途中で作った子は、フェードの始まりを受け取っていないので、これを呼んでおく */
+	void		follow_parent_fade(){ bFollowFade_ = true; }
+
 	//! 最新のイベント状態。サウンドバッファの状態を取得することにほぼ等価
-	sound::play_event	sound_event()const{ return static_cast<sound::play_event>(eEvent_.load(std::memory_order_acquire)); }
+	sound::play_event	sound_event()const{ return static_cast<sound::play_event>(pEvent_->eEvent_.load(std::memory_order_acquire)); }
+
+	//! @brief 再生を要求して、まだサウンド側で再生が始まっていないか
+	/*! この間のsound_eventは前の再生の状態なので、鳴り終わったかの判定に使えない */
+	bool		is_play_wait()const{ return eCmd_==sound::MODE_PLAY || static_cast<int32_t>(nPlayReq_-pEvent_->nPlayAck_.load(std::memory_order_acquire))>0; }
 
 	//! 再生状態を取得する
 	sound::play_mode	sound_play_mode();	// 値が取得できるまで呼び続ける版
@@ -85,8 +98,8 @@ public:
 			audio*	child(uint32_t nID){ return base_type::child(nID); }
 	void			clear_child(bool bDelete=true){ base_type::clear_child(bDelete); }
 
-	base_type::child_vector&		children(){ return vecChildren_; }
-	const base_type::child_vector&	children()const{ return vecChildren_; }
+	base_type::child_vector&		children(){ return base_type::children(); }
+	const base_type::child_vector&	children()const{ return base_type::children(); }
 
 	uint32_t		count_children()const{ return base_type::count_children(); }
 	void			shrink_children(){ base_type::shrink_children(); }
@@ -103,6 +116,10 @@ protected:
 	void			exec_cmd(audio_context& ctx);
 	void			exec_reset();
 
+	//! @brief 自分か親がフェード中なら、フェード先の合成ボリュームと残りの秒数を返す
+	/*! フェードの途中で音量が変わった時や、途中から加わった時に、サウンドへ送り直すのに使う */
+	bool			world_fade(float fFrameSec, sound::volume& end, float& fSec, sound::gain_envelope::curve& eCurve)const;
+
 protected:
 	uint32_t			nSoundID_;	//!< 対応するサウンドID
 
@@ -122,8 +139,21 @@ protected:
 	sound::volume		volFade_;		//!< フェード先ボーリューム
 	int32_t				nFadeFrame_;	//!< フェードフレーム
 	int32_t				nFadeCounter_;	//!< フェードカウンター
+	sound::gain_envelope::curve	eFadeCurve_;	//!< フェードカーブ
 
-	std::atomic_uint32_t	eEvent_;	//!< 最新のイベント
+	//! サウンドスレッドから書かれる状態。ハンドラはaudioより後まで残ることがあるので共有しておく
+	struct event_state
+	{
+	public:
+		event_state():eEvent_(sound::EV_END),nPlayAck_(0){}
+
+	public:
+		std::atomic_uint32_t	eEvent_;	//!< 最新のイベント
+		std::atomic_uint32_t	nPlayAck_;	//!< EV_PLAYを受け取った回数
+	};
+
+	shared_ptr<event_state>	pEvent_;
+	uint32_t				nPlayReq_;	//!< 再生命令を送った回数
 
 	std::atomic_uint32_t				eExecPlayMode_;	//!< 状態取得の取得先
 	function<void(sound::play_mode)>	playHandler_;	//!< 状態取得のためのハンドラ
@@ -132,6 +162,15 @@ protected:
 	uint32_t			worldFlag_;	//!< 変更フラグまとめ
 	sound::volume		worldVol_;	//!< 実際に設定されてるボリューム
 
+	//! @defgroup audio_world_fade PARAM_FADEの時に子に伝えるフェード
+	//! @{
+	sound::volume				worldFadeVol_;		//!< フェード先の合成ボリューム
+	float						fWorldFadeSec_;		//!< フェード秒数
+	sound::gain_envelope::curve	eWorldFadeCurve_;	//!< フェードカーブ
+
+	bool						bFollowFade_;		//!< 次のexecで、フェードの残りをサウンドに送る
+	//! @}
+
 	bool				bLRU_;		//!< LRU用フラグ。再生されるとtrueになるが、execのタイミングなので注意
 
 #ifdef MANA_DEBUG
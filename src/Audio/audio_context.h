@@ -12,11 +12,18 @@ namespace audio{
 class audio_context
 {
 public:
+	audio_context():fFrameSec_(1.0f/60.0f){}
+
 	const shared_ptr<sound::sound_player>&	player(){ return pPlayer_; }
 	void									set_player(const shared_ptr<sound::sound_player>& pPlayer){ pPlayer_=pPlayer; }
 
+	//! 1フレームの秒数。フレーム指定のフェードを秒数に換算する
+	float									frame_sec()const{ return fFrameSec_; }
+	void									set_frame_sec(float fSec){ if(fSec>0.0f) fFrameSec_=fSec; }
+
 protected:
 	shared_ptr<sound::sound_player>	pPlayer_;
+	float							fFrameSec_;
 };
 
 } // namespace audio end
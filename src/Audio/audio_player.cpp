@@ -12,7 +12,7 @@ namespace audio{
 
 ///////////////////////////////////
 
-audio_player::audio_player():eState_(STATE_NONE), eBgmState_(BGM_NONE),nBgmIndex_(0),nFade_(0),nSeGcNum_(SE_GC_NUM),nSeGcFrame_(SE_GC_FRAME),nSeGcCounter_(0)
+audio_player::audio_player():eState_(STATE_NONE), eBgmState_(BGM_NONE),nBgmIndex_(0),nFade_(0)
 {
 	eLoadState_.store(NONE, std::memory_order_release);
 
@@ -42,7 +42,7 @@ audio_player::~audio_player()
 	safe_delete(pCtx_);
 }
 
-bool audio_player::init(const shared_ptr<sound::sound_player>& pPlayer, uint32_t nSeGcFrame, uint32_t nSeGcNum)
+bool audio_player::init(const shared_ptr<sound::sound_player>& pPlayer, uint32_t nSeVoiceNum)
 {
 	if(!pPlayer)
 	{
@@ -54,9 +54,7 @@ bool audio_player::init(const shared_ptr<sound::sound_player>& pPlayer, uint32_t
 	
 	eState_ = STATE_INIT;
 
-	nSeGcNum_		= nSeGcNum;
-	nSeGcFrame_		= nSeGcFrame;
-	nSeGcCounter_	= 0;
+	voiceMgr_.set_default_category_voice(nSeVoiceNum);
 
 	return true;
 }
@@ -67,11 +65,16 @@ bool audio_player::exec(bool bWait)
 	if(!pCtx_->player()->start_request(bWait)) return false;
 		pRoot_->exec(*pCtx_);
 	pCtx_->player()->end_request();
-	gc_se();
+	exec_se();
 
 	return pCtx_->player()->play(bWait);
 }
 
+void audio_player::set_fps(uint32_t nFPS)
+{
+	if(nFPS>0) pCtx_->set_frame_sec(1.0f/nFPS);
+}
+
 //////////////////////////////////
 // Load
 
@@ -234,13 +237,13 @@ bool audio_player::play_bgm(uint32_t nID, uint32_t nFade, change_mode eChangeMod
 				play_new_bgm(nID,0);
 			}
 			else
-			{// 再生中をフェードアウト
+			{// 再生中をフェードアウト。合計の音量が落ち込まないように等パワーで重ねる
 				sound::volume end;
 				end.set_per(0);
-				pPlayBgm->fade_volume(end,nFade);
+				pPlayBgm->fade_volume(end,nFade,sound::gain_envelope::CURVE_EQUAL_POWER);
 
 				// 新しいBGMを再生開始
-				play_new_bgm(nID,nFade);
+				play_new_bgm(nID,nFade,sound::gain_envelope::CURVE_EQUAL_POWER);
 
 				eBgmState_ = BGM_CROSS_STOP;
 			}
@@ -326,7 +329,7 @@ bool audio_player::is_playing_bgm()const
 	return playing_bgm()->sound_event()==sound::EV_PLAY;
 }
 
-void audio_player::play_new_bgm(uint32_t nID, uint32_t nFade)
+void audio_player::play_new_bgm(uint32_t nID, uint32_t nFade, sound::gain_envelope::curve eCurve)
 {
 	nBgmIndex_^=1;
 	audio* pPlayBgm = playing_bgm();
@@ -341,7 +344,7 @@ void audio_player::play_new_bgm(uint32_t nID, uint32_t nFade)
 		sound::volume start,end;
 		start.set_per(0);
 		end.set_per(100);
-		pPlayBgm->fade_volume(start,end,nFade);
+		pPlayBgm->fade_volume(start,end,nFade,eCurve);
 	}
 	else
 	{
@@ -370,91 +373,187 @@ audio* audio_player::playing_past_bgm()
 
 ///////////////////////////////
 // se
-void audio_player::gc_se()
+void audio_player::exec_se()
 {
-	// GCカウント
-	if(nSeGcCounter_++ > nSeGcFrame_)
-	{
-		nSeGcCounter_ = 0;
+	voiceMgr_.tick();
 
-		// GCをする個数以下だったらここで終了
-		if(pSeRoot_->count_children()<nSeGcNum_) return;
-
-		// GC開始
-		list<uint32_t> removeChildren;
-		// LRUフラグチェック
-		for(auto child : pSeRoot_->children())
+	list<uint32_t> removeVoices;
+	for(auto pSE : pSeRoot_->children())
+	{
+		for(auto pVoice : pSE->children())
 		{
-			if(child->is_lru_flag())
-				child->reset_lru_flag();
+			uint32_t nVoiceID = pVoice->id();
+
+			if(!voiceMgr_.is_voice(nVoiceID))
+			{// 奪われたボイス。止める命令は送ってあるので外すだけ
+				removeVoices.push_back(nVoiceID);
+			}
+			else if(pVoice->is_play_wait())
+			{// 再生が始まらないまま待ちすぎたら諦める
+				if(voiceMgr_.voice_frame(nVoiceID)>VOICE_WAIT_FRAME)
+				{
+					logger::warnln("[audio_player]SEの再生が始まらないのでボイスを解放します。: " + to_str(sound::voice_sound_id(nVoiceID)));
+					removeVoices.push_back(nVoiceID);
+				}
+			}
 			else
-				removeChildren.push_back(child->id());
+			{// 鳴り終わったらすぐに解放する
+				sound::play_event e = pVoice->sound_event();
+				if(e==sound::EV_STOP || e==sound::EV_END)
+					removeVoices.push_back(nVoiceID);
+			}
 		}
+	}
 
-		// 削除対象を削除
-		for(auto rc : removeChildren)
-			pSeRoot_->remove_child(rc, true);
+	for(auto rv : removeVoices)
+	{
+		voiceMgr_.release(rv);
+		pSeRoot_->child(sound::voice_sound_id(rv))->remove_child(rv, true);
 	}
 }
 
-void audio_player::play_se(uint32_t nID, bool bLoop, bool bForce)
+audio* audio_player::se(uint32_t nID)
 {
 	audio* pSE = pSeRoot_->child(nID);
 	if(!pSE)
 	{
-		pSE = new audio();
-		pSE->set_sound_id(nID);
+		pSE = new_ audio();
 		pSeRoot_->add_child(pSE, nID);
 		pSE->init();
 	}
 
-	pSE->play(bLoop);
+	return pSE;
+}
+
+audio* audio_player::se_voice(uint32_t nVoiceID)
+{
+	audio* pSE = pSeRoot_->child(sound::voice_sound_id(nVoiceID));
+	return pSE ? pSE->child(nVoiceID) : nullptr;
+}
+
+void audio_player::stop_se_voice(audio* pSE)
+{
+	list<uint32_t> removeVoices;
+	for(auto pVoice : pSE->children())
+	{
+		if(pVoice->sound_event()==sound::EV_PAUSE && !pVoice->is_play_wait())
+		{// ポーズ中はサウンド側で止まらないので、ここで解放する
+			removeVoices.push_back(pVoice->id());
+		}
+		else
+		{
+			pVoice->stop();
+		}
+	}
+
+	for(auto rv : removeVoices)
+	{
+		voiceMgr_.release(rv);
+		pSE->remove_child(rv, true);
+	}
+}
+
+bool audio_player::play_se(uint32_t nID, bool bLoop, bool bForce)
+{
+	if(nID==0) return false;
+
+	audio* pSE = se(nID);
+
+	if(!bForce)
+	{// 鳴っているボイスがあるなら、それを再生する(ポーズ解除)
+		bool bPlay = false;
+		for(auto pVoice : pSE->children())
+		{
+			if(!voiceMgr_.is_voice(pVoice->id())) continue; // 奪われて止めているところ
+
+			pVoice->play(bLoop);
+			bPlay = true;
+		}
+
+		if(bPlay) return true;
+	}
+
+	voice_manager::alloc_result r = voiceMgr_.allocate(nID);
+	if(!r.bAlloc_)
+	{
+		logger::debugln("[audio_player]同時発音数の上限なので鳴らしません。: " + to_str(nID));
+		return false;
+	}
+
+	if(r.nStealVoiceID_>0 && r.nStealVoiceID_!=r.nVoiceID_)
+	{// 奪ったボイスを止める
+		audio* pSteal = se_voice(r.nStealVoiceID_);
+		if(pSteal) pSteal->stop();
+	}
+
+	audio* pVoice = pSE->child(r.nVoiceID_);
+	if(!pVoice)
+	{
+		pVoice = new_ audio(0);
+		pVoice->set_sound_id(r.nVoiceID_);
+		pSE->add_child(pVoice, r.nVoiceID_);
+		pVoice->init();
+	}
+	else
+	{// 同じボイスなら最初から再生し直す
+		pVoice->set_pos(0.0f);
+	}
+
+	// SEのまとめがフェード中なら、残りのフェードをボイスにも掛ける
+	pVoice->follow_parent_fade();
+	pVoice->play(bLoop);
 
-	// 再生強制フラグが立ってるなら再生位置を最初に戻す
-	if(bForce) pSE->set_pos(0);
+	return true;
 }
 
 void audio_player::stop_se(uint32_t nID)
 {
 	audio* pSE = pSeRoot_->child(nID);
-	if(pSE) pSE->stop();
+	if(pSE) stop_se_voice(pSE);
 }
 
 void audio_player::pause_se(uint32_t nID)
 {
 	audio* pSE = pSeRoot_->child(nID);
-	if(pSE) pSE->pause();
+	if(pSE)
+	{
+		for(auto pVoice : pSE->children())
+			pVoice->pause();
+	}
 }
 
 void audio_player::set_se_volume(uint32_t nID, const sound::volume& vol)
 {
-	audio* pSE = pSeRoot_->child(nID);
-	if(pSE) pSE->set_volume(vol);
+	if(nID>0) se(nID)->set_volume(vol);
 }
 
 void audio_player::fade_se_volume(uint32_t nID, const sound::volume& start, const sound::volume& end, int32_t nFadeFrame)
 {
-	audio* pSE = pSeRoot_->child(nID);
-	if(pSE) pSE->fade_volume(start, end, nFadeFrame);
+	if(nID>0) se(nID)->fade_volume(start, end, nFadeFrame);
 }
 
 void audio_player::fade_se_volume(uint32_t nID, const sound::volume& end, int32_t nFadeFrame)
 {
-	audio* pSE = pSeRoot_->child(nID);
-	if(pSE) pSE->fade_volume(end, nFadeFrame);
+	if(nID>0) se(nID)->fade_volume(end, nFadeFrame);
 }
 
 bool audio_player::is_playing_se(uint32_t nID)const
 {
-	audio* pSE = pSeRoot_->child(nID);
-	if(pSE) return pSE->sound_event()==sound::EV_PLAY;
+	const audio* pSE = pSeRoot_->child(nID);
+	if(pSE)
+	{
+		for(auto pVoice : pSE->children())
+		{
+			if(pVoice->sound_event()==sound::EV_PLAY) return true;
+		}
+	}
 	return false;
 }
 
 void audio_player::stop_se_all()
 {
-	for(auto child : pSeRoot_->children())
-		child->stop();
+	for(auto pSE : pSeRoot_->children())
+		stop_se_voice(pSE);
 }
 
 void audio_player::set_se_master_volume(const sound::volume& vol)
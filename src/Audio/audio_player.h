@@ -1,6 +1,9 @@
 ﻿#pragma once
 
+#include "../Sound/gain_envelope.h"
+
 #include "audio_util.h"
+#include "voice_manager.h"
 
 namespace mana{
 
@@ -18,13 +21,16 @@ class audio_context;
 /*! @brief audioプレイヤー。音データや再生状態を管理するフロントエンドクラス
  *
  *  sound_playerの呼び出しも担う。
- *  このクラスを介して音を扱うと良い */
+ *  このクラスを介して音を扱うと良い
+ *
+ *  SEはサウンドIDごとのaudioの下に、ボイスごとのaudioを持つ。
+ *  同時発音数はvoice_managerで管理し、鳴り終わったボイスはすぐに解放する */
 class audio_player
 {
 public:
 	enum player_const{
-		SE_GC_NUM	= 20,	//!< SEオブジェクトGCをかけ始めるSEオブジェクト数
-		SE_GC_FRAME	= 601,	//!< SEオブジェクトのGC間隔(フレーム数)
+		SE_VOICE_NUM	= voice_manager::DEFAULT_CATEGORY_VOICE,	//!< SEのカテゴリごとの同時発音数のデフォルト値
+		VOICE_WAIT_FRAME= 120,	//!< ボイスの再生が始まるのを待つ最大フレーム数。越えると解放する
 	};
 
 	enum player_state{
@@ -53,8 +59,9 @@ public:
 	~audio_player();
 
 	//! @brief 初期化
-	/*! @param[in] pPlaeyr 初期済みのsound_playerインスタンスを渡すこと */
-	bool init(const shared_ptr<sound::sound_player>& pPlayer, uint32_t nGcFrame=SE_GC_FRAME, uint32_t nSeGcNum=SE_GC_NUM);
+	/*! @param[in] pPlaeyr 初期済みのsound_playerインスタンスを渡すこと
+	 *  @param[in] nSeVoiceNum SEのカテゴリごとの同時発音数。set_se_category_voiceで設定していないカテゴリに使われる */
+	bool init(const shared_ptr<sound::sound_player>& pPlayer, uint32_t nSeVoiceNum=SE_VOICE_NUM);
 
 	//! @brief オーディオプレイヤー実行。毎フレーム呼ぶこと
 	bool exec(bool bWait=true);
@@ -67,6 +74,10 @@ public:
 
 	player_state state()const{ return eState_; }
 
+	//! @brief execを呼ぶ頻度を設定する。デフォルトは60
+	/*! フェード時間(フレーム数)を秒に直すのに使う */
+	void set_fps(uint32_t nFPS);
+
 public:
 	//! 全体のボリューム設定
 	void set_master_volume(const sound::volume& vol);
@@ -105,10 +116,12 @@ public:
 	//! @brief SEを再生する
 	/*! @param[in] sID SE ID
 	 *  @param[in] bLoop ループ再生するならtrue
-	 *  @param[in] bForce trueだったら、すでに再生中だったら最初から再生し直す
-	 *					  flaseだったら、すでに再生中だったら再生されない */
-	void play_se(const string& sID, bool bLoop=false, bool bForce=false){ play_se(sound_id(sID), bLoop, bForce); }
-	void play_se(uint32_t nID, bool bLoop=false, bool bForce=false);
+	 *  @param[in] bForce trueだったら、新しいボイスで最初から再生する。
+	 *					  最大インスタンス数が1の時は、再生中のものを最初から再生し直すことになる
+	 *					  flaseだったら、すでに再生中だったら再生されない
+	 *  @return 同時発音数の上限で鳴らせなかった時はfalse */
+	bool play_se(const string& sID, bool bLoop=false, bool bForce=false){ return play_se(sound_id(sID), bLoop, bForce); }
+	bool play_se(uint32_t nID, bool bLoop=false, bool bForce=false);
 	//! 再生中のSEを止める
 	void stop_se(const string& sID){ stop_se(sound_id(sID)); }
 	void stop_se(uint32_t nID);
@@ -124,10 +137,21 @@ public:
 	void fade_se_volume(const string& sID, const sound::volume& end, int32_t nFadeFrame){ fade_se_volume(sound_id(sID), end, nFadeFrame);  }
 	void fade_se_volume(uint32_t nID, const sound::volume& end, int32_t nFadeFrame);
 
-	//! SEが再生中かどうか
+	//! SEが再生中かどうか。どれか1つのボイスが再生中ならtrue
 	bool is_playing_se(const string& sID){ return is_playing_se(sound_id(sID)); }
 	bool is_playing_se(uint32_t nID)const;
 
+	//! @brief SEの同時発音の設定
+	/*! @param[in] nMaxInstance 同時に鳴らせる数
+	 *  @param[in] nCategory カテゴリ。カテゴリごとに同時発音数の上限がある
+	 *  @param[in] nPriority 優先度。カテゴリの上限に達した時、低いものから止められる */
+	void set_se_voice(const string& sID, uint32_t nMaxInstance, uint32_t nCategory=0, uint32_t nPriority=0){ set_se_voice(sound_id(sID), nMaxInstance, nCategory, nPriority); }
+	void set_se_voice(uint32_t nID, uint32_t nMaxInstance, uint32_t nCategory=0, uint32_t nPriority=0){ voiceMgr_.set_rule(nID, nMaxInstance, nCategory, nPriority); }
+	//! SEのカテゴリの同時発音数を設定する
+	void set_se_category_voice(uint32_t nCategory, uint32_t nMaxVoice){ voiceMgr_.set_category_voice(nCategory, nMaxVoice); }
+	//! 鳴っているSEのボイス数
+	uint32_t count_se_voice()const{ return voiceMgr_.count_voice(); }
+
 	//! 再生しているすべてのSEを停止する
 	void stop_se_all();
 
@@ -151,10 +175,16 @@ private:
 	audio*			playing_past_bgm();
 	//! @brief bgmを新しく再生する
 	/*! BGMインデックスを入れ替える。nIDが0の時はサウンドIDをセットしない */
-	void			play_new_bgm(uint32_t nID, uint32_t nFade);
+	void			play_new_bgm(uint32_t nID, uint32_t nFade, sound::gain_envelope::curve eCurve=sound::gain_envelope::CURVE_LINEAR);
 
-	//! SEのGC処理
-	void			gc_se();
+	//! SEのサウンドIDごとのaudio。無かったら作る
+	audio*			se(uint32_t nID);
+	//! SEのボイスのaudio
+	audio*			se_voice(uint32_t nVoiceID);
+	//! pSEのボイスを全部止める
+	void			stop_se_voice(audio* pSE);
+	//! 鳴り終わったボイスを解放する
+	void			exec_se();
 
 private:
 	player_state			eState_;
@@ -187,10 +217,8 @@ private:
 	// seルート
 	audio* pSeRoot_;
 
-	// se gc
-	uint32_t nSeGcNum_;		//!< GCをかけ始めるオブジェクト数
-	uint32_t nSeGcFrame_;	//!< GC間隔
-	uint32_t nSeGcCounter_;
+	// ボイス管理
+	voice_manager voiceMgr_;
 
 #ifdef MANA_DEBUG
 public:
@@ -16,6 +16,7 @@ enum param_flag : uint32_t
 	PARAM_PAUSE		=	1<<4,
 	PARAM_PLAY		=	1<<5,
 	PARAM_HANDLER	=	1<<6,
+	PARAM_FADE		=	1<<7,	//!< フェード開始。サウンド側でサンプル単位でフェードさせる
 };
 
 // BGMの入れ替え指定
@@ -0,0 +1,171 @@
+﻿#include "../mana_common.h"
+
+#include "../Sound/sound_util.h"
+
+#include "voice_manager.h"
+
+namespace mana{
+namespace audio{
+
+void voice_manager::fin()
+{
+#ifdef MANA_VOICE_MANAGER_COUNT
+	logger::infoln("[voice_manager]割り当て数 : " + to_str_s(nAllocCount_) + "奪った数 : " + to_str_s(nStealCount_) + "鳴らせなかった数 : " + to_str(nRejectCount_));
+#endif
+
+	clear();
+}
+
+void voice_manager::set_rule(uint32_t nSoundID, uint32_t nMaxInstance, uint32_t nCategory, uint32_t nPriority)
+{
+	sound_rule& r = hashRule_[nSoundID];
+	r.nMaxInstance_	= std::min<uint32_t>(nMaxInstance, sound::VOICE_MAX_NUM);
+	r.nCategory_	= nCategory;
+	r.nPriority_	= nPriority;
+}
+
+const voice_manager::sound_rule& voice_manager::rule(uint32_t nSoundID)const
+{
+	auto it = hashRule_.find(nSoundID);
+	return it!=hashRule_.end() ? it->second : defaultRule_;
+}
+
+uint32_t voice_manager::category_voice(uint32_t nCategory)const
+{
+	auto it = hashCategoryVoice_.find(nCategory);
+	return it!=hashCategoryVoice_.end() ? it->second : nDefaultCategoryVoice_;
+}
+
+voice_manager::alloc_result voice_manager::allocate(uint32_t nSoundID)
+{
+	alloc_result result;
+
+	const sound_rule& r = rule(nSoundID);
+	if(r.nMaxInstance_==0 || category_voice(r.nCategory_)==0)
+	{
+	#ifdef MANA_VOICE_MANAGER_COUNT
+		++nRejectCount_;
+	#endif
+		return result;
+	}
+
+	// 奪うボイスを探す
+	auto steal = vecVoice_.end();
+	if(count_instance(nSoundID)>=r.nMaxInstance_)
+	{// 同じサウンドで一番古いもの
+		for(auto it=vecVoice_.begin(); it!=vecVoice_.end(); ++it)
+		{
+			if(it->nSoundID_==nSoundID
+			&& (steal==vecVoice_.end() || it->nSerial_<steal->nSerial_))
+				steal = it;
+		}
+	}
+	else if(count_category(r.nCategory_)>=category_voice(r.nCategory_))
+	{// カテゴリ内で優先度が一番低く、その中で一番古いもの
+		for(auto it=vecVoice_.begin(); it!=vecVoice_.end(); ++it)
+		{
+			if(it->nCategory_!=r.nCategory_) continue;
+
+			if(steal==vecVoice_.end()
+			|| it->nPriority_<steal->nPriority_
+			|| (it->nPriority_==steal->nPriority_ && it->nSerial_<steal->nSerial_))
+				steal = it;
+		}
+
+		if(steal!=vecVoice_.end() && steal->nPriority_>r.nPriority_)
+		{// 鳴っている方が大事
+		#ifdef MANA_VOICE_MANAGER_COUNT
+			++nRejectCount_;
+		#endif
+			return result;
+		}
+	}
+
+	if(steal!=vecVoice_.end())
+	{
+		result.nStealVoiceID_ = steal->nVoiceID_;
+		vecVoice_.erase(steal);
+
+	#ifdef MANA_VOICE_MANAGER_COUNT
+		++nStealCount_;
+	#endif
+	}
+
+	uint32_t nVoiceNo = free_voice_no(nSoundID, r.nMaxInstance_);
+	if(nVoiceNo>=r.nMaxInstance_)
+	{
+	#ifdef MANA_VOICE_MANAGER_COUNT
+		++nRejectCount_;
+	#endif
+		return result;
+	}
+
+	voice v;
+	v.nVoiceID_		= sound::voice_id(nSoundID, nVoiceNo);
+	v.nSoundID_		= nSoundID;
+	v.nCategory_	= r.nCategory_;
+	v.nPriority_	= r.nPriority_;
+	v.nSerial_		= nSerial_++;
+	v.nFrame_		= nFrame_;
+	vecVoice_.emplace_back(v);
+
+	result.bAlloc_		= true;
+	result.nVoiceID_	= v.nVoiceID_;
+
+#ifdef MANA_VOICE_MANAGER_COUNT
+	++nAllocCount_;
+#endif
+
+	return result;
+}
+
+bool voice_manager::release(uint32_t nVoiceID)
+{
+	auto it = find(nVoiceID);
+	if(it==vecVoice_.end()) return false;
+
+	vecVoice_.erase(it);
+	return true;
+}
+
+bool voice_manager::is_voice(uint32_t nVoiceID)const
+{
+	return find(nVoiceID)!=vecVoice_.end();
+}
+
+uint32_t voice_manager::voice_frame(uint32_t nVoiceID)const
+{
+	auto it = find(nVoiceID);
+	if(it==vecVoice_.end()) return 0;
+
+	return nFrame_ - it->nFrame_;
+}
+
+uint32_t voice_manager::count_instance(uint32_t nSoundID)const
+{
+	return static_cast<uint32_t>(std::count_if(vecVoice_.begin(), vecVoice_.end(), [nSoundID](const voice& v){ return v.nSoundID_==nSoundID; }));
+}
+
+uint32_t voice_manager::count_category(uint32_t nCategory)const
+{
+	return static_cast<uint32_t>(std::count_if(vecVoice_.begin(), vecVoice_.end(), [nCategory](const voice& v){ return v.nCategory_==nCategory; }));
+}
+
+voice_manager::voice_vector::const_iterator voice_manager::find(uint32_t nVoiceID)const
+{
+	return std::find_if(vecVoice_.begin(), vecVoice_.end(), [nVoiceID](const voice& v){ return v.nVoiceID_==nVoiceID; });
+}
+
+uint32_t voice_manager::free_voice_no(uint32_t nSoundID, uint32_t nMaxInstance)const
+{
+	for(uint32_t i=0; i<nMaxInstance; ++i)
+	{
+		if(find(sound::voice_id(nSoundID, i))==vecVoice_.end())
+			return i;
+	}
+
+	return nMaxInstance;
+}
+
+} // namespace audio end
+} // namespace mana end
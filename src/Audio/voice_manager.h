@@ -0,0 +1,175 @@
+﻿#pragma once
+
+#ifdef MANA_DEBUG
+#define MANA_VOICE_MANAGER_COUNT
+#endif
+
+namespace mana{
+namespace audio{
+
+/*! @brief SEのボイス管理
+ *
+ *  同じサウンドを重ねて鳴らす時に、どのボイスを使うかを決める。
+ *  サウンドごとに最大インスタンス数・カテゴリ・優先度を設定でき、
+ *  カテゴリごとに同時発音数の上限がある。
+ *
+ *  上限に達している時は、
+ *  　サウンドの上限 : そのサウンドで一番古いボイスを奪う
+ *  　カテゴリの上限 : カテゴリ内で優先度が一番低く、その中で一番古いボイスを奪う。
+ *  　                 奪えるボイスが新しいボイスより優先度が高い時は鳴らさない
+ *  古さは割り当てた順番で決まるので、同じ順番で呼べば必ず同じ結果になる
+ *
+ *  割り当てと解放を記録するだけでサウンドには触らないので、
+ *  奪われたボイスを止めたり、鳴り終わったボイスを解放するのは呼び出し側で行うこと */
+class voice_manager
+{
+public:
+	enum voice_const : uint32_t
+	{
+		DEFAULT_MAX_INSTANCE	= 1,	//!< サウンドごとの最大インスタンス数のデフォルト値
+		DEFAULT_CATEGORY_VOICE	= 16,	//!< カテゴリごとの同時発音数のデフォルト値
+	};
+
+	//! サウンドごとの設定
+	struct sound_rule
+	{
+	public:
+		sound_rule():nMaxInstance_(DEFAULT_MAX_INSTANCE),nCategory_(0),nPriority_(0){}
+
+	public:
+		uint32_t nMaxInstance_;	//!< 同時に鳴らせる数
+		uint32_t nCategory_;	//!< カテゴリ
+		uint32_t nPriority_;	//!< 優先度。大きいほど奪われにくい
+	};
+
+	//! allocateの結果
+	struct alloc_result
+	{
+	public:
+		alloc_result():bAlloc_(false),nVoiceID_(0),nStealVoiceID_(0){}
+
+	public:
+		bool		bAlloc_;		//!< falseだと上限に達していて鳴らせない
+		uint32_t	nVoiceID_;		//!< 割り当てたボイスID(sound::voice_id)
+		uint32_t	nStealVoiceID_;	//!< 奪ったボイスID。0だと奪っていない。nVoiceID_と同じ時は同じボイスを鳴らし直す
+	};
+
+public:
+	voice_manager():nDefaultCategoryVoice_(DEFAULT_CATEGORY_VOICE),nSerial_(0),nFrame_(0)
+	{
+#ifdef MANA_VOICE_MANAGER_COUNT
+		nAllocCount_=0;
+		nStealCount_=0;
+		nRejectCount_=0;
+#endif
+	}
+	~voice_manager(){ fin(); }
+
+	//! 終了処理
+	void fin();
+
+	//! @brief サウンドごとの設定
+	/*! 設定していないサウンドは、最大インスタンス数1・カテゴリ0・優先度0になる
+	 *  @param[in] nMaxInstance 同時に鳴らせる数。0だと鳴らさない */
+	void				set_rule(uint32_t nSoundID, uint32_t nMaxInstance, uint32_t nCategory=0, uint32_t nPriority=0);
+	const sound_rule&	rule(uint32_t nSoundID)const;
+
+	//! カテゴリの同時発音数を設定する。0にするとそのカテゴリは鳴らなくなる
+	void		set_category_voice(uint32_t nCategory, uint32_t nMaxVoice){ hashCategoryVoice_[nCategory]=nMaxVoice; }
+	uint32_t	category_voice(uint32_t nCategory)const;
+	//! 設定していないカテゴリの同時発音数
+	void		set_default_category_voice(uint32_t nMaxVoice){ nDefaultCategoryVoice_=nMaxVoice; }
+
+	//! @brief ボイスを割り当てる
+	/*! 上限に達していたら、ボイスを奪って割り当てる */
+	alloc_result	allocate(uint32_t nSoundID);
+
+	//! ボイスを解放する。割り当てられていなければfalse
+	bool			release(uint32_t nVoiceID);
+
+	//! 全部解放する
+	void			clear(){ vecVoice_.clear(); }
+
+	//! フレームを進める。割り当ててからの経過フレームに使う
+	void			tick(){ ++nFrame_; }
+
+	//! 割り当て中のボイスか
+	bool			is_voice(uint32_t nVoiceID)const;
+	//! 割り当ててからの経過フレーム数。割り当てられていなければ0
+	uint32_t		voice_frame(uint32_t nVoiceID)const;
+
+	uint32_t		count_voice()const{ return vecVoice_.size(); }
+	uint32_t		count_instance(uint32_t nSoundID)const;
+	uint32_t		count_category(uint32_t nCategory)const;
+
+private:
+	struct voice
+	{
+		uint32_t	nVoiceID_;
+		uint32_t	nSoundID_;
+		uint32_t	nCategory_;
+		uint32_t	nPriority_;
+		uint64_t	nSerial_;	//!< 割り当てた順番。小さいほど古い
+		uint32_t	nFrame_;	//!< 割り当てたフレーム
+	};
+
+	typedef vector<voice> voice_vector;
+
+	voice_vector::const_iterator	find(uint32_t nVoiceID)const;
+
+	//! nSoundIDの空いているボイス番号で一番小さいもの。空いてなければnMaxInstance
+	uint32_t	free_voice_no(uint32_t nSoundID, uint32_t nMaxInstance)const;
+
+private:
+	//! 割り当て中のボイス。同時発音数分しか無いので線形に探す
+	voice_vector						vecVoice_;
+
+	unordered_map<uint32_t, sound_rule>	hashRule_;
+	sound_rule							defaultRule_;
+
+	unordered_map<uint32_t, uint32_t>	hashCategoryVoice_;
+	uint32_t							nDefaultCategoryVoice_;
+
+	uint64_t							nSerial_;
+	uint32_t							nFrame_;
+
+#ifdef MANA_VOICE_MANAGER_COUNT
+public:
+	//! 割り当てた数
+	uint32_t	alloc_count()const{ return nAllocCount_; }
+	//! ボイスを奪った数
+	uint32_t	steal_count()const{ return nStealCount_; }
+	//! 上限で鳴らせなかった数
+	uint32_t	reject_count()const{ return nRejectCount_; }
+
+private:
+	uint32_t	nAllocCount_;
+	uint32_t	nStealCount_;
+	uint32_t	nRejectCount_;
+#endif
+
+private:
+	NON_COPIABLE(voice_manager);
+};
+
+} // namespace audio end
+} // namespace mana end
+
+/*
+	audio::voice_manager mgr;
+	mgr.set_rule(nShotID, 3, 1, 0);	// 弾の音は3つまで。カテゴリ1、優先度0
+	mgr.set_rule(nVoiceID, 1, 1, 10);	// ボイスは優先度10
+	mgr.set_category_voice(1, 4);		// カテゴリ1は4つまで
+
+	auto r = mgr.allocate(nShotID);
+	if(r.bAlloc_)
+	{
+		if(r.nStealVoiceID_>0 && r.nStealVoiceID_!=r.nVoiceID_)
+			stop(r.nStealVoiceID_);	// 奪ったボイスを止める
+
+		play(r.nVoiceID_);
+	}
+
+	// 鳴り終わったら
+	mgr.release(r.nVoiceID_);
+ */
@@ -0,0 +1,261 @@
+﻿#pragma once
+
+#ifdef MANA_DEBUG
+#define MANA_CMD_STREAM_COUNT
+#endif
+
+namespace mana{
+namespace concurrent{
+
+/*! @brief PODコマンドを連続したバイト列に積むストリーム
+ *
+ *  コマンドはヘッダ＋本体＋可変長の追加データとして、1つのバッファに詰めて書き込まれる。
+ *  variantのようなコンストラクタ/デストラクタ呼び出しやヒープ確保が無いため、
+ *  毎フレーム大量に積まれるコマンドに向いている
+ *
+ *  積めるのはmemcpyでコピーしてよい型のみ。
+ *  文字列などは、追加データとしてコマンドの後ろにコピーする
+ *
+ *  バッファは足りなくなった時だけ拡張される。clearしても縮まないので
+ *  数フレーム回すと以降は確保が起きない
+ *
+ *  スレッド間の受け渡しは、このストリームを2つ持って入れ替えることで行う。
+ *  ロックはストリーム単位で行い、コマンド単位のロックはしないこと
+ *
+ *  積まれたバイト数や拡張回数をカウントする時は、
+ *  MANA_CMD_STREAM_COUNTをdefineする
+ */
+class cmd_stream
+{
+public:
+	enum cmd_stream_const : uint32_t
+	{
+		ALIGN = 8,
+	};
+
+	//! コマンドヘッダ
+	struct header
+	{
+		uint16_t nType_;	 //!< コマンド種別
+		uint16_t nCmdSize_;	 //!< コマンド本体のサイズ
+		uint32_t nSize_;	 //!< ヘッダ含めたレコード全体のサイズ
+		uint32_t nExtSize_;	 //!< 追加データのサイズ
+		uint32_t nPadding_;
+	};
+
+	/*! @brief ストリームを先頭から読むクラス
+	 *
+	 *  while(r.next()){ switch(r.type()){ ... } } のように使う */
+	class reader
+	{
+	public:
+		reader(const cmd_stream& stream):pCur_(nullptr),pNext_(stream.pBuf_),pEnd_(stream.pBuf_+stream.nSize_){}
+
+		//! 次のコマンドに進む。もう無ければfalse
+		bool next()
+		{
+			if(pNext_>=pEnd_) return false;
+			pCur_  = pNext_;
+			pNext_ = pCur_ + head().nSize_;
+			return true;
+		}
+
+		uint16_t type()const{ return head().nType_; }
+
+		template<class T>
+		T&		 get()const{ return *reinterpret_cast<T*>(const_cast<BYTE*>(pCur_)+sizeof(header)); }
+
+		//! 追加データ。無い時はnullptr
+		const void*	ext()const{ return head().nExtSize_>0 ? pCur_+sizeof(header)+align(head().nCmdSize_) : nullptr; }
+		uint32_t	ext_size()const{ return head().nExtSize_; }
+		//! 追加データを文字列として取得する。push_strで積んだ場合、終端付き
+		const char*	ext_str()const{ return static_cast<const char*>(ext()); }
+
+	private:
+		const header& head()const{ return *reinterpret_cast<const header*>(pCur_); }
+
+	private:
+		const BYTE* pCur_;
+		const BYTE* pNext_;
+		const BYTE* pEnd_;
+	};
+
+public:
+	cmd_stream():pBuf_(nullptr),nSize_(0),nCapacity_(0),nCmdNum_(0)
+	{
+#ifdef MANA_CMD_STREAM_COUNT
+		nMaxSize_=0; nMaxCmdNum_=0; nGrowCount_=0; nTotalSize_=0; nClearCount_=0;
+#endif
+	}
+
+	~cmd_stream()
+	{
+#ifdef MANA_CMD_STREAM_COUNT
+		if(!sMes_.empty()) logger::infoln("[cmd_stream]" + sMes_);
+		logger::infoln("[cmd_stream]最大バイト数 : " + to_str_s(nMaxSize_) + "最大コマンド数 : " + to_str_s(nMaxCmdNum_) + "拡張回数 : " + to_str(nGrowCount_));
+		if(nClearCount_>0) logger::infoln("[cmd_stream]1回あたりの平均バイト数 : " + to_str(nTotalSize_/nClearCount_));
+#endif
+		delete[] pBuf_;
+	}
+
+public:
+	//! @param[in] nReserveByte 予約するバイト数
+	void init(uint32_t nReserveByte=64*1024)
+	{
+		clear();
+		reserve(nReserveByte);
+	}
+
+	//! コマンドを積む
+	template<class T>
+	void push(uint16_t nType, const T& cmd){ push_inner(nType, &cmd, sizeof(T), nullptr, 0); }
+
+	//! 追加データ付きでコマンドを積む
+	template<class T>
+	void push(uint16_t nType, const T& cmd, const void* pExt, uint32_t nExtSize){ push_inner(nType, &cmd, sizeof(T), pExt, nExtSize); }
+
+	//! 文字列を追加データとしてコマンドを積む。文字列は終端付きでコピーされる
+	template<class T>
+	void push_str(uint16_t nType, const T& cmd, const string& sStr){ push_inner(nType, &cmd, sizeof(T), sStr.c_str(), sStr.size()+1); }
+
+	//! @brief 本体の無い、種別だけのコマンドを積む
+	/*! 別のキューに積んだコマンドの位置を、ストリーム中に残しておくのに使う */
+	void push_marker(uint16_t nType){ push_inner(nType, nullptr, 0, nullptr, 0); }
+
+	//! 別のストリームに積まれたコマンドを、まとめて後ろに積む
+	void append(const cmd_stream& other)
+	{
+		if(other.nSize_==0) return;
+
+		if(nSize_+other.nSize_>nCapacity_)
+		{
+			reserve((std::max)(nCapacity_*2, nSize_+other.nSize_));
+
+#ifdef MANA_CMD_STREAM_COUNT
+			++nGrowCount_;
+#endif
+		}
+
+		::memcpy(pBuf_+nSize_, other.pBuf_, other.nSize_);
+		nSize_	 += other.nSize_;
+		nCmdNum_ += other.nCmdNum_;
+	}
+
+	//! 積んだコマンドを全て破棄する。バッファは解放しない
+	void clear()
+	{
+#ifdef MANA_CMD_STREAM_COUNT
+		if(nSize_>nMaxSize_)	 nMaxSize_=nSize_;
+		if(nCmdNum_>nMaxCmdNum_) nMaxCmdNum_=nCmdNum_;
+		if(nSize_>0){ nTotalSize_+=nSize_; ++nClearCount_; }
+#endif
+		nSize_=0;
+		nCmdNum_=0;
+	}
+
+	bool		empty()const{ return nSize_==0; }
+	uint32_t	size()const{ return nSize_; }
+	uint32_t	cmd_num()const{ return nCmdNum_; }
+
+private:
+	static uint32_t align(uint32_t n){ return (n+(ALIGN-1)) & ~(ALIGN-1); }
+
+	void reserve(uint32_t nCapacity)
+	{
+		if(nCapacity<=nCapacity_) return;
+
+		BYTE* p = new_ BYTE[nCapacity];
+		if(pBuf_!=nullptr)
+		{
+			::memcpy(p, pBuf_, nSize_);
+			delete[] pBuf_;
+		}
+		pBuf_		= p;
+		nCapacity_	= nCapacity;
+	}
+
+	void push_inner(uint16_t nType, const void* pCmd, uint32_t nCmdSize, const void* pExt, uint32_t nExtSize)
+	{
+		uint32_t nRecSize = sizeof(header) + align(nCmdSize) + align(nExtSize);
+		if(nSize_+nRecSize>nCapacity_)
+		{
+			reserve((std::max)(nCapacity_*2, nSize_+nRecSize));
+
+#ifdef MANA_CMD_STREAM_COUNT
+			++nGrowCount_;
+#endif
+		}
+
+		BYTE* p = pBuf_+nSize_;
+
+		header& h	= *reinterpret_cast<header*>(p);
+		h.nType_	= nType;
+		h.nCmdSize_	= static_cast<uint16_t>(nCmdSize);
+		h.nSize_	= nRecSize;
+		h.nExtSize_	= nExtSize;
+		h.nPadding_	= 0;
+
+		p += sizeof(header);
+		if(nCmdSize>0)
+			::memcpy(p, pCmd, nCmdSize);
+
+		if(nExtSize>0)
+			::memcpy(p+align(nCmdSize), pExt, nExtSize);
+
+		nSize_ += nRecSize;
+		++nCmdNum_;
+	}
+
+private:
+	BYTE*		pBuf_;
+	uint32_t	nSize_;
+	uint32_t	nCapacity_;
+	uint32_t	nCmdNum_;
+
+#ifdef MANA_CMD_STREAM_COUNT
+public:
+	void		set_mes(const string& sMes){ sMes_=sMes; }
+	uint32_t	grow_count()const{ return nGrowCount_; }
+	//! clearされるまでに積まれたバイト数の最大値。1フレームごとにclearするなら、1フレームの最大転送量になる
+	uint32_t	max_size()const{ return nMaxSize_; }
+	uint64_t	total_size()const{ return nTotalSize_; }
+
+private:
+	uint32_t	nMaxSize_;
+	uint32_t	nMaxCmdNum_;
+	uint32_t	nGrowCount_;
+	uint64_t	nTotalSize_;	//!< clearまでに積まれたバイト数の合計
+	uint32_t	nClearCount_;	//!< 空でない状態でclearされた回数
+	string		sMes_;
+#endif
+
+private:
+	NON_COPIABLE(cmd_stream);
+};
+
+} // namespace concurrent end
+} // namespace mana end
+
+/* 使用例
+
+	enum{ CMD_A, CMD_B };
+
+	concurrent::cmd_stream stream;
+	stream.init();
+
+	cmd_a a;
+	stream.push(CMD_A, a);
+	stream.push_str(CMD_B, b, "文字列");
+
+	concurrent::cmd_stream::reader r(stream);
+	while(r.next())
+	{
+		switch(r.type())
+		{
+		case CMD_A: exec(r.get<cmd_a>()); break;
+		case CMD_B: exec(r.get<cmd_b>(), r.ext_str()); break;
+		}
+	}
+
+	stream.clear();
+*/
@@ -0,0 +1,120 @@
+﻿#include "../mana_common.h"
+
+#include "atlas_packer.h"
+
+namespace mana{
+namespace draw{
+
+void atlas_packer::init(uint32_t nWidth, uint32_t nHeight)
+{
+	nWidth_		= nWidth;
+	nHeight_	= nHeight;
+	nUseArea_	= 0;
+
+	vecSkyline_.clear();
+	vecSkyline_.reserve(64);
+
+	skyline s = { 0, 0, nWidth };
+	vecSkyline_.emplace_back(s);
+}
+
+bool atlas_packer::insert(uint32_t nWidth, uint32_t nHeight, uint32_t& nX, uint32_t& nY)
+{
+	if(nWidth==0 || nHeight==0) return false;
+
+	uint32_t nBestIndex		= UINT_MAX;
+	uint32_t nBestBottom	= UINT_MAX;
+	uint32_t nBestWidth		= UINT_MAX;
+
+	// 置いた後の下端が一番上になる位置。同じなら線分の幅が狭い方
+	for(uint32_t i=0; i<vecSkyline_.size(); ++i)
+	{
+		uint32_t y;
+		if(!fit(i, nWidth, nHeight, y)) continue;
+
+		if(y+nHeight<nBestBottom || (y+nHeight==nBestBottom && vecSkyline_[i].nWidth_<nBestWidth))
+		{
+			nBestIndex	= i;
+			nBestBottom	= y+nHeight;
+			nBestWidth	= vecSkyline_[i].nWidth_;
+			nX			= vecSkyline_[i].nX_;
+			nY			= y;
+		}
+	}
+
+	if(nBestIndex==UINT_MAX) return false;
+
+	add_skyline(nBestIndex, nX, nY, nWidth, nHeight);
+	nUseArea_ += nWidth*nHeight;
+
+	return true;
+}
+
+bool atlas_packer::fit(uint32_t nIndex, uint32_t nWidth, uint32_t nHeight, uint32_t& nY)const
+{
+	uint32_t nX = vecSkyline_[nIndex].nX_;
+	if(nX+nWidth>nWidth_) return false;
+
+	// 幅の分だけ線分をまたいで、一番高いところに合わせる
+	int32_t nWidthLeft = static_cast<int32_t>(nWidth);
+	nY = vecSkyline_[nIndex].nY_;
+
+	while(nWidthLeft>0)
+	{
+		if(nIndex>=vecSkyline_.size()) return false;
+
+		if(vecSkyline_[nIndex].nY_>nY) nY = vecSkyline_[nIndex].nY_;
+		if(nY+nHeight>nHeight_) return false;
+
+		nWidthLeft -= static_cast<int32_t>(vecSkyline_[nIndex].nWidth_);
+		++nIndex;
+	}
+
+	return true;
+}
+
+void atlas_packer::add_skyline(uint32_t nIndex, uint32_t nX, uint32_t nY, uint32_t nWidth, uint32_t nHeight)
+{
+	skyline s = { nX, nY+nHeight, nWidth };
+	vecSkyline_.insert(vecSkyline_.begin()+nIndex, s);
+
+	// 新しい線分の下に隠れた分を削る
+	for(uint32_t i=nIndex+1; i<vecSkyline_.size(); ++i)
+	{
+		skyline& prev = vecSkyline_[i-1];
+		skyline& cur  = vecSkyline_[i];
+
+		uint32_t nPrevRight = prev.nX_+prev.nWidth_;
+		if(cur.nX_>=nPrevRight) break;
+
+		uint32_t nShrink = nPrevRight-cur.nX_;
+		if(cur.nWidth_<=nShrink)
+		{
+			vecSkyline_.erase(vecSkyline_.begin()+i);
+			--i;
+		}
+		else
+		{
+			cur.nX_		+= nShrink;
+			cur.nWidth_ -= nShrink;
+			break;
+		}
+	}
+
+	// 同じ高さの線分をまとめる
+	for(uint32_t i=0; i+1<vecSkyline_.size(); )
+	{
+		if(vecSkyline_[i].nY_==vecSkyline_[i+1].nY_)
+		{
+			vecSkyline_[i].nWidth_ += vecSkyline_[i+1].nWidth_;
+			vecSkyline_.erase(vecSkyline_.begin()+i+1);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+} // namespace draw end
+} // namespace mana end
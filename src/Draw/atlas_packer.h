@@ -0,0 +1,71 @@
+﻿#pragma once
+
+namespace mana{
+namespace draw{
+
+/*! @brief 矩形をページに詰めるクラス
+ *
+ *  スカイライン法(Bottom-Left)で詰める。
+ *  ページの上端からの高さを線分の列として持ち、
+ *  置いた後の高さが一番低くなる位置に置いていく
+ *
+ *  高さの大きい順に入れると詰め効率が良くなる
+ */
+class atlas_packer
+{
+public:
+	atlas_packer():nWidth_(0),nHeight_(0),nUseArea_(0){}
+
+public:
+	//! ページサイズを指定して初期化
+	void		init(uint32_t nWidth, uint32_t nHeight);
+
+	//! @brief 矩形を詰める
+	/*! @param[out] nX,nY 置いた位置
+	 *  @retval false 入る場所が無かった */
+	bool		insert(uint32_t nWidth, uint32_t nHeight, uint32_t& nX, uint32_t& nY);
+
+	uint32_t	width()const{ return nWidth_; }
+	uint32_t	height()const{ return nHeight_; }
+
+	//! 詰めた矩形の総面積
+	uint32_t	use_area()const{ return nUseArea_; }
+	//! 詰め効率。0.0～1.0
+	float		occupancy()const{ return nWidth_*nHeight_>0 ? static_cast<float>(nUseArea_)/static_cast<float>(nWidth_*nHeight_) : 0.f; }
+
+private:
+	//! スカイラインの線分
+	struct skyline
+	{
+		uint32_t nX_, nY_, nWidth_;
+	};
+
+	//! @brief nIndexの線分から置けるか
+	/*! @param[out] nY 置ける時のY */
+	bool		fit(uint32_t nIndex, uint32_t nWidth, uint32_t nHeight, uint32_t& nY)const;
+
+	//! 置いた矩形でスカイラインを更新する
+	void		add_skyline(uint32_t nIndex, uint32_t nX, uint32_t nY, uint32_t nWidth, uint32_t nHeight);
+
+private:
+	vector<skyline>	vecSkyline_;
+
+	uint32_t		nWidth_;
+	uint32_t		nHeight_;
+	uint32_t		nUseArea_;
+};
+
+} // namespace draw end
+} // namespace mana end
+
+/* 使用例
+
+	draw::atlas_packer packer;
+	packer.init(1024, 1024);
+
+	uint32_t x,y;
+	if(packer.insert(64, 32, x, y))
+	{
+		// (x,y)-(x+64,y+32)に置く
+	}
+*/
@@ -102,7 +102,8 @@ public:
 	//! @{
 	bool	add_render_target(const string& sID, uint32_t nPriority, uint32_t nReserveSpriteCmdNum=32);
 	bool	add_render_target(uint32_t nID, uint32_t nPriority, uint32_t nReserveSpriteCmdNum=32);
-	bool	draw_sprite(const sprite_param& cmd, uint32_t nRenderTarget=cmd::BACK_BUFFER_ID){ return render_cmd_queue().add_cmd(cmd, nRenderTarget); }
+	//! アトラスに詰められたテクスチャは、ページのテクスチャとUVに付け替えて積む
+	bool	draw_sprite(const sprite_param& cmd, uint32_t nRenderTarget=cmd::BACK_BUFFER_ID);
 	//! @}
 
 public:
@@ -117,6 +118,7 @@ public:
 
 	//! テキスト描画
 	bool	draw_text(struct cmd::text_draw_cmd& cmd){ return renderText_.draw_text(render_cmd_queue(), cmd); }
+	bool	draw_text(const struct cmd::text_stream_cmd& cmd, const char* szExt){ return renderText_.draw_text(render_cmd_queue(), cmd, szExt); }
 	//! @}
 
 public:
@@ -135,6 +135,10 @@ bool d3d9_renderer_2d::init_inner(renderer_2d_init& param)
 
 	// テクスチャ関係初期化
 	texManager_.init(pDriver_, param.nReserveTextureNum_, param.nTextureMaxVRAM_);
+	if(param.nTextureLoadThreadNum_>0)
+		texManager_.init_async(param.nTextureLoadThreadNum_, param.nTextureUploadByte_);
+	else
+		texManager_.set_upload_budget(param.nTextureUploadByte_);
 	// テキスト関係初期化
 	renderText_.init(param.nReserveFontNum_);
 	// 最後にレンダーの初期化
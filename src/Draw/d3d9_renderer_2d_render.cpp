@@ -80,6 +80,10 @@ bool d3d9_renderer_2d::render()
 
 	HRESULT r;
 
+	// フレームを進めて、読み終わったテクスチャや先読み対象を生成する。UV計算より前に済ませておく
+	texManager_.next_frame();
+	texManager_.update_upload();
+
 	// コマンドソート
 	renderQueue_.sort_cmd();
 
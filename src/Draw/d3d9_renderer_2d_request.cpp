@@ -22,6 +22,24 @@ bool d3d9_renderer_2d::add_render_target(uint32_t nID, uint32_t nPriority, uint3
 	return render_cmd_queue().add_cmd(nID, nPriority, nReserveSpriteCmdNum);
 }
 
+bool d3d9_renderer_2d::draw_sprite(const sprite_param& cmd, uint32_t nRenderTarget)
+{
+	uint32_t nPageID, nX, nY;
+	if(!texManager_.atlas_location(cmd.nTextureID_, nPageID, nX, nY))
+		return render_cmd_queue().add_cmd(cmd, nRenderTarget);
+
+	// ページ内の位置にずらす。ページが同じスプライトは同じDrawCallにまとまる
+	sprite_param sp = cmd;
+	sp.nTextureID_ = nPageID;
+	for(auto& it : sp.uv_)
+	{
+		it.fU += static_cast<float>(nX);
+		it.fV += static_cast<float>(nY);
+	}
+
+	return render_cmd_queue().add_cmd(sp, nRenderTarget);
+}
+
 
 ///////////////////////////////////
 // 描画リクエストヘルパー
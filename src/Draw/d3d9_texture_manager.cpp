@@ -4,6 +4,9 @@
 #include "../File/file.h"
 
 #include "renderer_2d_util.h"
+#include "atlas_packer.h"
+#include "texture_container.h"
+#include "texture_residency.h"
 
 #include "d3d9_driver.h"
 #include "d3d9_texture_manager.h"
@@ -14,8 +17,14 @@ namespace draw{
 //////////////////////////////////////////////
 // 初期化と終了
 //////////////////////////////////////////////
-d3d9_texture_manager::d3d9_texture_manager():nTextureVRAM_(0),nTextureMaxVRAM_(0)
+d3d9_texture_manager::d3d9_texture_manager():nUploadBudgetByte_(0),pLoadingTexture_(nullptr),
+												nAtlasPageSize_(1024),nAtlasMaxImageSize_(256),nAtlasPadding_(2),nAtlasPageCount_(0)
 {
+	::ZeroMemory(&loadingImageInfo_, sizeof(loadingImageInfo_));
+	loadingImageInfo_.Width  = 1;
+	loadingImageInfo_.Height = 1;
+	loadingImageInfo_.Format = D3DFMT_UNKNOWN;
+
 #ifdef MANA_DEBUG
 	bReDefine_=false;
 #endif
@@ -26,20 +35,60 @@ void d3d9_texture_manager::init(const d3d9_driver_sptr& pDriver, uint32_t nReser
 	pDriver_ = pDriver;
 	hashTexture_.reserve(nReserveTextureNum);
 	texIdMgr_.init(nReserveTextureNum, cmd::RESERVE_TEX_ID_END, "");
-	set_texture_max_vram(nTextureMaxVRAM);
+	residency_.init(nTextureMaxVRAM, nReserveTextureNum);
+}
+
+bool d3d9_texture_manager::init_async(uint32_t nThreadNum, uint32_t nUploadBudgetByte)
+{
+	loader_.init(nThreadNum);
+	return init_async_inner(nUploadBudgetByte);
+}
+
+bool d3d9_texture_manager::init_async(const shared_ptr<concurrent::worker>& pWorker, uint32_t nUploadBudgetByte)
+{
+	loader_.init(pWorker);
+	return init_async_inner(nUploadBudgetByte);
+}
+
+bool d3d9_texture_manager::init_async_inner(uint32_t nUploadBudgetByte)
+{
+	nUploadBudgetByte_ = nUploadBudgetByte;
+
+	// 読み込み中に返すテクスチャ
+	safe_release(pLoadingTexture_);
+	HRESULT r = pDriver_->device()->CreateTexture(1, 1, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &pLoadingTexture_, NULL);
+	if(!check_hresult(r,"[d3d9_texture_manager]読み込み中テクスチャが作成できませんでした。"))
+	{
+		loader_.fin();
+		return false;
+	}
+
+	D3DLOCKED_RECT rect;
+	r = pLoadingTexture_->LockRect(0, &rect, NULL, 0);
+	if(check_hresult(r))
+	{
+		*reinterpret_cast<DWORD*>(rect.pBits) = D3DCOLOR_ARGB(0,0,0,0);
+		pLoadingTexture_->UnlockRect(0);
+	}
+
+	logger::infoln("[d3d9_texture_manager]非同期読み込みモードで動作します。");
+	return true;
 }
 
 void d3d9_texture_manager::fin()
 {
+	loader_.fin();
+	safe_release(pLoadingTexture_);
+
 	hashTexture_.clear();
-	listTexture_.clear();
-	nTextureVRAM_ = 0;
+	residency_.fin();
+	dequePrefetch_.clear();
 }
 
 //////////////////////////////////////////////
 // テクスチャ情報
 //////////////////////////////////////////////
-bool d3d9_texture_manager::add_texture_info(const string& sID, const string& sFilePath, const string& sGroup)
+bool d3d9_texture_manager::add_texture_info(const string& sID, const string& sFilePath, const string& sGroup, bool bAtlas)
 {
 	if(sID.empty() || sFilePath.empty()) return false;
 
@@ -47,9 +96,9 @@ bool d3d9_texture_manager::add_texture_info(const string& sID, const string& sFi
 	uint32_t nID = texIdMgr_.assign_id(sID);
 
 	tex_info info;
-	info.it_		= listTexture_.end();
 	info.sFilePath_ = sFilePath;
 	info.sGroup_	= sGroup;
+	info.bAtlas_	= bAtlas;
 
 	auto r = hashTexture_.emplace(nID, info);
 
@@ -63,15 +112,20 @@ bool d3d9_texture_manager::add_texture_info(const string& sID, const string& sFi
 			{
 				if(tex.bRenderTarget_) tex.release_(tex);
 
-				vram_manage_release(tex);
+				vram_manage_release(nID);
 				safe_release(tex.pTexture_);
 				tex.nTextureSize_ = 0;
 				tex.bRenderTarget_= false;
 			}
 
+			loader_.cancel(nID);
+
 			// 新しい情報
 			tex.sFilePath_	= sFilePath;
 			tex.sGroup_		= sGroup;
+			tex.bAtlas_		= bAtlas;
+			tex.nAtlasPage_	= 0;
+			residency_.add(nID, sGroup);
 			return true;
 		}
 	#endif
@@ -91,6 +145,7 @@ bool d3d9_texture_manager::add_texture_info(const string& sID, const string& sFi
 		}
 	}
 
+	residency_.add(nID, sGroup);
 	return true;
 }
 
@@ -102,8 +157,6 @@ bool d3d9_texture_manager::add_texture_info(const string& sID, uint32_t nWidth,
 	uint32_t nID = texIdMgr_.assign_id(sID);
 
 	tex_info info;
-	info.it_				= listTexture_.end();
-
 	info.bRenderTarget_		= true;
 	info.imageInfo_.Width	= nWidth;
 	info.imageInfo_.Height	= nHeight;
@@ -122,7 +175,7 @@ bool d3d9_texture_manager::add_texture_info(const string& sID, uint32_t nWidth,
 			{
 				if(tex.bRenderTarget_) tex.release_(tex);
 
-				vram_manage_release(tex);
+				vram_manage_release(nID);
 				safe_release(tex.pTexture_);
 				tex.nTextureSize_ = 0;
 				tex.bRenderTarget_= false;
@@ -135,6 +188,7 @@ bool d3d9_texture_manager::add_texture_info(const string& sID, uint32_t nWidth,
 			tex.imageInfo_.Format	= format;
 			tex.release_			= handler;
 			tex.sGroup_				= sGroup;
+			residency_.add(nID, sGroup);
 			return true;
 		}
 	#endif
@@ -144,6 +198,7 @@ bool d3d9_texture_manager::add_texture_info(const string& sID, uint32_t nWidth,
 		return false;
 	}
 
+	residency_.add(nID, sGroup);
 	return true;
 }
 
@@ -152,7 +207,16 @@ void d3d9_texture_manager::remove_texture_info(uint32_t nID)
 	tex_hash::iterator it = hashTexture_.find(nID);
 	if(it!=hashTexture_.end())
 	{
-		vram_manage_release(it->second);
+		loader_.cancel(nID);
+		residency_.remove(nID);
+
+		// アトラスページだったら、詰められていたテクスチャは単独に戻す
+		for(uint32_t nMember : it->second.vecAtlasMember_)
+		{
+			tex_hash::iterator member = hashTexture_.find(nMember);
+			if(member!=hashTexture_.end() && member->second.nAtlasPage_==nID)
+				member->second.nAtlasPage_ = 0;
+		}
 
 		texIdMgr_.erase_id(nID);
 		hashTexture_.erase(it);
@@ -168,7 +232,8 @@ void d3d9_texture_manager::remove_texture_info_group(const string& sGroup)
 	{
 		if(it->second.sGroup_==sGroup)
 		{
-			vram_manage_release(it->second);
+			loader_.cancel(it->first);
+			residency_.remove(it->first);
 
 			texIdMgr_.erase_id(it->first);
 			it = hashTexture_.erase(it);
@@ -197,6 +262,7 @@ bool d3d9_texture_manager::load_texture_info_file(const string& sFilePath, bool
 {/*
   *	<texture_def>
   *		<texture !id="" src="" group="" />
+  *		<group !id="" priority="" />
   *	</texture_def>
   */
 
@@ -224,6 +290,8 @@ bool d3d9_texture_manager::load_texture_info_file(const string& sFilePath, bool
 	}
 	
 
+	set<string> setAtlasGroup; // アトラス指定があったグループ
+
 	uint32_t nTexNum=1;
 	for(auto& it : *tex_def)
 	{
@@ -232,9 +300,11 @@ bool d3d9_texture_manager::load_texture_info_file(const string& sFilePath, bool
 			string sID = it.second.get<string>("<xmlattr>.id","");
 			string sSrc = it.second.get<string>("<xmlattr>.src","");
 			string sGroup = it.second.get<string>("<xmlattr>.group","");
+			bool   bAtlas = it.second.get<bool>("<xmlattr>.atlas",false);
 			if(!sID.empty() && !sSrc.empty())
 			{
-				add_texture_info(sID, sSrc, sGroup);
+				add_texture_info(sID, sSrc, sGroup, bAtlas);
+				if(bAtlas) setAtlasGroup.insert(sGroup);
 			}
 			else
 			{
@@ -244,8 +314,21 @@ bool d3d9_texture_manager::load_texture_info_file(const string& sFilePath, bool
 
 			++nTexNum;
 		}
+		else if(it.first=="group")
+		{
+			string sGroup	 = it.second.get<string>("<xmlattr>.id","");
+			string sPriority = it.second.get<string>("<xmlattr>.priority","normal");
+
+			if(sPriority=="low")		 set_group_priority(sGroup, texture_residency::PRIORITY_LOW);
+			else if(sPriority=="high")	 set_group_priority(sGroup, texture_residency::PRIORITY_HIGH);
+			else if(sPriority=="pinned") set_group_priority(sGroup, texture_residency::PRIORITY_PINNED);
+			else						 set_group_priority(sGroup, texture_residency::PRIORITY_NORMAL);
+		}
 	}
 
+	for(auto& it : setAtlasGroup)
+		build_atlas(it);
+
 	logger::infoln("[d3d9_texture_manager]テクスチャ定義ファイルの読み込みに成功しました。: " + sFilePath);
 	return true;
 }
@@ -259,7 +342,7 @@ bool d3d9_texture_manager::device_lost()
 	{
 		tex_info& info = it.second;
 
-		vram_manage_release(info);
+		vram_manage_release(it.first);
 		safe_release(info.pTexture_);
 		info.nTextureSize_ = 0;
 
@@ -279,9 +362,15 @@ LPDIRECT3DTEXTURE9 d3d9_texture_manager::texture(uint32_t nID)
 	{
 		tex_info& info = it->second;
 
+		// アトラスに詰められていたらページのテクスチャ
+		if(info.nAtlasPage_>0) return texture(info.nAtlasPage_);
+
 		// テクスチャが作成されてなかったら作成する
 		if(!info.pTexture_)
 		{
+			if(request_load(nID, info))
+				return pLoadingTexture_;
+
 			if(!create_texture_inner(nID, info))
 				return nullptr;
 		}
@@ -303,10 +392,12 @@ const tuple<uint32_t,uint32_t> d3d9_texture_manager::texture_size(uint32_t nID)
 	{
 		tex_info& info = it->second;
 
+		if(info.nAtlasPage_>0) return texture_size(info.nAtlasPage_);
+
 		// テクスチャが作成されてなかったら作成する
 		if(!info.pTexture_)
 		{
-			if(!create_texture_inner(nID, info))
+			if(request_load(nID, info) || !create_texture_inner(nID, info))
 				return std::move(make_tuple<uint32_t,uint32_t>(1,1));
 		}
 		else
@@ -333,9 +424,15 @@ const D3DXIMAGE_INFO& d3d9_texture_manager::texture_image_info(uint32_t nID)
 	{
 		tex_info& info = it->second;
 
+		// アトラスに詰められていたら、詰める時に調べた情報を返す
+		if(info.nAtlasPage_>0) return info.imageInfo_;
+
 		// テクスチャが作成されてなかったら作成する
 		if(!info.pTexture_)
 		{
+			if(request_load(nID, info))
+				return loadingImageInfo_;
+
 			if(!create_texture_inner(nID, info))
 				return std::move(img);
 		}
@@ -370,7 +467,8 @@ void d3d9_texture_manager::release_texture(uint32_t nID)
 	tex_hash::iterator it = hashTexture_.find(nID);
 	if(it!=hashTexture_.end())
 	{
-		vram_manage_release(it->second);
+		loader_.cancel(nID);
+		vram_manage_release(nID);
 
 		safe_release(it->second.pTexture_);
 		it->second.nTextureSize_ = 0;
@@ -385,7 +483,8 @@ void d3d9_texture_manager::release_texture_group(const string& sGroup)
 	{
 		if(it.second.sGroup_==sGroup)
 		{
-			vram_manage_release(it.second);
+			loader_.cancel(it.first);
+			vram_manage_release(it.first);
 
 			safe_release(it.second.pTexture_);
 			it.second.nTextureSize_ = 0;
@@ -393,6 +492,40 @@ void d3d9_texture_manager::release_texture_group(const string& sGroup)
 	}
 }
 
+uint32_t d3d9_texture_manager::preload_group(const string& sGroup)
+{
+	uint32_t nNum=0;
+	for(auto& it : hashTexture_)
+	{
+		tex_info& info = it.second;
+
+		// レンダーターゲットは使う時に作る。アトラスに詰められたものはページを作る
+		if(info.sGroup_!=sGroup || info.pTexture_ || info.bRenderTarget_ || info.nAtlasPage_>0) continue;
+
+		loader_.cancel(it.first);
+		if(create_texture_inner(it.first, info)) ++nNum;
+	}
+
+	return nNum;
+}
+
+uint32_t d3d9_texture_manager::prefetch_group(const string& sGroup)
+{
+	uint32_t nNum=0;
+	for(auto& it : hashTexture_)
+	{
+		tex_info& info = it.second;
+		if(info.sGroup_!=sGroup || info.pTexture_ || info.bRenderTarget_ || info.nAtlasPage_>0) continue;
+
+		if(!request_load(it.first, info))
+			dequePrefetch_.emplace_back(it.first);
+
+		++nNum;
+	}
+
+	return nNum;
+}
+
 //////////////////////////////////////////////
 // テクスチャのファイルへの書き出し
 //////////////////////////////////////////////
@@ -474,14 +607,19 @@ inline uint32_t calc_texture_size(uint32_t nWidth, uint32_t nHeight, D3DFORMAT f
 bool d3d9_texture_manager::create_texture_inner(uint32_t nID, tex_info& info)
 {
 	if(info.pTexture_)
-	{
+	{// 作り直す前に常駐の記録を外す。残すと古い容量のまま数えられる
+		vram_manage_release(nID);
 		safe_release(info.pTexture_);
 		info.nTextureSize_ = 0;
 	}
 
 	HRESULT r;
 
-	if(info.bRenderTarget_)
+	if(info.bAtlasPage_)
+	{// アトラスページ生成
+		return create_atlas_page(nID, info);
+	}
+	else if(info.bRenderTarget_)
 	{// レンダーテクスチャ生成
 		D3DXIMAGE_INFO& imageInfo = info.imageInfo_;
 
@@ -517,133 +655,534 @@ bool d3d9_texture_manager::create_texture_inner(uint32_t nID, tex_info& info)
 			return false;
 		}
 
-		while(true)
-		{
-			r = D3DXCreateTextureFromFileInMemoryEx(pDriver_->device(),
-															reinterpret_cast<void*>(tex_file.buf().get()), tex_file.filesize(),
-															D3DX_DEFAULT, D3DX_DEFAULT, 1, 0, D3DFMT_UNKNOWN,
-															D3DPOOL_DEFAULT, D3DX_FILTER_NONE, D3DX_FILTER_NONE,
-															0, &info.imageInfo_, NULL,
-															&info.pTexture_);
+		return create_texture_from_memory(nID, info, tex_file.buf().get(), tex_file.filesize());
+	}
 
-			// ビデオメモリが足りないなら、テクスチャを解放して、再チャレンジ
-			if(!(r==D3DERR_OUTOFVIDEOMEMORY && vram_manage_release_old_one()))
-			{	break;	}		
-		}
+	// テクスチャ容量（推定）を計算
+	if(info.nTextureSize_==0)
+	{
+		info.nTextureSize_ = calc_texture_size(info.nTextureWidth_, info.nTextureHeight_, info.imageInfo_.Format);
+	}
 
-		function<void(HRESULT)> err = [this, &nID](HRESULT r){ logger::warnln("[d3d9_texture_manager]テクスチャを作成することができませんでした。: " + texture_id(nID) + " " + to_str(r)); };
-		if(!check_hresult(r,err)) return false;
+	vram_manage_fetch(nID, info);
+
+	return true;
+}
+
+bool d3d9_texture_manager::create_texture_from_memory(uint32_t nID, tex_info& info, const void* pData, uint32_t nSize)
+{
+	// 変換済みコンテナならデコードしない
+	if(texture_container_header::is_container(pData, nSize))
+		return create_texture_from_container(nID, info, pData, nSize);
+
+	if(info.pTexture_)
+	{// 作り直す前に常駐の記録を外す。残すと古い容量のまま数えられる
+		vram_manage_release(nID);
+		safe_release(info.pTexture_);
+		info.nTextureSize_ = 0;
+	}
+
+	HRESULT r;
+
+	while(true)
+	{
+		r = D3DXCreateTextureFromFileInMemoryEx(pDriver_->device(),
+														pData, nSize,
+														D3DX_DEFAULT, D3DX_DEFAULT, 1, 0, D3DFMT_UNKNOWN,
+														D3DPOOL_DEFAULT, D3DX_FILTER_NONE, D3DX_FILTER_NONE,
+														0, &info.imageInfo_, NULL,
+														&info.pTexture_);
+
+		// ビデオメモリが足りないなら、テクスチャを解放して、再チャレンジ
+		if(!(r==D3DERR_OUTOFVIDEOMEMORY && vram_manage_release_old_one()))
+		{	break;	}		
+	}
+
+	function<void(HRESULT)> err = [this, &nID](HRESULT r){ logger::warnln("[d3d9_texture_manager]テクスチャを作成することができませんでした。: " + texture_id(nID) + " " + to_str(r)); };
+	if(!check_hresult(r,err)) return false;
+
+	// テクスチャサイズは2の累乗に丸められるのでIMAGE_INFOも丸めておく
+	info.nTextureWidth_  = round_2_power_size(info.imageInfo_.Width);
+	info.nTextureHeight_ = round_2_power_size(info.imageInfo_.Height);
+
+	// ファイルフォーマットがDXTだったらファイルサイズをそのままテクスチャ容量とする
+	switch(info.imageInfo_.Format)
+	{
+	case D3DFMT_DXT1:
+	case D3DFMT_DXT2:
+	case D3DFMT_DXT3:
+	case D3DFMT_DXT4:
+	case D3DFMT_DXT5:
+		info.nTextureSize_ = nSize;
+	break;
+
+	default:
+		// テクスチャ容量（推定）を計算
+		info.nTextureSize_ = calc_texture_size(info.nTextureWidth_, info.nTextureHeight_, info.imageInfo_.Format);
+	break;
+	}
+
+	vram_manage_fetch(nID, info);
+
+	return true;
+}
+
+bool d3d9_texture_manager::create_texture_from_pixel(uint32_t nID, tex_info& info, const texture_loader::staged& s)
+{
+	if(info.pTexture_)
+	{// 作り直す前に常駐の記録を外す。残すと古い容量のまま数えられる
+		vram_manage_release(nID);
+		safe_release(info.pTexture_);
+		info.nTextureSize_ = 0;
+	}
+
+	// D3DX_DEFAULTで作った時と同じく、2の累乗に丸める
+	const uint32_t nTexWidth  = round_2_power_size(s.nWidth_);
+	const uint32_t nTexHeight = round_2_power_size(s.nHeight_);
+
+	HRESULT r;
+
+	// 直接書き込むのでMANAGED
+	while(true)
+	{
+		r = pDriver_->device()->CreateTexture(nTexWidth, nTexHeight, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &info.pTexture_, NULL);
+
+		// ビデオメモリが足りないなら、テクスチャを解放して、再チャレンジ
+		if(!(r==D3DERR_OUTOFVIDEOMEMORY && vram_manage_release_old_one()))
+		{	break;	}
+	}
 
-		// テクスチャサイズは2の累乗に丸められるのでIMAGE_INFOも丸めておく
-		info.nTextureWidth_  = round_2_power_size(info.imageInfo_.Width);
-		info.nTextureHeight_ = round_2_power_size(info.imageInfo_.Height);
+	function<void(HRESULT)> err = [this, &nID](HRESULT r){ logger::warnln("[d3d9_texture_manager]デコード済みの画像からテクスチャを作成することができませんでした。: " + texture_id(nID) + " " + to_str(r)); };
+	if(!check_hresult(r,err)) return false;
 
-		// ファイルフォーマットがDXTだったらファイルサイズをそのままテクスチャ容量とする
-		switch(info.imageInfo_.Format)
+	D3DLOCKED_RECT rect;
+	r = info.pTexture_->LockRect(0, &rect, NULL, 0);
+	if(!check_hresult(r, "[d3d9_texture_manager]テクスチャをロックできませんでした。: " + texture_id(nID)))
+	{
+		safe_release(info.pTexture_);
+		return false;
+	}
+
+	// 行単位でコピーする。丸めてはみ出した所は透明にする
+	const uint32_t	nPitch	= s.nWidth_*4;
+	const BYTE*		pSrc	= s.pPixel_.get();
+	BYTE*			pDest	= static_cast<BYTE*>(rect.pBits);
+	for(uint32_t y=0; y<nTexHeight; ++y)
+	{
+		BYTE* pRow = pDest+rect.Pitch*y;
+		if(y<s.nHeight_)
 		{
-		case D3DFMT_DXT1:
-		case D3DFMT_DXT2:
-		case D3DFMT_DXT3:
-		case D3DFMT_DXT4:
-		case D3DFMT_DXT5:
-			info.nTextureSize_ = tex_file.filesize();
-		break;
-
-		default: break;
+			::memcpy(pRow, pSrc+nPitch*y, nPitch);
+			::ZeroMemory(pRow+nPitch, nTexWidth*4-nPitch);
+		}
+		else
+		{
+			::ZeroMemory(pRow, nTexWidth*4);
 		}
 	}
 
-	// テクスチャ容量（推定）を計算
-	if(info.nTextureSize_==0)
+	info.pTexture_->UnlockRect(0);
+
+	info.imageInfo_		 = s.imageInfo_;
+	info.nTextureWidth_  = nTexWidth;
+	info.nTextureHeight_ = nTexHeight;
+	info.nTextureSize_	 = calc_texture_size(nTexWidth, nTexHeight, D3DFMT_A8R8G8B8);
+
+	vram_manage_fetch(nID, info);
+
+	return true;
+}
+
+bool d3d9_texture_manager::create_texture_from_container(uint32_t nID, tex_info& info, const void* pData, uint32_t nSize)
+{
+	if(info.pTexture_)
+	{// 作り直す前に常駐の記録を外す。残すと古い容量のまま数えられる
+		vram_manage_release(nID);
+		safe_release(info.pTexture_);
+		info.nTextureSize_ = 0;
+	}
+
+	const texture_container_header& head = *static_cast<const texture_container_header*>(pData);
+
+	D3DFORMAT format;
+	switch(head.nFormat_)
 	{
-		info.nTextureSize_ = calc_texture_size(info.nTextureWidth_, info.nTextureHeight_, info.imageInfo_.Format);
+	case texture_container_header::FORMAT_BC1: format = D3DFMT_DXT1;		break;
+	case texture_container_header::FORMAT_BC3: format = D3DFMT_DXT5;		break;
+	default:								   format = D3DFMT_A8R8G8B8;	break;
 	}
 
+	HRESULT r;
+
+	// 直接書き込むのでMANAGED
+	while(true)
+	{
+		r = pDriver_->device()->CreateTexture(head.nWidth_, head.nHeight_, head.nMipLevels_, 0,
+													format, D3DPOOL_MANAGED, &info.pTexture_, NULL);
+
+		// ビデオメモリが足りないなら、テクスチャを解放して、再チャレンジ
+		if(!(r==D3DERR_OUTOFVIDEOMEMORY && vram_manage_release_old_one()))
+		{	break;	}
+	}
+
+	function<void(HRESULT)> err = [this, &nID](HRESULT r){ logger::warnln("[d3d9_texture_manager]テクスチャコンテナからテクスチャを作成することができませんでした。: " + texture_id(nID) + " " + to_str(r)); };
+	if(!check_hresult(r,err)) return false;
+
+	// ミップレベルごとに行単位でコピーする
+	const BYTE* pSrc = static_cast<const BYTE*>(pData) + sizeof(texture_container_header);
+
+	for(uint32_t nLevel=0; nLevel<head.nMipLevels_; ++nLevel)
+	{
+		uint32_t nPitch = texture_container_header::level_pitch(head.nFormat_, head.nWidth_, nLevel);
+		uint32_t nRows	= texture_container_header::level_rows(head.nFormat_, head.nHeight_, nLevel);
+
+		D3DLOCKED_RECT rect;
+		r = info.pTexture_->LockRect(nLevel, &rect, NULL, 0);
+		if(!check_hresult(r, "[d3d9_texture_manager]テクスチャをロックできませんでした。: " + texture_id(nID)))
+		{
+			safe_release(info.pTexture_);
+			return false;
+		}
+
+		BYTE* pDest = static_cast<BYTE*>(rect.pBits);
+		for(uint32_t y=0; y<nRows; ++y)
+			::memcpy(pDest+rect.Pitch*y, pSrc+nPitch*y, nPitch);
+
+		info.pTexture_->UnlockRect(nLevel);
+
+		pSrc += nPitch*nRows;
+	}
+
+	::ZeroMemory(&info.imageInfo_, sizeof(info.imageInfo_));
+	info.imageInfo_.Width			= head.nImageWidth_;
+	info.imageInfo_.Height			= head.nImageHeight_;
+	info.imageInfo_.Depth			= 1;
+	info.imageInfo_.MipLevels		= head.nMipLevels_;
+	info.imageInfo_.Format			= format;
+	info.imageInfo_.ResourceType	= D3DRTYPE_TEXTURE;
+	info.imageInfo_.ImageFileFormat = D3DXIFF_DDS;
+
+	info.nTextureWidth_  = head.nWidth_;
+	info.nTextureHeight_ = head.nHeight_;
+	info.nTextureSize_	 = head.nDataSize_;
+
 	vram_manage_fetch(nID, info);
 
 	return true;
 }
 
 //////////////////////////////////////////////
-// テクスチャ容量の調整
+// アトラス
 //////////////////////////////////////////////
-void d3d9_texture_manager::vram_manage_fetch(uint32_t nID, tex_info& info)
+uint32_t d3d9_texture_manager::build_atlas(const string& sGroup)
 {
-	if(info.it_!=listTexture_.end())
-	{// すでに使用中だったら、位置変更のために一端リストから削除
-		listTexture_.erase(info.it_);
-		info.it_ = listTexture_.end();
+	// ページサイズはデバイスが扱えるサイズに収める
+	uint32_t nPageSize = (std::min)(nAtlasPageSize_, pDriver_->draw_caps().max_texture_width());
+	nPageSize = (std::min)(nPageSize, pDriver_->draw_caps().max_texture_height());
+
+	// 候補を集めて、元画像のサイズを調べる
+	typedef tuple<uint32_t, D3DXIMAGE_INFO> candidate; // テクスチャID,画像情報
+	vector<candidate> vecCandidate;
+
+	for(auto& it : hashTexture_)
+	{
+		tex_info& info = it.second;
+		if(!info.bAtlas_ || info.nAtlasPage_>0 || info.sGroup_!=sGroup) continue;
+
+		D3DXIMAGE_INFO img;
+		if(!read_image_info(info.sFilePath_, img)) continue;
+
+		// 大きい画像は単独のテクスチャのまま
+		if(img.Width+nAtlasPadding_*2>(std::min)(nAtlasMaxImageSize_,nPageSize)
+		|| img.Height+nAtlasPadding_*2>(std::min)(nAtlasMaxImageSize_,nPageSize))
+			continue;
+
+		vecCandidate.emplace_back(candidate(it.first, img));
 	}
-	else
-	{// info.it_==listTexture_.end() だったら新規追加
-	 // 使用VRAMをチェックする
-		nTextureVRAM_ += info.nTextureSize_;
 
-		// 制限量を超えたら、制限内に収まるまでVRAMを解放する
-		if(nTextureMaxVRAM_>0 && nTextureVRAM_>nTextureMaxVRAM_)
+	if(vecCandidate.empty()) return 0;
+
+	// 高さの大きい順に詰めると効率が良い
+	std::sort(vecCandidate.begin(), vecCandidate.end(), [](const candidate& lhs, const candidate& rhs)
+	{
+		if(lhs.get<1>().Height!=rhs.get<1>().Height) return lhs.get<1>().Height > rhs.get<1>().Height;
+		return lhs.get<1>().Width > rhs.get<1>().Width;
+	});
+
+	// 詰める。入らなくなったら新しいページ
+	typedef tuple<uint32_t, uint32_t, uint32_t> placement; // ページ番号,X,Y
+	vector<atlas_packer> vecPacker;
+	vector<placement>	 vecPlace(vecCandidate.size());
+
+	for(uint32_t i=0; i<vecCandidate.size(); ++i)
+	{
+		const D3DXIMAGE_INFO& img = vecCandidate[i].get<1>();
+		uint32_t nWidth  = img.Width +nAtlasPadding_*2;
+		uint32_t nHeight = img.Height+nAtlasPadding_*2;
+
+		uint32_t x=0, y=0, nPage=0;
+		for(; nPage<vecPacker.size(); ++nPage)
 		{
-			// 前にあるほど古いので前から消して行く
-			list<uint32_t>::iterator it = listTexture_.begin();
-			while(nTextureVRAM_>nTextureMaxVRAM_ 
-			   && it!=listTexture_.end())
-			{
-				tex_hash::iterator info_it = hashTexture_.find(*it);
-				if(info_it!=hashTexture_.end())
-				{
-					tex_info& info_release = info_it->second;
+			if(vecPacker[nPage].insert(nWidth, nHeight, x, y)) break;
+		}
+
+		if(nPage==vecPacker.size())
+		{
+			vecPacker.emplace_back(atlas_packer());
+			vecPacker.back().init(nPageSize, nPageSize);
+			vecPacker.back().insert(nWidth, nHeight, x, y);
+		}
+
+		vecPlace[i] = placement(nPage, x+nAtlasPadding_, y+nAtlasPadding_);
+	}
+
+	// ページのテクスチャ情報を登録する
+	vector<uint32_t> vecPageID;
+	for(auto& it : vecPacker)
+	{
+		string sPageID = "__atlas_" + sGroup + "_" + to_str(nAtlasPageCount_++);
+		uint32_t nPageID = texIdMgr_.assign_id(sPageID);
 
-					vram_manage_release(info_release);
+		tex_info page;
+		page.bAtlasPage_		= true;
+		page.imageInfo_.Width	= it.width();
+		page.imageInfo_.Height	= it.height();
+		page.imageInfo_.Format	= D3DFMT_A8R8G8B8;
+		page.sGroup_			= sGroup;
+		hashTexture_.emplace(nPageID, page);
+		residency_.add(nPageID, sGroup);
 
-					safe_release(info_release.pTexture_);
-					info_release.nTextureSize_ = 0;
+		vecPageID.emplace_back(nPageID);
+
+		logger::infoln("[d3d9_texture_manager]アトラスページを作りました。: " + sPageID + " 詰め効率 : " + to_str(it.occupancy()));
+	}
 
-					// レンダーターゲットだったら削除されたことを通知
-					if(info_release.bRenderTarget_) info_release.release_(info_release);
-				}
-				it = listTexture_.erase(it);
+	// 詰めたテクスチャの情報を付け替える
+	for(uint32_t i=0; i<vecCandidate.size(); ++i)
+	{
+		uint32_t nID	 = vecCandidate[i].get<0>();
+		uint32_t nPageID = vecPageID[vecPlace[i].get<0>()];
+
+		tex_info& info = hashTexture_[nID];
+
+		// 単独で作られていたら解放する
+		loader_.cancel(nID);
+		if(info.pTexture_)
+		{
+			vram_manage_release(nID);
+			safe_release(info.pTexture_);
+			info.nTextureSize_ = 0;
+		}
+
+		info.imageInfo_		= vecCandidate[i].get<1>();
+		info.nAtlasPage_	= nPageID;
+		info.nAtlasX_		= vecPlace[i].get<1>();
+		info.nAtlasY_		= vecPlace[i].get<2>();
+
+		hashTexture_[nPageID].vecAtlasMember_.emplace_back(nID);
+	}
+
+	return vecCandidate.size();
+}
+
+bool d3d9_texture_manager::atlas_location(uint32_t nID, uint32_t& nPageID, uint32_t& nX, uint32_t& nY)const
+{
+	tex_hash::const_iterator it = hashTexture_.find(nID);
+	if(it==hashTexture_.end() || it->second.nAtlasPage_==0) return false;
+
+	nPageID = it->second.nAtlasPage_;
+	nX		= it->second.nAtlasX_;
+	nY		= it->second.nAtlasY_;
+	return true;
+}
+
+bool d3d9_texture_manager::create_atlas_page(uint32_t nID, tex_info& info)
+{
+	HRESULT r;
+
+	// 画像を書き込むのでMANAGED
+	while(true)
+	{
+		r = pDriver_->device()->CreateTexture(info.imageInfo_.Width, info.imageInfo_.Height, 1, 0,
+													info.imageInfo_.Format, D3DPOOL_MANAGED, &info.pTexture_, NULL);
+
+		// ビデオメモリが足りないなら、テクスチャを解放して、再チャレンジ
+		if(!(r==D3DERR_OUTOFVIDEOMEMORY && vram_manage_release_old_one()))
+		{	break;	}
+	}
+
+	function<void(HRESULT)> err = [this, &nID](HRESULT r){ logger::warnln("[d3d9_texture_manager]アトラスページを作成することができませんでした。: " + texture_id(nID) + " " + to_str(r)); };
+	if(!check_hresult(r,err)) return false;
+
+	// 隙間は透明にする
+	D3DLOCKED_RECT rect;
+	r = info.pTexture_->LockRect(0, &rect, NULL, 0);
+	if(check_hresult(r))
+	{
+		BYTE* pBits = static_cast<BYTE*>(rect.pBits);
+		for(uint32_t y=0; y<info.imageInfo_.Height; ++y)
+			::ZeroMemory(pBits+rect.Pitch*y, info.imageInfo_.Width*4);
+
+		info.pTexture_->UnlockRect(0);
+	}
+
+	// 詰められた画像を書き込む
+	LPDIRECT3DSURFACE9 pSurface = nullptr;
+	r = info.pTexture_->GetSurfaceLevel(0, &pSurface);
+	if(check_hresult(r))
+	{
+		using file::file_access;
+
+		for(uint32_t nMember : info.vecAtlasMember_)
+		{
+			tex_hash::iterator it = hashTexture_.find(nMember);
+			if(it==hashTexture_.end() || it->second.nAtlasPage_!=nID) continue;
+
+			const tex_info& member = it->second;
+
+			file_access tex_file(member.sFilePath_);
+			uint32_t rsize=0;
+			if(!tex_file.open(file_access::READ_ALL) || tex_file.read(rsize)==file_access::FAIL)
+			{
+				logger::warnln("[d3d9_texture_manager]テクスチャファイルを読むことができませんでした。: " + member.sFilePath_);
+				continue;
 			}
+
+			::RECT dest = { static_cast<LONG>(member.nAtlasX_), static_cast<LONG>(member.nAtlasY_),
+							static_cast<LONG>(member.nAtlasX_+member.imageInfo_.Width), static_cast<LONG>(member.nAtlasY_+member.imageInfo_.Height) };
+
+			r = D3DXLoadSurfaceFromFileInMemory(pSurface, NULL, &dest, tex_file.buf().get(), tex_file.filesize(), NULL, D3DX_FILTER_NONE, 0, NULL);
+			check_hresult(r, "[d3d9_texture_manager]アトラスページに書き込めませんでした。: " + member.sFilePath_);
 		}
+
+		safe_release(pSurface);
 	}
 
-	// 後ろに追加
-	listTexture_.emplace_back(nID);
-	info.it_=listTexture_.end();
-	--info.it_; // endの一つ前が自分の位置
+	info.nTextureWidth_  = info.imageInfo_.Width;
+	info.nTextureHeight_ = info.imageInfo_.Height;
+	info.nTextureSize_	 = calc_texture_size(info.nTextureWidth_, info.nTextureHeight_, info.imageInfo_.Format);
+
+	vram_manage_fetch(nID, info);
+
+	return true;
 }
 
-void d3d9_texture_manager::vram_manage_release(tex_info& info)
+bool d3d9_texture_manager::read_image_info(const string& sFilePath, D3DXIMAGE_INFO& imageInfo)
 {
-	if(info.it_!=listTexture_.end())
+	using file::file_access;
+
+	file_access tex_file(sFilePath);
+	uint32_t rsize=0;
+	if(!tex_file.open(file_access::READ_ALL) || tex_file.read(rsize)==file_access::FAIL)
 	{
-		listTexture_.erase(info.it_);
-		info.it_ = listTexture_.end();
+		logger::warnln("[d3d9_texture_manager]テクスチャファイルを読むことができませんでした。: " + sFilePath);
+		return false;
 	}
 
-	nTextureVRAM_ -= info.nTextureSize_;
+	// 変換済みコンテナはそのまま使った方が速いので詰めない
+	if(texture_container_header::is_container(tex_file.buf().get(), tex_file.filesize()))
+	{
+		logger::debugln("[d3d9_texture_manager]テクスチャコンテナはアトラスに詰めません。: " + sFilePath);
+		return false;
+	}
+
+	HRESULT r = D3DXGetImageInfoFromFileInMemory(tex_file.buf().get(), tex_file.filesize(), &imageInfo);
+	return check_hresult(r, "[d3d9_texture_manager]画像情報を取得できませんでした。: " + sFilePath);
 }
 
-bool d3d9_texture_manager::vram_manage_release_old_one()
+//////////////////////////////////////////////
+// 非同期読み込み
+//////////////////////////////////////////////
+bool d3d9_texture_manager::request_load(uint32_t nID, const tex_info& info)
 {
-	// 先頭が一番古い
-	list<uint32_t>::iterator it = listTexture_.begin();
-	tex_hash::iterator info_it = hashTexture_.find(*it);
-	if(info_it!=hashTexture_.end())
+	// アトラスページは複数のファイルから作るので同期で作る
+	if(!loader_.is_init() || info.bRenderTarget_ || info.bAtlasPage_) return false;
+
+	if(loader_.is_loading(nID)) return true;
+
+	// リクエストできなかったら同期で作る
+	return loader_.request(nID, info.sFilePath_);
+}
+
+uint32_t d3d9_texture_manager::update_upload()
+{
+	uint32_t nByte=0;
+
+	if(loader_.is_init())
 	{
-		tex_info& info_release = info_it->second;
+		nByte = loader_.upload(nUploadBudgetByte_, [this](const texture_loader::staged& s)->uint32_t
+		{
+			tex_hash::iterator it = hashTexture_.find(s.nID_);
+			if(it==hashTexture_.end()) return 0;
 
-		vram_manage_release(info_release);
+			tex_info& info = it->second;
 
-		safe_release(info_release.pTexture_);
-		info_release.nTextureSize_ = 0;
+			// 読んでいる間に同期で作られていたら何もしない
+			if(info.pTexture_) return 0;
 
-		// レンダーターゲットだったら削除されたことを通知
-		if(info_release.bRenderTarget_) info_release.release_(info_release);
+			// workerでデコードできなかった画像だけ、ここでデコードする
+			bool r = s.pPixel_ ? create_texture_from_pixel(s.nID_, info, s) : create_texture_from_memory(s.nID_, info, s.pData_.get(), s.nSize_);
+			if(!r) return 0;
 
-		listTexture_.erase(it);
-		return true;
+			return info.nTextureSize_;
+		});
 	}
 
-	return false;
+	// 非同期で読めなかった先読みは、残りの容量で作る
+	while(!dequePrefetch_.empty() && (nUploadBudgetByte_==0 || nByte<nUploadBudgetByte_))
+	{
+		uint32_t nID = dequePrefetch_.front();
+		dequePrefetch_.pop_front();
+
+		tex_hash::iterator it = hashTexture_.find(nID);
+		if(it==hashTexture_.end() || it->second.pTexture_) continue;
+
+		if(create_texture_inner(nID, it->second))
+			nByte += it->second.nTextureSize_;
+	}
+
+	return nByte;
+}
+
+//////////////////////////////////////////////
+// テクスチャ容量の調整
+//////////////////////////////////////////////
+void d3d9_texture_manager::vram_manage_fetch(uint32_t nID, tex_info& info)
+{
+	vector<uint32_t> vecEvict;
+	residency_.fetch(nID, info.nTextureSize_, vecEvict);
+
+	// 制限量を超えた分を解放する
+	for(auto& it : vecEvict)
+		vram_manage_evict(it);
+}
+
+void d3d9_texture_manager::vram_manage_release(uint32_t nID)
+{
+	residency_.release(nID);
+}
+
+bool d3d9_texture_manager::vram_manage_release_old_one()
+{
+	auto nID = residency_.evict_one();
+	if(!nID) return false;
+
+	vram_manage_evict(*nID);
+	return true;
+}
+
+void d3d9_texture_manager::vram_manage_evict(uint32_t nID)
+{
+	tex_hash::iterator it = hashTexture_.find(nID);
+	if(it==hashTexture_.end()) return;
+
+	tex_info& info = it->second;
+
+	safe_release(info.pTexture_);
+	info.nTextureSize_ = 0;
+
+	// レンダーターゲットだったら削除されたことを通知
+	if(info.bRenderTarget_) info.release_(info);
 }
 
 } // namespace draw end
@@ -2,6 +2,9 @@
 
 #include "../Utility/id_manger.h"
 
+#include "texture_loader.h"
+#include "texture_residency.h"
+
 namespace mana{
 namespace draw{
 
@@ -21,14 +24,24 @@ struct tex_info
 
 	string					sFilePath_;		//!< テクスチャー元ファイルのパス
 
-	string					 sGroup_;		//!< グループID
-	list<uint32_t>::iterator it_;			//!< LRU管理のためのリスト内の自位置
+	string					sGroup_;		//!< グループID
+
+	//! @defgroup tex_info_atlas アトラス
+	//! @{
+	bool					bAtlas_;		//!< アトラスに詰める候補か
+	uint32_t				nAtlasPage_;	//!< 詰められたアトラスページのテクスチャID。0だと詰められていない
+	uint32_t				nAtlasX_, nAtlasY_; //!< アトラスページ内の位置
+
+	bool					bAtlasPage_;	//!< アトラスページかどうか
+	vector<uint32_t>		vecAtlasMember_;//!< アトラスページに詰められたテクスチャID
+	//! @}
 
 
 	release_hadler			release_;	//!< VRAM調整時のリリースやデバイスロストの際に呼ばれるハンドラ。
 										//!< レンダーターゲットの際に使う。呼び出しは描画スレッドからなので注意
 
-	tex_info():pTexture_(nullptr),nTextureWidth_(1),nTextureHeight_(1),nTextureSize_(0),bRenderTarget_(false){}
+	tex_info():pTexture_(nullptr),nTextureWidth_(1),nTextureHeight_(1),nTextureSize_(0),bRenderTarget_(false),
+				bAtlas_(false),nAtlasPage_(0),nAtlasX_(0),nAtlasY_(0),bAtlasPage_(false){}
 	~tex_info(){ safe_release(pTexture_); nTextureSize_=0; }
 };
 
@@ -43,6 +56,25 @@ struct tex_info
  *  1から始まる。0は無効値を表す
  *
  *　それ以外のメソッドは、明示的に調整を行いたい時に使う
+ *
+ *　init_asyncを呼ぶと非同期読み込みモードになる。
+ *　テクスチャを取得した時に作成されていなければ、ファイル読み込みとデコードをworkerに積み、
+ *　読み終わるまでは1x1の透明なテクスチャを代わりに返す。
+ *　デコードしたピクセルは、update_uploadで1フレームに指定容量ずつテクスチャにコピーされる
+ *
+ *　アトラス指定で登録した小さい画像は、build_atlasで共有のページに詰められる。
+ *　詰められたテクスチャを取得するとページのテクスチャが返り、
+ *　atlas_locationでページ内の位置が分かる。d3d9_renderer_2dはこれでUVを付け替えるので、
+ *　描画コマンド側は詰められているかを気にしなくてよい
+ *　UVがラップする使い方(タイリングなど)をするテクスチャはアトラス指定しないこと
+ *
+ *　tool/TextureConvで変換したテクスチャコンテナ(.mtex)は、
+ *　デコードせずにブロック圧縮・ミップマップ済みのデータをそのまま使う
+ *
+ *　VRAM制限を超えた時の追い出しはtexture_residencyが決める。
+ *　グループに優先度を付けると、低いグループから追い出される。
+ *　シーン切り替えの前にpreload_group/prefetch_groupで次のグループを作っておくと、
+ *　切り替えた直後に追い出したテクスチャを作り直すことが減る
  */
 class d3d9_texture_manager
 {
@@ -61,13 +93,21 @@ public:
 	 *  @param[in] nTextureMaxVRAM テクスチャが使用できるVRAM容量最大値 */
 	void init(const d3d9_driver_sptr& pDriver, uint32_t nReserveTextureNum=256, uint32_t nTextureMaxVRAM=0);
 
+	//! @brief 非同期読み込みモードにする。initの後に呼ぶ
+	/*! @param[in] nThreadNum ファイル読み込みに使うスレッド数
+	 *  @param[in] nUploadBudgetByte 1フレームで生成するテクスチャ容量の目安。0だと制限なし */
+	bool init_async(uint32_t nThreadNum, uint32_t nUploadBudgetByte);
+	//! kick済みworkerを渡して非同期読み込みモードにする
+	bool init_async(const shared_ptr<concurrent::worker>& pWorker, uint32_t nUploadBudgetByte);
+
 	//! 終了処理
 	void fin();
 
 	//! @brief テクスチャ情報を登録。テクスチャ実体はテクスチャを取得する時に生成される
 	/*! @param[in] sID テクスチャID
-	 *  @param[in] sFilePath テクスチャの元ファイルパス */
-	bool add_texture_info(const string& sID, const string& sFilePath, const string& sGroup="");
+	 *  @param[in] sFilePath テクスチャの元ファイルパス
+	 *  @param[in] bAtlas trueならアトラスに詰める候補にする。build_atlasを呼ぶまでは単独のテクスチャ */
+	bool add_texture_info(const string& sID, const string& sFilePath, const string& sGroup="", bool bAtlas=false);
 
 	//! @brief レンダーテクスチャ情報を登録
 	bool add_texture_info(const string& sID, uint32_t nWidth, uint32_t nHeight, D3DFORMAT format, const string& sGroup="", const tex_info::release_hadler& handler=[](const tex_info&){});
@@ -111,11 +151,68 @@ public:
 	//! デバイスロスト対応
 	bool	 device_lost();
 
+	//! @defgroup texture_manager_atlas アトラス
+	//! @{
+	//! @brief アトラス候補のテクスチャを、グループごとにページに詰める
+	/*! 元画像を読んでサイズを調べるので、ロード時に呼ぶこと
+	 *  @param[in] sGroup 対象のグループ
+	 *  @return 詰めたテクスチャ数 */
+	uint32_t build_atlas(const string& sGroup="");
+
+	//! @brief アトラスに詰められているなら、ページのテクスチャIDと位置を返す
+	/*! @retval false 詰められていない */
+	bool	 atlas_location(uint32_t nID, uint32_t& nPageID, uint32_t& nX, uint32_t& nY)const;
+
+	//! @brief アトラスのパラメータを設定する
+	/*! @param[in] nPageSize ページの幅・高さ
+	 *  @param[in] nMaxImageSize 幅・高さがこれより大きい画像は詰めない
+	 *  @param[in] nPadding 画像の周りに空けるピクセル数。フィルタで隣の画像が滲まないようにする */
+	void	 set_atlas_param(uint32_t nPageSize, uint32_t nMaxImageSize, uint32_t nPadding){ nAtlasPageSize_=nPageSize; nAtlasMaxImageSize_=nMaxImageSize; nAtlasPadding_=nPadding; }
+	//! @}
+
 	//! テクスチャのVRAM容量最大値を設定
-	void	 set_texture_max_vram(uint32_t nTextureMaxVRAM){ nTextureMaxVRAM_=nTextureMaxVRAM; }
+	void	 set_texture_max_vram(uint32_t nTextureMaxVRAM){ residency_.set_max_byte(nTextureMaxVRAM); }
 
 	//! 使用してるテクスチャー総容量（目安）を取得
-	uint32_t texture_use_vram()const{ return nTextureVRAM_; }
+	uint32_t texture_use_vram()const{ return residency_.use_byte(); }
+
+	//! @defgroup texture_manager_residency 常駐管理
+	//! @{
+	//! @brief グループの優先度を設定する
+	/*! @param[in] nPriority texture_residency::priority */
+	void	 set_group_priority(const string& sGroup, uint32_t nPriority){ residency_.set_group_priority(sGroup, nPriority); }
+	uint32_t group_priority(const string& sGroup)const{ return residency_.group_priority(sGroup); }
+
+	//! @brief グループのテクスチャを今すぐ作る。非同期読み込み中のものも同期で作る
+	/*! @return 作ったテクスチャ数 */
+	uint32_t preload_group(const string& sGroup);
+
+	//! @brief グループのテクスチャを、描画を止めない範囲で先に作っておく
+	/*! 非同期読み込みモードなら読み込みをリクエストする。
+	 *  そうでなければupdate_uploadで1フレームに指定容量ずつ作る
+	 *  @return 先読み対象にしたテクスチャ数 */
+	uint32_t prefetch_group(const string& sGroup);
+
+	//! フレームを進める。描画スレッドから毎フレーム、描画前に呼ぶ
+	void	 next_frame(){ residency_.next_frame(); }
+
+	const texture_residency& residency()const{ return residency_; }
+	//! @}
+
+	//! @defgroup texture_manager_async 非同期読み込み
+	//! @{
+	//! @brief 読み終わったファイルや先読み対象からテクスチャを生成する。描画スレッドから毎フレーム、描画前に呼ぶ
+	/*! @return 生成したテクスチャ容量(byte) */
+	uint32_t update_upload();
+
+	bool	 is_async()const{ return loader_.is_init(); }
+	//! 読み込み中かどうか。読み込み中は代わりのテクスチャが返る
+	bool	 is_loading(uint32_t nID)const{ return loader_.is_loading(nID); }
+	//! 読み込み中のテクスチャ数
+	uint32_t loading_num()const{ return loader_.loading_num(); }
+
+	void	 set_upload_budget(uint32_t nUploadBudgetByte){ nUploadBudgetByte_=nUploadBudgetByte; }
+	//! @}
 
 
 	///// 以下ユーティリティーメソッド
@@ -144,6 +241,33 @@ private:
 	 *  @param[in,out] info 設定されている情報に基づきテクスチャを生成し、infoの中に設定する */
 	bool create_texture_inner(uint32_t nID, tex_info& info);
 
+	//! @brief 読み込み済みのファイルからテクスチャを生成する
+	/*! @param[in] pData ファイル実体
+	 *  @param[in] nSize ファイルサイズ */
+	bool create_texture_from_memory(uint32_t nID, tex_info& info, const void* pData, uint32_t nSize);
+
+	//! @brief workerでデコードしたA8R8G8B8のピクセルからテクスチャを生成する。コピーするだけ
+	/*! テクスチャは2の累乗に丸めて作り、はみ出した所は透明にする */
+	bool create_texture_from_pixel(uint32_t nID, tex_info& info, const texture_loader::staged& s);
+
+	//! @brief 変換済みテクスチャコンテナからテクスチャを生成する。デコードせずにコピーする
+	/*! @param[in] pData texture_container_headerから始まるデータ */
+	bool create_texture_from_container(uint32_t nID, tex_info& info, const void* pData, uint32_t nSize);
+
+	//! アトラスページのテクスチャを生成して、詰められた画像を書き込む
+	bool create_atlas_page(uint32_t nID, tex_info& info);
+
+	//! 元ファイルを読んで画像情報だけ取得する
+	bool read_image_info(const string& sFilePath, D3DXIMAGE_INFO& imageInfo);
+
+	//! 非同期読み込みモードの共通初期化。読み込み中テクスチャを作る
+	bool init_async_inner(uint32_t nUploadBudgetByte);
+
+	//! @brief 非同期読み込みモードなら読み込みをリクエストする
+	/*! @retval true 読み込み中。代わりのテクスチャを使う
+	 *  @retval false 同期で作成する */
+	bool request_load(uint32_t nID, const tex_info& info);
+
 	//! @defgroup texture_manager_vram テクスチャ容量の管理
 	//! @{
 	//! @brief テクスチャ容量の調整を行う。テクスチャが追加された時に呼ぶ
@@ -151,12 +275,15 @@ private:
 	void vram_manage_fetch(uint32_t nID, tex_info& info);
 
 	//! @brief テクスチャ容量の調整を行う。テクスチャが解放された時に呼ぶ
-	/*! @param[in] info 解放されようとしているのテクスチャ情報 */
-	void vram_manage_release(tex_info& info);
+	/*! @param[in] nID 解放されようとしているのテクスチャID */
+	void vram_manage_release(uint32_t nID);
 
-	//! @brief テクスチャの一番古いものを解放する
+	//! @brief 一番追い出してよいテクスチャを解放する
 	/*! @return trueなら削除できた。falseなら削除できなかった（削除するものがなかった） */
 	bool vram_manage_release_old_one();
+
+	//! 追い出されたテクスチャを解放する
+	void vram_manage_evict(uint32_t nID);
 	//! @}
 
 private:
@@ -168,14 +295,25 @@ private:
 	//! 数値IDとテクスチャID対応テーブル
 	tex_id_manager	texIdMgr_;
 
-	//! 使用しているVRAM容量byte（目安）
-	uint32_t		nTextureVRAM_;
-	//! TextureVRAM使用の最大値byte（目安） 0の時は制限無し
-	uint32_t		nTextureMaxVRAM_;
+	//! 使用中のテクスチャ管理。VRAM容量の上限もここで持つ
+	texture_residency	residency_;
+
+	//! @defgroup texture_manager_async_member 非同期読み込み
+	//! @{
+	texture_loader		loader_;
+	uint32_t			nUploadBudgetByte_;	//!< 1フレームで生成するテクスチャ容量の目安
+	LPDIRECT3DTEXTURE9	pLoadingTexture_;	//!< 読み込み中に代わりに返す1x1の透明テクスチャ。MANAGEDなのでデバイスロストで解放しなくてよい
+	D3DXIMAGE_INFO		loadingImageInfo_;	//!< 読み込み中に返すイメージ情報
+	deque<uint32_t>		dequePrefetch_;		//!< 非同期読み込みモードでない時の先読み待ち
+	//! @}
 
-	//! 使用中のテクスチャ管理（LRU処理）。数値IDを入れる。前にあるほど古い
-	//! レンダーターゲットは対象外なので注意
-	list<uint32_t>	listTexture_;
+	//! @defgroup texture_manager_atlas_member アトラス
+	//! @{
+	uint32_t			nAtlasPageSize_;
+	uint32_t			nAtlasMaxImageSize_;
+	uint32_t			nAtlasPadding_;
+	uint32_t			nAtlasPageCount_;	//!< 作ったページ数。ページIDの名前付けに使う
+	//! @}
 
 private:
 	NON_COPIABLE(d3d9_texture_manager);
@@ -199,7 +337,8 @@ private:
 <texture_def>
 	<texture id="" src="" />
 	<texture id="" src="" />
-	<texture id="" src="" />
-	<texture id="" src="" />
+	<texture id="" src="" group="" />
+	<texture id="" src="" group="" atlas="true" />
+	<group id="" priority="low|normal|high|pinned" />
 </texture_def>
  */
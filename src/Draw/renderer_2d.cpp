@@ -1,5 +1,7 @@
 ﻿#include "../mana_common.h"
 
+#include "../Concurrent/lock_helper.h"
+
 #include "d3d9_renderer_2d.h"
 
 #include "renderer_2d_cmd.h"
@@ -10,8 +12,15 @@
 
 namespace mana{
 namespace draw{
+
+namespace{
+thread_local cmd::cmd_capture* gtl_pCapture = nullptr; //!< コマンドキャプチャ先。スレッドごとに持つ
+} // namespace end
+
 renderer_2d::renderer_2d():pRenderer_(new_ d3d9_renderer_2d())
 {
+	fontIDLock_.clear();
+
 #ifdef MANA_DEBUG
 	bReDefine_ = false;
 #endif
@@ -49,6 +58,114 @@ void renderer_2d::device_reset(bool bFullScreen, int32_t nBackWidth, int32_t nBa
 	pRenderer_->device_reset(bFullScreen, nBackWidth, nBackHeight);
 }
 
+///////////////////////////////
+// 2Dレンダラーリクエスト
+void renderer_2d::request(const cmd::render_2d_cmd& cmd)
+{
+	for(cmd::cmd_capture* p=gtl_pCapture; p!=nullptr; p=p->pParent_)
+	{// ストリームとの前後関係が分かるように、位置を残しておく
+		p->vecCmd_.emplace_back(cmd);
+		p->stream_.push_marker(cmd::STREAM_QUEUE_CMD);
+		if(p->bDefer_) return;
+	}
+	request_cmd(cmd);
+}
+
+void renderer_2d::request(const cmd::text_draw_cmd& cmd)
+{
+	if(!cmd.pText_)
+	{// 中身が無いので、警告はレンダラーに任せる
+		request(cmd::render_2d_cmd(cmd));
+		return;
+	}
+
+	const string& sText = cmd.pText_->text();
+
+	cmd::text_stream_cmd s;
+	s.pFontID_		 = intern_font_id(cmd.pText_->font_id());
+	s.nTextSize_	 = sText.size();
+	s.nCharNum_		 = cmd.nCharNum_;
+	s.pos_			 = cmd.pos_;
+	s.nColor_		 = cmd.nColor_;
+	s.nRenderTarget_ = cmd.nRenderTarget_;
+	s.bMarkUp_		 = cmd.pText_->is_markup();
+
+	for(cmd::cmd_capture* p=gtl_pCapture; p!=nullptr; p=p->pParent_)
+	{// キャプチャはフレームをまたいで使われるので、文字列はレコードにコピーする
+		p->stream_.push_str(cmd::STREAM_TEXT, s, sText);
+		if(p->bDefer_) return;
+	}
+
+	s.szText_ = frame_arena().copy_str(sText);
+	request_pod(s);
+}
+
+void renderer_2d::request(const cmd::cmd_capture& capture)
+{
+	for(cmd::cmd_capture* p=gtl_pCapture; p!=nullptr; p=p->pParent_)
+	{// キャプチャ中なら、外側にも記録する
+		p->stream_.append(capture.stream_);
+		p->vecCmd_.insert(p->vecCmd_.end(), capture.vecCmd_.begin(), capture.vecCmd_.end());
+		if(p->bDefer_) return;
+	}
+
+	if(!capture.empty())
+		request_capture(capture);
+}
+
+const string_fw* renderer_2d::intern_font_id(const string_fw& sFontID)
+{
+	concurrent::spin_flag_lock lock(fontIDLock_);
+	return &*setFontID_.insert(sFontID).first;
+}
+
+cmd::cmd_capture* renderer_2d::begin_capture(cmd::cmd_capture* pCapture)
+{
+	cmd::cmd_capture* pPrev = gtl_pCapture;
+	pCapture->pParent_ = pPrev;
+	gtl_pCapture = pCapture;
+	return pPrev;
+}
+
+void renderer_2d::end_capture(cmd::cmd_capture* pPrevCapture)
+{
+	gtl_pCapture = pPrevCapture;
+}
+
+cmd::cmd_capture* renderer_2d::cur_capture()
+{
+	return gtl_pCapture;
+}
+
+void renderer_2d::request_capture(const cmd::cmd_capture& capture)
+{
+	uint32_t nCmdIndex=0;
+
+	concurrent::cmd_stream::reader r(capture.stream_);
+	while(r.next())
+	{
+		switch(r.type())
+		{
+		case cmd::STREAM_QUEUE_CMD:
+			if(nCmdIndex<capture.vecCmd_.size())
+				request_cmd(capture.vecCmd_[nCmdIndex++]);
+		break;
+
+		case cmd::STREAM_SCREEN_CTRL:	request_pod(r.get<cmd::screen_ctrl_cmd>());		break;
+		case cmd::STREAM_SPRITE:		request_pod(r.get<cmd::sprite_draw_cmd>());		break;
+		case cmd::STREAM_POLYGON:		request_pod(r.get<cmd::polygon_draw_cmd>());	break;
+		case cmd::STREAM_SPRITE_INSTANCE:request_pod(r.get<cmd::sprite_instance_cmd>());break;
+		case cmd::STREAM_TEXT:
+		{// 追加データの文字列を指させて積む。同期版はこの場ですぐ処理される
+			cmd::text_stream_cmd c = r.get<cmd::text_stream_cmd>();
+			c.szText_ = c.text(r.ext_str());
+			request_pod(c);
+		}
+		break;
+		}
+	}
+}
+
 ///////////////////////////////
 // 2Dレンダラーリクエストヘルパー
 void renderer_2d::request_screen_shot()
@@ -158,6 +275,43 @@ void renderer_2d::request_tex_release_group(const string& sGroup)
 	request(cmd);
 }
 
+void renderer_2d::request_tex_build_atlas(const string& sGroup)
+{
+	cmd::tex_group_cmd cmd;
+	cmd.eCtrl_	= cmd::tex_group_cmd::BUILD_ATLAS;
+	cmd.sGroup_	= sGroup;
+
+	request(cmd);
+}
+
+void renderer_2d::request_tex_preload_group(const string& sGroup)
+{
+	cmd::tex_group_cmd cmd;
+	cmd.eCtrl_	= cmd::tex_group_cmd::PRELOAD;
+	cmd.sGroup_	= sGroup;
+
+	request(cmd);
+}
+
+void renderer_2d::request_tex_prefetch_group(const string& sGroup)
+{
+	cmd::tex_group_cmd cmd;
+	cmd.eCtrl_	= cmd::tex_group_cmd::PREFETCH;
+	cmd.sGroup_	= sGroup;
+
+	request(cmd);
+}
+
+void renderer_2d::request_tex_group_priority(const string& sGroup, uint32_t nPriority)
+{
+	cmd::tex_group_cmd cmd;
+	cmd.eCtrl_		= cmd::tex_group_cmd::PRIORITY;
+	cmd.sGroup_		= sGroup;
+	cmd.nPriority_	= nPriority;
+
+	request(cmd);
+}
+
 ///////////////////////////////
 // 2Dレンダラー生成関数
 renderer_2d_sptr create_renderer_2d(renderer_2d_kind eKind)
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include "../Memory/linear_arena.h"
+
 #include "renderer_2d_cmd.h"
 
 namespace mana{
@@ -48,13 +50,33 @@ public:
 	//! @ brief request積み処理を開始する
 	virtual bool			start_request(bool bWait=true)=0;
 	//! @brief requestを積む
-	virtual void			request(const cmd::render_2d_cmd& cmd)=0;
+	void					request(const cmd::render_2d_cmd& cmd);
+	//! @brief PODコマンドを積む。variantを経由しない
+	void					request(const cmd::screen_ctrl_cmd& cmd){ request_pod(cmd::STREAM_SCREEN_CTRL, cmd); }
+	void					request(const cmd::sprite_draw_cmd& cmd){ request_pod(cmd::STREAM_SPRITE, cmd); }
+	void					request(const cmd::polygon_draw_cmd& cmd){ request_pod(cmd::STREAM_POLYGON, cmd); }
+	void					request(const cmd::sprite_instance_cmd& cmd){ request_pod(cmd::STREAM_SPRITE_INSTANCE, cmd); }
+	//! @brief テキストはtext_stream_cmdにしてコマンドストリームに積む
+	/*! 文字列はフレーム用アリーナにコピーされるので、積んだ後にtext_dataを書き換えてもよい */
+	void					request(const cmd::text_draw_cmd& cmd);
+	//! キャプチャしたコマンドをまとめて積む
+	void					request(const cmd::cmd_capture& capture);
 	//! request積みの終了
 	virtual void			end_request()=0;
 	//! 積んだリクエストの処理を開始する
 	virtual render_result	render(bool bWait=true)=0;
 	//! @}
 
+	//! @defgroup renderer_2d_capture コマンドキャプチャ
+	//! @{
+	//! @brief 以降に積まれたコマンドを、pCaptureにも記録する
+	/*! 記録したコマンドはrequest(const cmd_capture&)で積み直せる。
+	 *  入れ子にできるように、それまでのキャプチャ先を返すので、end_captureに渡すこと。
+	 *  キャプチャ先はスレッドごとに持つので、別スレッドで積んだコマンドは記録されない */
+	cmd::cmd_capture*		begin_capture(cmd::cmd_capture* pCapture);
+	void					end_capture(cmd::cmd_capture* pPrevCapture);
+	//! @}
+
 	//! @defgroup renderer_2d_util
 	//! @{
 	optional<uint32_t>		texture_id(const string& sID);
@@ -64,6 +86,13 @@ public:
 	//! デバイスロストしてるかどうか
 	virtual bool is_device_lost()const=0;
 
+	//! @brief フレーム用アリーナ
+	/*! start_request ～ end_request の間で確保したメモリは、
+	 *  そのリクエストがレンダラーに処理されるまで有効。
+	 *  コマンドに載せる一時的なデータの確保に使う。テキストの文字列はここにコピーされる。
+	 *  スレッドセーフではないので、start_requestを呼んだスレッドからのみ使うこと */
+	virtual memory::linear_arena& frame_arena()=0;
+
 	//! @defgroup renderer_2d_request_helper リクエストヘルパー
 	//! @{
 	void	request_screen_shot();
@@ -76,13 +105,60 @@ public:
 	void	request_tex_info_add(const string& sID, const string& sFilePath, const function<void(uint32_t)>& callback=nullptr, uint32_t nWidth=0, uint32_t nHeight=0, uint32_t nFormat=0);
 	void	request_tex_info_remove_group(const string& sGroup);
 	void	request_tex_release_group(const string& sGroup);
+	//! アトラス指定で登録したテクスチャをページに詰める
+	void	request_tex_build_atlas(const string& sGroup);
+	//! グループのテクスチャを今すぐ作る
+	void	request_tex_preload_group(const string& sGroup);
+	//! グループのテクスチャを描画を止めない範囲で先に作っておく
+	void	request_tex_prefetch_group(const string& sGroup);
+	//! @brief グループの常駐優先度を設定する
+	/*! @param[in] nPriority texture_residency::priority */
+	void	request_tex_group_priority(const string& sGroup, uint32_t nPriority);
+	//! @}
+
+protected:
+	//! @defgroup renderer_2d_request_inner リクエスト処理実体
+	//! @{
+	virtual void request_cmd(const cmd::render_2d_cmd& cmd)=0;
+	//! @brief PODコマンドを積む
+	/*! variantを経由しないで積めるレンダラーはオーバーライドする */
+	virtual void request_pod(const cmd::screen_ctrl_cmd& cmd){ request_cmd(cmd::render_2d_cmd(cmd)); }
+	virtual void request_pod(const cmd::sprite_draw_cmd& cmd){ request_cmd(cmd::render_2d_cmd(cmd)); }
+	virtual void request_pod(const cmd::polygon_draw_cmd& cmd){ request_cmd(cmd::render_2d_cmd(cmd)); }
+	virtual void request_pod(const cmd::sprite_instance_cmd& cmd)=0;
+	virtual void request_pod(const cmd::text_stream_cmd& cmd)=0;
+	//! キャプチャしたコマンドを、記録した順にまとめて積む
+	virtual void request_capture(const cmd::cmd_capture& capture);
 	//! @}
 
+	//! @brief フォントIDをインターンする
+	/*! 返したポインタはレンダラーが生きている間有効。別スレッドから呼んでもよい */
+	const string_fw* intern_font_id(const string_fw& sFontID);
+
+private:
+	template<class T>
+	void request_pod(cmd::stream_cmd_type eType, const T& cmd)
+	{
+		for(cmd::cmd_capture* p=cur_capture(); p!=nullptr; p=p->pParent_)
+		{
+			p->stream_.push(eType, cmd);
+			if(p->bDefer_) return;
+		}
+		request_pod(cmd);
+	}
+
+	//! このスレッドのキャプチャ先
+	static cmd::cmd_capture* cur_capture();
+
 protected:
 	d3d9_renderer_2d* pRenderer_; //!< 描画処理実体
 
 	reset_handler resetHandler_; //!< device_resetが終了した時に呼ばれる
 
+private:
+	set<string_fw>		setFontID_;		//!< インターンしたフォントID。要素は消さない
+	std::atomic_flag	fontIDLock_;
+
 #ifdef MANA_DEBUG
 public:
 	// 再定義フラグ。trueにするとテクスチャ情報登録などの時に同IDが登録されていた場合、上書きする
@@ -18,11 +18,21 @@ bool renderer_2d_async::init_render(uint32_t nReserveRequestNum, uint32_t nAffin
 	cmdQueue_[0].init(nReserveRequestNum);
 	cmdQueue_[1].init(nReserveRequestNum);
 
+	cmdStream_[0].init(nReserveRequestNum*sizeof(cmd::sprite_draw_cmd));
+	cmdStream_[1].init(nReserveRequestNum*sizeof(cmd::sprite_draw_cmd));
+
+	frameArena_.init();
+
 #ifdef MANA_SYNC_QUEUE_CMD_COUNT
 	cmdQueue_[0].set_mes("render_2d_0");
 	cmdQueue_[1].set_mes("render_2d_1");
 #endif
 
+#ifdef MANA_CMD_STREAM_COUNT
+	cmdStream_[0].set_mes("render_2d_0");
+	cmdStream_[1].set_mes("render_2d_1");
+#endif
+
 	// スレッド起動
 	if(!executer_.kick(nAffinity))
 	{
@@ -50,13 +60,16 @@ bool renderer_2d_async::start_request(bool bWait)
 	{
 		if(curQueue.lock(bWait))
 		{
-			if(!curQueue.queue().empty() && renderer_.state()!=STOP)
+			if(!is_cmd_empty(nCurReqIndex_) && renderer_.state()!=STOP)
 			{// リクエスト処理前なのにロック取れてしまったら
 			 // ロックを開放して、処理が終わるまで待つ
 				curQueue.unlock();
 			}
 			else
-			{
+			{// 積まれたキューが空ならば、同じインデックスのアリーナも使い終わっている
+				if(is_cmd_empty(nCurReqIndex_))
+					frameArena_.set_frame(nCurReqIndex_);
+
 				return true;
 			}
 		}
@@ -67,9 +80,20 @@ bool renderer_2d_async::start_request(bool bWait)
 	}
 }
 
-void renderer_2d_async::request(const cmd::render_2d_cmd& cmd)
+void renderer_2d_async::request_cmd(const cmd::render_2d_cmd& cmd)
 {
 	cur_queue().push_cmd(cmd);
+	cur_stream().push_marker(cmd::STREAM_QUEUE_CMD);
+}
+
+void renderer_2d_async::request_capture(const cmd::cmd_capture& capture)
+{
+	// キャプチャのストリームにはvecCmd_の位置が積まれているので、キューには足すだけでよい
+	cmd_queue& curQueue = cur_queue();
+	for(auto& it : capture.vecCmd_)
+		curQueue.push_cmd(it);
+
+	cur_stream().append(capture.stream_);
 }
 
 void renderer_2d_async::end_request()
@@ -85,7 +109,7 @@ render_result renderer_2d_async::render(bool bWait)
 		switch(renderer_.state())
 		{
 		case STOP:
-			if(!cur_queue().queue().empty())
+			if(!is_cmd_empty(nCurReqIndex_))
 			{
 				if(nCurReqIndex_==0)
 					renderer_.set_state(RECEIVE_0);
@@ -180,10 +204,13 @@ void renderer_2d_async::render_executer::render(uint32_t nIndex)
 	queue_.start_receive(nIndex);
 	cmd_queue::queue_type& curQueue = queue_.cmdQueue_[nIndex].queue();
 
+	// ストリームに積まれた位置で、キューのコマンドも実行する
 	cmd::render_2d_cmd_exec receiver(*pRenderer_);
-	std::for_each(curQueue.begin(), curQueue.end(), boost::apply_visitor(receiver));
+	concurrent::cmd_stream& curStream = queue_.cmdStream_[nIndex];
+	cmd::exec_cmd_stream(curStream, curQueue, receiver);
 
 	curQueue.clear();
+	curStream.clear();
 	queue_.end_receive(nIndex);
 
 	// 描画処理
@@ -49,9 +49,6 @@ public:
 	/*! @param[in] bWait リクエストを積む準備ができてない時、ブロックする
 	 *  @return bWaitがfalseの場合、falseが返って来たらコマンドキューが使用中でリクエストが積めない状態 */
 	bool start_request(bool bWait=true)override;
-	//! @brief requestを積む
-	/*! start_request ～ end_request の間でのみ呼ぶこと */
-	void request(const cmd::render_2d_cmd& cmd)override;
 	//! request積みの終了
 	void end_request()override;
 	//! @brief 積んだリクエストの処理を開始する
@@ -63,13 +60,39 @@ public:
 	//! デバイスロストしてるかどうか
 	bool is_device_lost()const override{ return renderer_.state()==DEVICE_LOST; }
 
+	//! 現在リクエストを積んでいるキューに対応するアリーナ
+	memory::linear_arena& frame_arena()override{ return frameArena_.cur(); }
+
+protected:
+	//! @brief requestを積む
+	/*! start_request ～ end_request の間でのみ呼ぶこと */
+	/*! ストリームにも位置を積んで、PODコマンドと積んだ順に処理されるようにする */
+	void request_cmd(const cmd::render_2d_cmd& cmd)override;
+	//! @brief PODコマンドを積む
+	/*! コマンドストリームに直接書き込むので、variantの生成やヒープ確保が無い */
+	void request_pod(const cmd::screen_ctrl_cmd& cmd)override{ cur_stream().push(cmd::STREAM_SCREEN_CTRL, cmd); }
+	void request_pod(const cmd::sprite_draw_cmd& cmd)override{ cur_stream().push(cmd::STREAM_SPRITE, cmd); }
+	void request_pod(const cmd::polygon_draw_cmd& cmd)override{ cur_stream().push(cmd::STREAM_POLYGON, cmd); }
+	void request_pod(const cmd::sprite_instance_cmd& cmd)override{ cur_stream().push(cmd::STREAM_SPRITE_INSTANCE, cmd); }
+	//! 文字列はframe_arenaを指しているので、ポインタのまま積む
+	void request_pod(const cmd::text_stream_cmd& cmd)override{ cur_stream().push(cmd::STREAM_TEXT, cmd); }
+	//! ストリームは位置ごとそのままコピーする
+	void request_capture(const cmd::cmd_capture& capture)override;
+
 private:
-	cmd_queue&	cur_queue(){ return cmdQueue_[nCurReqIndex_]; }
-	void		swap_queue(){ nCurReqIndex_^=1; }
+	cmd_queue&					cur_queue(){ return cmdQueue_[nCurReqIndex_]; }
+	concurrent::cmd_stream&		cur_stream(){ return cmdStream_[nCurReqIndex_]; }
+	void						swap_queue(){ nCurReqIndex_^=1; }
+
+	//! 指定インデックスのキューかストリームにコマンドが積まれているか
+	bool						is_cmd_empty(uint32_t nIndex){ return cmdQueue_[nIndex].queue().empty() && cmdStream_[nIndex].empty(); }
 
 private:
-	cmd_queue	cmdQueue_[2];	// ダブルバッファ
-	uint32_t	nCurReqIndex_;	// 現在リクエストを積むインデックス
+	cmd_queue				cmdQueue_[2];	// ダブルバッファ
+	concurrent::cmd_stream	cmdStream_[2];	// PODコマンド用ダブルバッファ。cmdQueue_のロックで一緒に守られる
+	uint32_t				nCurReqIndex_;	// 現在リクエストを積むインデックス
+
+	memory::frame_arena<2> frameArena_; // キューと同じ段数のフレーム用アリーナ
 
 private:
 	NON_COPIABLE(renderer_2d_async);
@@ -82,7 +82,7 @@ void render_2d_cmd_exec::operator()(tex_info_add_cmd& cmd)const
 	if(cmd.sFilePath_.empty())
 		texMgr.add_texture_info(cmd.sTextureID_, cmd.nWidth_, cmd.nHeight_, static_cast<D3DFORMAT>(cmd.nFormat_), cmd.sGroup_, cmd.release_handler_);
 	else
-		texMgr.add_texture_info(cmd.sTextureID_, cmd.sFilePath_, cmd.sGroup_);
+		texMgr.add_texture_info(cmd.sTextureID_, cmd.sFilePath_, cmd.sGroup_, cmd.bAtlas_);
 
 	if(cmd.callback_)
 	{
@@ -104,6 +104,10 @@ void render_2d_cmd_exec::operator()(tex_group_cmd& cmd)const
 	{
 	case tex_group_cmd::REMOVE:		texMgr.remove_texture_info_group(cmd.sGroup_);	break;
 	case tex_group_cmd::RELEASE:	texMgr.release_texture_group(cmd.sGroup_);		break;
+	case tex_group_cmd::BUILD_ATLAS:texMgr.build_atlas(cmd.sGroup_);				break;
+	case tex_group_cmd::PRELOAD:	texMgr.preload_group(cmd.sGroup_);				break;
+	case tex_group_cmd::PREFETCH:	texMgr.prefetch_group(cmd.sGroup_);				break;
+	case tex_group_cmd::PRIORITY:	texMgr.set_group_priority(cmd.sGroup_, cmd.nPriority_); break;
 	}
 }
 
@@ -112,6 +116,11 @@ void render_2d_cmd_exec::operator()(text_draw_cmd& cmd)const
 	renderer_.draw_text(cmd);
 }
 
+void render_2d_cmd_exec::operator()(text_stream_cmd& cmd, const char* szExt)const
+{
+	renderer_.draw_text(cmd, szExt);
+}
+
 void render_2d_cmd_exec::operator()(cmd::sprite_draw_cmd& cmd)const
 {
 	sprite_param sp;
@@ -183,6 +192,89 @@ void render_2d_cmd_exec::operator()(cmd::sprite_draw_cmd& cmd)const
 	renderer_.draw_sprite(sp, cmd.nRenderTarget_);
 }
 
+void render_2d_cmd_exec::operator()(cmd::sprite_instance_cmd& cmd)const
+{
+	sprite_param sp;
+	sp.nTextureID_ = cmd.nTexID_;
+	sp.set_color(0,cmd.nColor0_);
+	sp.set_color(1,cmd.nColor1_);
+	sp.mode_ = cmd.mode_;
+
+	if(cmd.nTexID_>0 && cmd.rect_.width()==0 && cmd.rect_.height()==0)
+	{// サイズ0だったら、テクスチャサイズで描画する
+		const D3DXIMAGE_INFO& img = renderer_.tex_manager().texture_image_info(cmd.nTexID_);
+		cmd.rect_.fLeft= 0.f;
+		cmd.rect_.fRight = static_cast<float>(img.Width);
+		cmd.rect_.fTop = 0.f;
+		cmd.rect_.fBottom = static_cast<float>(img.Height);
+	}
+
+	// UV。ここでは画像サイズのまま
+	sp.set_uv_rect(cmd.rect_.fLeft, cmd.rect_.fTop, cmd.rect_.fRight, cmd.rect_.fBottom);
+
+	// 頂点位置展開。左上・右上・左下・右下
+	const float fW = cmd.rect_.width();
+	const float fH = cmd.rect_.height();
+	cmd.transform(0.f,	0.f,	sp.pos_[0].fX, sp.pos_[0].fY);
+	cmd.transform(fW,	0.f,	sp.pos_[1].fX, sp.pos_[1].fY);
+	cmd.transform(0.f,	fH,		sp.pos_[2].fX, sp.pos_[2].fY);
+	cmd.transform(fW,	fH,		sp.pos_[3].fX, sp.pos_[3].fY);
+
+	RECT sprite(FLT_MAX,FLT_MAX,-FLT_MAX,-FLT_MAX);
+	for(uint32_t i=0; i<4; ++i)
+	{
+		sp.pos_[i].fZ = cmd.fZ_;
+
+		if(sprite.fLeft  >sp.pos_[i].fX) sprite.fLeft  =sp.pos_[i].fX;
+		if(sprite.fRight <sp.pos_[i].fX) sprite.fRight =sp.pos_[i].fX;
+		if(sprite.fTop   >sp.pos_[i].fY) sprite.fTop   =sp.pos_[i].fY;
+		if(sprite.fBottom<sp.pos_[i].fY) sprite.fBottom=sp.pos_[i].fY;
+	}
+
+	// 4頂点とWindowサイズでAABB判定交差しなかったら描画しない
+	if(sprite.fRight<0.f  || sprite.fLeft>static_cast<float>(renderer_.render_width())
+	|| sprite.fBottom<0.f || sprite.fTop >static_cast<float>(renderer_.render_height()))
+		return;
+
+	renderer_.draw_sprite(sp, cmd.nRenderTarget_);
+}
+
+/////////////////////////////////
+// コマンドストリーム実行
+/////////////////////////////////
+void exec_cmd_stream(const concurrent::cmd_stream& stream, vector<render_2d_cmd>& vecCmd, const render_2d_cmd_exec& receiver)
+{
+	uint32_t nCmdIndex=0;
+
+	concurrent::cmd_stream::reader r(stream);
+	while(r.next())
+	{
+		switch(r.type())
+		{
+		case STREAM_QUEUE_CMD:
+			if(nCmdIndex<vecCmd.size())
+				boost::apply_visitor(receiver, vecCmd[nCmdIndex++]);
+		break;
+
+		case STREAM_SCREEN_CTRL:	receiver(r.get<screen_ctrl_cmd>());		break;
+		case STREAM_SPRITE:			receiver(r.get<sprite_draw_cmd>());		break;
+		case STREAM_POLYGON:		receiver(r.get<polygon_draw_cmd>());	break;
+		case STREAM_SPRITE_INSTANCE:receiver(r.get<sprite_instance_cmd>());	break;
+		case STREAM_TEXT:			receiver(r.get<text_stream_cmd>(), r.ext_str()); break;
+		default:
+			logger::warnln("[exec_cmd_stream]不明なコマンドが積まれています : " + to_str(r.type()));
+		break;
+		}
+	}
+
+	if(nCmdIndex<vecCmd.size())
+	{// 位置が残っていないコマンドは最後に実行する
+		logger::warnln("[exec_cmd_stream]ストリームに位置が無いコマンドがあります : " + to_str(vecCmd.size()-nCmdIndex));
+		for(; nCmdIndex<vecCmd.size(); ++nCmdIndex)
+			boost::apply_visitor(receiver, vecCmd[nCmdIndex]);
+	}
+}
+
 void render_2d_cmd_exec::operator()(polygon_draw_cmd& cmd)const
 {
 	sprite_param sp;
@@ -5,6 +5,8 @@
  */
 #pragma once
 
+#include "../Concurrent/cmd_stream.h"
+
 #include "renderer_2d_util.h"
 #include "d3d9_driver.h"
 #include "text_data.h"
@@ -89,7 +91,7 @@ public:
 struct tex_info_add_cmd
 {
 public:
-	tex_info_add_cmd():nWidth_(0),nHeight_(0),nFormat_(0)
+	tex_info_add_cmd():nWidth_(0),nHeight_(0),nFormat_(0),bAtlas_(false)
 	{
 		release_handler_ = [](const tex_info&){};
 
@@ -108,6 +110,8 @@ public:
 
 	string	sGroup_;
 
+	bool	bAtlas_;	// trueだとアトラスに詰める候補になる。詰めるのはBUILD_ATLASの時
+
 	// レンダーターゲットがvram_manageされて消える時に呼ばれるハンドラ
 	function<void(const tex_info&)> release_handler_;
 
@@ -126,11 +130,19 @@ public:
 	{
 		REMOVE,
 		RELEASE,
+		BUILD_ATLAS,	//!< アトラス候補をページに詰める
+		PRELOAD,		//!< 今すぐテクスチャを作る
+		PREFETCH,		//!< 描画を止めない範囲で先に作っておく
+		PRIORITY,		//!< 常駐優先度を設定する
 	};
 
+public:
+	tex_group_cmd():nPriority_(0){}
+
 public:
 	enum ctrl	eCtrl_;
 	string		sGroup_;
+	uint32_t	nPriority_;	//!< PRIORITYの時の優先度。texture_residency::priority
 };
 
 //! テキスト描画コマンド
@@ -148,6 +160,31 @@ public:
 	uint32_t				nRenderTarget_;
 };
 
+/*! @brief コマンドストリーム用テキスト描画コマンド
+ *
+ *  renderer_2d::request(const text_draw_cmd&)が、text_dataの中身をコピーして作る。
+ *  文字列はフレーム用アリーナにコピーして、そのポインタを持つ。
+ *  キャプチャに記録する時はポインタをnullptrにして、終端付きでレコードの追加データにコピーする。
+ *  フォントIDはrenderer_2dがインターンしたものを指すので、レンダラーが生きている間は有効 */
+struct text_stream_cmd
+{
+public:
+	text_stream_cmd():szText_(nullptr),pFontID_(nullptr),nTextSize_(0),nCharNum_(UINT_MAX),nColor_(0xFFFFFFFF),nRenderTarget_(cmd::BACK_BUFFER_ID),bMarkUp_(false){}
+
+	//! 文字列。nullptrの時は追加データ
+	const char* text(const char* szExt)const{ return szText_!=nullptr ? szText_ : szExt; }
+
+public:
+	const char*			szText_;
+	const string_fw*	pFontID_;
+	uint32_t			nTextSize_;		//!< 終端を含まない文字列のバイト数
+	uint32_t			nCharNum_;		//!< この値までの文字数を描画する
+	draw::POS			pos_;
+	DWORD				nColor_;
+	uint32_t			nRenderTarget_;
+	bool				bMarkUp_;
+};
+
 //! スプライト描画コマンド
 struct sprite_draw_cmd
 {
@@ -169,6 +206,51 @@ public:
 	uint32_t	nRenderTarget_;
 };
 
+/*! @brief スプライトインスタンス描画コマンド
+ *
+ *  sprite_draw_cmdの4x4行列を2x3のアフィン変換にした、1スプライト1レコードのコンパクト版。
+ *  2Dスプライトは回転・拡縮・平行移動しか使わないので、これで足りる。
+ *  頂点への展開はレンダースレッド側で行う */
+struct sprite_instance_cmd
+{
+public:
+	sprite_instance_cmd():fZ_(0.0f),nColor0_(D3DCOLOR_ARGB(255,255,255,255)),nColor1_(D3DCOLOR_ARGB(255,255,255,255)),
+						  nTexID_(0),mode_(MODE_TEX_COLOR_BLEND),nRenderTarget_(cmd::BACK_BUFFER_ID)
+	{ set_affine(1.f,0.f,0.f,1.f,0.f,0.f); }
+
+	explicit sprite_instance_cmd(const sprite_draw_cmd& cmd):rect_(cmd.rect_),fZ_(cmd.fZ_),nColor0_(cmd.nColor0_),nColor1_(cmd.nColor1_),
+															 nTexID_(cmd.nTexID_),mode_(cmd.mode_),nRenderTarget_(cmd.nRenderTarget_)
+	{ set_affine(cmd.worldMat_); }
+
+public:
+	void set_affine(float f11, float f12, float f21, float f22, float f41, float f42)
+	{
+		affine_[0]=f11; affine_[1]=f12;
+		affine_[2]=f21; affine_[3]=f22;
+		affine_[4]=f41; affine_[5]=f42;
+	}
+
+	//! 4x4行列からアフィン部分だけを取り出す
+	void set_affine(const D3DXMATRIX& m){ set_affine(m._11, m._12, m._21, m._22, m._41, m._42); }
+
+	//! (fX,fY)をアフィン変換する
+	void transform(float fX, float fY, float& fOutX, float& fOutY)const
+	{
+		fOutX = fX*affine_[0] + fY*affine_[2] + affine_[4];
+		fOutY = fX*affine_[1] + fY*affine_[3] + affine_[5];
+	}
+
+public:
+	float		affine_[6];	//!< _11,_12,_21,_22,_41,_42 の順
+	draw::RECT	rect_;
+	float		fZ_;
+	DWORD		nColor0_;
+	DWORD		nColor1_;
+	uint32_t	nTexID_;
+	draw_mode	mode_;
+	uint32_t	nRenderTarget_;
+};
+
 //! ポリゴン描画コマンド。実質デバッグ用なのであまり機能はない
 struct polygon_draw_cmd
 {
@@ -221,7 +303,10 @@ public:
 	void operator()(tex_info_add_cmd& cmd)const;
 	void operator()(tex_group_cmd& cmd)const;
 	void operator()(text_draw_cmd& cmd)const;
+	//! @param[in] szExt レコードの追加データ
+	void operator()(text_stream_cmd& cmd, const char* szExt)const;
 	void operator()(sprite_draw_cmd& cmd)const;
+	void operator()(sprite_instance_cmd& cmd)const;
 	void operator()(polygon_draw_cmd& cmd)const;
 
 private:
@@ -231,6 +316,53 @@ private:
 	NON_COPIABLE(render_2d_cmd_exec);
 };
 
+/////////////////////////
+// コマンドストリーム
+
+/*! @brief cmd_streamに積むPODコマンドの種別
+ *
+ *  毎フレーム大量に積まれる、コピーしてよいコマンドだけをストリームで扱う。
+ *  それ以外のコマンドは従来通りrender_2d_cmdで積み、
+ *  ストリームにはSTREAM_QUEUE_CMDを積んで順番を残しておく */
+enum stream_cmd_type : uint16_t
+{
+	STREAM_QUEUE_CMD,	//!< 本体無し。ここでrender_2d_cmdを1つ実行する
+	STREAM_SCREEN_CTRL,
+	STREAM_SPRITE,
+	STREAM_POLYGON,
+	STREAM_SPRITE_INSTANCE,
+	STREAM_TEXT,
+};
+
+//! @brief cmd_streamに積まれたコマンドを、積まれた順にreceiverで実行する
+/*! STREAM_QUEUE_CMDの所で、vecCmdのコマンドを先頭から1つずつ実行する */
+extern void exec_cmd_stream(const concurrent::cmd_stream& stream, vector<render_2d_cmd>& vecCmd, const render_2d_cmd_exec& receiver);
+
+/*! @brief 積まれたコマンドの記録
+ *
+ *  renderer_2d::begin_capture～end_captureの間に積まれたコマンドが記録される。
+ *  graphic::static_layerが、変化の無いサブツリーのコマンドを使い回すのに使う
+ *
+ *  キャプチャ中にさらにキャプチャを始めると、コマンドは内側から外側の順に全てに記録される。
+ *  bDefer_がtrueのキャプチャより外側とレンダラーには積まれないので、
+ *  後でまとめてrequestし直す。graphic::parallel_layerが、別スレッドで積んだコマンドを
+ *  決まった順番でレンダラーに積むのに使う */
+struct cmd_capture
+{
+public:
+	cmd_capture():bDefer_(false),pParent_(nullptr){}
+
+	void clear(){ stream_.clear(); vecCmd_.clear(); }
+	bool empty()const{ return stream_.empty() && vecCmd_.empty(); }
+
+public:
+	concurrent::cmd_stream	stream_;	//!< PODコマンド。vecCmd_の位置にはSTREAM_QUEUE_CMDが積まれる
+	vector<render_2d_cmd>	vecCmd_;	//!< それ以外のコマンド
+
+	bool					bDefer_;	//!< trueだと、記録したコマンドを外側やレンダラーに積まない
+	cmd_capture*			pParent_;	//!< 外側のキャプチャ。begin_captureで設定される
+};
+
 } // namespace cmd end
 
 } // namespace draw end
@@ -27,6 +27,8 @@ bool renderer_2d_sync::init_render(uint32_t nReserveRequestNum, uint32_t nAffini
 
 	eRenderResult_=RENDER_SUCCESS;
 
+	frameArena_.init();
+
 	logger::infoln("[render_2d_sync]同期版renderer_2d初期化しました");
 	return true;
 }
@@ -36,7 +38,15 @@ void renderer_2d_sync::fin()
 	pRenderer_->fin();
 }
 
-void renderer_2d_sync::request(const cmd::render_2d_cmd& cmd)
+bool renderer_2d_sync::start_request(bool bWait)
+{
+	if(is_device_lost()) return false;
+
+	frameArena_.reset();
+	return true;
+}
+
+void renderer_2d_sync::request_cmd(const cmd::render_2d_cmd& cmd)
 {
 #ifdef MANA_RENDER_2D_CMD_COUNT
 	++nCurCmd_;
@@ -46,6 +56,36 @@ void renderer_2d_sync::request(const cmd::render_2d_cmd& cmd)
 	boost::apply_visitor(cmd::render_2d_cmd_exec(*pRenderer_), const_cast<cmd::render_2d_cmd&>(cmd));
 }
 
+template<class T>
+void renderer_2d_sync::exec_pod(const T& cmd)
+{
+#ifdef MANA_RENDER_2D_CMD_COUNT
+	++nCurCmd_;
+#endif
+
+	// visitorは引数を書き換えることがあるので、スタックにコピーして渡す
+	T c = cmd;
+	cmd::render_2d_cmd_exec receiver(*pRenderer_);
+	receiver(c);
+}
+
+void renderer_2d_sync::request_pod(const cmd::screen_ctrl_cmd& cmd){ exec_pod(cmd); }
+void renderer_2d_sync::request_pod(const cmd::sprite_draw_cmd& cmd){ exec_pod(cmd); }
+void renderer_2d_sync::request_pod(const cmd::polygon_draw_cmd& cmd){ exec_pod(cmd); }
+void renderer_2d_sync::request_pod(const cmd::sprite_instance_cmd& cmd){ exec_pod(cmd); }
+
+void renderer_2d_sync::request_pod(const cmd::text_stream_cmd& cmd)
+{
+#ifdef MANA_RENDER_2D_CMD_COUNT
+	++nCurCmd_;
+#endif
+
+	// 文字列はアリーナかストリームを指しているので、追加データは無い
+	cmd::text_stream_cmd c = cmd;
+	cmd::render_2d_cmd_exec receiver(*pRenderer_);
+	receiver(c, nullptr);
+}
+
 render_result renderer_2d_sync::render(bool bWait)
 {
 #ifdef MANA_RENDER_2D_CMD_COUNT
@@ -26,9 +26,7 @@ public:
 	//! @defgroup renderer_2d_sync_request リクエスト処理
 	//! @{
 	//! @ brief request積み処理を開始する
-	bool			start_request(bool bWait=true)override{ return !is_device_lost(); }
-	//! @brief requestを積む
-	void			request(const cmd::render_2d_cmd& cmd)override;
+	bool			start_request(bool bWait=true)override;
 	//! request積みの終了
 	void			end_request()override{}
 	//! 積んだリクエストの処理を開始する
@@ -38,9 +36,28 @@ public:
 	//! デバイスロストしてるかどうか
 	bool is_device_lost()const override{ return eRenderResult_==RENDER_DEVICE_LOST; }
 
+	//! 同期版はrequestの中で処理されるので、アリーナは1つでよい
+	memory::linear_arena& frame_arena()override{ return frameArena_; }
+
+protected:
+	//! @brief requestを積む
+	void			request_cmd(const cmd::render_2d_cmd& cmd)override;
+	//! @brief PODコマンドを積む。variantを経由せずにすぐ処理する
+	void			request_pod(const cmd::screen_ctrl_cmd& cmd)override;
+	void			request_pod(const cmd::sprite_draw_cmd& cmd)override;
+	void			request_pod(const cmd::polygon_draw_cmd& cmd)override;
+	void			request_pod(const cmd::sprite_instance_cmd& cmd)override;
+	void			request_pod(const cmd::text_stream_cmd& cmd)override;
+
+private:
+	template<class T>
+	void exec_pod(const T& cmd);
+
 private:
 	render_result eRenderResult_;
 
+	memory::linear_arena frameArena_;
+
 #ifdef MANA_RENDER_2D_CMD_COUNT
 	uint32_t nMaxCmd_;
 	uint32_t nCurCmd_;
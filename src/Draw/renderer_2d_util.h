@@ -61,6 +61,8 @@ struct renderer_2d_init
 
 	uint32_t	nReserveTextureNum_;		//!< 使用するテクスチャ枚数の推定値(越えても大丈夫)
 	uint32_t	nTextureMaxVRAM_;			//!< テクスチャ容量制限(byte)。0だと制限なし
+	uint32_t	nTextureLoadThreadNum_;		//!< テクスチャファイルを非同期に読み込むスレッド数。0だと使う時に同期で読み込む
+	uint32_t	nTextureUploadByte_;		//!< 非同期読み込みや先読みの時、1フレームで生成するテクスチャ容量の目安(byte)。0だと制限なし
 
 	uint32_t	nReserveFontNum_;			//!< 使用するフォントの推定数
 
@@ -70,6 +72,7 @@ struct renderer_2d_init
 						nMaxDrawSpriteNum_(DEFAULT_MAX_SPRITE_NUM),nMaxDrawCallPrimitiveNum_(DEFAULT_MAX_SPRITE_NUM),
 						nBackgroundColor_(0xFF000000),
 						nReserveTextureNum_(128),nTextureMaxVRAM_(0),
+						nTextureLoadThreadNum_(0),nTextureUploadByte_(4*1024*1024),
 						nReserveFontNum_(16){}
 };
 
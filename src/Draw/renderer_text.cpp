@@ -241,14 +241,10 @@ bool is_space(uint8_t c)
 
 bool renderer_text::draw_text(renderer_sprite_queue& queue, struct cmd::text_draw_cmd& cmd)
 {
-	const shared_ptr<text_data>& pTextData		= cmd.pText_;
-	const uint32_t				 nCharNum		= cmd.nCharNum_;
-	const draw::POS&			 pos			= cmd.pos_;
-	const DWORD					 nColor			= cmd.nColor_;
-	const uint32_t				 nRenderTarget	= cmd.nRenderTarget_;
+	const shared_ptr<text_data>& pTextData = cmd.pText_;
 
 	// 描画文字数0なので即座にリターン
-	if(nCharNum==0) return true;
+	if(cmd.nCharNum_==0) return true;
 
 	if(!pTextData || pTextData->text().empty())
 	{
@@ -256,9 +252,30 @@ bool renderer_text::draw_text(renderer_sprite_queue& queue, struct cmd::text_dra
 		return false;
 	}
 
-	if(!is_font_info(pTextData->font_id()))
+	return draw_text_inner(queue, pTextData->font_id(), pTextData->text().c_str(), pTextData->text().size(), pTextData->is_markup(),
+						   cmd.nCharNum_, cmd.pos_, cmd.nColor_, cmd.nRenderTarget_);
+}
+
+bool renderer_text::draw_text(renderer_sprite_queue& queue, const struct cmd::text_stream_cmd& cmd, const char* szExt)
+{
+	if(cmd.nCharNum_==0) return true;
+
+	if(cmd.nTextSize_==0)
+	{
+		logger::warnln("[renderer_text][draw_text]テキストデータが設定されていません。");
+		return false;
+	}
+
+	return draw_text_inner(queue, *cmd.pFontID_, cmd.text(szExt), cmd.nTextSize_, cmd.bMarkUp_,
+						   cmd.nCharNum_, cmd.pos_, cmd.nColor_, cmd.nRenderTarget_);
+}
+
+bool renderer_text::draw_text_inner(renderer_sprite_queue& queue, const string_fw& sFontID, const char* pText, uint32_t nTextSize, bool bMarkUp,
+									uint32_t nCharNum, const draw::POS& pos, DWORD nColor, uint32_t nRenderTarget)
+{
+	if(!is_font_info(sFontID))
 	{
-		logger::warnln("[renderer_text][draw_text]フォント情報が登録されていません。: " + pTextData->font_id().get());
+		logger::warnln("[renderer_text][draw_text]フォント情報が登録されていません。: " + sFontID.get());
 		return false;
 	}
 
@@ -267,7 +284,7 @@ bool renderer_text::draw_text(renderer_sprite_queue& queue, struct cmd::text_dra
 
 	// マークアップ処理準備
 	bool		bMarkupCmd = false;	 // マークアップ処理中華どうか。[が来るとtrueになり]が来るとfalseになる
-	font_info*	pCurFont	= get_font_info(pTextData->font_id());
+	font_info*	pCurFont	= get_font_info(sFontID);
 	DWORD		curColor	= nColor;
 
 	// 先頭から文字に分解しながらも文字情報を取得しつつコマンドを積む
@@ -276,8 +293,6 @@ bool renderer_text::draw_text(renderer_sprite_queue& queue, struct cmd::text_dra
 	bool		bBreak		= false; // 改行するかどうか
 
 	uint16_t nCode=0;
-	const char* pText = pTextData->text().c_str();
-	const uint32_t nTextSize = pTextData->text().size();
 	uint32_t i=0; // 処理中の文字バイト位置
 
 	while(i<nTextSize && nCurCharNum<nCharNum)
@@ -294,13 +309,13 @@ bool renderer_text::draw_text(renderer_sprite_queue& queue, struct cmd::text_dra
 			if((c>=0x01 && c<=0x1f) || c==0x7f)
 			{
 				// LFは改行扱いになるかもしれない
-				if(!pTextData->is_markup() && c=='\n')
+				if(!bMarkUp && c=='\n')
 					bBreak=true;
 				else
 					continue;
 			}
 
-			if(pTextData->is_markup() && c=='[')
+			if(bMarkUp && c=='[')
 			{// マークアップ開始文字
 				bMarkupCmd = true;
 			}
@@ -326,7 +341,7 @@ bool renderer_text::draw_text(renderer_sprite_queue& queue, struct cmd::text_dra
 
 		// マークアップコマンドチェック
 #pragma region markup
-		if(pTextData->is_markup() && bMarkupCmd)
+		if(bMarkUp && bMarkupCmd)
 		{// ] までの範囲を取得する
 			uint32_t j = i+1;
 			while(j<nTextSize)
@@ -389,7 +404,7 @@ bool renderer_text::draw_text(renderer_sprite_queue& queue, struct cmd::text_dra
 		{// 改行チェック
 			curPos.fX = pos.fX;
 			// Markupじゃない場合の改行はレターサイズからの算出される固定値
-			if(!pTextData->is_markup() || fMaxHeight==0.0f)
+			if(!bMarkUp || fMaxHeight==0.0f)
 				fMaxHeight = static_cast<float>(pCurFont->letter_pixel_size())*pCurFont->line_height();
 
 			curPos.fY += fMaxHeight;
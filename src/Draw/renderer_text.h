@@ -10,6 +10,7 @@ namespace draw{
 
 namespace cmd{
 struct text_draw_cmd;
+struct text_stream_cmd;
 } // namespace cmd end
 
 class renderer_sprite_queue;
@@ -134,11 +135,17 @@ public:
 	/*! @param[in] queue 描画コマンドの積み先
 	 *  @param[in] cmd 描画情報が入ったテキストコマンド */
 	bool draw_text(renderer_sprite_queue& queue, struct cmd::text_draw_cmd& cmd);
+	//! @brief コマンドストリームに積まれたテキストの描画
+	/*! @param[in] szExt レコードの追加データ。文字列がキャプチャされている時はここから読む */
+	bool draw_text(renderer_sprite_queue& queue, const struct cmd::text_stream_cmd& cmd, const char* szExt);
 	//! @}
 
 private:
 	font_info* 	get_font_info(const string_fw& nID);
 
+	bool draw_text_inner(renderer_sprite_queue& queue, const string_fw& sFontID, const char* pText, uint32_t nTextSize, bool bMarkUp,
+						 uint32_t nCharNum, const draw::POS& pos, DWORD nColor, uint32_t nRenderTarget);
+
 private:
 	//! 管理してるフォント情報マップ
 	font_map		mapFont_;
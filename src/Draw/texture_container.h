@@ -0,0 +1,106 @@
+﻿#pragma once
+
+namespace mana{
+namespace draw{
+
+/*! @brief 変換済みテクスチャコンテナ(.mtex)のヘッダ
+ *
+ *  tool/TextureConvで作る。ヘッダの後ろにミップレベル0から順にデータが並ぶ。
+ *  ブロック圧縮やミップマップ生成はオフラインで済ませてあるので、
+ *  読み込む時はデコードせずにテクスチャにコピーするだけでよい
+ *
+ *  データの並び
+ *  　BC1/BC3 : 4x4ブロックを左上から行ごとに並べる
+ *  　RGBA8   : 1ピクセル4byteをB,G,R,Aの順に並べる(D3DFMT_A8R8G8B8と同じ)
+ *
+ *  ツールからも使うので、mana_common.hに依存しないこと
+ */
+struct texture_container_header
+{
+	enum container_const : uint32_t
+	{
+		MAGIC	= 0x5845544D, //!< 'MTEX'
+		VERSION	= 1,
+	};
+
+	enum format : uint32_t
+	{
+		FORMAT_RGBA8,	//!< 無圧縮
+		FORMAT_BC1,		//!< DXT1。1bitα
+		FORMAT_BC3,		//!< DXT5。8bitα
+	};
+
+	uint32_t nMagic_;
+	uint32_t nVersion_;
+	uint32_t nFormat_;
+	uint32_t nImageWidth_;	//!< 元画像の幅
+	uint32_t nImageHeight_;	//!< 元画像の高さ
+	uint32_t nWidth_;		//!< テクスチャの幅。2の累乗に広げてある
+	uint32_t nHeight_;		//!< テクスチャの高さ。2の累乗に広げてある
+	uint32_t nMipLevels_;	//!< ミップレベル数
+	uint32_t nDataSize_;	//!< ヘッダより後ろのデータサイズ
+	uint32_t nReserved_[3];
+
+	//! ブロック圧縮フォーマットか
+	static bool		is_block(uint32_t nFormat){ return nFormat==FORMAT_BC1 || nFormat==FORMAT_BC3; }
+
+	//! 1ブロック(圧縮時)か1ピクセル(無圧縮時)のバイト数
+	static uint32_t	unit_byte(uint32_t nFormat)
+	{
+		switch(nFormat)
+		{
+		case FORMAT_BC1: return 8;
+		case FORMAT_BC3: return 16;
+		default:		 return 4;
+		}
+	}
+
+	//! ミップレベルの幅・高さ
+	static uint32_t	level_length(uint32_t nLength, uint32_t nLevel){ nLength >>= nLevel; return nLength>0 ? nLength : 1; }
+
+	//! ミップレベルの1行のバイト数。ブロック圧縮の時はブロック1行分
+	static uint32_t	level_pitch(uint32_t nFormat, uint32_t nWidth, uint32_t nLevel)
+	{
+		uint32_t w = level_length(nWidth, nLevel);
+		return is_block(nFormat) ? ((w+3)/4)*unit_byte(nFormat) : w*unit_byte(nFormat);
+	}
+
+	//! ミップレベルの行数。ブロック圧縮の時はブロックの行数
+	static uint32_t	level_rows(uint32_t nFormat, uint32_t nHeight, uint32_t nLevel)
+	{
+		uint32_t h = level_length(nHeight, nLevel);
+		return is_block(nFormat) ? (h+3)/4 : h;
+	}
+
+	static uint32_t	level_size(uint32_t nFormat, uint32_t nWidth, uint32_t nHeight, uint32_t nLevel)
+	{
+		return level_pitch(nFormat, nWidth, nLevel)*level_rows(nFormat, nHeight, nLevel);
+	}
+
+	//! 全ミップレベルのデータサイズ
+	uint32_t		calc_data_size()const
+	{
+		uint32_t nSize=0;
+		for(uint32_t i=0; i<nMipLevels_; ++i)
+			nSize += level_size(nFormat_, nWidth_, nHeight_, i);
+		return nSize;
+	}
+
+	//! @brief メモリ上のデータがコンテナか
+	/*! ヘッダが正しく、データサイズも合っている時にtrue */
+	static bool		is_container(const void* pData, uint32_t nSize)
+	{
+		if(pData==nullptr || nSize<sizeof(texture_container_header)) return false;
+
+		const texture_container_header& head = *static_cast<const texture_container_header*>(pData);
+		return head.nMagic_==MAGIC
+			&& head.nVersion_==VERSION
+			&& head.nFormat_<=FORMAT_BC3
+			&& head.nMipLevels_>0
+			&& head.nDataSize_==head.calc_data_size()
+			&& sizeof(texture_container_header)+head.nDataSize_<=nSize;
+	}
+};
+
+} // namespace draw end
+} // namespace mana end
@@ -0,0 +1,260 @@
+﻿#include "../mana_common.h"
+
+#include <wincodec.h>
+
+#include "../App/system_caps.h"
+#include "../Memory/util_memory.h"
+#include "../Concurrent/lock_helper.h"
+#include "../Concurrent/worker.h"
+
+#include "texture_container.h"
+#include "texture_loader.h"
+
+namespace mana{
+namespace draw{
+
+namespace{
+//! @brief WICでA8R8G8B8にデコードする。COMは初期化済みであること
+bool decode_wic(texture_loader::staged& s)
+{
+	IWICImagingFactory*		pFactory	= nullptr;
+	IWICStream*				pStream		= nullptr;
+	IWICBitmapDecoder*		pDecoder	= nullptr;
+	IWICBitmapFrameDecode*	pFrame		= nullptr;
+	IWICFormatConverter*	pConverter	= nullptr;
+
+	BOOST_SCOPE_EXIT_ALL(&)
+	{
+		safe_release(pConverter);
+		safe_release(pFrame);
+		safe_release(pDecoder);
+		safe_release(pStream);
+		safe_release(pFactory);
+	};
+
+	HRESULT r = ::CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pFactory));
+	if(FAILED(r)) return false;
+
+	r = pFactory->CreateStream(&pStream);
+	if(FAILED(r)) return false;
+
+	r = pStream->InitializeFromMemory(s.pData_.get(), s.nSize_);
+	if(FAILED(r)) return false;
+
+	r = pFactory->CreateDecoderFromStream(pStream, NULL, WICDecodeMetadataCacheOnDemand, &pDecoder);
+	if(FAILED(r)) return false;
+
+	r = pDecoder->GetFrame(0, &pFrame);
+	if(FAILED(r)) return false;
+
+	// BGRAの並びがD3DFMT_A8R8G8B8と同じになる
+	r = pFactory->CreateFormatConverter(&pConverter);
+	if(FAILED(r)) return false;
+
+	r = pConverter->Initialize(pFrame, GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom);
+	if(FAILED(r)) return false;
+
+	UINT nWidth=0, nHeight=0;
+	r = pConverter->GetSize(&nWidth, &nHeight);
+	if(FAILED(r) || nWidth==0 || nHeight==0) return false;
+
+	shared_ptr<BYTE[]> pPixel(new_ BYTE[nWidth*nHeight*4]);
+	r = pConverter->CopyPixels(NULL, nWidth*4, nWidth*nHeight*4, pPixel.get());
+	if(FAILED(r)) return false;
+
+	s.pPixel_	= pPixel;
+	s.nWidth_	= nWidth;
+	s.nHeight_	= nHeight;
+	return true;
+}
+} // namespace end
+
+texture_loader::texture_loader():nSerial_(0)
+{
+#ifdef MANA_TEXTURE_LOADER_COUNT
+	nRequestCount_=0; nUploadCount_=0; nDecodeCount_=0; nCancelCount_=0; nMaxUploadByte_=0; nMaxStagedNum_=0;
+#endif
+}
+
+void texture_loader::init(uint32_t nThreadNum)
+{
+	// 最低でも1スレッドは確保する
+	if(nThreadNum==0) nThreadNum=1;
+
+	shared_ptr<concurrent::worker> pWorker = make_shared<concurrent::worker>(128);
+
+	memory::scoped_alloc alloc(sizeof(uint32_t)*nThreadNum);
+	uint32_t* anAffine = reinterpret_cast<uint32_t*>(alloc.pMem_);
+
+	for(uint32_t i=0; i<nThreadNum; ++i)
+		anAffine[i] = i % app::cpu_logic_core();
+
+	pWorker->kick(nThreadNum, anAffine);
+
+	init(pWorker);
+}
+
+void texture_loader::init(const shared_ptr<concurrent::worker>& pWorker)
+{
+	fin();
+
+	pWorker_  = pWorker;
+	pStaging_ = make_shared<staging_queue>();
+	mapLoading_.reserve(64);
+}
+
+void texture_loader::fin()
+{
+#ifdef MANA_TEXTURE_LOADER_COUNT
+	if(nRequestCount_>0)
+	{
+		logger::infoln("[texture_loader]リクエスト回数 : " + to_str_s(nRequestCount_) + "生成回数 : " + to_str_s(nUploadCount_) + "デコード済み : " + to_str_s(nDecodeCount_) + "破棄回数 : " + to_str(nCancelCount_));
+		logger::infoln("[texture_loader]1回の最大生成容量 : " + to_str_s(nMaxUploadByte_) + "ステージング最大数 : " + to_str(nMaxStagedNum_));
+	}
+	nRequestCount_=0; nUploadCount_=0; nDecodeCount_=0; nCancelCount_=0; nMaxUploadByte_=0; nMaxStagedNum_=0;
+#endif
+
+	// 読み込み中のジョブはステージングキューを持っているので、切り離すだけでよい
+	mapLoading_.clear();
+	pStaging_.reset();
+	pWorker_.reset();
+}
+
+/////////////////////////////
+
+bool texture_loader::request(uint32_t nID, const string& sFilePath)
+{
+	if(!pWorker_ || is_loading(nID)) return false;
+
+	if(pWorker_->is_fin())
+	{
+		logger::warnln("[texture_loader]workerが終了しているのでリクエストできませんでした。: " + sFilePath);
+		return false;
+	}
+
+	auto pStaged = make_shared<staged>();
+	pStaged->nID_		= nID;
+	pStaged->nSerial_	= ++nSerial_;
+	pStaged->sFilePath_	= sFilePath;
+
+	shared_ptr<staging_queue> pQueue = pStaging_;
+	pWorker_->request([pStaged, pQueue](){ load(pStaged, pQueue); });
+
+	mapLoading_.emplace(nID, pStaged->nSerial_);
+
+#ifdef MANA_TEXTURE_LOADER_COUNT
+	++nRequestCount_;
+#endif
+
+	return true;
+}
+
+void texture_loader::cancel(uint32_t nID)
+{
+	mapLoading_.erase(nID);
+}
+
+void texture_loader::cancel_all()
+{
+	mapLoading_.clear();
+}
+
+uint32_t texture_loader::upload(uint32_t nBudgetByte, const upload_func& func)
+{
+	if(!pStaging_) return 0;
+
+	uint32_t nUploadByte=0;
+
+	while(nBudgetByte==0 || nUploadByte<nBudgetByte)
+	{
+		shared_ptr<staged> pStaged;
+		{
+			concurrent::spin_flag_lock lock(pStaging_->flag_);
+			if(pStaging_->que_.empty()) break;
+
+		#ifdef MANA_TEXTURE_LOADER_COUNT
+			if(pStaging_->que_.size()>nMaxStagedNum_) nMaxStagedNum_=pStaging_->que_.size();
+		#endif
+
+			pStaged = pStaging_->que_.front();
+			pStaging_->que_.pop_front();
+		}
+
+		// 取り消されたか、同じIDで新しくリクエストされていたら捨てる
+		auto it = mapLoading_.find(pStaged->nID_);
+		if(it==mapLoading_.end() || it->second!=pStaged->nSerial_)
+		{
+		#ifdef MANA_TEXTURE_LOADER_COUNT
+			++nCancelCount_;
+		#endif
+			continue;
+		}
+
+		mapLoading_.erase(it);
+
+		if(!pStaged->bSuccess_)
+		{
+			logger::warnln("[texture_loader]テクスチャファイルを読むことができませんでした。: " + pStaged->sFilePath_);
+			continue;
+		}
+
+		nUploadByte += func(*pStaged);
+
+	#ifdef MANA_TEXTURE_LOADER_COUNT
+		++nUploadCount_;
+		if(pStaged->pPixel_) ++nDecodeCount_;
+	#endif
+	}
+
+#ifdef MANA_TEXTURE_LOADER_COUNT
+	if(nUploadByte>nMaxUploadByte_) nMaxUploadByte_=nUploadByte;
+#endif
+
+	return nUploadByte;
+}
+
+void texture_loader::load(const shared_ptr<staged>& pStaged, const shared_ptr<staging_queue>& pQueue)
+{
+	using file::file_access;
+
+	file_access tex_file(pStaged->sFilePath_);
+	if(tex_file.open(file_access::READ_ALL))
+	{
+		uint32_t rsize=0;
+		if(tex_file.read(rsize)!=file_access::FAIL)
+		{
+			pStaged->pData_		= tex_file.buf();
+			pStaged->nSize_		= tex_file.filesize();
+			pStaged->bSuccess_	= true;
+		}
+		tex_file.close();
+	}
+
+	// 描画スレッドではピクセルのコピーだけで済むように、ここでデコードしておく
+	if(pStaged->bSuccess_ && decode(*pStaged))
+		pStaged->pData_.reset();
+
+	concurrent::spin_flag_lock lock(pQueue->flag_);
+	pQueue->que_.emplace_back(pStaged);
+}
+
+bool texture_loader::decode(staged& s)
+{
+	// 変換済みコンテナはそのままコピーできる
+	if(texture_container_header::is_container(s.pData_.get(), s.nSize_)) return false;
+
+	if(FAILED(::D3DXGetImageInfoFromFileInMemory(s.pData_.get(), s.nSize_, &s.imageInfo_))) return false;
+
+	// DDSは圧縮フォーマットのことが多いので、D3DXでそのまま作る
+	if(s.imageInfo_.ImageFileFormat==D3DXIFF_DDS) return false;
+
+	// workerのスレッドはCOMを初期化していないので、デコードの間だけ初期化する
+	HRESULT rCo = ::CoInitializeEx(NULL, COINIT_MULTITHREADED);
+	bool bDecode = (SUCCEEDED(rCo) || rCo==RPC_E_CHANGED_MODE) ? decode_wic(s) : false;
+	if(SUCCEEDED(rCo)) ::CoUninitialize();
+
+	return bDecode;
+}
+
+} // namespace draw end
+} // namespace mana end
@@ -0,0 +1,161 @@
+﻿#pragma once
+
+#include "../File/file.h"
+
+#ifdef MANA_DEBUG
+#define MANA_TEXTURE_LOADER_COUNT
+#endif
+
+namespace mana{
+
+namespace concurrent{
+class worker;
+} // namespace concurrent end
+
+namespace draw{
+
+/*! @brief テクスチャの元ファイルを非同期に読み込むクラス
+ *
+ *  テクスチャ生成を以下の段階に分ける
+ *  　1. request でworkerにファイル読み込みを積む
+ *  　2. workerはファイルを読み、画像はWICでA8R8G8B8のピクセルにデコードしてステージングキューに溜める
+ *  　3. 描画スレッドから毎フレーム upload を呼び、
+ *  　   指定バイト数に収まるだけテクスチャ生成関数に渡す
+ *
+ *  変換済みテクスチャコンテナとDDSはデコードが要らないので、ファイルのまま渡す。
+ *  WICでデコードできなかった画像もファイルのまま渡すので、生成関数側でデコードすること
+ *
+ *  デバイスに依存する処理は持たないので、
+ *  テクスチャの実生成は upload に渡す関数側で行う
+ *
+ *  request/cancel/upload は同じスレッド(描画スレッド)から呼ぶこと。
+ *  workerからはステージングキューへの追加だけ行う
+ *
+ *  リクエスト数やアップロード量をカウントする時は、
+ *  MANA_TEXTURE_LOADER_COUNTをdefineする
+ */
+class texture_loader
+{
+public:
+	//! 読み込みが終わったファイル
+	struct staged
+	{
+		uint32_t					nID_;		//!< テクスチャID
+		uint32_t					nSerial_;	//!< リクエスト通し番号。cancel後の古い結果を捨てるために使う
+		string						sFilePath_;	//!< 元ファイルのパス
+		file::file_data::data_sptr	pData_;		//!< ファイル実体。デコードした時は解放している
+		uint32_t					nSize_;		//!< ファイルサイズ
+		bool						bSuccess_;	//!< 読み込みに成功したか
+
+		//! @defgroup texture_loader_staged_pixel workerでデコードしたピクセル
+		//! @{
+		shared_ptr<BYTE[]>			pPixel_;	//!< A8R8G8B8。nullptrならデコードしていない
+		uint32_t					nWidth_;
+		uint32_t					nHeight_;
+		D3DXIMAGE_INFO				imageInfo_;	//!< 元ファイルの画像情報
+		//! @}
+
+		staged():nID_(0),nSerial_(0),nSize_(0),bSuccess_(false),nWidth_(0),nHeight_(0){ ::ZeroMemory(&imageInfo_, sizeof(imageInfo_)); }
+	};
+
+	//! @brief テクスチャ生成関数
+	/*! @return 生成したテクスチャの容量(byte)。uploadの予算から差し引かれる */
+	typedef function<uint32_t(const staged&)> upload_func;
+
+public:
+	texture_loader();
+	~texture_loader(){ fin(); }
+
+public:
+	//! 読み込みで使うスレッド数を渡して初期化
+	void		init(uint32_t nThreadNum=1);
+	//! kick済みworkerを渡して初期化
+	void		init(const shared_ptr<concurrent::worker>& pWorker);
+	//! 終了処理。読み込み中のものは結果を捨てる
+	void		fin();
+
+	bool		is_init()const{ return pWorker_!=nullptr; }
+
+public:
+	//! @brief ファイル読み込みをリクエストする
+	/*! @retval false 読み込み中か、リクエストできなかった */
+	bool		request(uint32_t nID, const string& sFilePath);
+
+	//! リクエストを取り消す。読み込み中のものは読み終わった時に捨てられる
+	void		cancel(uint32_t nID);
+	//! 全てのリクエストを取り消す
+	void		cancel_all();
+
+	//! 読み込み中(アップロード待ち含む)かどうか
+	bool		is_loading(uint32_t nID)const{ return mapLoading_.find(nID)!=mapLoading_.end(); }
+	//! 読み込み中の数
+	uint32_t	loading_num()const{ return mapLoading_.size(); }
+
+	//! @brief 読み終わったファイルをテクスチャ生成関数に渡す
+	/*! 1フレームに最低1つは渡すので、予算より大きいテクスチャも生成される
+	 *  @param[in] nBudgetByte 1回で生成するテクスチャ容量の目安。0だと全部渡す
+	 *  @param[in] func テクスチャ生成関数
+	 *  @return 生成したテクスチャ容量(byte) */
+	uint32_t	upload(uint32_t nBudgetByte, const upload_func& func);
+
+private:
+	//! workerとやりとりするステージングキュー。workerのジョブより先に消えないようにshared_ptrで持つ
+	struct staging_queue
+	{
+		std::atomic_flag				flag_;
+		deque<shared_ptr<staged>>		que_;
+
+		staging_queue(){ flag_.clear(); }
+	};
+
+	//! workerで実行される読み込み
+	static void load(const shared_ptr<staged>& pStaged, const shared_ptr<staging_queue>& pQueue);
+	//! @brief workerで読み込んだファイルをピクセルにデコードする
+	/*! @return falseならファイルのまま渡す */
+	static bool decode(staged& s);
+
+private:
+	shared_ptr<concurrent::worker>			pWorker_;
+	shared_ptr<staging_queue>				pStaging_;
+
+	unordered_map<uint32_t, uint32_t>		mapLoading_;	//!< 読み込み中のテクスチャIDとリクエスト通し番号
+	uint32_t								nSerial_;		//!< リクエスト通し番号
+
+#ifdef MANA_TEXTURE_LOADER_COUNT
+public:
+	uint32_t	request_count()const{ return nRequestCount_; }
+	uint32_t	upload_count()const{ return nUploadCount_; }
+	uint32_t	decode_count()const{ return nDecodeCount_; }
+	uint32_t	cancel_count()const{ return nCancelCount_; }
+	uint32_t	max_upload_byte()const{ return nMaxUploadByte_; }
+
+private:
+	uint32_t	nRequestCount_;		//!< リクエスト回数
+	uint32_t	nUploadCount_;		//!< テクスチャ生成関数に渡した回数
+	uint32_t	nDecodeCount_;		//!< 渡したうち、workerでデコード済みだった回数
+	uint32_t	nCancelCount_;		//!< 読み終わってから捨てた回数
+	uint32_t	nMaxUploadByte_;	//!< 1回のuploadで生成した最大容量
+	uint32_t	nMaxStagedNum_;		//!< ステージングキューに溜まった最大数
+#endif
+
+private:
+	NON_COPIABLE(texture_loader);
+};
+
+} // namespace draw end
+} // namespace mana end
+
+/* 使用例
+
+	draw::texture_loader loader;
+	loader.init(1);
+
+	loader.request(nID, "data/tex.png");
+
+	// 描画スレッドで毎フレーム
+	loader.upload(1024*1024, [&](const draw::texture_loader::staged& s)->uint32_t
+	{
+		if(s.pPixel_) return create_texture_from_pixel(s.nID_, s.pPixel_.get(), s.nWidth_, s.nHeight_);
+		return create_texture(s.nID_, s.pData_.get(), s.nSize_);
+	});
+*/
@@ -0,0 +1,231 @@
+﻿#include "../mana_common.h"
+
+#include "texture_residency.h"
+
+namespace mana{
+namespace draw{
+
+texture_residency::~texture_residency()
+{
+#ifdef MANA_TEXTURE_RESIDENCY_COUNT
+	logger::infoln("[texture_residency]追い出し回数 : " + to_str_s(nEvictCount_) + "追い出し容量 : " + to_str(nEvictByte_));
+	logger::infoln("[texture_residency]スラッシング回数 : " + to_str_s(nThrashCount_) + "作り直し容量 : " + to_str_s(nThrashByte_) + "上限超過回数 : " + to_str(nOverBudgetCount_));
+#endif
+}
+
+void texture_residency::init(uint32_t nMaxByte, uint32_t nReserveNum)
+{
+	fin();
+
+	nMaxByte_ = nMaxByte;
+	hashEntry_.reserve(nReserveNum);
+}
+
+void texture_residency::fin()
+{
+	hashEntry_.clear();
+	for(auto& it : listLru_) it.clear();
+	nUseByte_=0;
+}
+
+void texture_residency::add(uint32_t nID, const string& sGroup)
+{
+	auto it = hashEntry_.find(nID);
+	if(it!=hashEntry_.end())
+	{// グループが変わったら優先度も変える
+		entry& e = it->second;
+		if(e.sGroup_==sGroup) return;
+
+		uint32_t nPriority = group_priority(sGroup);
+		if(e.bResident_ && e.nPriority_!=nPriority)
+		{
+			list<uint32_t>& dest = listLru_[nPriority];
+			dest.splice(dest.end(), listLru_[e.nPriority_], e.it_);
+		}
+
+		e.sGroup_	 = sGroup;
+		e.nPriority_ = nPriority;
+		return;
+	}
+
+	entry e;
+	e.sGroup_		= sGroup;
+	e.nPriority_	= group_priority(sGroup);
+	e.nSize_		= 0;
+	e.nLastFrame_	= 0;
+	e.it_			= listLru_[e.nPriority_].end();
+	e.bResident_	= false;
+
+#ifdef MANA_TEXTURE_RESIDENCY_COUNT
+	e.nEvictFrame_	= 0;
+	e.bEvicted_		= false;
+#endif
+
+	hashEntry_.emplace(nID, std::move(e));
+}
+
+void texture_residency::remove(uint32_t nID)
+{
+	auto it = hashEntry_.find(nID);
+	if(it==hashEntry_.end()) return;
+
+	if(it->second.bResident_) unlink(it->second);
+	hashEntry_.erase(it);
+}
+
+void texture_residency::fetch(uint32_t nID, uint32_t nSize, vector<uint32_t>& vecEvict)
+{
+	auto it = hashEntry_.find(nID);
+	if(it==hashEntry_.end()) return;
+
+	entry& e = it->second;
+	e.nLastFrame_ = nFrame_;
+
+	list<uint32_t>& lru = listLru_[e.nPriority_];
+
+	if(e.bResident_)
+	{// 後ろに移すだけ
+		lru.splice(lru.end(), lru, e.it_);
+		return;
+	}
+
+#ifdef MANA_TEXTURE_RESIDENCY_COUNT
+	if(e.bEvicted_ && nFrame_-e.nEvictFrame_<=nThrashFrame_)
+	{
+		++nThrashCount_;
+		nThrashByte_ += nSize;
+	}
+	e.bEvicted_ = false;
+#endif
+
+	lru.emplace_back(nID);
+	e.it_		 = --lru.end();
+	e.nSize_	 = nSize;
+	e.bResident_ = true;
+	nUseByte_	+= nSize;
+
+	// 上限を超えたら、収まるまで追い出す
+	if(nMaxByte_==0) return;
+
+	while(nUseByte_>nMaxByte_)
+	{
+		auto victim = select_victim(false);
+		if(victim==hashEntry_.end())
+		{
+		#ifdef MANA_TEXTURE_RESIDENCY_COUNT
+			++nOverBudgetCount_;
+		#endif
+			break;
+		}
+
+		vecEvict.emplace_back(victim->first);
+		evict(victim);
+	}
+}
+
+void texture_residency::release(uint32_t nID)
+{
+	auto it = hashEntry_.find(nID);
+	if(it==hashEntry_.end() || !it->second.bResident_) return;
+
+	unlink(it->second);
+}
+
+optional<uint32_t> texture_residency::evict_one()
+{
+	auto victim = select_victim(true);
+	if(victim==hashEntry_.end()) return optional<uint32_t>();
+
+	uint32_t nID = victim->first;
+	evict(victim);
+	return nID;
+}
+
+bool texture_residency::is_resident(uint32_t nID)const
+{
+	auto it = hashEntry_.find(nID);
+	return it!=hashEntry_.end() && it->second.bResident_;
+}
+
+void texture_residency::set_group_priority(const string& sGroup, uint32_t nPriority)
+{
+	if(nPriority>=PRIORITY_NUM) nPriority = PRIORITY_PINNED;
+
+	if(nPriority==PRIORITY_NORMAL) hashGroupPriority_.erase(sGroup);
+	else						   hashGroupPriority_[sGroup] = nPriority;
+
+	// 常駐しているものは、古い順を保ったまま移す先の後ろに付ける
+	list<uint32_t>& dest = listLru_[nPriority];
+	for(uint32_t i=0; i<PRIORITY_NUM; ++i)
+	{
+		if(i==nPriority) continue;
+
+		list<uint32_t>& src = listLru_[i];
+		auto it = src.begin();
+		while(it!=src.end())
+		{
+			auto cur = it++;
+
+			auto e = hashEntry_.find(*cur);
+			if(e!=hashEntry_.end() && e->second.sGroup_==sGroup)
+				dest.splice(dest.end(), src, cur);
+		}
+	}
+
+	for(auto& it : hashEntry_)
+	{
+		if(it.second.sGroup_==sGroup) it.second.nPriority_ = nPriority;
+	}
+}
+
+uint32_t texture_residency::group_priority(const string& sGroup)const
+{
+	auto it = hashGroupPriority_.find(sGroup);
+	return it!=hashGroupPriority_.end() ? it->second : PRIORITY_NORMAL;
+}
+
+texture_residency::entry_hash::iterator texture_residency::select_victim(bool bCurFrame)
+{
+	for(uint32_t i=0; i<PRIORITY_PINNED; ++i)
+	{
+		for(auto& nID : listLru_[i])
+		{
+			auto it = hashEntry_.find(nID);
+			if(it==hashEntry_.end()) continue;
+
+			// 前にあるほど古いので、このフレームで使ったものに当たったら後ろも全部使っている
+			if(!bCurFrame && it->second.nLastFrame_==nFrame_) break;
+
+			return it;
+		}
+	}
+
+	return hashEntry_.end();
+}
+
+void texture_residency::evict(entry_hash::iterator it)
+{
+	entry& e = it->second;
+
+#ifdef MANA_TEXTURE_RESIDENCY_COUNT
+	++nEvictCount_;
+	nEvictByte_		+= e.nSize_;
+	e.nEvictFrame_	= nFrame_;
+	e.bEvicted_		= true;
+#endif
+
+	unlink(e);
+}
+
+void texture_residency::unlink(entry& e)
+{
+	listLru_[e.nPriority_].erase(e.it_);
+	e.it_		 = listLru_[e.nPriority_].end();
+	e.bResident_ = false;
+
+	nUseByte_ -= e.nSize_;
+	e.nSize_   = 0;
+}
+
+} // namespace draw end
+} // namespace mana end
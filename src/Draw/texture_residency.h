@@ -0,0 +1,178 @@
+﻿#pragma once
+
+#ifdef MANA_DEBUG
+#define MANA_TEXTURE_RESIDENCY_COUNT
+#endif
+
+namespace mana{
+namespace draw{
+
+/*! @brief テクスチャの常駐管理
+ *
+ *  テクスチャ容量の上限を超えた時に、どのテクスチャを追い出すかを決める。
+ *  テクスチャ実体には触らないので、生成・解放は呼び出し側で行う
+ *
+ *  グループごとに優先度を持ち、優先度の低いものから、同じ優先度なら古いものから追い出す。
+ *  そのフレームで使ったテクスチャと、PRIORITY_PINNEDのグループは追い出さない。
+ *  追い出せるものが無い時は上限を超えたままになる
+ *
+ *  next_frameを毎フレーム呼ぶこと
+ *
+ *  追い出した回数や、追い出してすぐに使われた回数(スラッシング)をカウントする時は、
+ *  MANA_TEXTURE_RESIDENCY_COUNTをdefineする
+ */
+class texture_residency
+{
+public:
+	enum priority : uint32_t
+	{
+		PRIORITY_LOW,		//!< 真っ先に追い出す。使い終わったシーンのグループなど
+		PRIORITY_NORMAL,	//!< 指定が無い時
+		PRIORITY_HIGH,		//!< LOW,NORMALを追い出しきるまで追い出さない。実行中のシーンのグループなど
+		PRIORITY_PINNED,	//!< 追い出さない
+
+		PRIORITY_NUM,
+	};
+
+	enum residency_const : uint32_t
+	{
+		DEFAULT_THRASH_FRAME = 60,
+	};
+
+private:
+	struct entry
+	{
+		string					 sGroup_;
+		uint32_t				 nPriority_;
+		uint32_t				 nSize_;		//!< 常駐している時の容量
+		uint32_t				 nLastFrame_;	//!< 最後に使ったフレーム
+		list<uint32_t>::iterator it_;			//!< 優先度ごとのLRUリスト内の位置。常駐していない時はend
+		bool					 bResident_;
+
+	#ifdef MANA_TEXTURE_RESIDENCY_COUNT
+		uint32_t				 nEvictFrame_;	//!< 追い出されたフレーム
+		bool					 bEvicted_;
+	#endif
+	};
+
+	typedef unordered_map<uint32_t, entry> entry_hash;
+
+public:
+	texture_residency():nMaxByte_(0),nUseByte_(0),nFrame_(0)
+	{
+	#ifdef MANA_TEXTURE_RESIDENCY_COUNT
+		nThrashFrame_=DEFAULT_THRASH_FRAME;
+		nEvictCount_=0; nEvictByte_=0; nThrashCount_=0; nThrashByte_=0; nOverBudgetCount_=0;
+	#endif
+	}
+
+	~texture_residency();
+
+public:
+	//! @param[in] nMaxByte 容量の上限。0だと制限なし
+	void		init(uint32_t nMaxByte, uint32_t nReserveNum);
+	void		fin();
+
+	//! @brief 管理対象に加える。常駐はしていない扱い
+	/*! 登録済みならグループだけ変更する */
+	void		add(uint32_t nID, const string& sGroup);
+	//! 管理対象から外す
+	void		remove(uint32_t nID);
+
+	//! @brief 使用を記録する
+	/*! 常駐していなかったら容量を足し、上限を超えた分の追い出し対象をvecEvictに追加する。
+	 *  vecEvictに入ったものは常駐していない扱いになるので、呼び出し側で解放すること
+	 *  @param[in] nSize 常駐していなかった時に足す容量 */
+	void		fetch(uint32_t nID, uint32_t nSize, vector<uint32_t>& vecEvict);
+
+	//! 明示的に解放された。追い出しとは数えない
+	void		release(uint32_t nID);
+
+	//! @brief 一番追い出してよいものを1つ選んで、常駐していない扱いにする
+	/*! 生成に失敗した時に空きを作るために使う。そのフレームで使ったものも対象にする */
+	optional<uint32_t> evict_one();
+
+	//! フレームを進める
+	void		next_frame(){ ++nFrame_; }
+
+	bool		is_resident(uint32_t nID)const;
+
+public:
+	//! @brief グループの優先度を設定する。登録済みのテクスチャにも反映される
+	void		set_group_priority(const string& sGroup, uint32_t nPriority);
+	uint32_t	group_priority(const string& sGroup)const;
+
+	void		set_max_byte(uint32_t nMaxByte){ nMaxByte_=nMaxByte; }
+	uint32_t	max_byte()const{ return nMaxByte_; }
+	//! 常駐しているテクスチャの合計容量
+	uint32_t	use_byte()const{ return nUseByte_; }
+
+	uint32_t	frame()const{ return nFrame_; }
+
+private:
+	//! @brief 追い出し対象を選ぶ
+	/*! @param[in] bCurFrame trueだとこのフレームで使ったものも対象にする */
+	entry_hash::iterator select_victim(bool bCurFrame);
+
+	//! 常駐していない扱いにする
+	void		evict(entry_hash::iterator it);
+
+	//! LRUリストから外して、容量を引く
+	void		unlink(entry& e);
+
+private:
+	entry_hash						hashEntry_;
+	unordered_map<string, uint32_t>	hashGroupPriority_;
+
+	//! 常駐しているテクスチャの優先度ごとのLRUリスト。前にあるほど古い
+	array<list<uint32_t>, PRIORITY_NUM>	listLru_;
+
+	uint32_t	nMaxByte_;
+	uint32_t	nUseByte_;
+	uint32_t	nFrame_;
+
+#ifdef MANA_TEXTURE_RESIDENCY_COUNT
+public:
+	//! 追い出してからこのフレーム数以内に使われたらスラッシングとして数える
+	void		set_thrash_frame(uint32_t nFrame){ nThrashFrame_=nFrame; }
+
+	uint32_t	evict_count()const{ return nEvictCount_; }
+	uint64_t	evict_byte()const{ return nEvictByte_; }
+	//! 追い出してすぐに使われた回数
+	uint32_t	thrash_count()const{ return nThrashCount_; }
+	//! スラッシングで作り直した容量
+	uint64_t	thrash_byte()const{ return nThrashByte_; }
+	//! 追い出せるものが無くて上限を超えたままになった回数
+	uint32_t	over_budget_count()const{ return nOverBudgetCount_; }
+
+private:
+	uint32_t	nThrashFrame_;
+	uint32_t	nEvictCount_;
+	uint64_t	nEvictByte_;
+	uint32_t	nThrashCount_;
+	uint64_t	nThrashByte_;
+	uint32_t	nOverBudgetCount_;
+#endif
+
+private:
+	NON_COPIABLE(texture_residency);
+};
+
+} // namespace draw end
+} // namespace mana end
+
+/* 使用例
+
+	texture_residency res;
+	res.init(64*1024*1024, 256);
+	res.add(nID, "title");
+	res.set_group_priority("title", texture_residency::PRIORITY_HIGH);
+
+	// テクスチャを使う時
+	vector<uint32_t> vecEvict;
+	res.fetch(nID, nTextureSize, vecEvict);
+	for(auto& it : vecEvict) release_texture_body(it);
+
+	// 毎フレーム
+	res.next_frame();
+*/
@@ -1,5 +1,7 @@
 ﻿#include "../mana_common.h"
 
+#include "../App/system_caps.h"
+#include "../Concurrent/worker.h"
 #include "../Timer/fps_timer.h"
 #include "../Draw/renderer_2d.h"
 #include "../Sound/sound_player.h"
@@ -149,16 +151,21 @@ bool game_window::game_init()
 	uint32_t nIntervalMs= 1000/60; // 60fps
 	nRequestReseve		= 256;
 	nCoreNo				= 2;
-	uint32_t nGcFrame	= 601;
-	uint32_t nSeGcNum	= 20;
-	on_game_init_sound(nIntervalMs, nRequestReseve, nCoreNo, nGcFrame, nSeGcNum);
+	uint32_t nSeVoiceNum= audio::audio_player::SE_VOICE_NUM;
+	on_game_init_sound(nIntervalMs, nRequestReseve, nCoreNo, nSeVoiceNum);
+
+	// ストリーム再生のoggのデコードを、サウンドスレッドの外で先読みする
+	pSoundWorker_ = make_shared<concurrent::worker>(64);
+	uint32_t nStreamCoreNo = (nCoreNo+1) % app::cpu_logic_core();
+	pSoundWorker_->kick(1, &nStreamCoreNo);
+	pSoundPlayer_->set_stream_worker(pSoundWorker_);
 
 	if(!pSoundPlayer_->init_driver(wnd_handle())
 	|| !pSoundPlayer_->init_player(nIntervalMs, nRequestReseve, nCoreNo))
 		return false;
 
 	pAudioPlayer_ = make_shared<audio::audio_player>();
-	pAudioPlayer_->init(pSoundPlayer_, nGcFrame, nSeGcNum);
+	pAudioPlayer_->init(pSoundPlayer_, nSeVoiceNum);
 
 	// 入力初期化
 	using namespace mana;
@@ -14,6 +14,10 @@ namespace graphic{
 class text_table;
 } // namespace graphic end
 
+namespace concurrent{
+class worker;
+} // namespace concurrent end
+
 namespace sound{
 class sound_player;
 } // namespace sound end
@@ -99,7 +103,7 @@ protected:
 	//! レンダラーの初期化パラメータを変更する場合、オーバーライドする
 	virtual void on_game_init_renderer(draw::d3d9_device_init& device, draw::renderer_2d_init& renderer, uint32_t& nRequestReseve, uint32_t& nCoreNo){}
 	//! サウンド/オーディオの初期化パラメータを変更する場合、オーバーライドする
-	virtual void on_game_init_sound(uint32_t& nIntervalMs, uint32_t& nRequestReserve, uint32_t& nCoreNo, uint32_t& nGcFrame, uint32_t& nSeGcNum){}
+	virtual void on_game_init_sound(uint32_t& nIntervalMs, uint32_t& nRequestReserve, uint32_t& nCoreNo, uint32_t& nSeVoiceNum){}
 
 protected:
 	void calc_limit_mouse();
@@ -111,6 +115,7 @@ protected:
 protected:
 	shared_ptr<draw::renderer_2d>			pRenderer_;
 
+	shared_ptr<concurrent::worker>			pSoundWorker_;	//!< ストリーム再生の先読み。pSoundPlayer_より後に破棄する
 	shared_ptr<sound::sound_player>			pSoundPlayer_;
 	shared_ptr<audio::audio_player>			pAudioPlayer_;
 
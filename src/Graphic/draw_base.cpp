@@ -1,12 +1,23 @@
 ﻿#include "../mana_common.h"
 
+#include "graphic_fun.h"
 #include "draw_context.h"
 #include "draw_base.h"
 
 namespace mana{
 namespace graphic{
 
-draw_base::draw_base(uint32_t nReserve):base_type(nReserve),eKind_(DRAW_BASE),nColor_(D3DCOLOR_ARGB(0,255,255,255)),eColorMode_(COLOR_NO),bVisible_(true),bPause_(false)
+namespace{
+//! 行列のアフィン部分で矩形を変換して、それを囲む矩形を求める
+inline void matrix_bounds(const D3DXMATRIX& m, const draw::RECT& rect, draw::RECT& out)
+{
+	const float af[6] = { m._11, m._12, m._21, m._22, m._41, m._42 };
+	affine_bounds(af, rect, out);
+}
+} // namespace end
+
+draw_base::draw_base(uint32_t nReserve):base_type(nReserve),eKind_(DRAW_BASE),nColor_(D3DCOLOR_ARGB(0,255,255,255)),eColorMode_(COLOR_NO),bVisible_(true),bPause_(false),
+										eBounds_(BOUNDS_EMPTY),eTreeBounds_(BOUNDS_EMPTY),bCullSubtree_(false),bLocalTreeBounds_(false)
 {
 	//handler_ = [](draw_base* pNode, draw_base_event_id id){};
 }
@@ -40,13 +51,18 @@ void draw_base::exec(draw_context& ctx)
 	// 自分の動き
 	exec_self(ctx);
 
+	// 子の動き
+	exec_children(ctx);
+}
+
+void draw_base::exec_children(draw_context& ctx)
+{
 	bool bVisible	= ctx.is_visible();
-	ctx.visible(is_visible_ctx(ctx));
+	ctx.visible(is_visible_children_ctx(ctx));
 	
 	bool bPause		= ctx.is_pause();
 	ctx.pause(is_pause_ctx(ctx));
 
-	// 子の動き
 	for(auto& it: children())
 		it->exec(ctx);
 
@@ -54,6 +70,79 @@ void draw_base::exec(draw_context& ctx)
 
 	ctx.pause(bPause);
 	ctx.visible(bVisible);
+
+	calc_tree_bounds(ctx);
+}
+
+bool draw_base::is_cull_ctx(draw_context& ctx)const
+{
+	if(eBounds_!=BOUNDS_RECT || !ctx.is_cull_out(bounds_)) return false;
+
+#ifdef MANA_DRAW_CULL_COUNT
+	ctx.add_cull_cmd_count();
+#endif
+	return true;
+}
+
+bool draw_base::is_visible_children_ctx(draw_context& ctx)const
+{
+	if(!is_visible_ctx(ctx)) return false;
+	if(!bCullSubtree_ || !bLocalTreeBounds_ || !ctx.is_cull()) return true;
+
+	// 前のフレームの範囲を、今のワールド行列で戻す
+	draw::RECT rect;
+	matrix_bounds(worldMat_, localTreeBounds_, rect);
+	if(!ctx.is_cull_out(rect)) return true;
+
+#ifdef MANA_DRAW_CULL_COUNT
+	ctx.add_cull_subtree_count();
+#endif
+	return false;
+}
+
+void draw_base::calc_tree_bounds(draw_context& ctx)
+{
+	bLocalTreeBounds_ = false;
+
+	if(!ctx.is_cull())
+	{// 範囲を計算していないので、親でカリングさせない
+		eTreeBounds_ = BOUNDS_INFINITE;
+		return;
+	}
+
+	eTreeBounds_ = eBounds_;
+	treeBounds_	 = bounds_;
+
+	for(auto& it : children())
+	{
+		if(it->eTreeBounds_==BOUNDS_EMPTY) continue;
+
+		if(it->eTreeBounds_==BOUNDS_INFINITE)
+		{
+			eTreeBounds_ = BOUNDS_INFINITE;
+			return;
+		}
+
+		if(eTreeBounds_==BOUNDS_EMPTY)
+		{
+			eTreeBounds_ = BOUNDS_RECT;
+			treeBounds_	 = it->treeBounds_;
+		}
+		else
+		{
+			union_bounds(treeBounds_, it->treeBounds_);
+		}
+	}
+
+	if(bCullSubtree_ && eTreeBounds_==BOUNDS_RECT)
+	{// 次のフレームで判定するので、ローカル座標に戻しておく
+		D3DXMATRIX inv;
+		if(D3DXMatrixInverse(&inv, nullptr, &worldMat_))
+		{
+			matrix_bounds(inv, treeBounds_, localTreeBounds_);
+			bLocalTreeBounds_ = true;
+		}
+	}
 }
 
 void draw_base::exec_self(draw_context& ctx)
@@ -106,10 +195,73 @@ void draw_base::calc_world(draw_context& ctx)
 	if(alpha()<255)
 		nWorldAlpha_ = static_cast<uint8_t>((static_cast<float>(nWorldAlpha_) / 255.0f) * (static_cast<float>(alpha()) / 255.0f) * 255.0f);
 
+	// カリング用の描画範囲
+	if(ctx.is_cull())
+	{
+		draw::RECT rect;
+		eBounds_ = local_bounds(rect);
+		if(eBounds_==BOUNDS_RECT) matrix_bounds(worldMat_, rect, bounds_);
+	}
+
 	// Z
 	ctx.add_total_z(-0.1f);
 	fWorldZ_ = ctx.total_z();
 }
 
+size_t draw_base::state_hash()const
+{
+	size_t nHash=0;
+	boost::hash_combine(nHash, drawInfo_.pos_.fX);
+	boost::hash_combine(nHash, drawInfo_.pos_.fY);
+	boost::hash_combine(nHash, drawInfo_.pos_.fZ);
+	boost::hash_combine(nHash, drawInfo_.scale_.fWidth);
+	boost::hash_combine(nHash, drawInfo_.scale_.fHeight);
+	boost::hash_combine(nHash, drawInfo_.angle_);
+	boost::hash_combine(nHash, drawInfo_.alpha_);
+	boost::hash_combine(nHash, pivot_.fX);
+	boost::hash_combine(nHash, pivot_.fY);
+	boost::hash_combine(nHash, nColor_);
+	boost::hash_combine(nHash, static_cast<uint32_t>(eColorMode_));
+	boost::hash_combine(nHash, bVisible_);
+	return nHash;
+}
+
+uint32_t draw_base::update_children_xtal(uint32_t nFields, const xtal::ArrayPtr& pUpdate)
+{
+	if(!pUpdate) return 0;
+
+	// 1レコードの要素数
+	uint32_t nStride=1;
+	for(uint32_t f=nFields & 0xFF; f; f&=f-1) ++nStride;
+
+	const uint32_t nSize = pUpdate->size();
+	if(nSize%nStride!=0)
+	{
+		logger::warnln("[draw_base]update_childrenの配列の長さが合いません。: " + to_str(nSize));
+		return 0;
+	}
+
+	uint32_t nUpdate=0;
+	for(uint32_t i=0; i<nSize; i+=nStride)
+	{
+		draw_base* pChild = child(static_cast<uint32_t>(pUpdate->at(i)->to_i()));
+		if(!pChild) continue;
+
+		uint32_t n=i+1;
+		if(nFields & UPDATE_X)		pChild->set_x(pUpdate->at(n++)->to_f());
+		if(nFields & UPDATE_Y)		pChild->set_y(pUpdate->at(n++)->to_f());
+		if(nFields & UPDATE_Z)		pChild->set_z(pUpdate->at(n++)->to_f());
+		if(nFields & UPDATE_WIDTH)	pChild->set_width(pUpdate->at(n++)->to_f());
+		if(nFields & UPDATE_HEIGHT)	pChild->set_height(pUpdate->at(n++)->to_f());
+		if(nFields & UPDATE_ANGLE)	pChild->set_angle(pUpdate->at(n++)->to_f());
+		if(nFields & UPDATE_ALPHA)	pChild->set_alpha(static_cast<uint8_t>(clamp(static_cast<int32_t>(pUpdate->at(n++)->to_i()), 0, 255)));
+		if(nFields & UPDATE_VISIBLE)pChild->visible(pUpdate->at(n++)->to_i()!=0);
+
+		++nUpdate;
+	}
+
+	return nUpdate;
+}
+
 } // namespace graphic_base end
 } // namespace mana end
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include <boost/functional/hash.hpp>
+
 #include "../Utility/node.h"
 #include "../draw/renderer_2d_util.h"
 #include "draw_util.h"
@@ -18,7 +20,17 @@ class draw_context;
  *  　カラーは、アルファのみ乗算合成
  *　　Zは、自動計算される
  *
+ *  draw_context::set_cull_rectでカリング矩形が設定されていると、
+ *  local_boundsが矩形の外にあるノードは描画コマンドを生成しない。
+ *  cull_subtreeを設定したノードは、子孫も含めた範囲が矩形の外にあれば、子孫をまとめて非表示として動かす。
+ *  子孫の範囲は前のフレームのものを自分のローカル座標で持っておくので、
+ *  スクロールするマップや長いリストのように、子が親に対して動かないサブツリーに設定すること。
+ *  子が親に対して動くと、画面内に入ってきた子の表示が1フレーム遅れる
+ *
  *  パラメータ設定系はメソッドチェーン対応
+ *
+ *  スクリプトから毎フレーム大量に動かす時は、1回の呼び出しで複数のパラメータを設定する
+ *  set_pos/set_transformや、子をまとめて更新するupdate_childrenを使うと、Xtalの呼び出しが減る
  */
 class draw_base : private utility::node<draw_base>
 {
@@ -34,6 +46,19 @@ public:
 		CHILD_RESERVE=5,
 	};
 
+	//! update_children_xtalで更新するパラメータ。レコード内はこの順に並ぶ
+	enum update_field : uint32_t
+	{
+		UPDATE_X		= 1,
+		UPDATE_Y		= 1<<1,
+		UPDATE_Z		= 1<<2,
+		UPDATE_WIDTH	= 1<<3,
+		UPDATE_HEIGHT	= 1<<4,
+		UPDATE_ANGLE	= 1<<5,
+		UPDATE_ALPHA	= 1<<6,
+		UPDATE_VISIBLE	= 1<<7,	//!< 0で非表示
+	};
+
 public:
 	draw_base(uint32_t nReserve=CHILD_RESERVE);
 	virtual ~draw_base();
@@ -106,6 +131,26 @@ public:
 	float				world_z()const{ return fWorldZ_; }
 	//! @}
 
+	//! @defgroup draw_base_bounds カリング用の描画範囲
+	//! @{
+	//! @brief 自分が描画する範囲。pivotを適用したローカル座標
+	/*! 描画するノードはオーバーライドする */
+	virtual bounds_kind	local_bounds(draw::RECT& rect)const{ return BOUNDS_EMPTY; }
+
+	//! @brief 描画結果に関わる状態のハッシュ
+	/*! static_layerが、子孫が変わったかを調べるのに使う。
+	 *  描画に関わるメンバーを追加したクラスはオーバーライドして、親クラスのハッシュに混ぜる */
+	virtual size_t		state_hash()const;
+
+	//! 自分と子孫の描画範囲。ワールド座標。カリングしている時にexecで更新される
+	bounds_kind			tree_bounds_kind()const{ return eTreeBounds_; }
+	const draw::RECT&	tree_bounds()const{ return treeBounds_; }
+
+	bool				is_cull_subtree()const{ return bCullSubtree_; }
+	//! trueだと、子孫の範囲がカリング矩形の外の時に、子孫を非表示として動かす
+	draw_base&			cull_subtree(bool bCull){ bCullSubtree_=bCull; bLocalTreeBounds_=false; return *this; }
+	//! @}
+
 	//! @defgroup draw_base_envent_handler_ctrl イベントハンドラ
 	//! @{
 	//const event_handler_type&	event_handler()const{ return handler_; }
@@ -131,11 +176,12 @@ public:
 	draw_base*			remove_child(uint32_t nPriority, bool bDelete){ return base_type::remove_child(nPriority, bDelete); }
 	draw_base*			child(uint32_t nPriority){ return base_type::child(nPriority); }
 	const draw_base*	child(uint32_t nPriority)const{ return base_type::child(nPriority); }
+	bool				change_child_priority(uint32_t nPriority, uint32_t nNewPriority){ return base_type::change_child_priority(nPriority, nNewPriority); }
 	virtual void		clear_child(bool bDelete=true){ base_type::clear_child(bDelete); }
 	void				sort_child(bool bChild=false){ base_type::sort_child(bChild); }
 
-	base_type::child_vector&		children(){ return vecChildren_; }
-	const base_type::child_vector&	children()const{ return vecChildren_; }
+	base_type::child_vector&		children(){ return base_type::children(); }
+	const base_type::child_vector&	children()const{ return base_type::children(); }
 
 	uint32_t						count_children()const{ return base_type::count_children(); }
 	void							shrink_children(){ base_type::shrink_children(); }
@@ -145,10 +191,22 @@ protected:
 	virtual void	init_self(){}
 	//! 自分自身の動作
 	virtual void	exec_self(draw_context& ctx);
+	//! 自分の表示・ポーズ状態をctxに反映して、子を動かす
+	void			exec_children(draw_context& ctx);
 
 	//! ワールド行列やアルファを構築する
 	void			calc_world(draw_context& ctx);
 
+	//! @defgroup draw_base_cull カリング
+	//! @{
+	//! 自分の描画範囲がカリング矩形の外にあるか。trueなら描画コマンドを生成しないこと
+	bool			is_cull_ctx(draw_context& ctx)const;
+	//! 子を表示状態で動かすか。is_visible_ctxに加えて、cull_subtreeの判定をする
+	bool			is_visible_children_ctx(draw_context& ctx)const;
+	//! 子を動かした後に、自分と子孫の描画範囲を更新する
+	void			calc_tree_bounds(draw_context& ctx);
+	//! @}
+
 protected:
 	draw_base_kind		eKind_;
 
@@ -167,6 +225,18 @@ protected:
 	D3DXMATRIX			worldMat_;
 	uint8_t				nWorldAlpha_;
 
+	//! @defgroup draw_base_bounds_member カリング用の描画範囲
+	//! @{
+	bounds_kind			eBounds_;			//!< 自分の描画範囲の種類
+	draw::RECT			bounds_;			//!< 自分の描画範囲。ワールド座標
+	bounds_kind			eTreeBounds_;		//!< 自分と子孫の描画範囲の種類
+	draw::RECT			treeBounds_;		//!< 自分と子孫の描画範囲。ワールド座標
+
+	bool				bCullSubtree_;
+	bool				bLocalTreeBounds_;	//!< localTreeBounds_が有効か
+	draw::RECT			localTreeBounds_;	//!< 前のフレームのtreeBounds_を、その時のワールド行列でローカル座標に戻したもの
+	//! @}
+
 	//event_handler_type	handler_;
 
 #ifdef MANA_DEBUG
@@ -180,6 +250,10 @@ public:
 	xtal::SmartPtr<draw_base> set_x_xtal(float fX){ set_x(fX); return xtal::SmartPtr<draw_base>(this); }
 	xtal::SmartPtr<draw_base> set_y_xtal(float fY){ set_y(fY); return xtal::SmartPtr<draw_base>(this); }
 	xtal::SmartPtr<draw_base> set_z_xtal(float fZ){ set_z(fZ); return xtal::SmartPtr<draw_base>(this); }
+	xtal::SmartPtr<draw_base> set_pos_xtal(float fX, float fY){ set_x(fX); set_y(fY); return xtal::SmartPtr<draw_base>(this); }
+
+	//! 位置・拡大率・角度を1回で設定する
+	xtal::SmartPtr<draw_base> set_transform_xtal(float fX, float fY, float fWidth, float fHeight, float fAngle){ set_x(fX); set_y(fY); set_scale(fWidth, fHeight); set_angle(fAngle); return xtal::SmartPtr<draw_base>(this); }
 
 	xtal::SmartPtr<draw_base> set_scale_xtal(float fWidth, float fHeight){ set_scale(fWidth, fHeight); return xtal::SmartPtr<draw_base>(this); }
 	xtal::SmartPtr<draw_base> set_width_xtal(float fWidth){ set_width(fWidth); return xtal::SmartPtr<draw_base>(this); }
@@ -200,6 +274,12 @@ public:
 	bool					  add_child_xtal(xtal::SmartPtr<draw_base> pChild, uint32_t nPri){ return add_child(pChild.get(), nPri); }
 	xtal::SmartPtr<draw_base> remove_child_xtal(uint32_t nPri, bool bDelete){ auto r = remove_child(nPri, bDelete); return xtal::SmartPtr<draw_base>(r); }
 	xtal::SmartPtr<draw_base> child_xtal(uint32_t nPri){ auto r = child(nPri); return xtal::SmartPtr<draw_base>(r); }
+
+	//! @brief 子のパラメータをまとめて更新する
+	/*! pUpdateは、[子のpriority, nFieldsで指定したパラメータ(update_fieldの順)] を子の数だけ並べた配列。
+	 *  例えばnFieldsがUPDATE_X|UPDATE_ALPHA(65)なら、[pri, x, alpha, pri, x, alpha, ...]
+	 *  @return 更新した子の数。見つからなかった子は飛ばす */
+	uint32_t				  update_children_xtal(uint32_t nFields, const xtal::ArrayPtr& pUpdate);
 };
 
 } // namespace graphic end
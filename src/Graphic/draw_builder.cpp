@@ -9,6 +9,7 @@
 #include "movieclip.h"
 #include "timeline.h"
 #include "keyframe.h"
+#include "skeleton.h"
 
 #include "draw_builder.h"
 
@@ -25,12 +26,24 @@ draw_builder::draw_builder():eLoadState_(LOAD_FIN),nLoadWait_(0),nLoadFin_(0)
 #ifdef MANA_DEBUG
 	bReDefine_ = false;
 #endif
+
+#ifdef MANA_DRAW_BUILDER_COUNT
+	nPoolCreateCount_=0;
+	nPoolReuseCount_=0;
+	nPoolReleaseCount_=0;
+	nPoolDiscardCount_=0;
+#endif
 }
 
 draw_builder::~draw_builder()
 {
 	eLoadState_=LOAD_FIN;
 	clear();
+
+#ifdef MANA_DRAW_BUILDER_COUNT
+	logger::infoln("[draw_builder]プール 生成 : " + to_str_s(nPoolCreateCount_) + "再利用 : " + to_str_s(nPoolReuseCount_) 
+					+ "返却 : " + to_str_s(nPoolReleaseCount_) + "破棄 : " + to_str(nPoolDiscardCount_));
+#endif
 }
 
 void draw_builder::clear()
@@ -38,6 +51,9 @@ void draw_builder::clear()
 	// ロード中だったら保留
 	if(eLoadState_==LOAD_START || eLoadState_==LOAD_TEX_FONT_WAIT || eLoadState_==LOAD_NODE) return;
 
+	// 定義が無くなると戻せないので、プールも捨てる
+	clear_pool();
+
 	for(auto& it : hashNode_) safe_delete(it.second);
 	hashNode_.clear();
 
@@ -66,6 +82,102 @@ draw_base* draw_builder::create_draw_base(const string_fw& sNodeID)
 	return pNode;
 }
 
+draw_base* draw_builder::acquire_draw_base(const string_fw& sNodeID)
+{
+	if(eLoadState_!=LOAD_FIN) return nullptr;
+
+	pool_hash::iterator it = hashPool_.find(sNodeID);
+	if(it!=hashPool_.end() && !it->second.empty())
+	{
+		draw_base* pNode = it->second.back();
+		it->second.pop_back();
+
+	#ifdef MANA_DRAW_BUILDER_COUNT
+		++nPoolReuseCount_;
+	#endif
+		return pNode;
+	}
+
+	draw_base* pNode = create_draw_base(sNodeID);
+	if(pNode)
+	{
+		pNode->init();
+
+	#ifdef MANA_DRAW_BUILDER_COUNT
+		++nPoolCreateCount_;
+	#endif
+	}
+	return pNode;
+}
+
+bool draw_builder::release_draw_base(const string_fw& sNodeID, draw_base* pNode)
+{
+	if(!pNode) return false;
+
+	if(pNode->parent())
+	{
+		logger::warnln("[draw_builder]親から外されていないノードは返却できません。: " + sNodeID.get());
+		return false;
+	}
+
+	draw_hash::iterator it = hashNode_.find(sNodeID);
+	if(eLoadState_!=LOAD_FIN || it==hashNode_.end() || !reset_draw_from_data(pNode, it->second))
+	{// 定義の状態に戻せないものは捨てる
+		delete pNode;
+
+	#ifdef MANA_DRAW_BUILDER_COUNT
+		++nPoolDiscardCount_;
+	#endif
+		return false;
+	}
+
+	pNode->init();
+	hashPool_[sNodeID].emplace_back(pNode);
+
+#ifdef MANA_DRAW_BUILDER_COUNT
+	++nPoolReleaseCount_;
+#endif
+	return true;
+}
+
+bool draw_builder::warm_up(const string_fw& sNodeID, uint32_t nNum)
+{
+	if(eLoadState_!=LOAD_FIN) return false;
+
+	vector<draw_base*>& vecPool = hashPool_[sNodeID];
+	if(vecPool.capacity()<nNum) vecPool.reserve(nNum);
+
+	while(vecPool.size()<nNum)
+	{
+		draw_base* pNode = create_draw_base(sNodeID);
+		if(!pNode) return false;
+
+		pNode->init();
+		vecPool.emplace_back(pNode);
+
+	#ifdef MANA_DRAW_BUILDER_COUNT
+		++nPoolCreateCount_;
+	#endif
+	}
+
+	return true;
+}
+
+uint32_t draw_builder::pool_num(const string_fw& sNodeID)const
+{
+	pool_hash::const_iterator it = hashPool_.find(sNodeID);
+	return it!=hashPool_.end() ? it->second.size() : 0;
+}
+
+void draw_builder::clear_pool()
+{
+	for(auto& it : hashPool_)
+	{
+		for(auto& pNode : it.second) delete pNode;
+	}
+	hashPool_.clear();
+}
+
 void draw_builder::set_draw_base(draw_base* pNode, draw_base_data* pData, bool bChildren)
 {
 #ifdef MANA_DEBUG
@@ -129,6 +241,7 @@ draw_base* draw_builder::create_draw_from_data(draw_base_data* pData)
 	case DRAW_MESSAGE:		return create_message(pData);
 	case DRAW_TIMELINE:		return create_timeline(pData);
 	case DRAW_MOVIECLIP:	return create_movieclip(pData);
+	case DRAW_SKELETON:		return create_skeleton(pData);
 	case DRAW_BASE:			return create_draw_inner(pData);
 	default:				return nullptr;
 	}
@@ -230,6 +343,7 @@ timeline* draw_builder::create_timeline(draw_base_data* pData)
 			pTweenFrame->set_draw_info_start(pTweenData->drawInfo_)
 						.set_draw_info_end(pTweenData->drawInfoEnd_)
 						.set_easing_param(pTweenData->fEasing_)
+						.set_curve(pTweenData->pCurve_)
 						;
 
 			pKeyFrameData	= pTweenData;
@@ -306,6 +420,14 @@ movieclip* draw_builder::create_movieclip(draw_base_data* pData)
 	return pMovieClip;
 }
 
+skeleton* draw_builder::create_skeleton(draw_base_data* pData)
+{
+	skeleton* pSkeleton = new_ skeleton(pData->vecChildren_.size());
+	pSkeleton->set_def(static_cast<skeleton_data*>(pData)->pDef_);
+	set_draw_base(pSkeleton, pData);
+	return pSkeleton;
+}
+
 draw_base* draw_builder::create_draw_inner(draw_base_data* pData)
 {
 	draw_base* pNode = new_ draw_base(pData->vecChildren_.size());
@@ -313,5 +435,157 @@ draw_base* draw_builder::create_draw_inner(draw_base_data* pData)
 	return pNode;
 }
 
+////////////////////////////////////
+// プール返却時のリセット
+////////////////////////////////////
+bool draw_builder::reset_draw_switch(draw_base* pNode, draw_base_data* pData)
+{
+	if(pData->sID_.get().empty()) return reset_draw_from_data(pNode, pData);
+
+	// ID指定は、参照先の状態に戻してから上書き分を適用する。create_draw_switchと同じ順番
+	draw_hash::iterator it = hashNode_.find(pData->sID_);
+	if(it==hashNode_.end() || !reset_draw_from_data(pNode, it->second)) return false;
+
+	set_draw_base(pNode, pData, false);
+	if(pData->is_over(draw_base_data::FLAG_CHILDREN) && pData->vecChildren_.size()>0)
+		return reset_draw_children(pNode, pData);
+
+	return true;
+}
+
+bool draw_builder::reset_draw_from_data(draw_base* pNode, draw_base_data* pData)
+{
+	if(pNode->kind()!=pData->eKind_) return false;
+
+	// 生成直後の値に戻してから、定義を適用する
+	pNode->visible(true).pause(false);
+	pNode->set_draw_info(draw::draw_info());
+	pNode->set_pivot(draw::POS());
+	pNode->set_color(D3DCOLOR_ARGB(0,255,255,255));
+	pNode->set_color_mode(COLOR_NO);
+
+	switch(pData->eKind_)
+	{
+	case DRAW_LABEL:
+		static_cast<label*>(pNode)->set_text_data(static_cast<label_data*>(pData)->pTextData_);
+	break;
+
+	case DRAW_SPRITE:
+	{
+		sprite_data* pSpriteData = static_cast<sprite_data*>(pData);
+		static_cast<sprite*>(pNode)->set_tex_id(pSpriteData->nTexID_)
+									.set_tex_rect(pSpriteData->rect_)
+									.blend(false);
+	}
+	break;
+
+	case DRAW_AUDIO_FRAME:
+		static_cast<audio_frame*>(pNode)->set_audio_info(static_cast<audio_data*>(pData)->info_);
+	break;
+
+	case DRAW_MESSAGE:
+	{
+		message_data* pMesData = static_cast<message_data*>(pData);
+		static_cast<message*>(pNode)->set_text_data(pMesData->pTextData_);
+		static_cast<message*>(pNode)->set_text_char_num(pMesData->nTextCharNum_)
+									 .set_next(pMesData->nNext_)
+									 .set_sound_id(pMesData->nSoundID_);
+	}
+	break;
+
+	case DRAW_TIMELINE:
+		return reset_timeline(pNode, pData);
+
+	case DRAW_SKELETON:
+		static_cast<skeleton*>(pNode)->set_def(static_cast<skeleton_data*>(pData)->pDef_)
+									  .blend_sprite(false);
+	break;
+
+	case DRAW_MOVIECLIP:
+	case DRAW_BASE:
+	break;
+
+	default:
+		return false;
+	}
+
+	set_draw_base(pNode, pData, false);
+	if(pData->is_over(draw_base_data::FLAG_CHILDREN))
+		return reset_draw_children(pNode, pData);
+
+	return pNode->count_children()==0;
+}
+
+bool draw_builder::reset_draw_children(draw_base* pNode, draw_base_data* pData)
+{
+	// 生成に失敗した子は詰められているので、数が合わなければ戻せない
+	auto& vecChildren = pNode->children();
+	if(vecChildren.size()!=pData->vecChildren_.size()) return false;
+
+	for(uint32_t i=0; i<vecChildren.size(); ++i)
+	{
+		if(!reset_draw_switch(vecChildren[i], pData->vecChildren_[i])) return false;
+	}
+
+	return true;
+}
+
+bool draw_builder::reset_timeline(draw_base* pNode, draw_base_data* pData)
+{
+	set_draw_base(pNode, pData, false);
+
+	auto& vecKeyFrame = pNode->children();
+	if(vecKeyFrame.size()!=pData->vecChildren_.size()) return false;
+
+	// timeline/keyframeの色は子に伝播するので、keyframeを全部戻してから子を戻す
+	for(uint32_t i=0; i<vecKeyFrame.size(); ++i)
+	{
+		keyframe_data* pKeyFrameData = static_cast<keyframe_data*>(pData->vecChildren_[i]);
+		if(vecKeyFrame[i]->kind()!=pKeyFrameData->eKind_) return false;
+
+		keyframe* pKeyFrame = static_cast<keyframe*>(vecKeyFrame[i]);
+		pKeyFrame->visible(true).pause(false);
+		pKeyFrame->set_draw_info(draw::draw_info());
+		pKeyFrame->set_pivot(draw::POS());
+		pKeyFrame->set_color(D3DCOLOR_ARGB(0,255,255,255));
+		pKeyFrame->set_color_mode(COLOR_NO);
+
+		if(pKeyFrameData->eKind_==DRAW_TWEENFRAME)
+		{
+			tweenframe_data* pTweenData = static_cast<tweenframe_data*>(pKeyFrameData);
+			static_cast<tweenframe*>(pKeyFrame)->set_draw_info_start(pTweenData->drawInfo_)
+												.set_draw_info_end(pTweenData->drawInfoEnd_)
+												.set_easing_param(pTweenData->fEasing_)
+												.set_curve(pTweenData->pCurve_);
+		}
+
+		set_draw_base(pKeyFrame, pKeyFrameData, false);
+		pKeyFrame->set_next_frame(pKeyFrameData->nNextFrame_);
+	}
+
+	keyframe_data* pPreKeyFrameData = nullptr;
+	for(uint32_t i=0; i<vecKeyFrame.size(); ++i)
+	{
+		keyframe_data*	pKeyFrameData	= static_cast<keyframe_data*>(pData->vecChildren_[i]);
+		auto&			vecNode			= vecKeyFrame[i]->children();
+		if(vecNode.size()!=pKeyFrameData->vecChildren_.size()) return false;
+
+		for(uint32_t n=0; n<vecNode.size(); ++n)
+		{
+			draw_base_data* pNodeData = pKeyFrameData->vecChildren_[n];
+
+			// 前のフレームと共有しているノードは、前のフレームで戻し済み
+			if(!pNodeData->sName_.get().empty() && pPreKeyFrameData
+			&& draw_id_form_name(pPreKeyFrameData->vecChildren_, pNodeData->sName_)) continue;
+
+			if(!reset_draw_switch(vecNode[n], pNodeData)) return false;
+		}
+
+		pPreKeyFrameData = pKeyFrameData;
+	}
+
+	return true;
+}
+
 } // namespace graphic end
 } // namespace mana end
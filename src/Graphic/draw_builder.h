@@ -1,5 +1,9 @@
 ﻿#pragma once
 
+#ifdef MANA_DEBUG
+#define MANA_DRAW_BUILDER_COUNT
+#endif
+
 namespace mana{
 
 namespace graphic{
@@ -12,6 +16,7 @@ struct keyframe_data;
 struct tweenframe_data;
 struct timeline_data;
 struct movieclip_data;
+struct skeleton_data;
 
 class label;
 class sprite;
@@ -20,6 +25,7 @@ class message;
 class keyframe;
 class timeline;
 class movieclip;
+class skeleton;
 
 class draw_context;
 class draw_base;
@@ -27,7 +33,15 @@ class draw_base;
 /*! @brief draw_baseビルダー
  *
  *  定義ファイルを読み込み、それに合わせてdraw_baseインスタンスを生成する
- *  TextTableやAudioを使う時は、先にTextTable/AudioPlayerをロード完了させておくこと */
+ *  TextTableやAudioを使う時は、先にTextTable/AudioPlayerをロード完了させておくこと
+ *
+ *  エフェクトや弾のように、同じノードを何度も作っては捨てる時は、
+ *  acquire_draw_base/release_draw_baseでプールから出し入れする。
+ *  返却されたノードは定義の状態に戻してプールに入れるので、次のacquireではnewが起きない。
+ *  warm_upで先に作っておけば、ゲーム中の生成は無くなる
+ *
+ *  プールの出し入れ回数をカウントする時は、
+ *  MANA_DRAW_BUILDER_COUNTをdefineする */
 class draw_builder
 {
 public:
@@ -63,6 +77,30 @@ public:
 	template<class T>
 	T*			create_draw_base_cast(const string_fw& sNodeID){ return static_cast<T*>(create_draw_base(sNodeID)); }
 
+	//! @defgroup draw_builder_pool インスタンスプール
+	//! @{
+	//! @brief ノードをプールから取り出す。プールが空なら生成する
+	/*! 返却する時はrelease_draw_baseに同じIDを渡すこと */
+	draw_base*	acquire_draw_base(const string_fw& sNodeID);
+
+	template<class T>
+	T*			acquire_draw_base_cast(const string_fw& sNodeID){ return static_cast<T*>(acquire_draw_base(sNodeID)); }
+
+	//! @brief ノードを定義の状態に戻して、プールに返却する
+	/*! 親から外してから返却すること。子の構成が変わっていて戻せない時はdeleteする
+	 *  @retval true プールに入った */
+	bool		release_draw_base(const string_fw& sNodeID, draw_base* pNode);
+
+	//! プールにnNum個になるまでノードを生成しておく
+	bool		warm_up(const string_fw& sNodeID, uint32_t nNum);
+
+	//! プール中のノード数
+	uint32_t	pool_num(const string_fw& sNodeID)const;
+
+	//! プール中のノードを全てdeleteする
+	void		clear_pool();
+	//! @}
+
 	//! @brief ノード情報ファイルからノード情報を展開する
 	/*!	ファイルからデータをロードする。ロードの終了はis_fin_loadメソッドで確認する。
 	 *	このメソッド前後で、rendererのstart_request/end_requestを呼んで置くこと
@@ -89,6 +127,7 @@ protected:
 	message_data*	load_draw_message(const p_tree::ptree& element, draw_context& ctx);
 	timeline_data*	load_draw_timeline(const p_tree::ptree& element, draw_context& ctx);
 	movieclip_data*	load_draw_movieclip(const p_tree::ptree& element, draw_context& ctx);
+	skeleton_data*	load_draw_skeleton(const p_tree::ptree& element, draw_context& ctx);
 
 	keyframe_data*	 load_draw_keyframe(const p_tree::ptree& element, draw_context& ctx);
 	tweenframe_data* load_draw_tweenframe(const p_tree::ptree& element, draw_context& ctx);
@@ -119,11 +158,26 @@ protected:
 
 	movieclip*		create_movieclip(draw_base_data* pData);
 
+	skeleton*		create_skeleton(draw_base_data* pData);
+
 	draw_base*		create_draw_inner(draw_base_data* pData);
 	//! @}
 
+	//! @defgroup draw_builder_reset プール返却時に定義の状態に戻すヘルパー
+	//! @{
+	//! pNodeをpDataの状態に戻す。子の構成が合わない時はfalse
+	bool			reset_draw_switch(draw_base* pNode, draw_base_data* pData);
+	bool			reset_draw_from_data(draw_base* pNode, draw_base_data* pData);
+	//! 子をpDataの子の状態に戻す
+	bool			reset_draw_children(draw_base* pNode, draw_base_data* pData);
+	bool			reset_timeline(draw_base* pNode, draw_base_data* pData);
+	//! @}
+
 protected:
+	typedef unordered_map<string_fw, vector<draw_base*>, string_fw_hash> pool_hash;
+
 	draw_hash	hashNode_;
+	pool_hash	hashPool_;	//!< ノードIDごとの返却済みインスタンス
 
 protected:
 	load_state	eLoadState_;
@@ -141,6 +195,22 @@ public:
 private:
 	bool bReDefine_;
 #endif
+
+#ifdef MANA_DRAW_BUILDER_COUNT
+public:
+	//! プールが空で、acquireやwarm_upでノードを生成した回数。ゲーム中に増えていなければ、ノードのnewは起きていない
+	uint32_t	pool_create_count()const{ return nPoolCreateCount_; }
+	uint32_t	pool_reuse_count()const{ return nPoolReuseCount_; }
+	uint32_t	pool_release_count()const{ return nPoolReleaseCount_; }
+	//! 定義の状態に戻せずにdeleteした回数
+	uint32_t	pool_discard_count()const{ return nPoolDiscardCount_; }
+
+private:
+	uint32_t	nPoolCreateCount_;
+	uint32_t	nPoolReuseCount_;
+	uint32_t	nPoolReleaseCount_;
+	uint32_t	nPoolDiscardCount_;
+#endif
 };
 
 } // namespace graphic end
@@ -158,6 +228,15 @@ private:
 	while(builder.is_fin_load(ctx)==draw_builder::LOAD);
 
 	draw_base* pNode = builder.create_draw("TEST");
+
+	// プールを使う時
+	builder.warm_up("BULLET", 64);
+
+	draw_base* pBullet = builder.acquire_draw_base("BULLET");
+	root.add_child(pBullet, 100);
+	...
+	root.remove_child(100, false);
+	builder.release_draw_base("BULLET", pBullet);
 */
 
 /*
@@ -244,7 +323,7 @@ private:
 			<draw x="" y="" width="" height="" angle="" alpha="" />
 			<draw x="" y="" width="" height="" angle="" alpha="" />
 			<color value="" mode="" />
-			<easing value="1.0" />
+			<easing value="1.0" /> // x1/y1/x2/y2を書くと3次ベジェになる。<easing x1="0.42" y1="0" x2="0.58" y2="1" />
 			<child>
 				<base name=""> // 同一timeline上で、name属性が同じbaseはインスタンスを共有する
 					<pos x="" y="" />
@@ -263,6 +342,24 @@ private:
 		</layer>
 	</movieclip>
 
+	<skeleton id="">
+		<pivot x="" y="" />
+		<draw x="" y="" width="" height="" angle="" alpha="" />
+		<color value="" mode="" />
+		<bone name="" parent="" x="" y="" width="" height="" angle="" alpha="" /> // parentは先に書いたボーンの名前。省略でルート
+		<part bone="">	// 書いた順に描画される
+			<tex id="" />
+			<rect left="" top="" right="" bottom="" />
+			<draw x="" y="" width="" height="" angle="" alpha="" /> // ボーンからの相対
+			<pivot x="" y="" />
+		</part>
+		<anim name="" frame="" loop="">
+			<track bone="">
+				<key frame="" x="" y="" width="" height="" angle="" alpha="" /> // キーの間は線形補間
+			</track>
+		</anim>
+	</skeleton>
+
 </draw_base_def>
 */
 
@@ -10,6 +10,7 @@
 #include "text_table.h"
 #include "draw_data.h"
 #include "draw_context.h"
+#include "skeleton_def.h"
 #include "draw_builder.h"
 
 namespace mana{
@@ -50,6 +51,8 @@ bool draw_builder::load_draw_info_file(const string& sFilePath, draw_context& co
 	uint32_t nTexNum	= 1;
 	uint32_t nFontNum	= 1;
 
+	set<string> setAtlasGroup; // アトラス指定があったグループ
+
 	// texture/font系のロードを仕込む
 	for(auto& it : *draw_base_def)
 	{
@@ -78,11 +81,13 @@ bool draw_builder::load_draw_info_file(const string& sFilePath, draw_context& co
 			cmd.sTextureID_	= it.second.get<string>("<xmlattr>.id","");
 			cmd.sFilePath_	= it.second.get<string>("<xmlattr>.src","");
 			cmd.sGroup_		= it.second.get<string>("<xmlattr>.group","");
+			cmd.bAtlas_		= it.second.get<bool>("<xmlattr>.atlas",false);
 			cmd.callback_	= [this](uint32_t result){ if(result>0) ++nLoadFin_; else bLoadErr_.store(true, std::memory_order_release); };
 
 			if(cmd.sTextureID_!="" && cmd.sFilePath_!="")
 			{
 				context.renderer()->request(cmd);
+				if(cmd.bAtlas_) setAtlasGroup.insert(cmd.sGroup_);
 				++nTexNum;
 			}
 			else
@@ -114,6 +119,10 @@ bool draw_builder::load_draw_info_file(const string& sFilePath, draw_context& co
 		}
 	}
 
+	// 登録の後にアトラスに詰める
+	for(auto& it : setAtlasGroup)
+		context.renderer()->request_tex_build_atlas(it);
+
 	if(nLoadWait_>0)
 		eLoadState_ = LOAD_TEX_FONT_WAIT;
 	else
@@ -200,6 +209,8 @@ bool draw_builder::load_draw_switch(const p_tree::ptree::value_type& element, dr
 		pData = load_draw_timeline(element.second, ctx);
 	else if(element.first=="movieclip")
 		pData = load_draw_movieclip(element.second, ctx);
+	else if(element.first=="skeleton")
+		pData = load_draw_skeleton(element.second, ctx);
 
 	if(!pData) return false;
 
@@ -739,6 +750,125 @@ movieclip_data* draw_builder::load_draw_movieclip(const p_tree::ptree& element,
 	return pData;
 }
 
+skeleton_data* draw_builder::load_draw_skeleton(const p_tree::ptree& element, draw_context& ctx)
+{
+	skeleton_data* pData = new_ skeleton_data();
+	shared_ptr<skeleton_def> pDef = make_shared<skeleton_def>();
+
+	auto err = [&pData](const string& mes)->skeleton_data*{ logger::warnln("[draw_builder]skeletonタグのフォーマットが間違っています。: " + mes); delete pData; return nullptr; };
+
+	for(const auto& child : element)
+	{
+		tribool r = load_draw_common_switch(child, ctx, pData);
+
+		if(indeterminate(r)) return err("");
+
+		if(r) continue;
+
+		if(child.first=="bone")
+		{
+			string sName = child.second.get<string>("<xmlattr>.name", "");
+			if(sName.empty()) return err("boneタグにnameが設定されていません。");
+
+			uint32_t nParent = skeleton_def::NO_PARENT;
+			optional<string> sParent = child.second.get_optional<string>("<xmlattr>.parent");
+			if(sParent)
+			{
+				optional<uint32_t> n = pDef->bone_index(*sParent);
+				if(!n) return err("親ボーンがありません。: " + *sParent);
+				nParent = *n;
+			}
+
+			draw::draw_info bind;
+			load_draw_base_draw_info(child.second, bind);
+
+			if(pDef->add_bone(sName, nParent, bind)==UINT_MAX) return err("bone : " + sName);
+		}
+		else if(child.first=="part")
+		{
+			string sBone = child.second.get<string>("<xmlattr>.bone", "");
+			optional<uint32_t> nBone = pDef->bone_index(sBone);
+			if(!nBone) return err("partのボーンがありません。: " + sBone);
+
+			uint32_t		nTexID=0;
+			draw::RECT		rect;
+			draw::draw_info	info;
+			draw::POS		pivot;
+
+			for(const auto& p : child.second)
+			{
+				if(p.first=="tex")
+				{
+					optional<string> id = p.second.get_optional<string>("<xmlattr>.id");
+					if(!id) return err("texタグにidが設定されていません。");
+
+					optional<uint32_t> nID = ctx.renderer()->texture_id(*id);
+					if(!nID) return err("textureロードが終わっていません。: " + *id);
+
+					nTexID = *nID;
+				}
+				else if(p.first=="rect")
+				{
+					rect.fLeft		= p.second.get<float>("<xmlattr>.left",0.0f);
+					rect.fTop		= p.second.get<float>("<xmlattr>.top",0.0f);
+					rect.fRight		= p.second.get<float>("<xmlattr>.right",0.0f);
+					rect.fBottom	= p.second.get<float>("<xmlattr>.bottom",0.0f);
+				}
+				else if(p.first=="draw")
+				{
+					load_draw_base_draw_info(p.second, info);
+				}
+				else if(p.first=="pivot")
+				{
+					load_draw_base_pivot(p.second, pivot);
+				}
+			}
+
+			if(nTexID==0) return err("partにtexタグが指定されていません。");
+
+			pDef->add_part(*nBone, nTexID, rect, info, pivot);
+		}
+		else if(child.first=="anim")
+		{
+			string	 sName		= child.second.get<string>("<xmlattr>.name", "");
+			uint32_t nFrameNum	= child.second.get<uint32_t>("<xmlattr>.frame", 0);
+			bool	 bLoop		= child.second.get<bool>("<xmlattr>.loop", true);
+
+			if(sName.empty()) return err("animタグにnameが設定されていません。");
+			if(nFrameNum==0)  return err("animのフレーム数が0です。: " + sName);
+
+			uint32_t nAnim = pDef->add_anim(sName, nFrameNum, bLoop);
+
+			for(const auto& track : child.second)
+			{
+				if(track.first!="track") continue;
+
+				string sBone = track.second.get<string>("<xmlattr>.bone", "");
+				optional<uint32_t> nBone = pDef->bone_index(sBone);
+				if(!nBone) return err("trackのボーンがありません。: " + sBone);
+
+				for(const auto& key : track.second)
+				{
+					if(key.first!="key") continue;
+
+					draw::draw_info info;
+					load_draw_base_draw_info(key.second, info);
+
+					if(!pDef->add_key(nAnim, *nBone, key.second.get<uint32_t>("<xmlattr>.frame", 0), info))
+						return err("keyが不正です。: " + sName + " " + sBone);
+				}
+			}
+		}
+	}
+
+	if(pDef->anim_num()==0) return err("animが一つも指定されていません。");
+
+	pDef->bake();
+	pData->pDef_ = pDef;
+
+	return pData;
+}
+
 keyframe_data* draw_builder::load_draw_keyframe(const p_tree::ptree& element, draw_context& ctx)
 {
 	keyframe_data* pFrame = new_ keyframe_data();;
@@ -790,6 +920,7 @@ tweenframe_data* draw_builder::load_draw_tweenframe(const p_tree::ptree& element
 	tweenframe_data* pTween = new_ tweenframe_data();
 
 	bool bDraw=false;
+	optional<boost::array<float,4>> bezier;
 
 	for(const auto& child : element)
 	{
@@ -818,6 +949,13 @@ tweenframe_data* draw_builder::load_draw_tweenframe(const p_tree::ptree& element
 		else if(child.first=="easing")
 		{
 			pTween->fEasing_ = clamp(child.second.get<float>("<xmlattr>.value",0.0f), -1.0, 1.0);
+
+			if(child.second.get_optional<float>("<xmlattr>.x1"))
+			{// ベジェ指定
+				boost::array<float,4> p = { child.second.get("<xmlattr>.x1",0.0f), child.second.get("<xmlattr>.y1",0.0f),
+											child.second.get("<xmlattr>.x2",1.0f), child.second.get("<xmlattr>.y2",1.0f) };
+				bezier = p;
+			}
 		}
 		else if(child.first=="child")
 		{
@@ -842,6 +980,12 @@ tweenframe_data* draw_builder::load_draw_tweenframe(const p_tree::ptree& element
 	#endif
 	}
 
+	// イージングをベイクしておく
+	shared_ptr<tween_curve> pCurve = make_shared<tween_curve>();
+	if(bezier)	pCurve->bake_bezier((*bezier)[0], (*bezier)[1], (*bezier)[2], (*bezier)[3], pTween->nNextFrame_);
+	else		pCurve->bake_sin(pTween->fEasing_, pTween->nNextFrame_);
+	pTween->pCurve_ = pCurve;
+
 	return pTween;
 }
 
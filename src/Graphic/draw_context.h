@@ -2,6 +2,10 @@
 
 #include "../Draw/renderer_2d_util.h"
 
+#ifdef MANA_DEBUG
+#define MANA_DRAW_CULL_COUNT
+#endif
+
 namespace mana{
 namespace draw{
 class renderer_2d;
@@ -11,13 +15,30 @@ namespace audio{
 class audio_player;
 } // namespace audio end
 
+namespace concurrent{
+class worker;
+} // namespace concurrent end
+
 namespace graphic{
 class text_table;
 
+/*! @brief ノードツリーを動かす時の状態
+ *
+ *  set_cull_rectでカリング矩形を設定すると、描画範囲が矩形の外にあるノードは描画コマンドを生成しなくなる。
+ *  矩形はスクリーン座標で、普通は画面サイズにする。カリングはバックバッファに描画する時だけ行う
+ *
+ *  カリングした数をカウントする時は、
+ *  MANA_DRAW_CULL_COUNTをdefineする
+ */
 class draw_context
 {
 public:
-	draw_context():bPause_(false),nRenderTarget_(draw::cmd::BACK_BUFFER_ID),bVisible_(true),fTotalZ_(0.f){}
+	draw_context():bPause_(false),nRenderTarget_(draw::cmd::BACK_BUFFER_ID),bVisible_(true),fTotalZ_(0.f),bCull_(false)
+	{
+	#ifdef MANA_DRAW_CULL_COUNT
+		reset_cull_count();
+	#endif
+	}
 
 public:
 	bool			is_pause()const{ return bPause_; }
@@ -33,6 +54,21 @@ public:
 	uint32_t		render_target()const{ return nRenderTarget_; }
 	void			set_render_target(uint32_t nRenderTarget){ nRenderTarget_ = nRenderTarget; }
 
+	//! @defgroup draw_context_cull カリング
+	//! @{
+	bool				is_cull()const{ return bCull_ && nRenderTarget_==draw::cmd::BACK_BUFFER_ID; }
+	const draw::RECT&	cull_rect()const{ return cullRect_; }
+	void				set_cull_rect(const draw::RECT& rect){ cullRect_=rect; bCull_=true; }
+	void				clear_cull_rect(){ bCull_=false; }
+
+	//! ワールド座標の範囲がカリング矩形の外にあるか。カリングしない時はfalse
+	bool				is_cull_out(const draw::RECT& bounds)const
+	{
+		return is_cull() && (bounds.fRight<cullRect_.fLeft || bounds.fLeft>cullRect_.fRight
+						  || bounds.fBottom<cullRect_.fTop || bounds.fTop>cullRect_.fBottom);
+	}
+	//! @}
+
 public:
 	const shared_ptr<class text_table>&		text_table(){ return pTextTable_; }
 	draw_context&							set_text_table(const shared_ptr<class text_table>& pTextTable){ pTextTable_=pTextTable; return *this; }
@@ -43,6 +79,10 @@ public:
 	const shared_ptr<audio::audio_player>&	audio_player(){ return pAudioPlayer_; }
 	draw_context&							set_audio_player(const shared_ptr<audio::audio_player>& pAudioPlayer){ pAudioPlayer_ = pAudioPlayer; return *this; }
 
+	//! parallel_layerが子を動かすのに使うワーカー。nullptrだとparallel_layerも逐次で動かす
+	const shared_ptr<concurrent::worker>&	worker(){ return pWorker_; }
+	draw_context&							set_worker(const shared_ptr<concurrent::worker>& pWorker){ pWorker_ = pWorker; return *this; }
+
 protected:
 	bool		bPause_; //!< trueだと、イベントハンドラが呼ばれなくなり、timelineのフレーム進行なども止まる
 
@@ -54,6 +94,28 @@ protected:
 
 	shared_ptr<draw::renderer_2d>	pRenderer_;
 	shared_ptr<audio::audio_player>	pAudioPlayer_;
+	shared_ptr<concurrent::worker>	pWorker_;
+
+	bool		bCull_;
+	draw::RECT	cullRect_; //!< カリング矩形。スクリーン座標
+
+#ifdef MANA_DRAW_CULL_COUNT
+public:
+	//! カリングで生成しなかった描画コマンド数
+	uint32_t	cull_cmd_count()const{ return nCullCmdCount_; }
+	//! cull_subtreeで描画しなかったサブツリー数
+	uint32_t	cull_subtree_count()const{ return nCullSubtreeCount_; }
+
+	void		add_cull_cmd_count(uint32_t nNum=1){ nCullCmdCount_+=nNum; }
+	void		add_cull_subtree_count(){ ++nCullSubtreeCount_; }
+	//! 別スレッドで使ったコンテキストのカウントを足し込む
+	void		add_cull_count(const draw_context& ctx){ nCullCmdCount_+=ctx.nCullCmdCount_; nCullSubtreeCount_+=ctx.nCullSubtreeCount_; }
+	void		reset_cull_count(){ nCullCmdCount_=0; nCullSubtreeCount_=0; }
+
+private:
+	uint32_t	nCullCmdCount_;
+	uint32_t	nCullSubtreeCount_;
+#endif
 };
 
 } // namespace graphic end
@@ -4,10 +4,13 @@
 #include "../Draw/renderer_2d_util.h"
 #include "../Draw/text_data.h"
 #include "draw_util.h"
+#include "tween_curve.h"
 
 namespace mana{
 namespace graphic{
 
+class skeleton_def;
+
 struct draw_base_data
 {
 public:
@@ -111,6 +114,8 @@ public:
 public:
 	draw::draw_info		drawInfoEnd_;
 	float				fEasing_;
+
+	shared_ptr<const tween_curve> pCurve_; //!< ロード時にベイクしたカーブ
 };
 
 struct timeline_data : public draw_base_data
@@ -125,5 +130,14 @@ public:
 	movieclip_data(){ eKind_=DRAW_MOVIECLIP; }
 };
 
+struct skeleton_data : public draw_base_data
+{
+public:
+	skeleton_data(){ eKind_=DRAW_SKELETON; }
+
+public:
+	shared_ptr<const skeleton_def> pDef_; //!< ロード時に焼いた定義。生成したノードで共有する
+};
+
 } // namespace graphic end
 } // namespace mana end
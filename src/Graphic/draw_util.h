@@ -16,9 +16,21 @@ enum draw_base_kind
 	DRAW_TIMELINE,
 	DRAW_KEYFRAME,
 	DRAW_TWEENFRAME,
+	DRAW_STATIC_LAYER,
+	DRAW_PARALLEL_LAYER,
+	DRAW_SOA_LAYER,
+	DRAW_SKELETON,
 	DRAW_END,
 };
 
+//! カリング用の描画範囲の種類
+enum bounds_kind
+{
+	BOUNDS_EMPTY,		//!< 何も描画しない
+	BOUNDS_RECT,		//!< 矩形の範囲に描画する
+	BOUNDS_INFINITE,	//!< 範囲が分からない。カリングしない
+};
+
 //! draw_baseイベントハンドラに渡されるイベントID
 enum draw_base_event_id
 {
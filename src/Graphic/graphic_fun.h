@@ -2,6 +2,9 @@
 
 #include <cmath>
 
+#include "../Draw/renderer_2d_util.h"
+#include "draw_util.h"
+
 namespace mana{
 namespace graphic{
 
@@ -15,6 +18,122 @@ inline float easing_sin_step(float fEasing, float fStep)
 	return fStep+(sinf(fStep*pi<float>())*fEasing/pi<float>());
 }
 
+//! @brief 3次ベジェによるイージングステップ計算
+/*! (0,0),(fX1,fY1),(fX2,fY2),(1,1)のベジェで、x=fStepの時のyを返す
+ *  @param[in] fX1,fX2	制御点のx。0.0～1.0であること
+ *  @param[in] fStep	0.0～1.0の値を取る */
+inline float cubic_bezier_step(float fX1, float fY1, float fX2, float fY2, float fStep)
+{
+	// ベジェの媒介変数tでの値。aはもう一方の制御点と合わせた係数
+	auto bezier   = [](float a1, float a2, float t){ return ((1.f-3.f*a2+3.f*a1)*t + (3.f*a2-6.f*a1))*t*t + 3.f*a1*t; };
+	auto bezier_d = [](float a1, float a2, float t){ return 3.f*(1.f-3.f*a2+3.f*a1)*t*t + 2.f*(3.f*a2-6.f*a1)*t + 3.f*a1; };
+
+	// x(t)=fStepになるtをニュートン法で求める。傾きが小さい時は二分法にする
+	float t = fStep;
+	for(uint32_t i=0; i<8; ++i)
+	{
+		float fErr = bezier(fX1, fX2, t) - fStep;
+		if(fabsf(fErr)<1e-6f) return bezier(fY1, fY2, t);
+
+		float fD = bezier_d(fX1, fX2, t);
+		if(fabsf(fD)<1e-6f) break;
+		t -= fErr/fD;
+		if(t<0.f || t>1.f) break;
+	}
+
+	float fLow=0.f, fHigh=1.f;
+	t = fStep;
+	for(uint32_t i=0; i<32; ++i)
+	{
+		float x = bezier(fX1, fX2, t);
+		if(fabsf(x-fStep)<1e-6f) break;
+
+		if(x<fStep)	fLow  = t;
+		else		fHigh = t;
+		t = (fLow+fHigh)*0.5f;
+	}
+
+	return bezier(fY1, fY2, t);
+}
+
+//! @defgroup graphic_fun_affine 2x3アフィン変換。_11,_12,_21,_22,_41,_42の順のfloat[6]で持つ
+//! @{
+//! @brief draw_base::calc_worldと同じく、scale*rot*posの変換を作る
+/*! @param[in] fAngle 度 */
+inline void affine_local(float fX, float fY, float fAngle, float fWidth, float fHeight, float afOut[6])
+{
+	float c=1.f, s=0.f;
+	if(fAngle!=0.f)
+	{
+		const float fRad = fAngle*boost::math::constants::pi<float>()/180.0f;
+		c = cosf(fRad);
+		s = sinf(fRad);
+	}
+
+	afOut[0] =  fWidth*c;	afOut[1] = fWidth*s;
+	afOut[2] = -fHeight*s;	afOut[3] = fHeight*c;
+	afOut[4] =  fX;			afOut[5] = fY;
+}
+
+//! @brief afAの後にafBを掛けた変換。afOutはafA/afBと別の領域であること
+inline void affine_mul(const float afA[6], const float afB[6], float afOut[6])
+{
+	afOut[0] = afA[0]*afB[0] + afA[1]*afB[2];
+	afOut[1] = afA[0]*afB[1] + afA[1]*afB[3];
+	afOut[2] = afA[2]*afB[0] + afA[3]*afB[2];
+	afOut[3] = afA[2]*afB[1] + afA[3]*afB[3];
+	afOut[4] = afA[4]*afB[0] + afA[5]*afB[2] + afB[4];
+	afOut[5] = afA[4]*afB[1] + afA[5]*afB[3] + afB[5];
+}
+//! @}
+
+//! @defgroup graphic_fun_bounds カリング用の矩形操作
+//! @{
+//! @brief 矩形をアフィン変換して、それを囲む矩形を求める
+inline void affine_bounds(const float afAffine[6], const draw::RECT& rect, draw::RECT& out)
+{
+	// 4頂点を変換する代わりに、軸ごとに小さい方・大きい方を足し合わせる
+	const float x0=rect.fLeft*afAffine[0], x1=rect.fRight*afAffine[0];
+	const float x2=rect.fTop *afAffine[2], x3=rect.fBottom*afAffine[2];
+	const float y0=rect.fLeft*afAffine[1], y1=rect.fRight*afAffine[1];
+	const float y2=rect.fTop *afAffine[3], y3=rect.fBottom*afAffine[3];
+
+	out.fLeft	= afAffine[4] + (std::min)(x0,x1) + (std::min)(x2,x3);
+	out.fRight	= afAffine[4] + (std::max)(x0,x1) + (std::max)(x2,x3);
+	out.fTop	= afAffine[5] + (std::min)(y0,y1) + (std::min)(y2,y3);
+	out.fBottom	= afAffine[5] + (std::max)(y0,y1) + (std::max)(y2,y3);
+}
+
+//! 2つの矩形が重なっているか。辺が接しているだけでも重なっているとする
+inline bool is_overlap(const draw::RECT& a, const draw::RECT& b)
+{
+	return a.fLeft<=b.fRight && b.fLeft<=a.fRight && a.fTop<=b.fBottom && b.fTop<=a.fBottom;
+}
+
+//! outをrectも囲むように広げる
+inline void union_bounds(draw::RECT& out, const draw::RECT& rect)
+{
+	out.fLeft	= (std::min)(out.fLeft,	  rect.fLeft);
+	out.fTop	= (std::min)(out.fTop,	  rect.fTop);
+	out.fRight	= (std::max)(out.fRight,  rect.fRight);
+	out.fBottom	= (std::max)(out.fBottom, rect.fBottom);
+}
+
+//! 種類付きの範囲に矩形を足し込む
+inline void merge_bounds(bounds_kind& eKind, draw::RECT& out, const draw::RECT& rect)
+{
+	if(eKind==BOUNDS_EMPTY)
+	{
+		eKind	= BOUNDS_RECT;
+		out		= rect;
+	}
+	else if(eKind==BOUNDS_RECT)
+	{
+		union_bounds(out, rect);
+	}
+}
+//! @}
+
 //! @brief 線形補間関数
 /*! @param[in] fStart 開始値
  *  @param[in] fEnd   終了値
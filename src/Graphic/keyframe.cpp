@@ -73,17 +73,17 @@ void tweenframe::init_self()
 
 void tweenframe::exec_self(draw_context& ctx)
 {
-	const float fEasingStep = easing_sin_step(easing_param(), static_cast<float>(cur_step())/static_cast<float>(step()));
-
-	set_x(lerp(draw_info_start().pos_.fX, draw_info_end().pos_.fX, fEasingStep));
-	set_y(lerp(draw_info_start().pos_.fY, draw_info_end().pos_.fY, fEasingStep));
-
-	set_angle(lerp(draw_info_start().angle_, draw_info_end().angle_, fEasingStep));
-
-	set_width(lerp(draw_info_start().scale_.fWidth, draw_info_end().scale_.fWidth, fEasingStep));
-	set_height(lerp(draw_info_start().scale_.fHeight, draw_info_end().scale_.fHeight, fEasingStep));
-
-	set_alpha(static_cast<uint8_t>(lerp(draw_info_start().alpha(), draw_info_end().alpha(), fEasingStep)));
+	float fEasingStep;
+	if(pCurve_ && pCurve_->step()==step())
+	{// ベイク済みなら表を引くだけ
+		fEasingStep = pCurve_->sample(cur_step());
+	}
+	else
+	{
+		fEasingStep = clamp(easing_sin_step(easing_param(), static_cast<float>(cur_step())/static_cast<float>(step())), 0.0f, 1.0f);
+	}
+
+	tween_curve::lerp_draw_info(draw_info_start(), draw_info_end(), fEasingStep, drawInfo_);
 
 	draw_base::exec_self(ctx);
 
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "draw_base.h"
+#include "tween_curve.h"
 
 namespace mana{
 namespace graphic{
@@ -48,7 +49,13 @@ public:
 	tweenframe&				set_draw_info_end(const draw::draw_info& info){ easingDrawInfo_[1]=info; return *this; }
 
 	float					easing_param()const{ return fEasing_; }
-	tweenframe&				set_easing_param(float fEasing){ fEasing_ = clamp(fEasing, -1.0f, 1.0); return *this; }
+	//! ベイク済みカーブは使わなくなる
+	tweenframe&				set_easing_param(float fEasing){ fEasing_ = clamp(fEasing, -1.0f, 1.0); pCurve_.reset(); return *this; }
+
+	//! @brief ベイク済みカーブを設定する
+	/*! カーブのステップ数がstepと同じ時だけ使う。使わない時はeasing_paramでその場で計算する */
+	const shared_ptr<const tween_curve>&	curve()const{ return pCurve_; }
+	tweenframe&								set_curve(const shared_ptr<const tween_curve>& pCurve){ pCurve_=pCurve; return *this; }
 
 	uint32_t				cur_step()const{ return nCurStep_; }
 	uint32_t				step()const{ return next_frame(); }
@@ -61,6 +68,8 @@ protected:
 	draw::draw_info easingDrawInfo_[2];
 	float			fEasing_;
 
+	shared_ptr<const tween_curve> pCurve_;
+
 	uint32_t		nCurStep_;
 };
 
@@ -18,6 +18,19 @@ label& label::set_text(const string& sText, bool bMarkUp)
 	return *this;
 }
 
+size_t label::state_hash()const
+{
+	size_t nHash = draw_base::state_hash();
+	boost::hash_combine(nHash, pTextData_.get());
+	if(pTextData_)
+	{
+		boost::hash_combine(nHash, pTextData_->text());
+		boost::hash_combine(nHash, pTextData_->font_id().get());
+		boost::hash_combine(nHash, pTextData_->is_markup());
+	}
+	return nHash;
+}
+
 label& label::set_font_id(const string_fw& sFont)
 {
 	if(text_data())
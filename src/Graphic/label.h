@@ -28,6 +28,11 @@ public:
 	label&								set_text(const string& sText, bool bMarkUp);
 	label&								set_font_id(const string_fw& sFont);
 
+	//! 文字の配置はレンダラーで決まるので、範囲は分からない
+	virtual bounds_kind					local_bounds(draw::RECT& rect)const override{ return BOUNDS_INFINITE; }
+	//! テキストの中身も混ぜる
+	virtual size_t						state_hash()const override;
+
 protected:
 	virtual void	exec_self(draw_context& ctx)override;
 
@@ -16,6 +16,13 @@ message::message(bool bCreate, uint32_t nReserve):label(bCreate, nReserve),nCurC
 	eKind_ = DRAW_MESSAGE;
 }
 
+size_t message::state_hash()const
+{
+	size_t nHash = label::state_hash();
+	boost::hash_combine(nHash, nCurCharNum_);
+	return nHash;
+}
+
 void message::init_self()
 {
 	set_cur_char_num(0);
@@ -22,6 +22,9 @@ public:
 	message(bool bCreate=true, uint32_t nReserve=CHILD_RESERVE);
 	virtual ~message(){}
 
+	//! 表示している文字数も混ぜる
+	virtual size_t state_hash()const override;
+
 protected:
 	virtual void init_self()override;
 	virtual void exec_self(draw_context& ctx)override;
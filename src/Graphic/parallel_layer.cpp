@@ -0,0 +1,239 @@
+﻿#include "../mana_common.h"
+
+#include "../Concurrent/worker.h"
+#include "../Draw/renderer_2d.h"
+
+#include "parallel_layer.h"
+
+namespace mana{
+namespace graphic{
+
+namespace{
+thread_local bool gtl_bParallelTask = false; //!< parallel_layerの範囲を動かしている最中か
+
+//! コマンドのZをずらすvisitor
+struct shift_z_visitor : public boost::static_visitor<>
+{
+	shift_z_visitor(float fDelta):fDelta_(fDelta){}
+
+	static float shift(float fZ, float fDelta){ fZ += fDelta; return fZ<0 ? 0 : fZ; }
+
+	void operator()(draw::cmd::sprite_draw_cmd& cmd)const{ cmd.fZ_ = shift(cmd.fZ_, fDelta_); }
+	void operator()(draw::cmd::text_draw_cmd& cmd)const{ cmd.pos_.fZ = shift(cmd.pos_.fZ, fDelta_); }
+	void operator()(draw::cmd::polygon_draw_cmd& cmd)const
+	{
+		for(uint32_t i=0; i<cmd.nVertexNum_; ++i)
+			cmd.vertex_[i].fZ = shift(cmd.vertex_[i].fZ, fDelta_);
+	}
+
+	template<class T>
+	void operator()(T&)const{}
+
+	float fDelta_;
+};
+} // namespace end
+
+parallel_layer::parallel_layer(uint32_t nTaskNum, uint32_t nReserve):draw_base(nReserve),fPrevBaseZ_(0.f),nPrevChildNum_(UINT_MAX)
+{
+	eKind_ = DRAW_PARALLEL_LAYER;
+	set_task_num(nTaskNum);
+
+#ifdef MANA_PARALLEL_LAYER_COUNT
+	nParallelCount_=0;
+	nSerialCount_=0;
+	nZShiftCount_=0;
+#endif
+}
+
+parallel_layer& parallel_layer::set_task_num(uint32_t nTaskNum)
+{
+	if(nTaskNum<1) nTaskNum=1;
+
+	vecTask_.clear();
+	for(uint32_t i=0; i<nTaskNum; ++i)
+		vecTask_.push_back(new_ task());
+
+	nPrevChildNum_ = UINT_MAX;
+	return *this;
+}
+
+void parallel_layer::exec(draw_context& ctx)
+{
+	exec_self(ctx);
+
+	const shared_ptr<concurrent::worker>& pWorker = ctx.worker();
+
+	// childrenで保留中の子の追加を済ませておく。タスクからは並びを読むだけにする
+	const uint32_t nChildNum = children().size();
+	const uint32_t nTaskNum	 = (std::min)(task_num(), nChildNum);
+
+	if(gtl_bParallelTask || !pWorker || pWorker->is_fin() || !ctx.renderer() || nTaskNum<2)
+	{
+		exec_children(ctx);
+		nPrevChildNum_ = UINT_MAX;
+
+	#ifdef MANA_PARALLEL_LAYER_COUNT
+		++nSerialCount_;
+	#endif
+		return;
+	}
+
+	// 子に渡すコンテキスト。exec_childrenと同じく、自分の表示・ポーズ状態を反映させる
+	draw_context baseCtx = ctx;
+	baseCtx.visible(is_visible_children_ctx(ctx));
+	baseCtx.pause(is_pause_ctx(ctx));
+
+#ifdef MANA_DRAW_CULL_COUNT
+	baseCtx.reset_cull_count();
+#endif
+
+	const float fBaseZ	 = ctx.total_z();
+	const bool	bPredict = nPrevChildNum_==nChildNum && fPrevBaseZ_==fBaseZ;
+
+	for(uint32_t i=0; i<nTaskNum; ++i)
+	{
+		task& t = vecTask_[i];
+		t.nBegin_	= i*nChildNum/nTaskNum;
+		t.nEnd_		= (i+1)*nChildNum/nTaskNum;
+		t.fStartZ_	= (i>0 && bPredict) ? vecTask_[i-1].fResultZ_ : fBaseZ;
+
+		t.ctx_ = baseCtx;
+		t.ctx_.set_total_z(t.fStartZ_);
+		t.capture_.clear();
+		t.claim_.clear();
+		t.bDone_.store(false, std::memory_order_release);
+	}
+
+	// 先頭以外をワーカーに投げて、先頭は自分で動かす
+	vecFuture_.clear();
+	for(uint32_t i=1; i<nTaskNum; ++i)
+	{
+		task* pTask = &vecTask_[i];
+		vecFuture_.emplace_back(pWorker->request([this, pTask](){ exec_task(*pTask); }));
+	}
+
+	for(uint32_t i=0; i<nTaskNum; ++i)
+	{// まだ動いていない範囲は自分で動かす
+		exec_task(vecTask_[i]);
+	}
+
+	// 範囲の順番にコマンドを積む
+	const shared_ptr<draw::renderer_2d>& pRenderer = ctx.renderer();
+
+	float fZ = fBaseZ;
+	for(uint32_t i=0; i<nTaskNum; ++i)
+	{
+		task& t = vecTask_[i];
+		while(!t.bDone_.load(std::memory_order_acquire))
+			std::this_thread::yield();
+
+		float fDelta = fZ - t.fStartZ_;
+		if(fDelta!=0.f)
+		{
+			shift_z(t.capture_, fDelta);
+
+		#ifdef MANA_PARALLEL_LAYER_COUNT
+			++nZShiftCount_;
+		#endif
+		}
+
+		pRenderer->request(t.capture_);
+
+		fZ = shift_z_visitor::shift(t.fEndZ_, fDelta);
+		t.fResultZ_ = fZ;
+
+	#ifdef MANA_DRAW_CULL_COUNT
+		ctx.add_cull_count(t.ctx_);
+	#endif
+	}
+
+	ctx.set_total_z(fZ);
+
+	// 子は全て動き終わっているので、exec_childrenと同じく範囲をまとめる
+	calc_tree_bounds(ctx);
+
+	// 自分で動かした範囲のリクエストも、ワーカーで空振りし終わるまで待つ。
+	// 残したまま次のフレームに行くと、範囲を設定している途中で動き出してしまう
+	for(auto& w : vecFuture_)
+	{
+		for(auto p=w.lock(); p && !p->is_fin(); p=w.lock())
+			std::this_thread::yield();
+	}
+	vecFuture_.clear();
+
+	fPrevBaseZ_		= fBaseZ;
+	nPrevChildNum_	= nChildNum;
+
+#ifdef MANA_PARALLEL_LAYER_COUNT
+	++nParallelCount_;
+#endif
+}
+
+void parallel_layer::exec_task(task& t)
+{
+	if(t.claim_.test_and_set(std::memory_order_acq_rel)) return;
+
+	bool bPrev = gtl_bParallelTask;
+	gtl_bParallelTask = true;
+
+	const shared_ptr<draw::renderer_2d>& pRenderer = t.ctx_.renderer();
+	draw::cmd::cmd_capture* pPrev = pRenderer->begin_capture(&t.capture_);
+
+	for(uint32_t i=t.nBegin_; i<t.nEnd_; ++i)
+		children()[i]->exec(t.ctx_);
+
+	pRenderer->end_capture(pPrev);
+
+	t.fEndZ_ = t.ctx_.total_z();
+
+	gtl_bParallelTask = bPrev;
+	t.bDone_.store(true, std::memory_order_release);
+}
+
+void parallel_layer::shift_z(draw::cmd::cmd_capture& capture, float fDelta)
+{
+	using namespace draw::cmd;
+
+	concurrent::cmd_stream::reader r(capture.stream_);
+	while(r.next())
+	{
+		switch(r.type())
+		{
+		case STREAM_SPRITE:
+		{
+			sprite_draw_cmd& cmd = r.get<sprite_draw_cmd>();
+			cmd.fZ_ = shift_z_visitor::shift(cmd.fZ_, fDelta);
+		}
+		break;
+
+		case STREAM_SPRITE_INSTANCE:
+		{
+			sprite_instance_cmd& cmd = r.get<sprite_instance_cmd>();
+			cmd.fZ_ = shift_z_visitor::shift(cmd.fZ_, fDelta);
+		}
+		break;
+
+		case STREAM_TEXT:
+		{
+			text_stream_cmd& cmd = r.get<text_stream_cmd>();
+			cmd.pos_.fZ = shift_z_visitor::shift(cmd.pos_.fZ, fDelta);
+		}
+		break;
+
+		case STREAM_POLYGON:
+		{
+			polygon_draw_cmd& cmd = r.get<polygon_draw_cmd>();
+			for(uint32_t i=0; i<cmd.nVertexNum_; ++i)
+				cmd.vertex_[i].fZ = shift_z_visitor::shift(cmd.vertex_[i].fZ, fDelta);
+		}
+		break;
+		}
+	}
+
+	shift_z_visitor v(fDelta);
+	for(auto& cmd : capture.vecCmd_)
+		boost::apply_visitor(v, cmd);
+}
+
+} // namespace graphic end
+} // namespace mana end
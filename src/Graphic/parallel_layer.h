@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include "../Draw/renderer_2d_cmd.h"
+
+#include "draw_context.h"
+#include "draw_base.h"
+
+#ifdef MANA_DEBUG
+#define MANA_PARALLEL_LAYER_COUNT
+#endif
+
+namespace mana{
+namespace concurrent{
+class future;
+} // namespace concurrent end
+
+namespace graphic{
+
+/*! @brief 子をワーカースレッドで並列に動かすノード
+ *
+ *  子を優先度順にnTaskNum個の連続した範囲に分け、それぞれを別スレッドでexecする。
+ *  タイムラインやトゥイーンの計算、ワールド行列の計算がスレッドに分散される。
+ *  ワーカーはdraw_context::set_workerで設定する
+ *
+ *  各範囲が積んだ描画コマンドはいったん範囲ごとに記録し、
+ *  全部終わったら範囲の順番にレンダラーに積む。
+ *  Zは子を動かす前に前フレームの結果から予測しておき、外れた時は記録したコマンドのZをずらす。
+ *  なので、積まれるコマンドの順番とZの大小関係は逐次で動かした時と同じになる。
+ *  子の数が変わらなければ、Zの値も数フレームで逐次と完全に一致する
+ *
+ *  以下の時は逐次で動かす
+ *  　ワーカーかレンダラーが無い
+ *  　子が2つ未満
+ *  　parallel_layerの子孫として動いている(入れ子の並列化はしない)
+ *
+ *  子孫のexecは別スレッドで呼ばれるので、スレッドセーフでない共有状態に触るノード
+ *  (audio_frameや、イベントハンドラでゲーム側の状態を書き換えるノードなど)は下に置かないこと。
+ *  renderer_2dへのrequestと、ノード自身の状態の更新は問題ない
+ *
+ *  並列・逐次で動かした回数、Zの予測が外れた回数をカウントする時は、
+ *  MANA_PARALLEL_LAYER_COUNTをdefineする
+ */
+class parallel_layer : public draw_base
+{
+public:
+	parallel_layer(uint32_t nTaskNum=4, uint32_t nReserve=CHILD_RESERVE);
+	virtual ~parallel_layer(){}
+
+	virtual void	exec(draw_context& ctx)override;
+
+public:
+	//! 子を分ける数。Zの予測はやり直しになる
+	parallel_layer&	set_task_num(uint32_t nTaskNum);
+	uint32_t		task_num()const{ return vecTask_.size(); }
+
+private:
+	//! 1スレッドで動かす子の範囲
+	struct task
+	{
+		task():nBegin_(0),nEnd_(0),fStartZ_(0.f),fEndZ_(0.f),fResultZ_(0.f){ capture_.bDefer_=true; bDone_.store(false); claim_.clear(); }
+
+		draw_context			ctx_;
+		draw::cmd::cmd_capture	capture_;	//!< この範囲が積んだコマンド
+
+		uint32_t				nBegin_;
+		uint32_t				nEnd_;
+
+		float					fStartZ_;	//!< 予測した開始Z
+		float					fEndZ_;		//!< 動かし終わった時のZ
+		float					fResultZ_;	//!< Zをずらした後の終了Z。次のフレームで、次の範囲の開始Zの予測に使う
+
+		std::atomic_flag		claim_;		//!< 動かし始めたスレッドが立てる
+		std::atomic_bool		bDone_;
+
+	private:
+		NON_COPIABLE(task);
+	};
+
+	//! 範囲の子を動かす。claimできなければ何もしない
+	void			exec_task(task& t);
+
+	//! 記録したコマンドのZをfDeltaずらす
+	static void		shift_z(draw::cmd::cmd_capture& capture, float fDelta);
+
+private:
+	ptr_vector<task>	vecTask_;
+	vector<weak_ptr<concurrent::future>> vecFuture_; //!< ワーカーに投げたリクエスト
+
+	//! @defgroup parallel_layer_predict 前のフレームの状態。Zの予測に使う
+	//! @{
+	float				fPrevBaseZ_;
+	uint32_t			nPrevChildNum_; //!< UINT_MAXだと予測しない
+	//! @}
+
+#ifdef MANA_PARALLEL_LAYER_COUNT
+public:
+	uint32_t	parallel_count()const{ return nParallelCount_; }
+	uint32_t	serial_count()const{ return nSerialCount_; }
+	uint32_t	z_shift_count()const{ return nZShiftCount_; }
+
+private:
+	uint32_t	nParallelCount_;	//!< 並列で動かした回数
+	uint32_t	nSerialCount_;		//!< 逐次で動かした回数
+	uint32_t	nZShiftCount_;		//!< Zの予測が外れて、コマンドのZをずらした範囲の数
+#endif
+};
+
+} // namespace graphic end
+} // namespace mana end
+
+/* 使用例
+
+	shared_ptr<concurrent::worker> pWorker = make_shared<concurrent::worker>(64);
+	uint32_t anAffinity[] = { 1, 2, 3 };
+	pWorker->kick(3, anAffinity);
+	ctx.set_worker(pWorker);
+
+	parallel_layer* pLayer = new_ parallel_layer(4);
+	for(uint32_t i=0; i<enemyNum; ++i)
+		pLayer->add_child(vecEnemy[i], i);
+	root.add_child(pLayer, 10);
+*/
@@ -2,6 +2,7 @@
 
 #include "../Draw/renderer_2d.h"
 
+#include "graphic_fun.h"
 #include "draw_context.h"
 #include "polygon.h"
 
@@ -24,6 +25,8 @@ void polygon::exec_self(draw_context& ctx)
 			worldMat_ = m * worldMat_;
 		}
 
+		if(is_cull_ctx(ctx)) return;
+
 		//　グローバル化
 		cmd.nVertexNum_ = ePoly_;
 		for(uint32_t i=0; i<cmd.nVertexNum_; ++i)
@@ -48,5 +51,30 @@ void polygon::exec_self(draw_context& ctx)
 	}
 }
 
+bounds_kind polygon::local_bounds(draw::RECT& rect)const
+{
+	rect = draw::RECT(vertex_[0].fX, vertex_[0].fY, vertex_[0].fX, vertex_[0].fY);
+	for(uint32_t i=1; i<static_cast<uint32_t>(ePoly_); ++i)
+		union_bounds(rect, draw::RECT(vertex_[i].fX, vertex_[i].fY, vertex_[i].fX, vertex_[i].fY));
+
+	rect.fLeft	-= pivot_x(); rect.fRight  -= pivot_x();
+	rect.fTop	-= pivot_y(); rect.fBottom -= pivot_y();
+	return BOUNDS_RECT;
+}
+
+size_t polygon::state_hash()const
+{
+	size_t nHash = draw_base::state_hash();
+	boost::hash_combine(nHash, static_cast<uint32_t>(ePoly_));
+	for(auto& v : vertex_)
+	{
+		boost::hash_combine(nHash, v.fX);
+		boost::hash_combine(nHash, v.fY);
+		boost::hash_combine(nHash, v.fZ);
+	}
+	boost::hash_combine(nHash, bBlend_);
+	return nHash;
+}
+
 } // namespace graphic end
 } // namespace mana end
@@ -30,6 +30,9 @@ public:
 	bool					is_blend()const{ return bBlend_; }
 	polygon&				blend(bool bBlend){ bBlend_=bBlend; return *this; }
 
+	virtual bounds_kind		local_bounds(draw::RECT& rect)const override;
+	virtual size_t			state_hash()const override;
+
 protected:
 	virtual void exec_self(draw_context& ctx)override;
 
@@ -0,0 +1,261 @@
+﻿#include "../mana_common.h"
+
+#include "../Draw/renderer_2d.h"
+
+#include "graphic_fun.h"
+#include "draw_context.h"
+#include "sprite.h"
+#include "skeleton_def.h"
+#include "skeleton.h"
+
+namespace mana{
+namespace graphic{
+
+skeleton::skeleton(uint32_t nReserve):draw_base(nReserve),bBlend_(false),fBlend_(0.f),fFadeStep_(0.f),bBlendSprite_(false)
+{
+	eKind_ = DRAW_SKELETON;
+	anLayerAnim_[0]=anLayerAnim_[1]=0;
+	anLayerFrame_[0]=anLayerFrame_[1]=0;
+}
+
+skeleton& skeleton::set_def(const shared_ptr<const skeleton_def>& pDef)
+{
+	pDef_ = pDef;
+
+	if(pDef_ && !pDef_->is_baked())
+		logger::warnln("[skeleton]焼いていない定義が設定されました。");
+
+	init_self();
+	return *this;
+}
+
+void skeleton::init_self()
+{
+	anLayerAnim_[0]=anLayerAnim_[1]=0;
+	anLayerFrame_[0]=anLayerFrame_[1]=0;
+	bBlend_		= false;
+	fBlend_		= 0.f;
+	fFadeStep_	= 0.f;
+}
+
+bool skeleton::play(uint32_t nAnim, uint32_t nFadeFrame)
+{
+	if(!pDef_ || nAnim>=pDef_->anim_num()) return false;
+
+	if(nFadeFrame>0)
+	{// 今のアニメをレイヤー1に移して、重みを減らしていく
+		anLayerAnim_[1]	 = anLayerAnim_[0];
+		anLayerFrame_[1] = anLayerFrame_[0];
+		bBlend_		= true;
+		fBlend_		= 1.f;
+		fFadeStep_	= 1.f/static_cast<float>(nFadeFrame);
+	}
+	else
+	{
+		bBlend_		= false;
+		fBlend_		= 0.f;
+		fFadeStep_	= 0.f;
+	}
+
+	anLayerAnim_[0]	 = nAnim;
+	anLayerFrame_[0] = 0;
+	return true;
+}
+
+bool skeleton::play(const string_fw& sName, uint32_t nFadeFrame)
+{
+	if(!pDef_) return false;
+
+	optional<uint32_t> nAnim = pDef_->anim_index(sName);
+	if(!nAnim)
+	{
+		logger::warnln("[skeleton]アニメーションがありません。: " + sName.get());
+		return false;
+	}
+
+	return play(*nAnim, nFadeFrame);
+}
+
+bool skeleton::blend(uint32_t nAnimA, uint32_t nAnimB, float fWeight)
+{
+	if(!pDef_ || nAnimA>=pDef_->anim_num() || nAnimB>=pDef_->anim_num()) return false;
+
+	if(anLayerAnim_[0]!=nAnimA){ anLayerAnim_[0]=nAnimA; anLayerFrame_[0]=0; }
+	if(!bBlend_ || anLayerAnim_[1]!=nAnimB){ anLayerAnim_[1]=nAnimB; anLayerFrame_[1]=0; }
+
+	bBlend_		= true;
+	fFadeStep_	= 0.f;
+	set_blend_weight(fWeight);
+	return true;
+}
+
+bool skeleton::is_end()const
+{
+	if(!pDef_ || anLayerAnim_[0]>=pDef_->anim_num()) return true;
+
+	const skeleton_def::anim& a = pDef_->get_anim(anLayerAnim_[0]);
+	return !a.bLoop_ && anLayerFrame_[0]+1>=a.nFrameNum_;
+}
+
+void skeleton::exec_self(draw_context& ctx)
+{
+	draw_base::exec_self(ctx);
+
+	if(!pDef_ || !pDef_->is_baked() || pDef_->anim_num()==0) return;
+
+	const bool bRequest = is_visible_ctx(ctx) && ctx.renderer();
+
+	if(bRequest || ctx.is_cull())
+	{// パーツの範囲をまとめて、自分の描画範囲にする。非表示でも親のカリングのために求める
+		eBounds_ = BOUNDS_EMPTY;
+
+		if(bBlend_ && fBlend_>0.f)	request_blend(ctx, bRequest);
+		else						request_baked(ctx, bRequest);
+	}
+	else
+	{// 描画しなくてもZはパーツの分進める
+		for(uint32_t i=0; i<pDef_->part_num(); ++i)
+			ctx.add_total_z(-0.1f);
+	}
+
+	if(!is_pause_ctx(ctx)) advance();
+}
+
+void skeleton::advance()
+{
+	const uint32_t nLayerNum = bBlend_ ? 2 : 1;
+	for(uint32_t i=0; i<nLayerNum; ++i)
+	{
+		const skeleton_def::anim& a = pDef_->get_anim(anLayerAnim_[i]);
+		if(anLayerFrame_[i]+1<a.nFrameNum_)	++anLayerFrame_[i];
+		else if(a.bLoop_)					anLayerFrame_[i]=0;
+	}
+
+	if(bBlend_ && fFadeStep_>0.f)
+	{// 切り替え中
+		fBlend_ -= fFadeStep_;
+		if(fBlend_<=0.f)
+		{
+			bBlend_		= false;
+			fBlend_		= 0.f;
+			fFadeStep_	= 0.f;
+		}
+	}
+}
+
+void skeleton::request_baked(draw_context& ctx, bool bRequest)
+{
+	const skeleton_def::anim& a = pDef_->get_anim(anLayerAnim_[0]);
+	const uint32_t nPartNum = pDef_->part_num();
+	const uint32_t nBase	= anLayerFrame_[0]*nPartNum;
+
+	for(uint32_t p=0; p<nPartNum; ++p)
+	{
+		const uint32_t n = nBase+p;
+		const float afPose[6] = { a.vecPartPose_[0][n], a.vecPartPose_[1][n], a.vecPartPose_[2][n],
+								  a.vecPartPose_[3][n], a.vecPartPose_[4][n], a.vecPartPose_[5][n] };
+		request_part(ctx, p, afPose, a.vecPartAlpha_[n], bRequest);
+	}
+}
+
+void skeleton::request_blend(draw_context& ctx, bool bRequest)
+{
+	const uint32_t nBoneNum = pDef_->bone_num();
+	vecBoneAffine_.resize(nBoneNum*6);
+	vecBoneAlpha_.resize(nBoneNum);
+
+	const float fW = fBlend_;
+
+	for(uint32_t b=0; b<nBoneNum; ++b)
+	{
+		// チャンネルごとに2つのアニメを混ぜる
+		float afCh[skeleton_def::CH_NUM];
+		for(uint32_t ch=0; ch<skeleton_def::CH_NUM; ++ch)
+		{
+			const skeleton_def::channel eCh = static_cast<skeleton_def::channel>(ch);
+			const float f0 = pDef_->sample(anLayerAnim_[0], b, anLayerFrame_[0], eCh);
+			const float f1 = pDef_->sample(anLayerAnim_[1], b, anLayerFrame_[1], eCh);
+			afCh[ch] = f0 + (f1-f0)*fW;
+		}
+
+		float afLocal[6];
+		affine_local(afCh[skeleton_def::CH_X], afCh[skeleton_def::CH_Y], afCh[skeleton_def::CH_ANGLE],
+					 afCh[skeleton_def::CH_WIDTH], afCh[skeleton_def::CH_HEIGHT], afLocal);
+
+		const uint32_t nParent = pDef_->get_bone(b).nParent_;
+		if(nParent==skeleton_def::NO_PARENT)
+		{
+			std::copy(afLocal, afLocal+6, &vecBoneAffine_[b*6]);
+			vecBoneAlpha_[b] = afCh[skeleton_def::CH_ALPHA];
+		}
+		else
+		{
+			affine_mul(afLocal, &vecBoneAffine_[nParent*6], &vecBoneAffine_[b*6]);
+			vecBoneAlpha_[b] = afCh[skeleton_def::CH_ALPHA]*vecBoneAlpha_[nParent];
+		}
+	}
+
+	for(uint32_t p=0; p<pDef_->part_num(); ++p)
+	{
+		const skeleton_def::part& pt = pDef_->get_part(p);
+
+		float afPose[6];
+		affine_mul(pt.afOffset_, &vecBoneAffine_[pt.nBone_*6], afPose);
+		request_part(ctx, p, afPose, vecBoneAlpha_[pt.nBone_], bRequest);
+	}
+}
+
+void skeleton::request_part(draw_context& ctx, uint32_t nPart, const float afPose[6], float fAlpha, bool bRequest)
+{
+	ctx.add_total_z(-0.1f);
+
+	const skeleton_def::part& pt = pDef_->get_part(nPart);
+
+	// ノードのワールド行列を掛ける
+	const D3DXMATRIX& m = world_matrix();
+	const float afWorld[6] = { m._11, m._12, m._21, m._22, m._41, m._42 };
+
+	float afOut[6];
+	affine_mul(afPose, afWorld, afOut);
+
+	if(ctx.is_cull())
+	{
+		if(pt.rect_.width()==0.f && pt.rect_.height()==0.f)
+		{// テクスチャサイズで描画されるので、範囲が分からない
+			eBounds_ = BOUNDS_INFINITE;
+		}
+		else
+		{
+			draw::RECT bounds;
+			affine_bounds(afOut, draw::RECT(0.f, 0.f, pt.rect_.width(), pt.rect_.height()), bounds);
+			merge_bounds(eBounds_, bounds_, bounds);
+
+			if(ctx.is_cull_out(bounds))
+			{
+			#ifdef MANA_DRAW_CULL_COUNT
+				if(bRequest) ctx.add_cull_cmd_count();
+			#endif
+				return;
+			}
+		}
+	}
+
+	if(!bRequest) return;
+
+	const uint8_t nAlpha = static_cast<uint8_t>(clamp(fAlpha*static_cast<float>(world_alpha()), 0.0f, 255.0f));
+
+	draw::cmd::sprite_instance_cmd cmd;
+	cmd.set_affine(afOut[0], afOut[1], afOut[2], afOut[3], afOut[4], afOut[5]);
+	cmd.nTexID_			= pt.nTexID_;
+	cmd.rect_			= pt.rect_;
+	cmd.fZ_				= ctx.total_z();
+	cmd.nColor0_		= D3DCOLOR_ARGB(nAlpha,255,255,255);
+	cmd.nColor1_		= color();
+	cmd.mode_			= sprite::select_mode(pt.nTexID_, nAlpha<255 || is_blend_sprite(), eColorMode_);
+	cmd.nRenderTarget_	= ctx.render_target();
+
+	ctx.renderer()->request(cmd);
+}
+
+} // namespace graphic end
+} // namespace mana end
@@ -0,0 +1,109 @@
+﻿#pragma once
+
+#include "draw_base.h"
+
+namespace mana{
+namespace graphic{
+
+class skeleton_def;
+
+/*! @brief スケルタルアニメーションを再生するノード
+ *
+ *  skeleton_defのボーンを動かして、ボーンに貼り付けたパーツをスプライトとして描画する。
+ *  パーツごとにノードを作るmovieclipと違い、ノード1つでキャラクター1体になる
+ *
+ *  ブレンドしていない時は、定義に焼いてあるパーツの変換にノードのワールド行列を掛けるだけで済む。
+ *  同じ定義のノードは定義を共有するので、大量に並べても表は増えない。
+ *  たくさん並べる時はparallel_layerの下に置けば、スレッドに分けて動かせる
+ *
+ *  2つのアニメーションのブレンドは、以下の2通り
+ *  　play(アニメ, フレーム数)	前のアニメから、指定フレームかけて切り替える
+ *  　blend(アニメA, アニメB, 重み)	重みを指定して混ぜ続ける。歩き/走りを速度で混ぜるなど
+ *  ブレンド中はボーンごとにトラックを混ぜて、階層をたどり直す
+ */
+class skeleton : public draw_base
+{
+public:
+	skeleton(uint32_t nReserve=CHILD_RESERVE);
+	virtual ~skeleton(){}
+
+public:
+	const shared_ptr<const skeleton_def>&	def()const{ return pDef_; }
+	//! 定義を設定する。再生状態は最初のアニメーションの先頭に戻る
+	skeleton&								set_def(const shared_ptr<const skeleton_def>& pDef);
+
+	//! @defgroup skeleton_play 再生
+	//! @{
+	//! @brief アニメーションを先頭から再生する
+	/*! @param[in] nFadeFrame 0より大きいと、今のアニメーションからこのフレーム数かけて切り替える */
+	bool		play(uint32_t nAnim, uint32_t nFadeFrame=0);
+	bool		play(const string_fw& sName, uint32_t nFadeFrame=0);
+
+	//! @brief 2つのアニメーションを混ぜて再生し続ける
+	/*! @param[in] fWeight nAnimBの重み。0.0～1.0。フレームは今のまま */
+	bool		blend(uint32_t nAnimA, uint32_t nAnimB, float fWeight);
+	//! blendの重みだけ変える
+	skeleton&	set_blend_weight(float fWeight){ fBlend_=clamp(fWeight, 0.0f, 1.0f); return *this; }
+
+	uint32_t	cur_anim()const{ return anLayerAnim_[0]; }
+	uint32_t	cur_frame()const{ return anLayerFrame_[0]; }
+	//! ループしないアニメーションが最後のフレームまで来た
+	bool		is_end()const;
+	bool		is_blend()const{ return bBlend_; }
+
+	bool		is_blend_sprite()const{ return bBlendSprite_; }
+	skeleton&	blend_sprite(bool bBlend){ bBlendSprite_=bBlend; return *this; }
+	//! @}
+
+protected:
+	virtual void init_self()override;
+	virtual void exec_self(draw_context& ctx)override;
+
+private:
+	//! @defgroup skeleton_request パーツを積む。bRequestがfalseの時は、カリング用の範囲だけ求める
+	//! @{
+	//! ブレンドしない時の、焼いてあるパーツの変換を積む
+	void		request_baked(draw_context& ctx, bool bRequest);
+	//! ボーンを混ぜてから積む
+	void		request_blend(draw_context& ctx, bool bRequest);
+	//! パーツ1つを積む
+	void		request_part(draw_context& ctx, uint32_t nPart, const float afPose[6], float fAlpha, bool bRequest);
+	//! @}
+
+	//! フレームを進める
+	void		advance();
+
+private:
+	shared_ptr<const skeleton_def> pDef_;
+
+	//! @defgroup skeleton_layer 再生レイヤー。0が今のアニメ、1が混ぜる相手
+	//! @{
+	uint32_t	anLayerAnim_[2];
+	uint32_t	anLayerFrame_[2];
+	//! @}
+
+	bool		bBlend_;		//!< trueだとレイヤー1を混ぜる
+	float		fBlend_;		//!< レイヤー1の重み
+	float		fFadeStep_;		//!< 切り替え中に1フレームで減らす重み。0だとblendで指定した重みのまま
+	bool		bBlendSprite_;	//!< trueだと強制的にblend描画になる
+
+	//! request_blend用の作業領域。ボーンごとの変換とアルファ
+	vector<float> vecBoneAffine_;
+	vector<float> vecBoneAlpha_;
+};
+
+} // namespace graphic end
+} // namespace mana end
+
+/* 使用例
+
+	// 定義ファイルで<skeleton id="CHARA">を定義しておく
+	skeleton* pChara = builder.create_draw_base_cast<skeleton>("CHARA");
+	pChara->play("walk");
+
+	// 走りに10フレームかけて切り替える
+	pChara->play("run", 10);
+
+	// 歩きと走りを速度で混ぜる
+	pChara->blend(nWalk, nRun, fSpeed/fMaxSpeed);
+*/
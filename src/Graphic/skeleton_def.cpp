@@ -0,0 +1,209 @@
+﻿#include "../mana_common.h"
+
+#include "graphic_fun.h"
+#include "tween_curve.h"
+#include "skeleton_def.h"
+
+namespace mana{
+namespace graphic{
+
+uint32_t skeleton_def::add_bone(const string_fw& sName, uint32_t nParent, const draw::draw_info& bind)
+{
+	if(nParent!=NO_PARENT && nParent>=bone_num())
+	{
+		logger::warnln("[skeleton_def]親ボーンが追加されていません。: " + sName.get());
+		return UINT_MAX;
+	}
+
+	bone b;
+	b.sName_	= sName;
+	b.nParent_	= nParent;
+	b.bind_		= bind;
+	vecBone_.emplace_back(b);
+
+	for(auto& vecAnimKey : vecKey_) vecAnimKey.resize(bone_num());
+
+	bBaked_ = false;
+	return bone_num()-1;
+}
+
+uint32_t skeleton_def::add_part(uint32_t nBone, uint32_t nTexID, const draw::RECT& rect, const draw::draw_info& info, const draw::POS& pivot)
+{
+	if(nBone>=bone_num())
+	{
+		logger::warnln("[skeleton_def]パーツのボーンが不正です。: " + to_str(nBone));
+		return UINT_MAX;
+	}
+
+	part p;
+	p.nBone_	= nBone;
+	p.nTexID_	= nTexID;
+	p.rect_		= rect;
+
+	// pivot分ずらしてから、パーツの変換を掛ける
+	float afLocal[6], afPivot[6];
+	affine_local(info.pos_.fX, info.pos_.fY, info.angle_, info.scale_.fWidth, info.scale_.fHeight, afLocal);
+	affine_local(-pivot.fX, -pivot.fY, 0.f, 1.f, 1.f, afPivot);
+	affine_mul(afPivot, afLocal, p.afOffset_);
+
+	vecPart_.emplace_back(p);
+
+	bBaked_ = false;
+	return part_num()-1;
+}
+
+uint32_t skeleton_def::add_anim(const string_fw& sName, uint32_t nFrameNum, bool bLoop)
+{
+	anim a;
+	a.sName_	= sName;
+	a.nFrameNum_= (std::max)(nFrameNum, 1u);
+	a.bLoop_	= bLoop;
+	vecAnim_.emplace_back(a);
+
+	vecKey_.resize(anim_num());
+	vecKey_.back().resize(bone_num());
+
+	bBaked_ = false;
+	return anim_num()-1;
+}
+
+bool skeleton_def::add_key(uint32_t nAnim, uint32_t nBone, uint32_t nFrame, const draw::draw_info& info)
+{
+	if(nAnim>=anim_num() || nBone>=bone_num() || nFrame>=vecAnim_[nAnim].nFrameNum_) return false;
+
+	vector<key>& vecTrackKey = vecKey_[nAnim][nBone];
+
+	key k;
+	k.nFrame_	= nFrame;
+	k.info_		= info;
+
+	// フレーム順に並べる。同じフレームは上書き
+	auto it = std::lower_bound(vecTrackKey.begin(), vecTrackKey.end(), nFrame, [](const key& k, uint32_t n){ return k.nFrame_<n; });
+	if(it!=vecTrackKey.end() && it->nFrame_==nFrame) *it = k;
+	else											 vecTrackKey.insert(it, k);
+
+	bBaked_ = false;
+	return true;
+}
+
+optional<uint32_t> skeleton_def::bone_index(const string_fw& sName)const
+{
+	for(uint32_t i=0; i<bone_num(); ++i)
+	{
+		if(vecBone_[i].sName_==sName) return i;
+	}
+	return optional<uint32_t>();
+}
+
+optional<uint32_t> skeleton_def::anim_index(const string_fw& sName)const
+{
+	for(uint32_t i=0; i<anim_num(); ++i)
+	{
+		if(vecAnim_[i].sName_==sName) return i;
+	}
+	return optional<uint32_t>();
+}
+
+void skeleton_def::bake()
+{
+	for(uint32_t i=0; i<anim_num(); ++i)
+		bake_anim(vecAnim_[i], vecKey_[i]);
+
+	vecKey_.clear();
+	vecKey_.resize(anim_num());
+	for(auto& vecAnimKey : vecKey_) vecAnimKey.resize(bone_num());
+
+	bBaked_ = true;
+}
+
+void skeleton_def::bake_anim(anim& a, vector<vector<key>>& vecKey)
+{
+	const uint32_t nFrameNum = a.nFrameNum_;
+
+	// キーをチャンネルごとのサンプルに展開する
+	for(auto& v : a.vecTrack_) v.resize(bone_num()*nFrameNum);
+
+	for(uint32_t b=0; b<bone_num(); ++b)
+	{
+		const vector<key>& vecTrackKey = vecKey[b];
+
+		for(uint32_t f=0; f<nFrameNum; ++f)
+		{
+			draw::draw_info info = vecBone_[b].bind_;
+
+			if(!vecTrackKey.empty())
+			{
+				auto it = std::upper_bound(vecTrackKey.begin(), vecTrackKey.end(), f, [](uint32_t n, const key& k){ return n<k.nFrame_; });
+				if(it==vecTrackKey.begin())
+				{// 最初のキーより前
+					info = it->info_;
+				}
+				else if(it==vecTrackKey.end())
+				{// 最後のキーより後
+					info = vecTrackKey.back().info_;
+				}
+				else
+				{
+					const key& k0 = *(it-1);
+					const key& k1 = *it;
+					float fStep = static_cast<float>(f-k0.nFrame_)/static_cast<float>(k1.nFrame_-k0.nFrame_);
+					tween_curve::lerp_draw_info(k0.info_, k1.info_, fStep, info);
+				}
+			}
+
+			const uint32_t n = b*nFrameNum+f;
+			a.vecTrack_[CH_X][n]		= info.pos_.fX;
+			a.vecTrack_[CH_Y][n]		= info.pos_.fY;
+			a.vecTrack_[CH_ANGLE][n]	= info.angle_;
+			a.vecTrack_[CH_WIDTH][n]	= info.scale_.fWidth;
+			a.vecTrack_[CH_HEIGHT][n]	= info.scale_.fHeight;
+			a.vecTrack_[CH_ALPHA][n]	= static_cast<float>(info.alpha())/255.0f;
+		}
+	}
+
+	// ブレンドしない時用に、パーツのモデル空間の変換を焼く
+	const uint32_t nPartNum = part_num();
+	for(auto& v : a.vecPartPose_) v.resize(nFrameNum*nPartNum);
+	a.vecPartAlpha_.resize(nFrameNum*nPartNum);
+
+	vector<float> vecBoneAffine(bone_num()*6);
+	vector<float> vecBoneAlpha(bone_num());
+
+	for(uint32_t f=0; f<nFrameNum; ++f)
+	{
+		for(uint32_t b=0; b<bone_num(); ++b)
+		{
+			const uint32_t n = b*nFrameNum+f;
+
+			float afLocal[6];
+			affine_local(a.vecTrack_[CH_X][n], a.vecTrack_[CH_Y][n], a.vecTrack_[CH_ANGLE][n], a.vecTrack_[CH_WIDTH][n], a.vecTrack_[CH_HEIGHT][n], afLocal);
+
+			const uint32_t nParent = vecBone_[b].nParent_;
+			if(nParent==NO_PARENT)
+			{
+				std::copy(afLocal, afLocal+6, &vecBoneAffine[b*6]);
+				vecBoneAlpha[b] = a.vecTrack_[CH_ALPHA][n];
+			}
+			else
+			{
+				affine_mul(afLocal, &vecBoneAffine[nParent*6], &vecBoneAffine[b*6]);
+				vecBoneAlpha[b] = a.vecTrack_[CH_ALPHA][n]*vecBoneAlpha[nParent];
+			}
+		}
+
+		for(uint32_t p=0; p<nPartNum; ++p)
+		{
+			const part& pt = vecPart_[p];
+
+			float afPose[6];
+			affine_mul(pt.afOffset_, &vecBoneAffine[pt.nBone_*6], afPose);
+
+			const uint32_t n = f*nPartNum+p;
+			for(uint32_t i=0; i<6; ++i) a.vecPartPose_[i][n] = afPose[i];
+			a.vecPartAlpha_[n] = vecBoneAlpha[pt.nBone_];
+		}
+	}
+}
+
+} // namespace graphic end
+} // namespace mana end
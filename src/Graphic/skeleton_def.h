@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#include "../Draw/renderer_2d_util.h"
+
+namespace mana{
+namespace graphic{
+
+/*! @brief スケルタルアニメーションの定義
+ *
+ *  ボーン階層、ボーンに貼り付けるパーツ(スプライト)、アニメーションを持つ。
+ *  アニメーションはボーンごとのキーを、ロード時にフレームごとのサンプル表に焼く。
+ *  さらにブレンドしない時用に、フレームごとのパーツのモデル空間の変換も焼いておく
+ *
+ *  定義は同じキャラクターのskeletonノードで共有する。ノードごとに持つのは再生状態だけ
+ *
+ *  組み立て方
+ *  　add_bone → add_part → add_anim/add_key → bake
+ *  　ボーンは親を先に追加すること。パーツは追加順に描画される
+ */
+class skeleton_def
+{
+public:
+	enum skeleton_def_const : uint32_t
+	{
+		NO_PARENT = UINT_MAX,
+	};
+
+	//! トラックのチャンネル
+	enum channel
+	{
+		CH_X,
+		CH_Y,
+		CH_ANGLE,
+		CH_WIDTH,
+		CH_HEIGHT,
+		CH_ALPHA,	//!< 0.0～1.0
+		CH_NUM,
+	};
+
+	struct bone
+	{
+		string_fw		sName_;
+		uint32_t		nParent_;
+		draw::draw_info	bind_;	//!< トラックが無い時の姿勢
+	};
+
+	struct part
+	{
+		uint32_t	nBone_;
+		uint32_t	nTexID_;
+		draw::RECT	rect_;
+		float		afOffset_[6]; //!< ボーンからの変換。pivotも含む
+	};
+
+	struct anim
+	{
+		string_fw		sName_;
+		uint32_t		nFrameNum_;
+		bool			bLoop_;
+
+		//! チャンネルごとのサンプル。[ボーン*nFrameNum_+フレーム]
+		vector<float>	vecTrack_[CH_NUM];
+
+		//! ブレンドしない時のパーツの変換とアルファ。[フレーム*パーツ数+パーツ]
+		vector<float>	vecPartPose_[6];
+		vector<float>	vecPartAlpha_;
+	};
+
+public:
+	skeleton_def():bBaked_(false){}
+
+public:
+	//! @defgroup skeleton_def_build 組み立て
+	//! @{
+	//! @return ボーン番号。親が不正だとUINT_MAX
+	uint32_t	add_bone(const string_fw& sName, uint32_t nParent, const draw::draw_info& bind);
+
+	//! @param[in] info	 ボーンからの相対変換
+	//! @param[in] pivot 描画・拡縮・回転の原点
+	//! @return パーツ番号。ボーンが不正だとUINT_MAX
+	uint32_t	add_part(uint32_t nBone, uint32_t nTexID, const draw::RECT& rect, const draw::draw_info& info, const draw::POS& pivot);
+
+	//! @return アニメーション番号
+	uint32_t	add_anim(const string_fw& sName, uint32_t nFrameNum, bool bLoop);
+
+	//! キーを追加する。キーの間は線形補間する。キーの無いボーンはバインド姿勢のまま
+	bool		add_key(uint32_t nAnim, uint32_t nBone, uint32_t nFrame, const draw::draw_info& info);
+
+	//! キーをサンプル表に焼く。キーは捨てる
+	void		bake();
+	bool		is_baked()const{ return bBaked_; }
+	//! @}
+
+public:
+	uint32_t			bone_num()const{ return vecBone_.size(); }
+	uint32_t			part_num()const{ return vecPart_.size(); }
+	uint32_t			anim_num()const{ return vecAnim_.size(); }
+
+	const bone&			get_bone(uint32_t nBone)const{ return vecBone_[nBone]; }
+	const part&			get_part(uint32_t nPart)const{ return vecPart_[nPart]; }
+	const anim&			get_anim(uint32_t nAnim)const{ return vecAnim_[nAnim]; }
+
+	optional<uint32_t>	bone_index(const string_fw& sName)const;
+	optional<uint32_t>	anim_index(const string_fw& sName)const;
+
+	//! トラックのサンプル
+	float				sample(uint32_t nAnim, uint32_t nBone, uint32_t nFrame, channel eCh)const
+	{
+		const anim& a = vecAnim_[nAnim];
+		return a.vecTrack_[eCh][nBone*a.nFrameNum_+nFrame];
+	}
+
+private:
+	struct key
+	{
+		uint32_t		nFrame_;
+		draw::draw_info	info_;
+	};
+
+	//! 1つのアニメーションのキーを焼く
+	void		bake_anim(anim& a, vector<vector<key>>& vecKey);
+
+private:
+	vector<bone>				vecBone_;
+	vector<part>				vecPart_;
+	vector<anim>				vecAnim_;
+
+	vector<vector<vector<key>>>	vecKey_; //!< [アニメーション][ボーン]。bakeまで持つ
+
+	bool						bBaked_;
+};
+
+} // namespace graphic end
+} // namespace mana end
@@ -0,0 +1,225 @@
+﻿#include "../mana_common.h"
+
+#include "../Draw/renderer_2d.h"
+
+#include "graphic_fun.h"
+#include "draw_context.h"
+#include "sprite.h"
+#include "soa_layer.h"
+
+namespace mana{
+namespace graphic{
+
+soa_layer::soa_layer(uint32_t nElemReserve, uint32_t nReserve):draw_base(nReserve),bBlend_(false)
+{
+	eKind_ = DRAW_SOA_LAYER;
+	reserve_elem(nElemReserve);
+}
+
+uint32_t soa_layer::add_elem(uint32_t nParent)
+{
+	if(nParent!=NO_PARENT && nParent>=elem_num())
+	{
+		logger::warnln("[soa_layer]親要素が追加されていません : " + to_str(nParent));
+		return UINT_MAX;
+	}
+
+	vecParent_.push_back(nParent);
+	vecX_.push_back(0.f);
+	vecY_.push_back(0.f);
+	vecWidth_.push_back(1.f);
+	vecHeight_.push_back(1.f);
+	vecAngle_.push_back(0.f);
+	vecPivotX_.push_back(0.f);
+	vecPivotY_.push_back(0.f);
+	vecAlpha_.push_back(255);
+	vecVisible_.push_back(1);
+	vecColor_.push_back(D3DCOLOR_ARGB(255,255,255,255));
+	vecTexID_.push_back(0);
+	vecRect_.push_back(draw::RECT());
+
+	for(auto& v : vecWorld_) v.push_back(0.f);
+	vecWorldAlpha_.push_back(255);
+	vecWorldVisible_.push_back(1);
+
+	return elem_num()-1;
+}
+
+void soa_layer::reserve_elem(uint32_t nNum)
+{
+	vecParent_.reserve(nNum);
+	vecX_.reserve(nNum);
+	vecY_.reserve(nNum);
+	vecWidth_.reserve(nNum);
+	vecHeight_.reserve(nNum);
+	vecAngle_.reserve(nNum);
+	vecPivotX_.reserve(nNum);
+	vecPivotY_.reserve(nNum);
+	vecAlpha_.reserve(nNum);
+	vecVisible_.reserve(nNum);
+	vecColor_.reserve(nNum);
+	vecTexID_.reserve(nNum);
+	vecRect_.reserve(nNum);
+
+	for(auto& v : vecWorld_) v.reserve(nNum);
+	vecWorldAlpha_.reserve(nNum);
+	vecWorldVisible_.reserve(nNum);
+}
+
+void soa_layer::clear_elem()
+{
+	vecParent_.clear();
+	vecX_.clear();
+	vecY_.clear();
+	vecWidth_.clear();
+	vecHeight_.clear();
+	vecAngle_.clear();
+	vecPivotX_.clear();
+	vecPivotY_.clear();
+	vecAlpha_.clear();
+	vecVisible_.clear();
+	vecColor_.clear();
+	vecTexID_.clear();
+	vecRect_.clear();
+
+	for(auto& v : vecWorld_) v.clear();
+	vecWorldAlpha_.clear();
+	vecWorldVisible_.clear();
+}
+
+void soa_layer::exec(draw_context& ctx)
+{
+	exec_self(ctx);
+
+	calc_world_elem();
+	request_elem(ctx);
+
+	exec_children(ctx);
+}
+
+void soa_layer::calc_world_elem()
+{
+	const D3DXMATRIX& m = world_matrix();
+	const float fDegToRad = boost::math::constants::pi<float>()/180.0f;
+
+	float* const p11 = vecWorld_[0].data();
+	float* const p12 = vecWorld_[1].data();
+	float* const p21 = vecWorld_[2].data();
+	float* const p22 = vecWorld_[3].data();
+	float* const p41 = vecWorld_[4].data();
+	float* const p42 = vecWorld_[5].data();
+
+	const uint32_t nNum = elem_num();
+	for(uint32_t i=0; i<nNum; ++i)
+	{
+		// ローカル変換。draw_base::calc_worldと同じく scale*rot*pos の順
+		float c = 1.f, s = 0.f;
+		if(vecAngle_[i]!=0.f)
+		{
+			c = ::cosf(vecAngle_[i]*fDegToRad);
+			s = ::sinf(vecAngle_[i]*fDegToRad);
+		}
+
+		const float a11 =  vecWidth_[i]*c,  a12 = vecWidth_[i]*s;
+		const float a21 = -vecHeight_[i]*s, a22 = vecHeight_[i]*c;
+		const float a41 =  vecX_[i],        a42 = vecY_[i];
+
+		// 親のワールド変換を掛ける。親は必ず前にある
+		float b11, b12, b21, b22, b41, b42;
+		uint8_t nParentAlpha;
+		bool	bParentVisible;
+
+		const uint32_t nParent = vecParent_[i];
+		if(nParent==NO_PARENT)
+		{
+			b11=m._11; b12=m._12; b21=m._21; b22=m._22; b41=m._41; b42=m._42;
+			nParentAlpha	= world_alpha();
+			bParentVisible	= true;
+		}
+		else
+		{
+			b11=p11[nParent]; b12=p12[nParent]; b21=p21[nParent]; b22=p22[nParent]; b41=p41[nParent]; b42=p42[nParent];
+			nParentAlpha	= vecWorldAlpha_[nParent];
+			bParentVisible	= vecWorldVisible_[nParent]!=0;
+		}
+
+		p11[i] = a11*b11 + a12*b21;
+		p12[i] = a11*b12 + a12*b22;
+		p21[i] = a21*b11 + a22*b21;
+		p22[i] = a21*b12 + a22*b22;
+		p41[i] = a41*b11 + a42*b21 + b41;
+		p42[i] = a41*b12 + a42*b22 + b42;
+
+		// カラー合成
+		if(vecAlpha_[i]<255)
+			vecWorldAlpha_[i] = static_cast<uint8_t>((static_cast<float>(nParentAlpha) / 255.0f) * (static_cast<float>(vecAlpha_[i]) / 255.0f) * 255.0f);
+		else
+			vecWorldAlpha_[i] = nParentAlpha;
+
+		vecWorldVisible_[i] = (bParentVisible && vecVisible_[i]!=0) ? 1 : 0;
+	}
+}
+
+void soa_layer::request_elem(draw_context& ctx)
+{
+	const bool bVisible = is_visible_ctx(ctx) && ctx.renderer();
+
+	// 要素の範囲をまとめて、自分の描画範囲にする。非表示でも親のカリングのために求める
+	const bool bCull	= ctx.is_cull();
+	if(bCull) eBounds_ = BOUNDS_EMPTY;
+
+	draw::cmd::sprite_instance_cmd cmd;
+	cmd.nRenderTarget_ = ctx.render_target();
+
+	const uint32_t nNum = elem_num();
+	for(uint32_t i=0; i<nNum; ++i)
+	{
+		// Zはノードと同じく、描画しなくても進める
+		ctx.add_total_z(-0.1f);
+
+		if((!bVisible && !bCull) || vecWorldVisible_[i]==0 || vecTexID_[i]==GROUP_TEX_ID) continue;
+
+		const float w11=vecWorld_[0][i], w12=vecWorld_[1][i], w21=vecWorld_[2][i], w22=vecWorld_[3][i];
+		const float px=vecPivotX_[i], py=vecPivotY_[i];
+
+		// pivotの分だけ先に平行移動する
+		cmd.set_affine(w11, w12, w21, w22, vecWorld_[4][i] - px*w11 - py*w21, vecWorld_[5][i] - px*w12 - py*w22);
+
+		if(bCull)
+		{
+			const draw::RECT& rect = vecRect_[i];
+			if(rect.width()==0.f && rect.height()==0.f)
+			{// テクスチャサイズで描画されるので、範囲が分からない
+				eBounds_ = BOUNDS_INFINITE;
+			}
+			else
+			{
+				draw::RECT bounds;
+				affine_bounds(cmd.affine_, draw::RECT(0.f, 0.f, rect.width(), rect.height()), bounds);
+				merge_bounds(eBounds_, bounds_, bounds);
+
+				if(ctx.is_cull_out(bounds))
+				{
+				#ifdef MANA_DRAW_CULL_COUNT
+					if(bVisible) ctx.add_cull_cmd_count();
+				#endif
+					continue;
+				}
+			}
+		}
+
+		if(!bVisible) continue;
+
+		cmd.nTexID_	= vecTexID_[i];
+		cmd.rect_	= vecRect_[i];
+		cmd.fZ_		= ctx.total_z();
+		cmd.nColor0_= D3DCOLOR_ARGB(vecWorldAlpha_[i],255,255,255);
+		cmd.nColor1_= vecColor_[i];
+		cmd.mode_	= sprite::select_mode(cmd.nTexID_, vecWorldAlpha_[i]<255 || is_blend(), eColorMode_);
+
+		ctx.renderer()->request(cmd);
+	}
+}
+
+} // namespace graphic end
+} // namespace mana end
@@ -0,0 +1,173 @@
+﻿#pragma once
+
+#include "draw_base.h"
+
+namespace mana{
+namespace graphic{
+
+/*! @brief 大量の要素の変換・カラーを配列で持つノード
+ *
+ *  弾やパーティクル、タイルなど、数千個単位で並ぶスプライトを
+ *  1つずつdraw_baseノードにする代わりに、このノードの「要素」として持つ。
+ *  要素のpos/scale/angle/pivot/alpha/colorは、成分ごとの連続した配列に格納される(SoA)
+ *
+ *  要素は親要素を持てる。親は子より先に追加するので、配列は深さ優先順に並び、
+ *  ワールド変換とアルファの伝播は、先頭から1回なめるだけで済む。
+ *  ノードのように仮想関数呼び出しやポインタをたどる処理が無い
+ *
+ *  描画順も配列の順になる。Zは要素1つごとに、ノードと同じだけ進める
+ *
+ *  要素の操作はインデックスか、elemで行う。elemはdraw_baseと同じ名前のメソッドを持つビュー。
+ *  要素の削除はできないので、消す時はvisible(false)にするか、clearして作り直す
+ *
+ *  要素はアニメーションしない。タイムラインで動かしたいものは、普通のノードにすること
+ */
+class soa_layer : public draw_base
+{
+public:
+	enum soa_layer_const : uint32_t
+	{
+		NO_PARENT = UINT_MAX, //!< 親要素無し。このノード自身が親になる
+	};
+
+	/*! @brief 要素1つのビュー
+	 *
+	 *  soa_layerの配列を直接読み書きする。要素を追加すると無効になるので、保持しないこと */
+	class elem
+	{
+	public:
+		elem(soa_layer& layer, uint32_t nIndex):layer_(layer),nIndex_(nIndex){}
+
+		uint32_t			index()const{ return nIndex_; }
+		uint32_t			parent()const{ return layer_.vecParent_[nIndex_]; }
+
+		bool				is_visible()const{ return layer_.vecVisible_[nIndex_]!=0; }
+		elem&				visible(bool bVisible){ layer_.vecVisible_[nIndex_]=bVisible ? 1 : 0; return *this; }
+
+		float				x()const{ return layer_.vecX_[nIndex_]; }
+		elem&				set_x(float fX){ layer_.vecX_[nIndex_]=fX; return *this; }
+		float				y()const{ return layer_.vecY_[nIndex_]; }
+		elem&				set_y(float fY){ layer_.vecY_[nIndex_]=fY; return *this; }
+		elem&				set_pos(float fX, float fY){ set_x(fX); set_y(fY); return *this; }
+
+		float				width()const{ return layer_.vecWidth_[nIndex_]; }
+		elem&				set_width(float fWidth){ layer_.vecWidth_[nIndex_]=fWidth; return *this; }
+		float				height()const{ return layer_.vecHeight_[nIndex_]; }
+		elem&				set_height(float fHeight){ layer_.vecHeight_[nIndex_]=fHeight; return *this; }
+		elem&				set_scale(float fWidth, float fHeight){ set_width(fWidth); set_height(fHeight); return *this; }
+
+		float				angle()const{ return layer_.vecAngle_[nIndex_]; }
+		elem&				set_angle(float fAngle){ layer_.vecAngle_[nIndex_]=fAngle; return *this; }
+
+		float				pivot_x()const{ return layer_.vecPivotX_[nIndex_]; }
+		elem&				set_pivot_x(float fX){ layer_.vecPivotX_[nIndex_]=fX; return *this; }
+		float				pivot_y()const{ return layer_.vecPivotY_[nIndex_]; }
+		elem&				set_pivot_y(float fY){ layer_.vecPivotY_[nIndex_]=fY; return *this; }
+		elem&				set_pivot(float fX, float fY){ set_pivot_x(fX); set_pivot_y(fY); return *this; }
+
+		uint8_t				alpha()const{ return layer_.vecAlpha_[nIndex_]; }
+		elem&				set_alpha(uint8_t nAlpha){ layer_.vecAlpha_[nIndex_]=nAlpha; return *this; }
+
+		DWORD				color()const{ return layer_.vecColor_[nIndex_]; }
+		elem&				set_color(DWORD nColor){ layer_.vecColor_[nIndex_]=nColor; return *this; }
+		elem&				set_color(uint8_t a, uint8_t r, uint8_t g, uint8_t b){ return set_color(D3DCOLOR_ARGB(a,r,g,b)); }
+
+		//! テクスチャ。0だと四角ポリゴンになる
+		uint32_t			tex_id()const{ return layer_.vecTexID_[nIndex_]; }
+		elem&				set_tex_id(uint32_t nTexID){ layer_.vecTexID_[nIndex_]=nTexID; return *this; }
+		const draw::RECT&	tex_rect()const{ return layer_.vecRect_[nIndex_]; }
+		elem&				set_tex_rect(const draw::RECT& rect){ layer_.vecRect_[nIndex_]=rect; return *this; }
+
+		//! 描画しない要素にする。子要素をまとめて動かすのに使う
+		elem&				set_group(){ return set_tex_id(GROUP_TEX_ID); }
+
+		//! @defgroup soa_layer_elem_world 最後にexecした時のワールド変換。2x3アフィンの_11,_12,_21,_22,_41,_42
+		//! @{
+		float				world(uint32_t n)const{ return layer_.vecWorld_[n][nIndex_]; }
+		uint8_t				world_alpha()const{ return layer_.vecWorldAlpha_[nIndex_]; }
+		//! @}
+
+	private:
+		soa_layer&	layer_;
+		uint32_t	nIndex_;
+	};
+
+public:
+	soa_layer(uint32_t nElemReserve=0, uint32_t nReserve=CHILD_RESERVE);
+	virtual ~soa_layer(){}
+
+	virtual void	exec(draw_context& ctx)override;
+
+public:
+	//! @brief 要素を追加する
+	/*! @param[in] nParent 親要素のインデックス。追加済みの要素であること
+	 *  @return 追加した要素のインデックス。親が不正だとUINT_MAX */
+	uint32_t		add_elem(uint32_t nParent=NO_PARENT);
+	elem			at(uint32_t nIndex){ return elem(*this, nIndex); }
+
+	uint32_t		elem_num()const{ return vecParent_.size(); }
+	void			reserve_elem(uint32_t nNum);
+	void			clear_elem();
+
+	bool			is_blend()const{ return bBlend_; }
+	soa_layer&		blend(bool bBlend){ bBlend_ = bBlend; return *this; }
+
+private:
+	enum{ GROUP_TEX_ID = UINT_MAX }; //!< このテクスチャIDの要素は描画しない
+
+	//! 配列の先頭から、ワールド変換・アルファ・表示状態を計算する
+	void			calc_world_elem();
+
+	//! 要素の描画コマンドを積む
+	void			request_elem(draw_context& ctx);
+
+private:
+	friend class elem;
+
+	//! @defgroup soa_layer_local 要素のパラメータ
+	//! @{
+	vector<uint32_t>	vecParent_;
+	vector<float>		vecX_;
+	vector<float>		vecY_;
+	vector<float>		vecWidth_;
+	vector<float>		vecHeight_;
+	vector<float>		vecAngle_;
+	vector<float>		vecPivotX_;
+	vector<float>		vecPivotY_;
+	vector<uint8_t>		vecAlpha_;
+	vector<uint8_t>		vecVisible_;
+	vector<DWORD>		vecColor_;
+	vector<uint32_t>	vecTexID_;
+	vector<draw::RECT>	vecRect_;
+	//! @}
+
+	//! @defgroup soa_layer_world calc_world_elemで計算される値
+	//! @{
+	vector<float>		vecWorld_[6];
+	vector<uint8_t>		vecWorldAlpha_;
+	vector<uint8_t>		vecWorldVisible_;
+	//! @}
+
+	bool				bBlend_; //!< trueだと強制的にblend描画になる
+};
+
+} // namespace graphic end
+} // namespace mana end
+
+/* 使用例
+
+	soa_layer* pBullets = new_ soa_layer(4096);
+	root.add_child(pBullets, 10);
+
+	uint32_t n = pBullets->add_elem();
+	pBullets->at(n).set_tex_id(nBulletTex).set_tex_rect(rect).set_pos(100.f, 200.f);
+
+	// 子要素は親要素からの相対変換になる
+	uint32_t nGroup = pBullets->add_elem();
+	pBullets->at(nGroup).set_group().set_pos(320.f, 240.f);
+	uint32_t nChild = pBullets->add_elem(nGroup);
+	pBullets->at(nChild).set_tex_id(nBulletTex).set_tex_rect(rect).set_angle(45.f);
+
+	// 毎フレーム
+	pBullets->at(n).set_y(pBullets->at(n).y()-4.f);
+*/
@@ -12,7 +12,7 @@ void sprite::exec_self(draw_context& ctx)
 {
 	draw_base::exec_self(ctx);
 
-	if(is_visible_ctx(ctx))
+	if(is_visible_ctx(ctx) && !is_cull_ctx(ctx))
 	{
 		draw::cmd::sprite_draw_cmd cmd;
 		cmd.nTexID_ = tex_id();
@@ -34,69 +34,87 @@ void sprite::exec_self(draw_context& ctx)
 			cmd.worldMat_	= world_matrix();
 		}
 
-		if(cmd.nTexID_>0)
+		cmd.mode_	= select_mode(cmd.nTexID_, world_alpha()<255 || is_blend(), eColorMode_);
+
+		cmd.nRenderTarget_ = ctx.render_target();
+
+		// 行列は2x3のアフィンにして積む
+		ctx.renderer()->request(draw::cmd::sprite_instance_cmd(cmd));
+	}
+}
+
+bounds_kind sprite::local_bounds(draw::RECT& rect)const
+{
+	// サイズ0はテクスチャサイズで描画されるが、ここではサイズが分からない
+	if(rect_.width()==0.f && rect_.height()==0.f) return BOUNDS_INFINITE;
+
+	rect = draw::RECT(-pivot_x(), -pivot_y(), rect_.width()-pivot_x(), rect_.height()-pivot_y());
+	return BOUNDS_RECT;
+}
+
+size_t sprite::state_hash()const
+{
+	size_t nHash = draw_base::state_hash();
+	boost::hash_combine(nHash, nTexID_);
+	boost::hash_combine(nHash, rect_.fLeft);
+	boost::hash_combine(nHash, rect_.fTop);
+	boost::hash_combine(nHash, rect_.fRight);
+	boost::hash_combine(nHash, rect_.fBottom);
+	boost::hash_combine(nHash, bBlend_);
+	return nHash;
+}
+
+draw::draw_mode sprite::select_mode(uint32_t nTexID, bool bBlend, color_mode_kind eColorMode)
+{
+	if(nTexID>0)
+	{
+		if(bBlend)
 		{
-			if(world_alpha()<255 || is_blend())
+			switch(eColorMode)
 			{
-				switch(eColorMode_)
-				{
-				default:
-					cmd.mode_ = draw::MODE_TEX_BLEND;
-				break;
-
-				case COLOR_THR:
-					cmd.mode_ = draw::MODE_TEX_COLOR_THR_BLEND;
-				break;
-
-				case COLOR_BLEND:
-					cmd.mode_ = draw::MODE_TEX_COLOR_BLEND_BLEND;
-				break;
-
-				case COLOR_MUL:
-					cmd.mode_ = draw::MODE_TEX_COLOR_MUL_BLEND;
-				break;
-
-				case COLOR_SCREEN:
-					cmd.mode_ = draw::MODE_TEX_COLOR_SCREEN_BLEND;
-				break;
-				}
-			}
-			else
-			{
-				switch(eColorMode_)
-				{
-				default:
-					cmd.mode_ = draw::MODE_TEX;
-				break;
-
-				case COLOR_THR:
-					cmd.mode_ = draw::MODE_TEX_COLOR_THR;
-				break;
-
-				case COLOR_BLEND:
-					cmd.mode_ = draw::MODE_TEX_COLOR_BLEND;
-				break;
-
-				case COLOR_MUL:
-					cmd.mode_ = draw::MODE_TEX_COLOR_MUL;
-				break;
-
-				case COLOR_SCREEN:
-					cmd.mode_ = draw::MODE_TEX_COLOR_SCREEN;
-				break;
-				}
+			default:
+				return draw::MODE_TEX_BLEND;
+
+			case COLOR_THR:
+				return draw::MODE_TEX_COLOR_THR_BLEND;
+
+			case COLOR_BLEND:
+				return draw::MODE_TEX_COLOR_BLEND_BLEND;
+
+			case COLOR_MUL:
+				return draw::MODE_TEX_COLOR_MUL_BLEND;
+
+			case COLOR_SCREEN:
+				return draw::MODE_TEX_COLOR_SCREEN_BLEND;
 			}
 		}
 		else
 		{
-			if(world_alpha()<255 || is_blend())
-				cmd.mode_ = draw::MODE_PLY_COLOR_BLEND;
-			else
-				cmd.mode_ = draw::MODE_PLY_COLOR;
+			switch(eColorMode)
+			{
+			default:
+				return draw::MODE_TEX;
+
+			case COLOR_THR:
+				return draw::MODE_TEX_COLOR_THR;
+
+			case COLOR_BLEND:
+				return draw::MODE_TEX_COLOR_BLEND;
+
+			case COLOR_MUL:
+				return draw::MODE_TEX_COLOR_MUL;
+
+			case COLOR_SCREEN:
+				return draw::MODE_TEX_COLOR_SCREEN;
+			}
 		}
-		
-		cmd.nRenderTarget_ = ctx.render_target();
-		ctx.renderer()->request(cmd);
+	}
+	else
+	{
+		if(bBlend)
+			return draw::MODE_PLY_COLOR_BLEND;
+		else
+			return draw::MODE_PLY_COLOR;
 	}
 }
 
@@ -23,6 +23,12 @@ public:
 	bool				is_blend()const{ return bBlend_; }
 	sprite&				blend(bool bBlend){ bBlend_ = bBlend; return *this; }
 
+	//! テクスチャの有無、ブレンドの有無、カラー合成モードから描画モードを決める
+	static draw::draw_mode select_mode(uint32_t nTexID, bool bBlend, color_mode_kind eColorMode);
+
+	virtual bounds_kind	local_bounds(draw::RECT& rect)const override;
+	virtual size_t		state_hash()const override;
+
 protected:
 	virtual void exec_self(draw_context& ctx)override;
 
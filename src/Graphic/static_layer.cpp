@@ -0,0 +1,111 @@
+﻿#include "../mana_common.h"
+
+#include "../Draw/renderer_2d.h"
+
+#include "draw_context.h"
+#include "static_layer.h"
+
+namespace mana{
+namespace graphic{
+
+namespace{
+//! 子孫の並びと状態をnHashに混ぜる
+void hash_tree(size_t& nHash, const draw_base& node)
+{
+	for(auto& it : node.children())
+	{
+		boost::hash_combine(nHash, it);
+		boost::hash_combine(nHash, it->priority());
+		boost::hash_combine(nHash, it->state_hash());
+		hash_tree(nHash, *it);
+	}
+
+	// 子の無いノードと区別する
+	boost::hash_combine(nHash, node.children().size());
+}
+} // namespace end
+
+static_layer::static_layer(uint32_t nReserve):draw_base(nReserve),bDirty_(true),nRecAlpha_(0),fRecZ_(0.f),fRecEndZ_(0.f),nRecRenderTarget_(draw::cmd::BACK_BUFFER_ID),bRecCull_(false),nRecHash_(0)
+{
+	eKind_ = DRAW_STATIC_LAYER;
+	D3DXMatrixIdentity(&recMat_);
+
+#ifdef MANA_STATIC_LAYER_COUNT
+	nRecordCount_=0;
+	nReuseCount_=0;
+	nSubtreeChangeCount_=0;
+#endif
+}
+
+void static_layer::exec(draw_context& ctx)
+{
+	exec_self(ctx);
+
+	const shared_ptr<draw::renderer_2d>& pRenderer = ctx.renderer();
+
+	if(!is_visible_ctx(ctx) || !pRenderer)
+	{// 描画されないなら普通に子を動かす。次に表示される時は記録し直す
+		exec_children(ctx);
+		bDirty_ = true;
+		return;
+	}
+
+	bool bSubtreeChanged = !bDirty_ && subtree_hash()!=nRecHash_;
+
+#ifdef MANA_STATIC_LAYER_COUNT
+	if(bSubtreeChanged) ++nSubtreeChangeCount_;
+#endif
+
+	if(bDirty_ || bSubtreeChanged || is_changed(ctx))
+	{// 子を動かしつつ、積まれたコマンドを記録する
+		capture_.clear();
+
+		draw::cmd::cmd_capture* pPrev = pRenderer->begin_capture(&capture_);
+		exec_children(ctx);
+		pRenderer->end_capture(pPrev);
+
+		recMat_				= world_matrix();
+		nRecAlpha_			= world_alpha();
+		fRecZ_				= world_z();
+		fRecEndZ_			= ctx.total_z();
+		nRecRenderTarget_	= ctx.render_target();
+		bRecCull_			= ctx.is_cull();
+		recCullRect_		= ctx.cull_rect();
+		nRecHash_			= subtree_hash();
+		bDirty_				= false;
+
+	#ifdef MANA_STATIC_LAYER_COUNT
+		++nRecordCount_;
+	#endif
+	}
+	else
+	{// 記録したコマンドをまとめて積む。子が進めるはずだったZも合わせる
+		pRenderer->request(capture_);
+		ctx.set_total_z(fRecEndZ_);
+
+	#ifdef MANA_STATIC_LAYER_COUNT
+		++nReuseCount_;
+	#endif
+	}
+}
+
+size_t static_layer::subtree_hash()const
+{
+	size_t nHash=0;
+	hash_tree(nHash, *this);
+	return nHash;
+}
+
+bool static_layer::is_changed(draw_context& ctx)const
+{
+	return world_matrix()!=recMat_
+		|| world_alpha()!=nRecAlpha_
+		|| world_z()!=fRecZ_
+		|| ctx.render_target()!=nRecRenderTarget_
+		|| ctx.is_cull()!=bRecCull_
+		|| (bRecCull_ && (ctx.cull_rect().fLeft!=recCullRect_.fLeft || ctx.cull_rect().fTop!=recCullRect_.fTop
+					   || ctx.cull_rect().fRight!=recCullRect_.fRight || ctx.cull_rect().fBottom!=recCullRect_.fBottom));
+}
+
+} // namespace graphic end
+} // namespace mana end
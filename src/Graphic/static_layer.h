@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include "../Draw/renderer_2d_cmd.h"
+
+#include "draw_base.h"
+
+#ifdef MANA_DEBUG
+#define MANA_STATIC_LAYER_COUNT
+#endif
+
+namespace mana{
+namespace graphic{
+
+/*! @brief 変化しないサブツリーの描画コマンドを使い回すノード
+ *
+ *  HUDや背景など、毎フレーム同じ絵になるサブツリーの親にする。
+ *  一度子を動かして積まれた描画コマンドを記録し、
+ *  以降は子を動かさずに記録したコマンドをまとめて積む。
+ *  子のexec、コマンド生成がまるごと省略される
+ *
+ *  以下の時は記録し直す
+ *  　mark_dirtyが呼ばれた
+ *  　子孫の追加・削除・並び替えがあった
+ *  　子孫のstate_hashが変わった(位置・拡縮・角度・アルファ・色・表示・テクスチャ・テキストなど)
+ *  　自分のワールド行列・アルファ・Z・レンダーターゲット・カリング矩形が変わった
+ *  　前のフレームで非表示だった
+ *
+ *  子孫の変化は毎フレーム子孫をたどってstate_hashを比べて見つけるので、
+ *  子のパラメータを変更しても、mark_dirtyを呼ぶ必要は無い。
+ *  記録し直さない間は子のexecが呼ばれないので、タイムラインなどのアニメーションは進まない。
+ *  state_hashに含まれない状態で描画を変える時は、mark_dirtyを呼ぶこと
+ *
+ *  記録・使い回しの回数をカウントする時は、
+ *  MANA_STATIC_LAYER_COUNTをdefineする
+ */
+class static_layer : public draw_base
+{
+public:
+	static_layer(uint32_t nReserve=CHILD_RESERVE);
+	virtual ~static_layer(){}
+
+	virtual void	exec(draw_context& ctx)override;
+
+public:
+	//! 次のexecで記録し直す
+	static_layer&	mark_dirty(){ bDirty_=true; return *this; }
+	bool			is_dirty()const{ return bDirty_; }
+
+	//! 記録されたコマンド
+	const draw::cmd::cmd_capture& capture()const{ return capture_; }
+
+public:
+	//! @defgroup static_layer_child_ctrl 子操作。変更があったら記録し直す
+	//! @{
+	virtual bool	add_child(draw_base* pChild, uint32_t nPriority)override{ bDirty_=true; return draw_base::add_child(pChild, nPriority); }
+	virtual void	clear_child(bool bDelete=true)override{ bDirty_=true; draw_base::clear_child(bDelete); }
+	draw_base*		remove_child(uint32_t nPriority, bool bDelete){ bDirty_=true; return draw_base::remove_child(nPriority, bDelete); }
+	bool			change_child_priority(uint32_t nPriority, uint32_t nNewPriority){ bDirty_=true; return draw_base::change_child_priority(nPriority, nNewPriority); }
+	//! @}
+
+protected:
+	virtual void	init_self()override{ bDirty_=true; }
+
+private:
+	//! 記録した時と状態が変わっているか
+	bool			is_changed(draw_context& ctx)const;
+	//! 子孫の並びと状態のハッシュ
+	size_t			subtree_hash()const;
+
+private:
+	draw::cmd::cmd_capture capture_; //!< 記録したコマンド
+
+	bool		bDirty_;
+
+	//! @defgroup static_layer_record_state 記録した時の状態
+	//! @{
+	D3DXMATRIX	recMat_;
+	uint8_t		nRecAlpha_;
+	float		fRecZ_;
+	float		fRecEndZ_;		//!< 子を動かし終わった時のZ。使い回す時はここまでZを進める
+	uint32_t	nRecRenderTarget_;
+	bool		bRecCull_;
+	draw::RECT	recCullRect_;	//!< 記録したコマンドはこの矩形でカリングされている
+	size_t		nRecHash_;		//!< 子を動かし終わった時のsubtree_hash
+	//! @}
+
+#ifdef MANA_STATIC_LAYER_COUNT
+public:
+	uint32_t	record_count()const{ return nRecordCount_; }
+	uint32_t	reuse_count()const{ return nReuseCount_; }
+	uint32_t	subtree_change_count()const{ return nSubtreeChangeCount_; }
+
+private:
+	uint32_t	nRecordCount_;	//!< 記録した回数
+	uint32_t	nReuseCount_;	//!< 使い回した回数
+	uint32_t	nSubtreeChangeCount_;	//!< 子孫の変化で記録し直した回数
+#endif
+};
+
+} // namespace graphic end
+} // namespace mana end
+
+/* 使用例
+
+	static_layer* pHud = new_ static_layer();
+	pHud->add_child(pScoreFrame, 0);
+	pHud->add_child(pLifeFrame, 1);
+	root.add_child(pHud, 10);
+
+	// 子のパラメータを書き換えると、次のexecで記録し直される
+	pLifeFrame->set_alpha(128);
+*/
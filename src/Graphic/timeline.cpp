@@ -20,7 +20,7 @@ void timeline::exec(draw_context& ctx)
 	draw_base::exec_self(ctx);
 
 	bool bVisible	= ctx.is_visible();
-	ctx.visible(is_visible_ctx(ctx));
+	ctx.visible(is_visible_children_ctx(ctx));
 
 	bool bPause		= ctx.is_pause();
 	ctx.pause(is_pause_ctx(ctx));
@@ -31,6 +31,8 @@ void timeline::exec(draw_context& ctx)
 
 	ctx.visible(bVisible);
 	ctx.pause(bPause);
+
+	calc_tree_bounds(ctx);
 }
 
 timeline& timeline::set_color(uint8_t a, uint8_t r, uint8_t g, uint8_t b)
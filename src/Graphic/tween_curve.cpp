@@ -0,0 +1,39 @@
+﻿#include "../mana_common.h"
+
+#include "graphic_fun.h"
+#include "tween_curve.h"
+
+namespace mana{
+namespace graphic{
+
+void tween_curve::bake_sin(float fEasing, uint32_t nStep)
+{
+	eType_ = EASING_SIN;
+	nStep_ = nStep;
+	vecSample_.resize(nStep+1);
+
+	// フレーム数0のトゥイーンは動かないので、開始状態のままにする
+	vecSample_[0] = 0.f;
+
+	// lerpと同じく0.0～1.0に収める
+	for(uint32_t i=1; i<=nStep; ++i)
+		vecSample_[i] = clamp(easing_sin_step(fEasing, static_cast<float>(i)/static_cast<float>(nStep)), 0.0f, 1.0f);
+}
+
+void tween_curve::bake_bezier(float fX1, float fY1, float fX2, float fY2, uint32_t nStep)
+{
+	eType_ = EASING_BEZIER;
+	nStep_ = nStep;
+	vecSample_.resize(nStep+1);
+
+	vecSample_[0] = 0.f;
+
+	fX1 = clamp(fX1, 0.0f, 1.0f);
+	fX2 = clamp(fX2, 0.0f, 1.0f);
+
+	for(uint32_t i=1; i<=nStep; ++i)
+		vecSample_[i] = cubic_bezier_step(fX1, fY1, fX2, fY2, static_cast<float>(i)/static_cast<float>(nStep));
+}
+
+} // namespace graphic end
+} // namespace mana end
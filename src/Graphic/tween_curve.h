@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "../Draw/renderer_2d_util.h"
+
+namespace mana{
+namespace graphic{
+
+/*! @brief ベイク済みのトゥイーンカーブ
+ *
+ *  トゥイーンの各ステップでのイージング後の進み具合(0.0～1.0)を、ロード時に表にしておく。
+ *  毎フレームの計算は表を引いて、全プロパティをまとめて線形補間するだけになり、
+ *  イージングの種類による分岐やsinの計算が無くなる
+ *
+ *  表は定義データ(tweenframe_data)が持ち、同じ定義から作ったtweenframeで共有する
+ */
+class tween_curve
+{
+public:
+	enum easing_type
+	{
+		EASING_SIN,		//!< easing_sin_step。Flashのイージング値(-100～100)を-1.0～1.0にしたもの
+		EASING_BEZIER,	//!< 3次ベジェ。Flashのカスタムイージングと同じく(0,0)-(1,1)を結ぶ
+	};
+
+public:
+	tween_curve():eType_(EASING_SIN),nStep_(0){}
+
+public:
+	//! @brief easing_sin_stepをベイクする
+	/*! @param[in] fEasing イージングパラメータ。-1.0～1.0
+	 *  @param[in] nStep   トゥイーンのフレーム数 */
+	void		bake_sin(float fEasing, uint32_t nStep);
+
+	//! @brief 3次ベジェをベイクする
+	/*! 制御点のxは0.0～1.0に丸める。yは範囲外も使える(行き過ぎて戻る動きになる) */
+	void		bake_bezier(float fX1, float fY1, float fX2, float fY2, uint32_t nStep);
+
+	easing_type	type()const{ return eType_; }
+	uint32_t	step()const{ return nStep_; }
+
+	//! nCurStepステップ目の進み具合
+	float		sample(uint32_t nCurStep)const{ return vecSample_[(std::min)(nCurStep, nStep_)]; }
+
+public:
+	//! 全プロパティをfStepで線形補間する。Zは補間しない
+	static void	lerp_draw_info(const draw::draw_info& start, const draw::draw_info& end, float fStep, draw::draw_info& out)
+	{
+		out.pos_.fX			= start.pos_.fX			+ (end.pos_.fX-start.pos_.fX)*fStep;
+		out.pos_.fY			= start.pos_.fY			+ (end.pos_.fY-start.pos_.fY)*fStep;
+		out.angle_			= start.angle_			+ (end.angle_-start.angle_)*fStep;
+		out.scale_.fWidth	= start.scale_.fWidth	+ (end.scale_.fWidth-start.scale_.fWidth)*fStep;
+		out.scale_.fHeight	= start.scale_.fHeight	+ (end.scale_.fHeight-start.scale_.fHeight)*fStep;
+
+		float fAlpha = static_cast<float>(start.alpha()) + (static_cast<float>(end.alpha())-static_cast<float>(start.alpha()))*fStep;
+		out.set_alpha(static_cast<uint8_t>(clamp(fAlpha, 0.0f, 255.0f)));
+	}
+
+private:
+	easing_type		eType_;
+	uint32_t		nStep_;
+	vector<float>	vecSample_; //!< nStep_+1個
+};
+
+} // namespace graphic end
+} // namespace mana end
+
+/* 使用例
+
+	tween_curve curve;
+	curve.bake_bezier(0.42f, 0.f, 0.58f, 1.f, 30);
+
+	// 毎フレーム
+	tween_curve::lerp_draw_info(start, end, curve.sample(nCurStep), info);
+*/
@@ -0,0 +1,347 @@
+﻿#pragma once
+
+#ifdef MANA_DEBUG
+#define MANA_LINEAR_ARENA_COUNT
+#endif
+
+namespace mana{
+namespace memory{
+
+/*! @brief 線形(バンプ)アロケータ
+ *
+ *  ポインタを進めるだけで確保し、個別の解放はしない。
+ *  reset で確保した全領域をまとめて破棄する。
+ *  確保したメモリのデストラクタは呼ばれないので、
+ *  POD か、デストラクタを呼ばなくてよい型に使うこと
+ *
+ *  ブロックが足りなくなった時はヒープから追加ブロックを確保し、
+ *  次の reset で1つの大きなブロックにまとめ直す。
+ *  そのため、数フレーム回すと以降はヒープを触らなくなる
+ *
+ *  確保回数やヒープ確保回数をカウントする時は、
+ *  MANA_LINEAR_ARENA_COUNTをdefineする
+ */
+class linear_arena
+{
+public:
+	enum arena_const : uint32_t
+	{
+		DEFAULT_BLOCK_SIZE	= 64*1024,
+		DEFAULT_ALIGN		= 8,
+	};
+
+public:
+	linear_arena():pBlock_(nullptr),nBlockSize_(0),nOffset_(0),nOverflowSize_(0)
+	{
+#ifdef MANA_LINEAR_ARENA_COUNT
+		nAllocCount_=0; nHeapAllocCount_=0; nMaxUseSize_=0; nTotalHeapAllocCount_=0;
+#endif
+	}
+
+	~linear_arena(){ fin(); }
+
+public:
+	//! @brief 初期化
+	/*! @param[in] nBlockSize 最初に確保するブロックのサイズ */
+	void init(uint32_t nBlockSize=DEFAULT_BLOCK_SIZE);
+	void fin();
+
+	//! @brief メモリを確保する
+	/*! @param[in] nAlign 2の累乗であること */
+	void* alloc(size_t nSize, size_t nAlign=DEFAULT_ALIGN);
+
+	//! 型を指定してnNum個分確保する。コンストラクタは呼ばれない
+	template<class T>
+	T* alloc_array(size_t nNum){ return static_cast<T*>(alloc(sizeof(T)*nNum, __alignof(T))); }
+
+	//! 文字列をコピーして、終端付きのポインタを返す
+	const char* copy_str(const char* szStr, size_t nLen);
+	const char* copy_str(const string& sStr){ return copy_str(sStr.c_str(), sStr.size()); }
+
+	//! @brief 確保した領域を全て破棄する
+	/*! 追加ブロックを確保していた場合は、それらを合わせたサイズでブロックを作り直す */
+	void reset();
+
+	//! 現在使用しているサイズ
+	size_t use_size()const{ return nOffset_+nOverflowSize_; }
+	//! メインブロックのサイズ
+	size_t block_size()const{ return nBlockSize_; }
+
+private:
+	void* alloc_overflow(size_t nSize, size_t nAlign);
+
+private:
+	BYTE*			pBlock_;		//!< メインブロック
+	size_t			nBlockSize_;	//!< メインブロックサイズ
+	size_t			nOffset_;		//!< メインブロック中の使用位置
+
+	vector<BYTE*>	vecOverflow_;	//!< メインブロックから溢れた分の追加ブロック
+	size_t			nOverflowSize_;	//!< 追加ブロックの合計サイズ
+
+#ifdef MANA_LINEAR_ARENA_COUNT
+public:
+	//! reset以降の確保回数
+	uint32_t alloc_count()const{ return nAllocCount_; }
+	//! reset以降のヒープ確保回数。ブロックが足りていれば0になる
+	uint32_t heap_alloc_count()const{ return nHeapAllocCount_; }
+	//! 起動してからのヒープ確保回数
+	uint32_t total_heap_alloc_count()const{ return nTotalHeapAllocCount_; }
+	//! 最大使用サイズ
+	size_t	 max_use_size()const{ return nMaxUseSize_; }
+
+private:
+	uint32_t nAllocCount_;
+	uint32_t nHeapAllocCount_;
+	uint32_t nTotalHeapAllocCount_;
+	size_t	 nMaxUseSize_;
+#endif
+
+private:
+	NON_COPIABLE(linear_arena);
+};
+
+/*! @brief フレーム単位の線形アロケータ
+ *
+ *  linear_arena を N 個持ち、フレーム毎に切り替えて使う。
+ *  renderer_2d_async のように、積んだフレームと処理中のフレームが
+ *  並行して存在する場合、その段数と N を合わせること
+ *
+ *  next_frame で次のアリーナに切り替え、そのアリーナを reset する。
+ *  N フレーム前に確保したメモリはその時点で無効になる
+ */
+template<uint32_t N>
+class frame_arena
+{
+public:
+	enum frame_arena_const : uint32_t
+	{
+		FRAME_NUM = N,
+	};
+
+public:
+	frame_arena():nCurIndex_(0){}
+
+public:
+	void init(uint32_t nBlockSize=linear_arena::DEFAULT_BLOCK_SIZE)
+	{
+		nCurIndex_=0;
+		for(auto& it : arena_) it.init(nBlockSize);
+	}
+
+	void fin()
+	{
+		for(auto& it : arena_) it.fin();
+	}
+
+	//! 現在のフレームのアリーナ
+	linear_arena& cur(){ return arena_[nCurIndex_]; }
+	//! 指定インデックスのアリーナ
+	linear_arena& arena(uint32_t nIndex){ return arena_[nIndex]; }
+
+	uint32_t cur_index()const{ return nCurIndex_; }
+
+	//! 次のフレームのアリーナに切り替えて、reset する
+	linear_arena& next_frame()
+	{
+		nCurIndex_ = (nCurIndex_+1)%N;
+		arena_[nCurIndex_].reset();
+		return arena_[nCurIndex_];
+	}
+
+	//! 指定インデックスのアリーナに切り替えて、reset する
+	linear_arena& set_frame(uint32_t nIndex)
+	{
+		nCurIndex_ = nIndex%N;
+		arena_[nCurIndex_].reset();
+		return arena_[nCurIndex_];
+	}
+
+private:
+	array<linear_arena, N>	arena_;
+	uint32_t				nCurIndex_;
+
+private:
+	NON_COPIABLE(frame_arena);
+};
+
+/*! @brief linear_arena を使う STL 互換アロケータ
+ *
+ *  deallocate は何もしない。メモリはアリーナの reset で一括破棄される。
+ *  コンテナの寿命はアリーナの reset より短くすること
+ */
+template<class T>
+class arena_allocator
+{
+public:
+	typedef T			value_type;
+	typedef T*			pointer;
+	typedef const T*	const_pointer;
+	typedef T&			reference;
+	typedef const T&	const_reference;
+	typedef size_t		size_type;
+	typedef ptrdiff_t	difference_type;
+
+	template<class U>
+	struct rebind{ typedef arena_allocator<U> other; };
+
+public:
+	explicit arena_allocator(linear_arena& arena):pArena_(&arena){}
+
+	template<class U>
+	arena_allocator(const arena_allocator<U>& other):pArena_(other.arena()){}
+
+public:
+	pointer		allocate(size_type nNum, const void* =nullptr){ return static_cast<pointer>(pArena_->alloc(sizeof(T)*nNum, __alignof(T))); }
+	void		deallocate(pointer, size_type){}
+
+	void		construct(pointer p, const T& val){ ::new(static_cast<void*>(p)) T(val); }
+	void		destroy(pointer p){ p->~T(); }
+
+	pointer			address(reference r)const{ return &r; }
+	const_pointer	address(const_reference r)const{ return &r; }
+	size_type		max_size()const{ return static_cast<size_type>(-1)/sizeof(T); }
+
+	linear_arena*	arena()const{ return pArena_; }
+
+private:
+	linear_arena* pArena_;
+};
+
+template<class T, class U>
+inline bool operator==(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs){ return lhs.arena()==rhs.arena(); }
+
+template<class T, class U>
+inline bool operator!=(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs){ return lhs.arena()!=rhs.arena(); }
+
+//! アリーナから確保するvector
+template<class T>
+struct arena_vector
+{
+	typedef vector<T, arena_allocator<T>> type;
+};
+
+//! アリーナから確保するstring
+typedef std::basic_string<char, std::char_traits<char>, arena_allocator<char>> arena_string;
+
+
+////////////////////////
+// 実装
+inline void linear_arena::init(uint32_t nBlockSize)
+{
+	fin();
+
+	nBlockSize_ = nBlockSize;
+	pBlock_		= new_ BYTE[nBlockSize_];
+	nOffset_	= 0;
+
+#ifdef MANA_LINEAR_ARENA_COUNT
+	++nTotalHeapAllocCount_;
+#endif
+}
+
+inline void linear_arena::fin()
+{
+	for(auto& it : vecOverflow_) delete[] it;
+	vecOverflow_.clear();
+	nOverflowSize_=0;
+
+	delete[] pBlock_;
+	pBlock_		= nullptr;
+	nBlockSize_	= 0;
+	nOffset_	= 0;
+}
+
+inline void* linear_arena::alloc(size_t nSize, size_t nAlign)
+{
+#ifdef MANA_LINEAR_ARENA_COUNT
+	++nAllocCount_;
+#endif
+
+	size_t nStart = (nOffset_ + (nAlign-1)) & ~(nAlign-1);
+	if(pBlock_!=nullptr && nStart+nSize<=nBlockSize_)
+	{
+		nOffset_ = nStart+nSize;
+
+#ifdef MANA_LINEAR_ARENA_COUNT
+		if(use_size()>nMaxUseSize_) nMaxUseSize_=use_size();
+#endif
+		return pBlock_+nStart;
+	}
+
+	return alloc_overflow(nSize, nAlign);
+}
+
+inline void* linear_arena::alloc_overflow(size_t nSize, size_t nAlign)
+{// 足りない分は追加ブロックで確保する。追加ブロックは1確保1ブロック
+	size_t nAllocSize = nSize+nAlign;
+	BYTE* p = new_ BYTE[nAllocSize];
+	vecOverflow_.emplace_back(p);
+	nOverflowSize_ += nAllocSize;
+
+#ifdef MANA_LINEAR_ARENA_COUNT
+	++nHeapAllocCount_;
+	++nTotalHeapAllocCount_;
+	if(use_size()>nMaxUseSize_) nMaxUseSize_=use_size();
+#endif
+
+	uintptr_t nAddr = (reinterpret_cast<uintptr_t>(p) + (nAlign-1)) & ~(static_cast<uintptr_t>(nAlign)-1);
+	return reinterpret_cast<void*>(nAddr);
+}
+
+inline const char* linear_arena::copy_str(const char* szStr, size_t nLen)
+{
+	char* p = static_cast<char*>(alloc(nLen+1, 1));
+	::memcpy(p, szStr, nLen);
+	p[nLen] = '\0';
+	return p;
+}
+
+inline void linear_arena::reset()
+{
+	if(!vecOverflow_.empty())
+	{// 溢れていたら、溢れた分も含めたサイズでブロックを作り直す
+		size_t nNewSize = nBlockSize_ + nOverflowSize_;
+
+		for(auto& it : vecOverflow_) delete[] it;
+		vecOverflow_.clear();
+		nOverflowSize_=0;
+
+		delete[] pBlock_;
+		nBlockSize_ = nNewSize;
+		pBlock_		= new_ BYTE[nBlockSize_];
+
+#ifdef MANA_LINEAR_ARENA_COUNT
+		++nTotalHeapAllocCount_;
+		logger::debugln("[linear_arena]ブロックを拡張しました : " + to_str(nBlockSize_));
+#endif
+	}
+
+	nOffset_=0;
+
+#ifdef MANA_LINEAR_ARENA_COUNT
+	nAllocCount_=0;
+	nHeapAllocCount_=0;
+#endif
+}
+
+} // namespace memory end
+} // namespace mana end
+
+/* 使用例
+
+	memory::frame_arena<2> arena;
+	arena.init();
+
+	// メインループ
+	while(true)
+	{
+		memory::linear_arena& cur = arena.next_frame();
+
+		// フレーム内だけ使うコンテナ
+		memory::arena_vector<uint32_t>::type vec((memory::arena_allocator<uint32_t>(cur)));
+		vec.reserve(128);
+
+		// 文字列もアリーナにコピーできる
+		const char* szText = cur.copy_str("テキスト");
+	}
+*/
@@ -108,6 +108,20 @@ optional<shared_ptr<resource_file>> resource_manager::resource(const string_fw&
 	return optional<shared_ptr<resource_file>>();
 }
 
+bool resource_manager::is_fail(const string_fw& sID)
+{
+	auto cache = cacheResouce_.find(sID);
+	if(cache==cacheResouce_.end()) return true;
+
+	uint32_t n = cache->second.get<1>()->state();
+	if(n==resource_file::FAIL)		return true;
+	if(n==resource_file::SUCCESS)	return false;
+
+	// ワーカーの処理が終わっているのに、ロードが終わっていない
+	auto f = cache->second.get<0>().lock();
+	return f==nullptr || f->is_fin();
+}
+
 void resource_manager::release_cache(const string_fw& sID)
 {
 	cacheResouce_.erase(sID);
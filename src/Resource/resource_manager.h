@@ -52,6 +52,9 @@ public:
 	//! リソース取得
 	/*! @return ロードが終わって無いファイルを指定した場合、無効な値が返ってくる */
 	optional<shared_ptr<resource_file>>	resource(const string_fw& sID);
+	//! @brief ロードに失敗したか
+	/*! リクエストされていないものや、ワーカーが動かさずに終わってロードが進まないものも失敗にする */
+	bool								is_fail(const string_fw& sID);
 	//! リソースキャッシュ解放。ロード終了後のリソースにのみ有効
 	void								release_cache(const string_fw& sID);
 
@@ -113,6 +113,8 @@ XTAL_BIND(mana::graphic::draw_base)
 	Xdef_method_alias(set_y,		&draw_base::set_y_xtal);
 	Xdef_method(z);
 	Xdef_method_alias(set_z,		&draw_base::set_z_xtal);
+	Xdef_method_alias(set_pos,		&draw_base::set_pos_xtal);
+	Xdef_method_alias(set_transform,&draw_base::set_transform_xtal);
 
 	Xdef_method_alias(set_scale,	&draw_base::set_scale_xtal);
 	Xdef_method(width);
@@ -144,5 +146,16 @@ XTAL_BIND(mana::graphic::draw_base)
 	Xdef_method_alias(add_child,	&draw_base::add_child_xtal);
 	Xdef_method_alias(remove_child, &draw_base::remove_child_xtal);
 	Xdef_method_alias(child,		&draw_base::child_xtal);
+	Xdef_method_alias(update_children, &draw_base::update_children_xtal);
+
+	// update_childrenに渡すフラグ
+	it->def(Xid(UPDATE_X),			static_cast<xtal::int_t>(draw_base::UPDATE_X));
+	it->def(Xid(UPDATE_Y),			static_cast<xtal::int_t>(draw_base::UPDATE_Y));
+	it->def(Xid(UPDATE_Z),			static_cast<xtal::int_t>(draw_base::UPDATE_Z));
+	it->def(Xid(UPDATE_WIDTH),		static_cast<xtal::int_t>(draw_base::UPDATE_WIDTH));
+	it->def(Xid(UPDATE_HEIGHT),		static_cast<xtal::int_t>(draw_base::UPDATE_HEIGHT));
+	it->def(Xid(UPDATE_ANGLE),		static_cast<xtal::int_t>(draw_base::UPDATE_ANGLE));
+	it->def(Xid(UPDATE_ALPHA),		static_cast<xtal::int_t>(draw_base::UPDATE_ALPHA));
+	it->def(Xid(UPDATE_VISIBLE),	static_cast<xtal::int_t>(draw_base::UPDATE_VISIBLE));
 }
 
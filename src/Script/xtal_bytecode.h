@@ -0,0 +1,54 @@
+﻿#pragma once
+
+namespace mana{
+namespace script{
+
+/*! @brief コンパイル済みXtalコード(.xbc)のヘッダ
+ *
+ *  xtal_manager::precompileで作る。ヘッダの後ろにxtal::Stream::serializeしたデータが並ぶ。
+ *  アーカイブにはソースの代わりにこれを入れておけば、xtal_codeは構文解析とコンパイルをせずに読み込む。
+ *  ソースかどうかは先頭のマジックで判定するので、ファイル名やリソースIDはソースの時のままでよい
+ *
+ *  nSourceHash_はコンパイル元のソースのハッシュ。開発中のキャッシュでも同じハッシュを使う
+ */
+struct xtal_bytecode_header
+{
+	enum bytecode_const : uint32_t
+	{
+		MAGIC	= 0x4342584D, //!< 'MXBC'
+		VERSION	= 1,
+	};
+
+	uint32_t nMagic_;
+	uint32_t nVersion_;
+	uint32_t nSourceHash_;	//!< コンパイル元のソースのハッシュ
+	uint32_t nDataSize_;	//!< ヘッダより後ろのデータサイズ
+
+	//! @brief メモリ上のデータがコンパイル済みコードか
+	/*! ヘッダが正しく、データサイズも合っている時にtrue */
+	static bool		is_bytecode(const void* pData, uint32_t nSize)
+	{
+		if(pData==nullptr || nSize<sizeof(xtal_bytecode_header)) return false;
+
+		const xtal_bytecode_header& head = *static_cast<const xtal_bytecode_header*>(pData);
+		return head.nMagic_==MAGIC
+			&& head.nVersion_==VERSION
+			&& sizeof(xtal_bytecode_header)+head.nDataSize_<=nSize;
+	}
+
+	//! @brief ソースのハッシュ(FNV-1a)
+	/*! @param[in] nHash 続きから計算する時に、前のハッシュを渡す */
+	static uint32_t	hash(const void* pData, uint32_t nSize, uint32_t nHash=2166136261u)
+	{
+		const BYTE* p = static_cast<const BYTE*>(pData);
+		for(uint32_t i=0; i<nSize; ++i)
+		{
+			nHash ^= p[i];
+			nHash *= 16777619u;
+		}
+		return nHash;
+	}
+};
+
+} // namespace script end
+} // namespace mana end
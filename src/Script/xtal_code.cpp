@@ -1,14 +1,29 @@
 ﻿#include "../mana_common.h"
 
+#include "../Concurrent/worker.h"
+#include "../File/file.h"
 #include "../Resource/resource_file.h"
 #include "../Resource/resource_manager.h"
 
+#include "xtal_bytecode.h"
 #include "xtal_manager.h"
 #include "xtal_code.h"
 
 namespace mana{
 namespace script{
 
+struct xtal_code::async_compile
+{
+public:
+	async_compile():bReload_(false),bFail_(false){ bRead_.store(false, std::memory_order_relaxed); }
+
+public:
+	bool				bReload_;	//!< 差し替える時にリロードを通知する
+	std::atomic_bool	bRead_;		//!< TYPE_FILEPATHの時、ワーカーでソースを読み終わった
+	bool				bFail_;		//!< ソースを読めなかった
+	file::file_access	file_;
+};
+
 xtal_code::xtal_code():eState_(NONE),eType_(TYPE_NONE),bReload_(false),pMgr_(nullptr)
 { 
 	vecReloadID_.reserve(8); 
@@ -205,6 +220,7 @@ bool xtal_code::compile_str()
 		xtal::full_gc();
 	}
 
+	vecMember_.clear();
 	pCode_ = xtal::compile(sFile_.c_str());
 	if(!check_xtal_result())
 	{
@@ -229,8 +245,6 @@ bool xtal_code::compile_str()
 
 xtal_code::compile_result xtal_code::compile_stream(BYTE* p, uint32_t size)
 {
-	xtal::PointerStreamPtr stream = xtal::xnew<xtal::PointerStream>(p,size);
-	
 	if(pCode_)
 	{
 		call_bind(false);
@@ -238,11 +252,19 @@ xtal_code::compile_result xtal_code::compile_stream(BYTE* p, uint32_t size)
 		xtal::full_gc();
 	}
 
-	pCode_ = xtal::compile(stream, sFile_.c_str());
+	vecMember_.clear();
+
+	// コンパイル済みコードならそのまま読む
+	if(xtal_bytecode_header::is_bytecode(p, size))
+		pCode_ = pMgr_->load_bytecode(p, size);
+	else
+		pCode_ = pMgr_->compile_source(p, size, sFile_);
 
 	string sErr;
-	if(!check_xtal_result(sErr))
-	{
+	if(!check_xtal_result(sErr) || !pCode_)
+	{// 例外を残さずに空のコードが返ることもある(別のXtalで作ったコンパイル済みコードなど)
+		if(sErr.empty()) sErr = "コードを読み込めませんでした。: " + sFile_;
+
 		bool r = err_("[xtal_code]*** コンパイルエラー ***\n"+sErr);
 		eState_ = ERR;
 		return r ? COMP_REREAD : COMP_ERR;
@@ -273,6 +295,224 @@ bool xtal_code::reload()
 	return true;
 }
 
+xtal::AnyPtr xtal_code::member(const xtal::IDPtr& pName)
+{
+	for(auto& m : vecMember_)
+	{
+		if(m.first.get()==pName.get()) return m.second;
+	}
+
+	if(!pCode_) return xtal::undefined;
+
+	// 見つからなかった時は覚えない。後から定義されることがある
+	xtal::AnyPtr pMember = pCode_->member(pName);
+	if(xtal::is_undefined(pMember)) return pMember;
+
+	vecMember_.emplace_back(pName, pMember);
+	return pMember;
+}
+
+//////////////////////////////////
+
+bool xtal_code::compile_async(bool bReread)
+{
+	return request_async(bReread, false);
+}
+
+bool xtal_code::reload_async()
+{
+	return request_async(true, true);
+}
+
+bool xtal_code::request_async(bool bReread, bool bReload)
+{
+	if(pAsync_ || eState_==COMPILING)
+	{
+		logger::warnln("[xtal_code]コンパイル中です。");
+		return false;
+	}
+
+	auto pAsync = make_shared<async_compile>();
+	pAsync->bReload_ = bReload;
+
+	switch(type())
+	{
+	case TYPE_RESOURCE:
+	{
+		if(!pMgr_->pResource_)
+		{
+			logger::warnln("[xtal_code]リソースタイプが指定されてますが、リソーマネージャーが登録されていません。");
+			return false;
+		}
+
+		string_fw resID(sFile_);
+		if(bReread) pMgr_->pResource_->release_cache(resID);
+
+		// 読み込みはリソースマネージャーが裏でやるので、update_asyncで待つだけ
+		if(pMgr_->pResource_->request(resID)==resource_manager::FAIL)
+		{
+			logger::warnln("[xtal_code]リソースリクエストに失敗しました。");
+			return false;
+		}
+	}
+	break;
+
+	case TYPE_FILEPATH:
+	{
+		string sFile = sFile_;
+		auto read = [pAsync, sFile]()
+		{
+			uint32_t nReadSize;
+			pAsync->bFail_ = !pAsync->file_.open(sFile, file::file_access::READ_ALL) || pAsync->file_.read(nReadSize)==file::file_access::FAIL;
+			pAsync->file_.close();
+			pAsync->bRead_.store(true, std::memory_order_release);
+		};
+
+		auto& pWorker = pMgr_->pWorker_;
+		if(pWorker && !pWorker->is_fin())
+		{
+			// リクエストできなかったら、ここで読む
+			if(pWorker->request(read).expired() && !pAsync->bRead_.load(std::memory_order_acquire))
+				read();
+		}
+		else
+		{
+			read();
+		}
+	}
+	break;
+
+	case TYPE_STR:
+	break;
+
+	default:
+		logger::warnln("[xtal_code]ファイルタイプが設定されてません。");
+	return false;
+	}
+
+	pAsync_ = pAsync;
+	sAsyncErr_.clear();
+	pMgr_->deqAsync_.emplace_back(sID_);
+	return true;
+}
+
+xtal_code::async_result xtal_code::update_async(bool bCompile)
+{
+	if(!pAsync_) return ASYNC_FIN;
+
+	const BYTE*	p=nullptr;
+	uint32_t	nSize=0;
+	shared_ptr<resource_file> pRes;
+
+	switch(type())
+	{
+	case TYPE_RESOURCE:
+	{
+		string_fw resID(sFile_);
+		auto res = pMgr_->pResource_->resource(resID);
+		if(!res && !pMgr_->pResource_->is_fail(resID)) return ASYNC_WAIT;
+
+		if(!res || (*res)->state()!=resource_file::SUCCESS)
+		{
+			sAsyncErr_ = "リソースを読み込めませんでした。: " + sFile_;
+			logger::warnln("[xtal_code]" + sAsyncErr_);
+			if(!pCode_) eState_ = ERR;
+			pAsync_.reset();
+			return ASYNC_FIN;
+		}
+
+		pRes	= *res;
+		p		= pRes->buf().get();
+		nSize	= pRes->filesize();
+	}
+	break;
+
+	case TYPE_FILEPATH:
+		if(!pAsync_->bRead_.load(std::memory_order_acquire)) return ASYNC_WAIT;
+
+		if(pAsync_->bFail_)
+		{
+			sAsyncErr_ = "ファイルを読み込めませんでした。: " + sFile_;
+			logger::warnln("[xtal_code]" + sAsyncErr_);
+			if(!pCode_) eState_ = ERR;
+			pAsync_.reset();
+			return ASYNC_FIN;
+		}
+
+		p		= pAsync_->file_.buf().get();
+		nSize	= pAsync_->file_.filesize();
+	break;
+
+	case TYPE_STR:
+		p		= reinterpret_cast<const BYTE*>(sFile_.c_str());
+		nSize	= sFile_.size();
+	break;
+
+	default: break;
+	}
+
+	if(!bCompile) return ASYNC_WAIT;
+
+	swap_code(p, nSize);
+	pAsync_.reset();
+	return ASYNC_FIN;
+}
+
+bool xtal_code::swap_code(const BYTE* p, uint32_t nSize)
+{
+	// XtalのVMはメインスレッドからしか触れないので、コンパイルもここで行う。重さは1フレーム1つまでにして抑える
+	const bool bReload = pAsync_->bReload_;
+	const string sName = type()==TYPE_STR ? sID_.get() : sFile_;
+
+	xtal::CodePtr pNew;
+	if(xtal_bytecode_header::is_bytecode(p, nSize))
+		pNew = pMgr_->load_bytecode(p, nSize);
+	else
+		pNew = pMgr_->compile_source(p, nSize, sName);
+
+	if(!check_xtal_result(sAsyncErr_) || !pNew)
+	{
+		if(sAsyncErr_.empty()) sAsyncErr_ = "コードを読み込めませんでした。: " + sName;
+
+		logger::warnln("[xtal_code]*** コンパイルエラー *** 動いているコードはそのまま使います。\n" + sAsyncErr_);
+		if(!pCode_) eState_ = ERR;
+		return false;
+	}
+
+	if(bReload)
+	{
+		reload_notify(false);
+		pNew->enable_redefine();
+	}
+
+	// 古いバインドを外してから新しいコードを動かし、動くのを確かめてから入れ替える
+	call_bind(false);
+	if(bind_) bind_(pNew, true);
+	pNew->call();
+	if(!check_xtal_result(sAsyncErr_))
+	{
+		// 新しいバインドを外して、古いバインドを戻す
+		if(bind_) bind_(pNew, false);
+		call_bind(true);
+
+		logger::warnln("[xtal_code]*** 実行に失敗しました *** 動いているコードはそのまま使います。\n" + sAsyncErr_);
+		if(!pCode_) eState_ = ERR;
+
+		// 関連コードには、元のコードのままリロードが終わったことにする
+		if(bReload) reload_notify(true);
+		return false;
+	}
+
+	vecMember_.clear();
+	pCode_	= pNew;
+	eState_	= OK;
+
+	if(bReload) reload_notify(true);
+	return true;
+}
+
+//////////////////////////////////
+
 void xtal_code::reload_notify(bool bAfter)
 {
 	for(auto& id : vecReloadID_)
@@ -280,8 +520,7 @@ void xtal_code::reload_notify(bool bAfter)
 		auto xcode = pMgr_->code(id);
 		if(!xcode || xcode->state()!=OK) continue;
 
-		auto pTargetCode = xcode->code();
-		auto reload_fun = pTargetCode->member(Xid(on_reload));
+		auto reload_fun = xcode->member(Xid(on_reload));
 		if(reload_fun) reload_fun->call(pCode_, bAfter);
 	}
 
@@ -16,10 +16,19 @@ class xtal_manager;
  *  処理を戻した場合は、修正した後にもう一度引数にtrueを渡してcompile/reloadを呼ぶ。
  *  エラーハンドラーが設定されてない時は処理を戻す。
  *
+ *  リソースやファイルの中身がコンパイル済みコード(xtal_bytecode_header)だった時は、
+ *  コンパイルせずに読み込む。
+ *
  *  リロードしたことを関連する他のコードに伝えたい時は、reloadメソッドを使う。
  *  リロード前と後に、関連コードに"on_reload(CodePtr,bool)"という形の関数があれば
  *  それを呼ぶ。CodePtrはリロードする/したcodeで、boolはリロード直前false、リロード後はtrueで
  *　呼ばれる
+ *
+ *  compile_async/reload_asyncを使うと、ソースの読み込みをxtal_managerのワーカーで行い、
+ *  読み終わったらxtal_manager::execのタイミングでコンパイルして差し替える。
+ *  XtalのVMはメインスレッドからしか触れないので、コンパイル自体はメインスレッドで行うが、
+ *  1フレームに1つまでにしてあり、ファイル待ちでフレームが止まることはない。
+ *  コンパイルや実行に失敗した時は、エラーハンドラを呼ばずにasync_errorに入れて、動いているコードはそのまま使い続ける
  */
 class xtal_code
 {
@@ -57,9 +66,18 @@ private:
 		COMP_REREAD,
 	};
 
+	enum async_result
+	{
+		ASYNC_WAIT,		// ソース待ちか、このフレームではコンパイルしない
+		ASYNC_FIN,		// 差し替えたか、失敗した
+	};
+
+	//! 裏でのコンパイル。xtal_code.cppで定義する
+	struct async_compile;
+
 public:
 	xtal_code();
-	~xtal_code(){ call_bind(false); pCode_ = xtal::null; }
+	~xtal_code(){ call_bind(false); vecMember_.clear(); pCode_ = xtal::null; }
 
 public:
 	enum state				state();
@@ -79,6 +97,11 @@ public:
 
 	const xtal::CodePtr&	code(){ return pCode_; }
 
+	//! @brief コードのメンバを取得する
+	/*! 一度取得したメンバは覚えておき、コードが差し替わるまで使い回す。見つからなかったメンバは覚えない。
+	 *  毎フレーム呼ぶスクリプトの関数は、code()->memberで毎回探さずにこちらを使う */
+	xtal::AnyPtr			member(const xtal::IDPtr& pName);
+
 public:
 	//! @param[in] bReread trueだと強制出来にファイルを読み直す
 	//! @return falseが返って来たら、コンパイルリクエスト失敗している
@@ -87,6 +110,19 @@ public:
 	//! またreload時は強制敵にファイルを読み直します
 	bool					reload();
 
+	//! @defgroup xtal_code_async 裏でのコンパイル
+	//! @{
+	//! @brief ソースを裏で読んで、xtal_manager::execでコンパイルして差し替える
+	/*! @return falseが返って来たら、リクエスト失敗している */
+	bool					compile_async(bool bReread=false);
+	//! 差し替える時にリロードを通知する
+	bool					reload_async();
+
+	bool					is_compiling_async()const{ return pAsync_!=nullptr; }
+	//! 最後の裏でのコンパイルのエラー。成功していれば空
+	const string&			async_error()const{ return sAsyncErr_; }
+	//! @}
+
 private:
 	void					set_id(const string_fw& sID){ sID_=sID; }
 	void					call_bind(bool b){ if(bind_ && pCode_) bind_(pCode_, b); } // バインドする時はtrue、外す時はfalse 
@@ -98,6 +134,12 @@ private:
 
 	void					reload_notify(bool bAfter); // リロード前とリロード後の2回呼ばれる
 
+	bool					request_async(bool bReread, bool bReload);
+	//! ソースが読めていればコンパイルして差し替える。bCompileがfalseならコンパイルせずに待つ
+	async_result			update_async(bool bCompile);
+	//! コンパイルして、成功したら差し替える
+	bool					swap_code(const BYTE* p, uint32_t nSize);
+
 private:
 	string_fw			sID_;
 	enum state			eState_;
@@ -108,11 +150,15 @@ private:
 	vector<string_fw>	vecReloadID_; // このxtal_dataをリロードした際にリロードを通知する先
 
 	xtal::CodePtr	pCode_;
+	vector<std::pair<xtal::IDPtr, xtal::AnyPtr>> vecMember_; // memberで取得したメンバ。コードが変わったら捨てる
 	bind_handler	bind_;
 	err_handler		err_;
 
 	bool			bReload_;
 
+	shared_ptr<async_compile>	pAsync_;	// 裏でコンパイル中の時だけある
+	string						sAsyncErr_;
+
 	xtal_manager*	pMgr_;	// 自分自身を管理してるマネージャー
 };
 
@@ -1,10 +1,13 @@
 ﻿#include "../mana_common.h"
 
+#include "../File/file.h"
+
 #include <xtal_lib/xtal_winthread.h>
 #include <xtal_lib/xtal_chcode.h>
 #include <xtal_lib/xtal_errormessage.h>
 
 #include "xtal_lib.h"
+#include "xtal_bytecode.h"
 #include "xtal_code.h"
 #include "xtal_manager.h"
 
@@ -43,7 +46,15 @@ void xtal_manager::fin()
 {
 	if(!bInit_) return;
 
+#ifdef MANA_XTAL_MANAGER_COUNT
+	logger::infoln("[xtal_manager]コンパイル回数 : " + to_str_s(nCompileCount_) + "時間(us) : " + to_str(nCompileMicro_));
+	logger::infoln("[xtal_manager]コンパイル済みコード読み込み回数 : " + to_str_s(nLoadCount_) + "時間(us) : " + to_str_s(nLoadMicro_) + "キャッシュヒット数 : " + to_str(nCacheHitCount_));
+	logger::infoln("[xtal_manager]裏でのコンパイルの差し替え最大時間(us) : " + to_str(nMaxAsyncMicro_));
+#endif
+
+	deqAsync_.clear();
 	mapCode_.clear();
+	clear_bytecode_cache();
 
 	fin_bind();
 
@@ -78,9 +89,41 @@ void xtal_manager::fin_bind()
 
 void xtal_manager::exec()
 {
+	update_async();
 	xtal::gc();
 }
 
+void xtal_manager::update_async()
+{
+	if(deqAsync_.empty()) return;
+
+#ifdef MANA_XTAL_MANAGER_COUNT
+	timer::elapsed_timer t;
+	t.start();
+#endif
+
+	// ソースが読めたものから、1フレームに1つだけコンパイルする
+	bool bCompile=true;
+	for(uint32_t n=deqAsync_.size(); n>0; --n)
+	{
+		string_fw sID = deqAsync_.front();
+		deqAsync_.pop_front();
+
+		auto it = mapCode_.find(sID);
+		if(it==mapCode_.end() || !it->second->is_compiling_async()) continue;
+
+		if(it->second->update_async(bCompile)==xtal_code::ASYNC_FIN)
+			bCompile=false;
+		else
+			deqAsync_.emplace_back(sID);
+	}
+
+#ifdef MANA_XTAL_MANAGER_COUNT
+	t.end();
+	nMaxAsyncMicro_ = (std::max)(nMaxAsyncMicro_, t.elasped_micro());
+#endif
+}
+
 //////////////////////////////////
 
 const shared_ptr<xtal_code>& xtal_manager::create_code(const string_fw& sID)
@@ -121,6 +164,176 @@ const shared_ptr<xtal_code>& xtal_manager::code(const string_fw& sID)
 	return std::move(shared_ptr<xtal_code>());
 }
 
+//////////////////////////////////
+
+bool xtal_manager::precompile(const string& sSrcPath, const string& sDstPath)
+{
+	file::file_access src;
+	uint32_t nReadSize;
+	if(!src.open(sSrcPath, file::file_access::READ_ALL) || src.read(nReadSize)==file::file_access::FAIL)
+	{
+		logger::warnln("[xtal_manager]ソースを読み込めませんでした。: " + sSrcPath);
+		return false;
+	}
+	src.close();
+
+	vector<BYTE> vecBytecode;
+	if(!compile_bytecode(src.buf().get(), src.filesize(), sSrcPath, vecBytecode)) return false;
+
+	file::file_access dst;
+	if(!dst.open(sDstPath, file::file_access::WRITE_STREAM, 0)
+	|| dst.write(vecBytecode.data(), vecBytecode.size())==file::file_access::FAIL)
+	{
+		logger::warnln("[xtal_manager]コンパイル済みコードを書き出せませんでした。: " + sDstPath);
+		return false;
+	}
+
+	return true;
+}
+
+bool xtal_manager::compile_bytecode(const BYTE* p, uint32_t nSize, const string& sName, vector<BYTE>& vecOut)
+{
+	xtal::PointerStreamPtr stream = xtal::xnew<xtal::PointerStream>(p, nSize);
+	xtal::CodePtr pCode = xtal::compile(stream, sName.c_str());
+
+	string sErr;
+	if(!check_xtal_result(sErr))
+	{
+		logger::warnln("[xtal_manager]コンパイルに失敗しました。: " + sName + "\n" + sErr);
+		return false;
+	}
+
+	return serialize_code(pCode, xtal_bytecode_header::hash(p, nSize), vecOut);
+}
+
+xtal::CodePtr xtal_manager::compile_source(const BYTE* p, uint32_t nSize, const string& sName)
+{
+	uint32_t nHash=0;
+	if(bBytecodeCache_)
+	{
+		nHash = xtal_bytecode_header::hash(p, nSize);
+
+		auto it = mapBytecode_.find(nHash);
+		if(it!=mapBytecode_.end() && it->second.nSourceSize_==nSize)
+		{
+#ifdef MANA_XTAL_MANAGER_COUNT
+			++nCacheHitCount_;
+#endif
+			bytecode_entry& e = it->second;
+			xtal::CodePtr pCode = load_bytecode(e.vecCode_.data(), e.vecCode_.size());
+			if(pCode)
+			{// 使ったので一番新しくする
+				listBytecodeLRU_.splice(listBytecodeLRU_.end(), listBytecodeLRU_, e.it_);
+				return pCode;
+			}
+		}
+
+		// ハッシュが同じ別のソースか、読めなかったキャッシュは捨てて、コンパイルし直す
+		if(it!=mapBytecode_.end())
+		{
+			nBytecodeSize_ -= it->second.vecCode_.size();
+			listBytecodeLRU_.erase(it->second.it_);
+			mapBytecode_.erase(it);
+		}
+	}
+
+#ifdef MANA_XTAL_MANAGER_COUNT
+	timer::elapsed_timer t;
+	t.start();
+#endif
+
+	xtal::PointerStreamPtr stream = xtal::xnew<xtal::PointerStream>(p, nSize);
+	xtal::CodePtr pCode = xtal::compile(stream, sName.c_str());
+
+#ifdef MANA_XTAL_MANAGER_COUNT
+	t.end();
+	nCompileMicro_ += t.elasped_micro();
+	++nCompileCount_;
+#endif
+
+	// 失敗していたら、例外を残したまま呼び出し側に返す
+	if(!bBytecodeCache_ || !pCode) return pCode;
+	XTAL_CHECK_EXCEPT(e){ return pCode; }
+
+	vector<BYTE> vecBytecode;
+	if(serialize_code(pCode, nHash, vecBytecode) && vecBytecode.size()<=nBytecodeBudget_)
+	{
+		const uint32_t nCodeSize = vecBytecode.size();
+		evict_bytecode(nCodeSize);
+
+		bytecode_entry& e = mapBytecode_[nHash];
+		e.nSourceSize_	= nSize;
+		e.vecCode_.swap(vecBytecode);
+		e.it_			= listBytecodeLRU_.insert(listBytecodeLRU_.end(), nHash);
+
+		nBytecodeSize_ += nCodeSize;
+	}
+
+	return pCode;
+}
+
+void xtal_manager::evict_bytecode(uint32_t nNeed)
+{
+	while(!listBytecodeLRU_.empty() && nBytecodeSize_+nNeed>nBytecodeBudget_)
+	{
+		auto it = mapBytecode_.find(listBytecodeLRU_.front());
+		if(it!=mapBytecode_.end())
+		{
+			nBytecodeSize_ -= it->second.vecCode_.size();
+			mapBytecode_.erase(it);
+		}
+
+		listBytecodeLRU_.pop_front();
+	}
+}
+
+xtal::CodePtr xtal_manager::load_bytecode(const BYTE* p, uint32_t nSize)
+{
+#ifdef MANA_XTAL_MANAGER_COUNT
+	timer::elapsed_timer t;
+	t.start();
+#endif
+
+	const xtal_bytecode_header& head = *reinterpret_cast<const xtal_bytecode_header*>(p);
+
+	xtal::PointerStreamPtr stream = xtal::xnew<xtal::PointerStream>(p+sizeof(xtal_bytecode_header), head.nDataSize_);
+	xtal::CodePtr pCode = xtal::ptr_cast<xtal::Code>(stream->deserialize());
+
+#ifdef MANA_XTAL_MANAGER_COUNT
+	t.end();
+	nLoadMicro_ += t.elasped_micro();
+	++nLoadCount_;
+#endif
+
+	// 別のXtalで作ったものなどは、例外を残さずに空になることがある
+	if(!pCode) logger::warnln("[xtal_manager]コンパイル済みコードを読み込めませんでした。");
+
+	return pCode;
+}
+
+bool xtal_manager::serialize_code(const xtal::CodePtr& pCode, uint32_t nSourceHash, vector<BYTE>& vecOut)
+{
+	xtal::MemoryStreamPtr stream = xtal::xnew<xtal::MemoryStream>();
+	stream->serialize(pCode);
+	if(!check_xtal_result())
+	{
+		logger::warnln("[xtal_manager]コンパイル済みコードを作れませんでした。");
+		return false;
+	}
+
+	xtal_bytecode_header head;
+	head.nMagic_		= xtal_bytecode_header::MAGIC;
+	head.nVersion_		= xtal_bytecode_header::VERSION;
+	head.nSourceHash_	= nSourceHash;
+	head.nDataSize_		= stream->size();
+
+	vecOut.resize(sizeof(xtal_bytecode_header)+head.nDataSize_);
+	::memcpy(vecOut.data(), &head, sizeof(xtal_bytecode_header));
+	::memcpy(vecOut.data()+sizeof(xtal_bytecode_header), stream->data(), head.nDataSize_);
+
+	return true;
+}
+
 } // namespace script end
 } // namespace mana end
 
@@ -2,6 +2,10 @@
 
 #include "xtal_code.h"
 
+#ifdef MANA_DEBUG
+#define MANA_XTAL_MANAGER_COUNT
+#endif
+
 namespace xtal{
 class ChCodeLib;
 class StdStreamLib;
@@ -12,6 +16,10 @@ class ThreadLib;
 namespace mana{
 class resource_manager;
 
+namespace concurrent{
+class worker;
+} // namespace concurrent end
+
 namespace script{
 
 /*! @brief Xtal全体の管理をするクラス
@@ -20,7 +28,19 @@ namespace script{
  *  resource_managerを設定すると、ファイルの読み込みをresource_managerを介して行える
  *
  *  add_code_infoやcode_infoメソッドでxtal_codeインスタンスを取得し、
- *  取得後はxtal_codeを介して操作する */
+ *  取得後はxtal_codeを介して操作する
+ *
+ *  precompileで、ソースをコンパイル済みコード(xtal_bytecode_header)にして書き出せる。
+ *  xtal_codeはコンパイル済みコードを読むと、コンパイルせずにそのまま使う
+ *
+ *  バイトコードキャッシュを有効にすると、コンパイルした結果をソースのハッシュとサイズで覚えておき、
+ *  同じソースをもう一度コンパイルする時(変更していないスクリプトのreloadなど)は使い回す。
+ *  合計サイズが上限を越えると、最後に使ってから一番時間が経ったものから捨てる
+ *
+ *  xtal_code::compile_asyncで裏でのコンパイルを頼まれたコードは、execで1フレームに1つずつ差し替える
+ *
+ *  コンパイルと読み込みにかかった時間をカウントする時は、
+ *  MANA_XTAL_MANAGER_COUNTをdefineする */
 class xtal_manager
 {
 public:
@@ -29,8 +49,38 @@ public:
 private:
 	typedef unordered_map<string_fw, shared_ptr<xtal_code>, string_fw_hash>	code_map; // IDとdataのマップ
 
+	//! キャッシュしたコンパイル済みコード
+	struct bytecode_entry
+	{
+		uint32_t					nSourceSize_;	//!< ハッシュが衝突しても別のソースを使わないように、サイズも比べる
+		vector<BYTE>				vecCode_;
+		list<uint32_t>::iterator	it_;			//!< listBytecodeLRU_の対応iterator
+	};
+
+	typedef unordered_map<uint32_t, bytecode_entry>	bytecode_map; // ソースのハッシュとコンパイル済みコードのマップ
+
 public:
-	xtal_manager():bInit_(false){}
+	enum xtal_manager_const : uint32_t
+	{
+		DEFAULT_BYTECODE_BUDGET = 4*1024*1024,	//!< バイトコードキャッシュ全体の上限(byte)
+	};
+
+public:
+	xtal_manager():bInit_(false),nBytecodeBudget_(DEFAULT_BYTECODE_BUDGET),nBytecodeSize_(0)
+	{
+#ifdef MANA_DEBUG
+		bBytecodeCache_=true;
+#else
+		bBytecodeCache_=false;
+#endif
+
+#ifdef MANA_XTAL_MANAGER_COUNT
+		nCompileCount_=0; nCompileMicro_=0;
+		nLoadCount_=0; nLoadMicro_=0;
+		nCacheHitCount_=0;
+		nMaxAsyncMicro_=0;
+#endif
+	}
 	~xtal_manager();
 
 public:
@@ -38,8 +88,12 @@ public:
 	void init(const shared_ptr<resource_manager>& pResource=nullptr);
 	void fin();
 
+	//! 毎フレーム呼ぶ。裏でのコンパイルの差し替えとGCを行う
 	void exec();
 
+	//! xtal_code::compile_asyncでソースを読むワーカー。設定されていない時はその場で読む
+	void set_worker(const shared_ptr<concurrent::worker>& pWorker){ pWorker_=pWorker; }
+
 public:
 	//! コード情報を追加する。追加できなかったら、nullptrが返る
 	const shared_ptr<xtal_code>&	create_code(const string_fw& sID);
@@ -48,9 +102,47 @@ public:
 	//! コード情報を取得する。存在してなかたらnullptrが返る
 	const shared_ptr<xtal_code>&	code(const string_fw& sID);
 
+public:
+	//! @defgroup xtal_manager_bytecode コンパイル済みコード
+	//! @{
+	//! @brief ソースファイルをコンパイルして、コンパイル済みコードのファイルを書き出す
+	/*! 出荷用のアーカイブを作る前に、ツールやデバッグビルドから呼ぶ。initの後に使うこと */
+	bool	precompile(const string& sSrcPath, const string& sDstPath);
+	//! @brief ソースをコンパイルして、ヘッダ付きのコンパイル済みコードを作る
+	/*! @param[in] sName エラーメッセージなどに使われる名前 */
+	bool	compile_bytecode(const BYTE* p, uint32_t nSize, const string& sName, vector<BYTE>& vecOut);
+
+	//! バイトコードキャッシュを使うか。MANA_DEBUGの時は最初から有効
+	void	set_bytecode_cache(bool bCache){ bBytecodeCache_=bCache; if(!bCache) clear_bytecode_cache(); }
+	bool	is_bytecode_cache()const{ return bBytecodeCache_; }
+	void	clear_bytecode_cache(){ mapBytecode_.clear(); listBytecodeLRU_.clear(); nBytecodeSize_=0; }
+
+	//! @brief バイトコードキャッシュ全体の上限を設定する
+	/*! 今のサイズが上限を越えていたら、古いものから捨てる */
+	void		set_bytecode_budget(uint32_t nBudget){ nBytecodeBudget_=nBudget; evict_bytecode(0); }
+	uint32_t	bytecode_budget()const{ return nBytecodeBudget_; }
+	//! 今キャッシュしているサイズ(byte)
+	uint32_t	bytecode_size()const{ return nBytecodeSize_; }
+	//! @}
+
+private:
+	//! @brief ソースをコンパイルする。キャッシュが有効なら、同じソースのコンパイル結果を使い回す
+	/*! 失敗した時は、xtalの例外が残っているので呼び出し側でcheck_xtal_resultすること */
+	xtal::CodePtr	compile_source(const BYTE* p, uint32_t nSize, const string& sName);
+	//! @brief ヘッダ付きのコンパイル済みコードを読み込む
+	/*! 読めなかった時は空を返す。xtalの例外が残っていないこともあるので、呼び出し側は空かどうかも見ること */
+	xtal::CodePtr	load_bytecode(const BYTE* p, uint32_t nSize);
+	//! nNeedバイト入るまで、古いキャッシュから捨てる
+	void			evict_bytecode(uint32_t nNeed);
+	//! コンパイル済みのコードを、ヘッダを付けて書き出す
+	bool			serialize_code(const xtal::CodePtr& pCode, uint32_t nSourceHash, vector<BYTE>& vecOut);
+
 private:
 	//! 機種依存のライブラリ部分の初期化
 	void init_lib();
+	//! 裏でのコンパイルを進める
+	void update_async();
+
 	//! 全体で使うものをバインド。xtal初期化直後に呼ばれる
 	void init_bind();
 	//! init_bindでバインドしたクラスの後始末(object_orphenを呼ぶこと)
@@ -63,11 +155,41 @@ private:
 	code_map						mapCode_;
 	shared_ptr<resource_manager>	pResource_;
 
+	bool							bBytecodeCache_;
+	bytecode_map					mapBytecode_;
+	list<uint32_t>					listBytecodeLRU_;	//!< 前にあるほど古い
+	uint32_t						nBytecodeBudget_;
+	uint32_t						nBytecodeSize_;
+
+	shared_ptr<concurrent::worker>	pWorker_;
+	deque<string_fw>				deqAsync_;	//!< 裏でコンパイル中のコードID。頼まれた順
+
 
 	xtal::ChCodeLib*		pCodeLib_;
 	xtal::StdStreamLib*		pStreamLib_;
 	xtal::FilesystemLib*	pFileSystemLib_;
 	xtal::ThreadLib*		pThreadLib_;
+
+#ifdef MANA_XTAL_MANAGER_COUNT
+public:
+	//! ソースからコンパイルした回数と時間(マイクロ秒)
+	uint32_t	compile_count()const{ return nCompileCount_; }
+	int64_t		compile_micro()const{ return nCompileMicro_; }
+	//! コンパイル済みコードを読み込んだ回数と時間(マイクロ秒)。キャッシュからの読み込みも含む
+	uint32_t	load_count()const{ return nLoadCount_; }
+	int64_t		load_micro()const{ return nLoadMicro_; }
+	uint32_t	cache_hit_count()const{ return nCacheHitCount_; }
+	//! 裏でのコンパイルの差し替えで、1フレームに使った最大時間(マイクロ秒)
+	int64_t		max_async_micro()const{ return nMaxAsyncMicro_; }
+
+private:
+	uint32_t	nCompileCount_;
+	int64_t		nCompileMicro_;
+	uint32_t	nLoadCount_;
+	int64_t		nLoadMicro_;
+	uint32_t	nCacheHitCount_;
+	int64_t		nMaxAsyncMicro_;
+#endif
 };
 
 } // namespace script end
@@ -97,6 +219,10 @@ private:
 		while(pTest2->state()==xtal_code::COMPILING);
 	}
 
+	// 出荷用には、コンパイル済みコードを書き出してアーカイブに入れておく。
+	// xtal_code側はソースの時と同じ指定でよい
+	mgr.precompile("script/test.xtal", "pack/script/test.xtal");
+
 	// リロードする時は、ファイルを書き換えた状態でreloadメソッドを呼べば良い
 	// 関連するスクリプトに通知をしたい時は、関連するスクリプトIDを設定しておくと
 	// 対象のスクリプトに定義されているon_reload関数を呼びに行く
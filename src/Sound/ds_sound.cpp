@@ -1,18 +1,27 @@
 ﻿#include "../mana_common.h"
 
 #include "ds_driver.h"
+#include "pcm_cache.h"
 #include "ds_sound.h"
 
 namespace mana{
 namespace sound{
 
-ds_sound::ds_sound():pSoundBuffer_(nullptr),nSoundBufferSize_(0),nSoundDataSize_(0),
+namespace{
+// ソフトウェアゲインでボリュームを即座に変える時に、プチノイズが出ないようにかける時間(ms)
+const uint32_t DECLICK_MS = 5;
+}
+
+ds_sound::ds_sound():pSoundBuffer_(nullptr),nSoundBufferSize_(0),pPcmCache_(nullptr),nSoundDataSize_(0),
 								   bStreaming_(false),nStreamCheckMs_(0),nStreamLastByte_(0),fStreamLoopSec_(0.0f),
 								   eEvent_(sound::EV_END),
 								   bLoop_(false),bEndData_(false),cmdIndex_(0),
 								   fSpeedCur_(1.0f),fPosCur_(0.0f),
 								   bVolUpdate_(false),bSpeedUpdate_(false),bPosUpdate_(false),
-								   nVolFadeFrame_(0),nVolFadeCounter_(0),nStreamElapsedTime_(0)
+								   nVolFadeFrame_(0),nVolFadeCounter_(0),
+								   bFadePending_(false),fFadePendingSec_(0.0f),eFadePendingCurve_(gain_envelope::CURVE_LINEAR),
+								   nStreamElapsedTime_(0),nLastElapsedMs_(DEFAULT_INTERVAL_MS),
+								   bSoftGain_(false),nPlayFrame_(0),nLastPlayPos_(0)
 {
 	init_cmd();
 
@@ -21,8 +30,13 @@ ds_sound::ds_sound():pSoundBuffer_(nullptr),nSoundBufferSize_(0),nSoundDataSize_
 
 void ds_sound::fin()
 {
+	decoder_.fin();
 	reader_.fin();
 	safe_release(pSoundBuffer_);
+
+	bSoftGain_ = false;
+	vecRaw_.clear();
+	vecRaw_.shrink_to_fit();
 }
 
 ///////////////////////////////////////
@@ -40,7 +54,7 @@ void ds_sound::init(const string& sFilename, const volume& vol, bool bStreaming,
 	init_cmd();
 }
 
-bool ds_sound::create_buffer(ds_driver& driver)
+bool ds_sound::create_buffer(ds_driver& driver, pcm_cache* pCache)
 {
 	if(pSoundBuffer_)
 	{
@@ -50,8 +64,10 @@ bool ds_sound::create_buffer(ds_driver& driver)
 
 	uint32_t nStreamSec = nStreamCheckMs_*2 / 1000;
 
+	pPcmCache_ = pCache;
+
 	// サウンドファイルをロードして準備
-	if(!reader_.open(sFilePath_, bStreaming_))
+	if(!open_reader())
 		return false;
 
 	if(reader_.waveformat()->nSamplesPerSec < MIN_SAMPLE_RATE 
@@ -93,6 +109,19 @@ bool ds_sound::create_buffer(ds_driver& driver)
 	nSoundBufferSize_	= desc.dwBufferBytes;
 	nSoundDataSize_		= reader_.data_size();
 
+	// ストリームはバッファ1つ分をワーカーで先読みしておく
+	if(bStreaming_) decoder_.init(&reader_, nSoundBufferSize_);
+
+	// 8bit/16bitのPCMは、ボリュームをPCMに掛けてから書き込む
+	bSoftGain_ = gain_envelope::is_support(*desc.lpwfxFormat);
+	if(bSoftGain_)
+	{
+		vecRaw_.resize(nSoundBufferSize_);
+		env_.set(volCur_.amp());
+		nPlayFrame_		= 0;
+		nLastPlayPos_	= 0;
+	}
+
 	// 最初のデータ書き込み
 	if(!full_sound_buffer(true))
 	{
@@ -124,6 +153,8 @@ bool ds_sound::update(uint32_t nElapsedMillSec)
 {
 	HRESULT r;
 
+	if(nElapsedMillSec>0) nLastElapsedMs_ = nElapsedMillSec;
+
 	// 現在の情報を反映
 	update_volume();
 	update_speed();
@@ -153,6 +184,14 @@ bool ds_sound::update(uint32_t nElapsedMillSec)
 			if(bStreaming_)	flag = DSBPLAY_LOOPING;
 		}
 
+		decoder_.set_loop(bLoop_, fStreamLoopSec_);
+
+		// 再生前に来たフェードは、ここから始める
+		if(bFadePending_)
+			update_pending_fade(true);
+		else if(bSoftGain_ && !bStreaming_)
+			rebake(); // 一括読みは前の再生の時のゲインが残っているので掛け直す
+
 		r = pSoundBuffer_->Play(0,0,flag);
 
 		if(r==DSERR_BUFFERLOST)
@@ -191,11 +230,47 @@ bool ds_sound::update(uint32_t nElapsedMillSec)
 	// コマンド変更
 	if(next_cmd().eMode_!=MODE_NONE) swap_cmd();
 
+	// 再生が始まらなかったので、取っておいたフェードをすぐに反映する
+	if(bFadePending_) update_pending_fade(false);
+
 	// 再生処理
 	if(is_play())
 	{
+		if(bSoftGain_)
+		{// 再生したフレームを進める
+			DWORD plyPos;
+			if(SUCCEEDED(pSoundBuffer_->GetCurrentPosition(&plyPos, NULL)))
+				update_play_frame(plyPos);
+		}
+
 		// Fadeボリューム処理
-		if(nVolFadeFrame_>0 && (nVolFadeCounter_<=nVolFadeFrame_))
+		if(bSoftGain_)
+		{// ゲインはサンプル単位で変化させてるので、終わったかだけ見る
+			if(nVolFadeFrame_>0 && env_.is_end(nPlayFrame_))
+			{
+				if(volFade_.per()==0)
+				{// 音量0になったらSTOP
+					volCur_ = volFadeBase_; // 音量は元に戻す
+					env_.set(volCur_.amp());
+					cur_cmd().eMode_=MODE_STOP;
+					stop_sound_buffer();
+					rebake();
+				}
+				else
+				{// 一括読みはバッファを繰り返し鳴らすので、フェード途中のゲインが残らないよう掛け直す
+					env_.set(volFade_.amp());
+					if(!bStreaming_) rebake();
+
+					cur_cmd().eMode_ = bLoop_ ? MODE_PLAY_LOOP : MODE_PLAY;
+				}
+				nVolFadeFrame_ = 0;
+			}
+			else if(nVolFadeFrame_>0 && bLoop_ && !bStreaming_)
+			{// ループする一括読みは、一周前に書いたゲインがまた鳴るので毎回掛け直す
+				rebake();
+			}
+		}
+		else if(nVolFadeFrame_>0 && (nVolFadeCounter_<=nVolFadeFrame_))
 		{
 			float sub = ((volFade_.per() - volFadeBase_.per()) / static_cast<float>(nVolFadeFrame_));
 			float volPer = static_cast<float>(volFadeBase_.per()) + sub * nVolFadeCounter_;
@@ -290,12 +365,74 @@ void ds_sound::pause()
 
 void ds_sound::fade_volume(const volume& fadeVol, uint32_t nFadeFrame)
 {
+	if(bSoftGain_)
+	{// 直近のupdate間隔で時間に換算する
+		fade_volume(fadeVol, nFadeFrame*nLastElapsedMs_/1000.0f, gain_envelope::CURVE_LINEAR);
+		return;
+	}
+
 	volFadeBase_		= volCur_;
 	volFade_			= fadeVol;
 	nVolFadeFrame_		= nFadeFrame;
 	nVolFadeCounter_	= 0;
 }
 
+void ds_sound::fade_volume(const volume& fadeVol, float fFadeSec, gain_envelope::curve eCurve)
+{
+	if(!bSoftGain_)
+	{// DirectSoundのボリュームで段階的に変える
+		fade_volume(fadeVol, static_cast<uint32_t>((std::max)(fFadeSec*1000.0f/nLastElapsedMs_, 1.0f)));
+		return;
+	}
+
+	if(!is_play() && next_cmd().eMode_!=MODE_PLAY && next_cmd().eMode_!=MODE_PLAY_LOOP)
+	{// 再生命令がフェードの後に来ることがあるので、次のupdateまで取っておく
+		bFadePending_		= true;
+		volFadePending_		= fadeVol;
+		fFadePendingSec_	= fFadeSec;
+		eFadePendingCurve_	= eCurve;
+		return;
+	}
+
+	bFadePending_ = false;
+
+	int64_t nFrame = write_frame();
+
+	// set_volumeがまだ反映されてなければ、そこから始める
+	float fFrom = bVolUpdate_ ? volCur_.amp() : env_.gain(nFrame);
+	bVolUpdate_ = false;
+
+	if(nVolFadeFrame_==0) volFadeBase_ = volCur_; // フェード中なら、フェード前のボリュームを残す
+	volFade_			= fadeVol;
+	volCur_				= fadeVol;
+	nVolFadeFrame_		= 1; // ソフトウェアゲインの時はフェード中フラグとして使う
+	nVolFadeCounter_	= 0;
+
+	uint32_t nLength = static_cast<uint32_t>((std::max)(fFadeSec, 0.0f) * reader_.waveformat()->nSamplesPerSec);
+	env_.ramp(fFrom, fadeVol.amp(), nFrame, nLength, eCurve);
+
+	rebake();
+}
+
+void ds_sound::update_pending_fade(bool bPlay)
+{
+	bFadePending_ = false;
+
+	if(bPlay)
+	{// 再生待ちなので、そのままフェードが始まる
+		fade_volume(volFadePending_, fFadePendingSec_, eFadePendingCurve_);
+		return;
+	}
+
+	// 再生しないならフェードする意味がないので、すぐに変える
+	volCur_			= volFadePending_;
+	bVolUpdate_		= false;
+	nVolFadeFrame_	= 0;
+	env_.set(volCur_.amp());
+
+	rebake();
+}
+
 void ds_sound::set_volume(const volume& vol)
 {
 	if(volCur_.db()==vol.db()) return;
@@ -322,7 +459,27 @@ void ds_sound::update_volume()
 	if(!bVolUpdate_) return;
 
 	if(is_create_buffer())
-		pSoundBuffer_->SetVolume(volCur_.db());
+	{
+		if(bSoftGain_)
+		{
+			if(is_play())
+			{// 書き込める位置から少しだけかけて変える
+				int64_t nFrame = write_frame();
+				env_.ramp(env_.gain(nFrame), volCur_.amp(), nFrame, reader_.waveformat()->nSamplesPerSec*DECLICK_MS/1000);
+			}
+			else
+			{// 鳴っていないのでプチノイズは出ない。この後のフェードがこの音量から始まるように、すぐに変える
+				env_.set(volCur_.amp());
+			}
+			nVolFadeFrame_ = 0;
+
+			rebake();
+		}
+		else
+		{
+			pSoundBuffer_->SetVolume(volCur_.db());
+		}
+	}
 
 	bVolUpdate_ = false;
 }
@@ -352,11 +509,20 @@ void ds_sound::update_pos()
 		else
 		{
 			DWORD nPos = static_cast<DWORD>(reader_.waveformat()->nAvgBytesPerSec * fPosCur_);
+			nPos -= nPos % reader_.waveformat()->nBlockAlign; // Blockアライン
 
 			HRESULT r = 0;
 
 			if(nPos < nSoundBufferSize_)
+			{
 				r = pSoundBuffer_->SetCurrentPosition(nPos);
+
+				if(bSoftGain_)
+				{// 再生位置が変わったので、ゲインを掛け直す
+					nLastPlayPos_ = nPos;
+					rebake();
+				}
+			}
 		}
 	}
 
@@ -376,15 +542,29 @@ void ds_sound::init_cmd()
 ///////////////////////////////////////
 // サウンドバッファへの書き込み
 ///////////////////////////////////////
+bool ds_sound::open_reader()
+{
+	if(!bStreaming_ && pPcmCache_)
+	{// 短いoggはデコード済みのものを使い回す
+		if(reader_.open(pPcmCache_->load(sFilePath_)))
+			return true;
+	}
+
+	return reader_.open(sFilePath_, bStreaming_);
+}
+
 bool ds_sound::full_sound_buffer(bool bBegin)
 {
+	// 先読み中ならリーダーを触る前に止める
+	decoder_.wait();
+
 	bool bOpen=false;
 	// ファイルを閉じちゃってたら読み出す
 	if(bStreaming_ && !reader_.is_open()
 	||!bStreaming_ && reader_.data()==nullptr)
 	{
 		bOpen=true;
-		if(!reader_.open(sFilePath_, bStreaming_))
+		if(!open_reader())
 			return false; // 読み込み失敗したら終了
 	}
 
@@ -414,11 +594,30 @@ bool ds_sound::full_sound_buffer(bool bBegin)
 		if(bStreaming_) nWriteSize = static_cast<DWORD>(nWriteSize * 0.9f);
 	}
 
-	uint32_t rsize = reader_.read(reinterpret_cast<BYTE*>(pData), nWriteSize, bLoop_, fStreamLoopSec_);
+	// ソフトウェアゲインの時は、一旦vecRaw_に読んでからゲインを掛ける
+	BYTE* pWrite = bSoftGain_ ? vecRaw_.data() : reinterpret_cast<BYTE*>(pData);
+
+	uint32_t rsize = reader_.read(pWrite, nWriteSize, bLoop_, fStreamLoopSec_);
+
+	// 書き込んだ続きから先読みし直す
+	decoder_.reset(reader_.is_data_file_end());
 
 	if(rsize<nWriteSize)
 	{// 足りない所は無音(0)で埋めておく
-		memset(&reinterpret_cast<BYTE*>(pData)[rsize], 0, nSoundBufferSize_-rsize);
+		memset(&pWrite[rsize], 0, nSoundBufferSize_-rsize);
+	}
+
+	if(bSoftGain_)
+	{
+		DWORD nPlayPos = 0;
+		if(bBegin)
+			nLastPlayPos_ = 0; // 再生位置を先頭にする
+		else if(SUCCEEDED(pSoundBuffer_->GetCurrentPosition(&nPlayPos, NULL)))
+			update_play_frame(nPlayPos);
+
+		// 再生位置の前後で分けて書く
+		write_gain(&reinterpret_cast<BYTE*>(pData)[nPlayPos], nPlayPos, nSoundBufferSize_-nPlayPos, nPlayPos);
+		write_gain(reinterpret_cast<BYTE*>(pData), 0, nPlayPos, nPlayPos);
 	}
 	
 	pSoundBuffer_->Unlock(pData, rsize, NULL, 0);
@@ -435,6 +634,9 @@ bool ds_sound::full_sound_buffer(bool bBegin)
 
 	if(bBegin) pSoundBuffer_->SetCurrentPosition(0);
 
+	decoder_.set_loop(bLoop_, fStreamLoopSec_);
+	decoder_.prefetch();
+
 	return true;
 }
 
@@ -444,6 +646,8 @@ bool ds_sound::stream_sound_buffer()
 	HRESULT r = pSoundBuffer_->GetCurrentPosition(&plyPos, &wrtPos);
 	if(!check_hresult(r,"[ds_sound]再生位置が取得できませんでした。")) return false;
 
+	if(bSoftGain_) update_play_frame(plyPos);
+
 	// ループ指定なしで終了フラグ立ってたら終了チェック
 	if(bEndData_)
 	{
@@ -507,24 +711,38 @@ bool ds_sound::stream_sound_buffer()
 
 	if(!check_hresult(r)) return false; // Lockできないことが正しい位置に書くことを保証するのでエラーを許容する
 
-	nDataSize[0] = reader_.read(pData[0], nSize[0], bLoop_, fStreamLoopSec_);
-	if(reader_.is_data_file_end())
+	// ソフトウェアゲインの時は、一旦vecRaw_に読んでからゲインを掛ける
+	BYTE* pRaw[2]={pData[0],pData[1]};
+	if(bSoftGain_)
+	{
+		pRaw[0] = &vecRaw_[writeStart[0]];
+		if(pData[1]!=NULL) pRaw[1] = vecRaw_.data();
+	}
+
+	nDataSize[0] = read_stream(pRaw[0], nSize[0]);
+	if(is_stream_end())
 	{
 		bEndData_=true;
 		// 残りを無音0で埋めておく
-		memset(&pData[0][nDataSize[0]], 0, nSize[0]-nDataSize[0]);
+		memset(&pRaw[0][nDataSize[0]], 0, nSize[0]-nDataSize[0]);
 	}
 	else if(pData[1]!=NULL)
 	{
-		nDataSize[1] = reader_.read(pData[1], nSize[1], bLoop_, fStreamLoopSec_);
-		if(reader_.is_data_file_end())
+		nDataSize[1] = read_stream(pRaw[1], nSize[1]);
+		if(is_stream_end())
 		{
 			bEndData_=true;
 			// 残りを無音0で埋めておく
-			memset(&pData[1][nDataSize[1]], 0, nSize[1]-nDataSize[1]);
+			memset(&pRaw[1][nDataSize[1]], 0, nSize[1]-nDataSize[1]);
 		}
 	}
 
+	if(bSoftGain_)
+	{
+		write_gain(pData[0], writeStart[0], nSize[0], plyPos);
+		if(pData[1]!=NULL) write_gain(pData[1], 0, nSize[1], plyPos);
+	}
+
 	pSoundBuffer_->Unlock(pData[0], nDataSize[0], pData[1], nDataSize[1]);
 
 	// 最後の書き込み位置を設定
@@ -538,9 +756,104 @@ bool ds_sound::stream_sound_buffer()
 
 	nStreamElapsedTime_ = 0; // 書き込み時間リセット
 
+	// 読んだ分を先読みしておく
+	decoder_.prefetch();
+
 	return true;
 }
 
+///////////////////////////////////////
+// ソフトウェアゲイン
+///////////////////////////////////////
+void ds_sound::update_play_frame(DWORD nPlayPos)
+{
+	DWORD nDiff = nPlayPos>=nLastPlayPos_ ? nPlayPos-nLastPlayPos_ : nSoundBufferSize_-nLastPlayPos_+nPlayPos;
+
+	nPlayFrame_	  += nDiff / reader_.waveformat()->nBlockAlign;
+	nLastPlayPos_  = nPlayPos;
+}
+
+int64_t ds_sound::frame_at(DWORD nPos, DWORD nPlayPos)const
+{
+	DWORD nDiff = nPos>=nPlayPos ? nPos-nPlayPos : nSoundBufferSize_-nPlayPos+nPos;
+	return nPlayFrame_ + nDiff / reader_.waveformat()->nBlockAlign;
+}
+
+int64_t ds_sound::write_frame()
+{
+	if(!is_create_buffer()) return nPlayFrame_;
+
+	DWORD plyPos,wrtPos;
+	if(FAILED(pSoundBuffer_->GetCurrentPosition(&plyPos, &wrtPos))) return nPlayFrame_;
+
+	update_play_frame(plyPos);
+	return frame_at(wrtPos, plyPos);
+}
+
+void ds_sound::write_gain(BYTE* pDst, DWORD nPos, DWORD nSize, DWORD nPlayPos)
+{
+	if(nSize==0) return;
+	env_.apply(pDst, &vecRaw_[nPos], nSize, *reader_.waveformat(), frame_at(nPos, nPlayPos));
+}
+
+void ds_sound::rebake()
+{
+	if(!bSoftGain_ || !is_create_buffer()) return;
+
+	DWORD plyPos,wrtPos,status=0;
+	HRESULT r = pSoundBuffer_->GetCurrentPosition(&plyPos, &wrtPos);
+	if(!check_hresult(r,"[ds_sound]再生位置が取得できませんでした。")) return;
+
+	update_play_frame(plyPos);
+	pSoundBuffer_->GetStatus(&status);
+
+	BYTE* pData[2]={NULL,NULL};
+	DWORD nSize[2]={0,0};
+
+	if(bit_test<uint32_t>(status,DSBSTATUS_PLAYING))
+	{// 再生中は、書き込める位置から再生位置の手前まで
+		DWORD nWrite = plyPos>wrtPos ? plyPos-wrtPos : nSoundBufferSize_-wrtPos+plyPos;
+
+		r = pSoundBuffer_->Lock(wrtPos, nWrite,
+								reinterpret_cast<void**>(&pData[0]), &nSize[0],
+								reinterpret_cast<void**>(&pData[1]), &nSize[1],
+								0);
+		if(!check_hresult(r)) return;
+
+		write_gain(pData[0], wrtPos, nSize[0], plyPos);
+		if(pData[1]!=NULL) write_gain(pData[1], 0, nSize[1], plyPos);
+	}
+	else
+	{// 止まってたら全部。再生位置の前後で分けて書く
+		r = pSoundBuffer_->Lock(0, 0,
+								reinterpret_cast<void**>(&pData[0]), &nSize[0],
+								NULL, NULL,
+								DSBLOCK_ENTIREBUFFER);
+		if(!check_hresult(r)) return;
+
+		write_gain(&pData[0][plyPos], plyPos, nSize[0]-plyPos, plyPos);
+		write_gain(pData[0], 0, plyPos, plyPos);
+	}
+
+	pSoundBuffer_->Unlock(pData[0], nSize[0], pData[1], nSize[1]);
+}
+
+uint32_t ds_sound::read_stream(BYTE* pBuf, uint32_t nSize)
+{
+	if(decoder_.is_active())
+		return decoder_.read(pBuf, nSize);
+
+	return reader_.read(pBuf, nSize, bLoop_, fStreamLoopSec_);
+}
+
+bool ds_sound::is_stream_end()const
+{
+	if(decoder_.is_active())
+		return decoder_.is_data_end();
+
+	return reader_.is_data_file_end();
+}
+
 bool ds_sound::stop_sound_buffer()
 {
 	pSoundBuffer_->Stop();
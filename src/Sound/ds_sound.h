@@ -2,10 +2,13 @@
 
 #include "sound_util.h"
 #include "sound_file_reader.h"
+#include "stream_decoder.h"
+#include "gain_envelope.h"
 
 namespace mana{
 namespace sound{
 class ds_driver;
+class pcm_cache;
 
 struct sound_cmd
 {
@@ -33,10 +36,17 @@ public:
 	 *  @param[in] bStreamingLoopSec ストリーミングのループする時の先頭位置
 	 *  @param[in] nStreamSec ストリーミング時に確保する秒数(sec) */
 	void init(const string& sFilename, const volume& vol, bool bStreaming, float fStreamLoopSec=0.0f, uint32_t nStreamSec=STREAM_SECONDS);
+	//! baseと同じファイルを鳴らすボイスとして初期化パラメータを登録する
+	void init(const ds_sound& base, const volume& vol){ init(base.sFilePath_, vol, base.bStreaming_, base.fStreamLoopSec_, base.nStreamCheckMs_*2/1000); }
 
 	//! @brief バッファを作成し、サウンド再生の準備をする
-	/*! @param[in] driver DirectSoundドライバー */
-	bool create_buffer(ds_driver& driver);
+	/*! @param[in] driver DirectSoundドライバー
+	 *  @param[in] pCache 一括読みの時に使うデコード済みPCMキャッシュ。nullptrだと毎回ファイルから読む */
+	bool create_buffer(ds_driver& driver, pcm_cache* pCache=nullptr);
+
+	//! @brief ストリーム再生の先読みに使うワーカーを設定する
+	/*! create_bufferより前に呼ぶこと。設定しないとサウンドスレッドで読み込む */
+	void set_worker(const shared_ptr<concurrent::worker>& pWorker){ decoder_.set_worker(pWorker); }
 
 	//! イベントハンドラ設定
 	void set_event_handler(const function<void(play_event)>& handler);
@@ -51,6 +61,11 @@ public:
 	void stop();
 	void pause();
 	void fade_volume(const volume& fadeVol, uint32_t nFadeFrame);
+	//! @brief 時間指定でフェードする
+	/*! ソフトウェアゲインの時は、サンプル単位でeCurveに沿って変化する。
+	 *  再生中でも再生待ちでもない時は、次のupdateまで取っておき、
+	 *  そこで再生が始まれば再生の頭からフェードする。始まらなければすぐにfadeVolにする */
+	void fade_volume(const volume& fadeVol, float fFadeSec, gain_envelope::curve eCurve);
 
 	// パラメータ系は即座に反映される
 	void set_volume(const volume& vol);
@@ -73,10 +88,16 @@ public:
 	//! 対応するファイルパス
 	const string& filepath()const{ return sFilePath_; }
 
+	//! @brief ボリュームをPCMに掛けているか
+	/*! 8bit/16bitのPCMの時は、DirectSoundのボリュームを使わずに
+	 *  サウンドバッファに書く時にゲインを掛ける */
+	bool is_soft_gain()const{ return bSoftGain_; }
+
 private:
 	void update_volume();
 	void update_speed();
 	void update_pos();
+	void update_pending_fade(bool bPlay); // 再生前に来たフェードを、再生するなら始めて、しないならすぐに反映する
 
 private:
 	//! @defgroup sound_cmd コマンドバッファ操作
@@ -89,8 +110,20 @@ private:
 	void				swap_cmd(){ cmdIndex_^=1; next_cmd().eMode_=MODE_NONE; }
 	//! @}
 
+	bool		open_reader();	// サウンドファイルを開く。キャッシュにあればそっちを使う
 	bool		full_sound_buffer(bool bBegin); // サウンドバッファへの最初のデータ書き込み
 	bool		stream_sound_buffer();
+	uint32_t	read_stream(BYTE* pBuf, uint32_t nSize); // 先読みしてればそっちから読む
+	bool		is_stream_end()const;
+
+	//! @defgroup ds_sound_soft_gain ソフトウェアゲイン
+	//! @{
+	void		update_play_frame(DWORD nPlayPos);								// 再生位置の進みをnPlayFrame_に足す
+	int64_t		frame_at(DWORD nPos, DWORD nPlayPos)const;						// バッファ位置nPosが再生されるフレーム
+	int64_t		write_frame();													// 今から書き込める位置のフレーム
+	void		write_gain(BYTE* pDst, DWORD nPos, DWORD nSize, DWORD nPlayPos);	// vecRaw_のnPosからゲインを掛けて書く
+	void		rebake();														// 書き込み済みでまだ再生されていない範囲を書き直す
+	//! @}
 	bool		stop_sound_buffer();
 
 private:
@@ -99,6 +132,8 @@ private:
 
 	string					sFilePath_;
 	sound_file_reader		reader_;
+	pcm_cache*				pPcmCache_;
+	stream_decoder			decoder_;	//!< ストリーム再生の先読み
 	uint32_t				nSoundDataSize_;
 
 	bool					bStreaming_;
@@ -129,9 +164,24 @@ private:
 	volume					volFade_;			//!< フェード先ボリューム
 	uint32_t				nVolFadeFrame_;		//!< フェードフレーム
 	uint32_t				nVolFadeCounter_;	//!< フェードカウンタ
+
+	bool					bFadePending_;		//!< 再生前にフェードが来ている
+	volume					volFadePending_;	//!< 再生前に来たフェードのフェード先
+	float					fFadePendingSec_;	//!< 再生前に来たフェードの時間(秒)
+	gain_envelope::curve	eFadePendingCurve_;	//!< 再生前に来たフェードのカーブ
 	//! @}
 
 	uint32_t				nStreamElapsedTime_; // 最後にバッファに書き込んでからの経過時間
+	uint32_t				nLastElapsedMs_;	 // 直近のupdate間隔。フレーム指定のフェードを時間に換算する
+
+	//! @defgroup ds_sound_soft_gain_param ソフトウェアゲイン用パラメータ
+	//! @{
+	bool					bSoftGain_;
+	gain_envelope			env_;			//!< 再生したフレームに対するゲイン
+	vector<BYTE>			vecRaw_;		//!< ゲインを掛ける前のPCM。サウンドバッファと同じ並び
+	int64_t					nPlayFrame_;	//!< 再生したフレーム数
+	DWORD					nLastPlayPos_;	//!< nPlayFrame_を最後に進めた時の再生位置
+	//! @}
 
 public:
 	static void set_enable_sample_rate(uint32_t nMin, uint32_t nMax);
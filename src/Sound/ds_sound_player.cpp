@@ -37,6 +37,7 @@ bool ds_sound_player::init(HWND hWnd, uint32_t nReserveSoundNum, bool bHighQuari
 void ds_sound_player::fin()
 {
 	hashSound_.clear();
+	pcmCache_.clear();
 	safe_release(pSilentBuffer_);
 
 	driver_.fin();
@@ -76,7 +77,8 @@ bool ds_sound_player::add_sound_info(const string& sID, const string& sFilePath,
 {
 	uint32_t nID = soundIdMgr_.assign_id(sID);
 
-	auto r = hashSound_.emplace(nID, sound_info());
+	// ds_soundはコピーできないので、その場で作る
+	auto r = hashSound_.emplace(std::piecewise_construct, std::forward_as_tuple(nID), std::forward_as_tuple());
 
 	if(!r.second)
 	{
@@ -84,6 +86,8 @@ bool ds_sound_player::add_sound_info(const string& sID, const string& sFilePath,
 		if(bReDefine_)
 		{// リロード時は強制リリースして上書きする
 			r.first->second.snd_.release_force();
+			pcmCache_.erase(r.first->second.snd_.filepath());
+			erase_voice(nID);
 		}
 		else
 		{
@@ -120,17 +124,15 @@ void ds_sound_player::remove_sound_info(uint32_t nID)
 	if(it!=hashSound_.end())
 	{
 		soundIdMgr_.erase_id(nID);
-		
-		if(it->second.it_!=listSound_.end())
-			listSound_.erase(it->second.it_);
 
-		hashSound_.erase(it);
+		erase_voice(nID);
+		erase_sound(hashSound_.find(nID));
 	}
 }
 
 bool ds_sound_player::is_sound_info(uint32_t nID)const
 {
-	sound_hash::const_iterator it = hashSound_.find(nID);
+	sound_hash::const_iterator it = hashSound_.find(voice_sound_id(nID));
 	return it!=hashSound_.end();
 }
 
@@ -213,7 +215,7 @@ void ds_sound_player::play(uint32_t nID, bool bLoop)
 	
 	pSnd->play(bLoop);
 
-	if(!pSnd->is_play()) activeSound_.emplace_back(pSnd);
+	if(!pSnd->is_play()) activate(pSnd);
 }
 
 void ds_sound_player::stop(uint32_t nID)
@@ -240,6 +242,23 @@ void ds_sound_player::fade_volume(uint32_t nID, const volume& fadeVol, uint32_t
 	if(pSnd->is_play()) pSnd->fade_volume(fadeVol,nFadeFrame);
 }
 
+void ds_sound_player::fade_volume(uint32_t nID, const volume& fadeVol, float fFadeSec, gain_envelope::curve eCurve)
+{
+	ds_sound* pSnd = sound(nID);
+	if(pSnd==nullptr) return;
+
+	pSnd->fade_volume(fadeVol, fFadeSec, eCurve);
+
+	// 再生前のフェードは次のupdateで反映されるので、止まっていてもupdateさせる
+	if(!pSnd->is_play()) activate(pSnd);
+}
+
+void ds_sound_player::activate(ds_sound* pSnd)
+{
+	if(std::find(activeSound_.begin(), activeSound_.end(), pSnd)==activeSound_.end())
+		activeSound_.emplace_back(pSnd);
+}
+
 void ds_sound_player::set_volume(uint32_t nID, const volume& vol)
 {
 	ds_sound* pSnd = sound(nID);
@@ -269,7 +288,10 @@ play_mode ds_sound_player::sound_play_mode(uint32_t nID)const
 	auto it = hashSound_.find(nID);
 	if(it==hashSound_.end())
 	{
-		logger::warnln("[ds_sound_player]指定されたサウンドの情報がありません。: " + nID);
+		// まだ鳴らしてないボイスは停止扱い
+		if(voice_no(nID)>0 && is_sound_info(nID)) return MODE_STOP;
+
+		logger::warnln("[ds_sound_player]指定されたサウンドの情報がありません。: " + to_str(nID));
 		return MODE_ERR;
 	}
 
@@ -301,8 +323,18 @@ ds_sound* ds_sound_player::sound(uint32_t nID)
 	sound_hash::iterator it = hashSound_.find(nID);
 	if(it==hashSound_.end())
 	{
-		logger::warnln("[ds_sound_player]指定されたサウンドの情報がありません。: " + sound_id(nID));
-		return nullptr;
+		sound_hash::iterator bit = voice_no(nID)>0 ? hashSound_.find(voice_sound_id(nID)) : hashSound_.end();
+		if(bit==hashSound_.end())
+		{
+			logger::warnln("[ds_sound_player]指定されたサウンドの情報がありません。: " + sound_id(nID));
+			return nullptr;
+		}
+
+		// 初めて使うボイスは、元のサウンド情報からサウンド情報を作る
+		const ds_sound& base = bit->second.snd_;
+		it = hashSound_.emplace(std::piecewise_construct, std::forward_as_tuple(nID), std::forward_as_tuple()).first;
+		it->second.snd_.init(base, defaultVolume_);
+		it->second.it_ = listSound_.end();
 	}
 
 	sound_info& info = it->second;
@@ -311,7 +343,8 @@ ds_sound* ds_sound_player::sound(uint32_t nID)
 	// バッファ作って無かったら作成
 	if(!snd.is_create_buffer())
 	{
-		if(!snd.create_buffer(driver_))
+		snd.set_worker(pStreamWorker_);
+		if(!snd.create_buffer(driver_, &pcmCache_))
 			return nullptr;
 	}
 	else
@@ -349,6 +382,32 @@ void ds_sound_player::limit_sound()
 	}
 }
 
+void ds_sound_player::erase_sound(sound_hash::iterator it)
+{
+	if(it==hashSound_.end()) return;
+
+	sound_info& info = it->second;
+	if(info.it_!=listSound_.end())
+		listSound_.erase(info.it_);
+
+	activeSound_.remove(&info.snd_);
+
+	hashSound_.erase(it);
+}
+
+void ds_sound_player::erase_voice(uint32_t nID)
+{
+	list<uint32_t> removeVoices;
+	for(auto& it : hashSound_)
+	{
+		if(voice_no(it.first)>0 && voice_sound_id(it.first)==nID)
+			removeVoices.push_back(it.first);
+	}
+
+	for(auto rv : removeVoices)
+		erase_sound(hashSound_.find(rv));
+}
+
 void ds_sound_player::create_silent_sound(bool bHighQuarity)
 {
 	LPDIRECTSOUNDBUFFER pBuffer;
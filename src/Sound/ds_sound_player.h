@@ -5,6 +5,7 @@
 #include "sound_util.h"
 #include "ds_sound.h"
 #include "ds_driver.h"
+#include "pcm_cache.h"
 
 namespace mana{
 namespace sound{
@@ -17,6 +18,10 @@ namespace sound{
  *  サウンド情報を登録して、サウンド命令メソッドを呼ぶと再生などが
  *  行われる。
  *
+ *  サウンド命令にボイスID(sound::voice_id)を渡すと、同じサウンドを
+ *  別のサウンドバッファで重ねて鳴らせる。ボイスのバッファも
+ *  通常のサウンドと同じく最大サウンド数の管理対象になる。
+ *
  *  最大サウンド数を指定すると、サウンドバッファ作成数をできるだけ
  *  その範囲内で収めようとする。ただし、再生中のサウンドを止めてまで
  *  削除はしないので、再生状況によっては最大サウンド数を超えることも
@@ -64,6 +69,20 @@ public:
 	//! 保持しておく最大サウンドバッファ数。この値を越えるとバッファが解放される
 	void set_max_sound_buffer_num(uint32_t nMax){ if(nMax>0) nMaxSoundBufferNum_=nMax; }
 
+	//! @brief デコード済みPCMキャッシュの設定
+	/*! 一括読みのoggは、デコード後のサイズがnThreshold以下ならデコード結果をキャッシュして、
+	 *  バッファを作り直す時に使い回す。nBudgetを0にするとキャッシュしない
+	 *  @param[in] nBudget キャッシュ全体の上限(byte)
+	 *  @param[in] nThreshold キャッシュ対象にする1サウンドの上限(byte) */
+	void set_pcm_cache(uint32_t nBudget, uint32_t nThreshold=pcm_cache::DEFAULT_THRESHOLD){ pcmCache_.set_budget(nBudget); pcmCache_.set_threshold(nThreshold); }
+
+	pcm_cache&	pcm(){ return pcmCache_; }
+
+	//! @brief ストリーム再生の先読みに使うワーカーを設定する
+	/*! 設定すると、ストリーム再生のデコードはワーカーで行われる。
+	 *  設定後に作られたサウンドバッファから有効 */
+	void set_stream_worker(const shared_ptr<concurrent::worker>& pWorker){ pStreamWorker_=pWorker; }
+
 	//! サウンド情報追加
 	bool add_sound_info(const string& sID, const string& sFilePath, bool bStreaming, float fStreamLoopSec=0.0f, uint32_t nStreamSec=STREAM_SECONDS);
 
@@ -77,7 +96,7 @@ public:
 
 	//! サウンドID変換
 	optional<uint32_t>	sound_id(const string& sID){ return soundIdMgr_.id(sID); }
-	const string&		sound_id(uint32_t nID){ return soundIdMgr_.id(nID); }
+	const string&		sound_id(uint32_t nID){ return soundIdMgr_.id(voice_sound_id(nID)); }
 
 	//! @brief サウンド情報ファイルを読み込んで、サウンド情報を登録する
 	/*! @param[in] sFilePath サウンド情報ファイルへのパス。もしくはサウンド情報文字列 
@@ -98,6 +117,9 @@ public:
 
 	void fade_volume(uint32_t nID, const volume& fadeVol, uint32_t nFadeFrame);
 	void fade_volume(const string& sID, const volume& fadeVol, uint32_t nFadeFrame){ auto n = sound_id(sID); if(n) fade_volume(*n, fadeVol, nFadeFrame); }
+	//! 秒数でフェードする。同じupdateの中でplayより前に呼ぶと、再生を始めたところからフェードする
+	void fade_volume(uint32_t nID, const volume& fadeVol, float fFadeSec, gain_envelope::curve eCurve=gain_envelope::CURVE_LINEAR);
+	void fade_volume(const string& sID, const volume& fadeVol, float fFadeSec, gain_envelope::curve eCurve=gain_envelope::CURVE_LINEAR){ auto n = sound_id(sID); if(n) fade_volume(*n, fadeVol, fFadeSec, eCurve); }
 
 	void set_volume(uint32_t nID, const volume& vol);
 	void set_volume(const string& sID, const volume& vol){ auto n = sound_id(sID); if(n) set_volume(*n,vol); }
@@ -124,6 +146,15 @@ private:
 	//! サウンド数をnMaxSoundNum_以下に留める
 	void		limit_sound();
 
+	//! 有効なサウンドリストに入れて、updateが呼ばれるようにする。もう入っていれば何もしない
+	void		activate(ds_sound* pSnd);
+
+	//! @brief サウンド情報を削除する
+	/*! 再生中のリストとLRUリストからも外す */
+	void		erase_sound(sound_hash::iterator it);
+	//! nIDのボイスをすべて削除する
+	void		erase_voice(uint32_t nID);
+
 	//! 無音のサウンドを作り再生する
 	void		create_silent_sound(bool bHighQuarity);
 
@@ -134,6 +165,9 @@ private:
 	//! デフォルトボリューム。ds_soundを作成する際に渡される音量
 	volume				defaultVolume_;
 
+	//! デコード済みPCMキャッシュ。ds_soundから参照されるのでhashSound_より前に置く
+	pcm_cache			pcmCache_;
+
 	//! サウンドハッシュ
 	sound_hash			hashSound_;
 	//! 数値IDとサウンドID対応テーブル
@@ -148,6 +182,9 @@ private:
 	// 保持しておく最大サウンドバッファ数
 	uint32_t			nMaxSoundBufferNum_;
 
+	//! ストリーム再生の先読みに使うワーカー
+	shared_ptr<concurrent::worker> pStreamWorker_;
+
 	//! 停止時ノイズ対策用の無音バッファ
 	LPDIRECTSOUNDBUFFER8 pSilentBuffer_;
 
@@ -0,0 +1,89 @@
+﻿#include "../mana_common.h"
+
+#include "gain_envelope.h"
+
+namespace mana{
+namespace sound{
+
+void gain_envelope::ramp(float fFrom, float fTo, int64_t nStart, uint32_t nLength, curve eCurve)
+{
+	eCurve_		= eCurve;
+	fFrom_		= fFrom;
+	fTo_		= fTo;
+	nStart_		= nStart;
+	nLength_	= nLength;
+}
+
+float gain_envelope::gain(int64_t nFrame)const
+{
+	if(nFrame>=end_frame())	return fTo_;
+	if(nFrame<=nStart_)		return fFrom_;
+
+	float t = static_cast<float>(nFrame-nStart_) / static_cast<float>(nLength_);
+
+	switch(eCurve_)
+	{
+	case CURVE_EQUAL_POWER:
+	{
+		const float HALF_PI = 1.5707963f;
+		return fFrom_*std::cos(t*HALF_PI) + fTo_*std::sin(t*HALF_PI);
+	}
+
+	case CURVE_CUSTOM:
+		if(customCurve_) t = clamp(customCurve_(t), 0.0f, 1.0f);
+	break;
+
+	default: break;
+	}
+
+	return fFrom_ + (fTo_-fFrom_)*t;
+}
+
+void gain_envelope::apply(BYTE* pDst, const BYTE* pSrc, uint32_t nByte, const WAVEFORMATEX& fmt, int64_t nFrame)const
+{
+	const uint32_t nChannel	= fmt.nChannels;
+	const uint32_t nAlign	= fmt.nBlockAlign;
+	const uint32_t nFrameNum= nByte / nAlign;
+
+	// 全部変化の範囲外なら一定のゲインで済む
+	bool  bConst = nFrame>=end_frame() || nFrame+nFrameNum<=nStart_;
+	float fConst = gain(nFrame);
+
+	if(bConst && fConst==1.0f)
+	{
+		if(pDst!=pSrc) ::memcpy(pDst, pSrc, nByte);
+		return;
+	}
+
+	if(fmt.wBitsPerSample==16)
+	{
+		const int16_t*	pIn	 = reinterpret_cast<const int16_t*>(pSrc);
+		int16_t*		pOut = reinterpret_cast<int16_t*>(pDst);
+
+		for(uint32_t i=0; i<nFrameNum; ++i)
+		{
+			float g = bConst ? fConst : gain(nFrame+i);
+			for(uint32_t c=0; c<nChannel; ++c, ++pIn, ++pOut)
+				*pOut = static_cast<int16_t>(clamp(static_cast<int32_t>(*pIn*g), -32768, 32767));
+		}
+	}
+	else
+	{// 8bitは128が無音
+		const BYTE*	pIn	 = pSrc;
+		BYTE*		pOut = pDst;
+
+		for(uint32_t i=0; i<nFrameNum; ++i)
+		{
+			float g = bConst ? fConst : gain(nFrame+i);
+			for(uint32_t c=0; c<nChannel; ++c, ++pIn, ++pOut)
+				*pOut = static_cast<BYTE>(clamp(128 + static_cast<int32_t>((*pIn-128)*g), 0, 255));
+		}
+	}
+
+	// ブロックに満たない端数はそのまま
+	uint32_t nRest = nByte - nFrameNum*nAlign;
+	if(nRest>0 && pDst!=pSrc) ::memcpy(&pDst[nByte-nRest], &pSrc[nByte-nRest], nRest);
+}
+
+} // namespace sound end
+} // namespace mana end
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+namespace mana{
+namespace sound{
+
+/*! @brief サンプル単位のゲインエンベロープ
+ *
+ *  時間をサンプル数(フレーム)で持つので、フレームレートやupdate間隔に関係なく
+ *  フェードの長さが決まる。PCMにサンプルごとにゲインを掛けるので、
+ *  ボリュームを段階的に変えた時のジッパーノイズが出ない
+ *
+ *  fFromからfToへnLengthフレームかけて変化させる。範囲外ではそれぞれの値のまま
+ */
+class gain_envelope
+{
+public:
+	enum curve : uint32_t
+	{
+		CURVE_LINEAR,		//!< 線形
+		CURVE_EQUAL_POWER,	//!< 等パワー。クロスフェードで合計の音量が下がらない
+		CURVE_CUSTOM,		//!< set_custom_curveで設定した関数
+	};
+
+public:
+	gain_envelope():eCurve_(CURVE_LINEAR),fFrom_(1.0f),fTo_(1.0f),nStart_(0),nLength_(0){}
+
+	//! 一定のゲインにする
+	void		set(float fGain){ fFrom_=fTo_=fGain; nLength_=0; }
+
+	//! @brief ゲインを変化させる
+	/*! @param[in] fFrom 開始時のゲイン
+	 *  @param[in] fTo 終了時のゲイン
+	 *  @param[in] nStart 開始するフレーム
+	 *  @param[in] nLength 変化にかけるフレーム数 */
+	void		ramp(float fFrom, float fTo, int64_t nStart, uint32_t nLength, curve eCurve=CURVE_LINEAR);
+
+	//! @brief CURVE_CUSTOMの時に使う関数を設定する
+	/*! 0.0～1.0の経過割合を受け取り、0.0(fFrom)～1.0(fTo)の割合を返すこと */
+	void		set_custom_curve(const function<float(float)>& curve){ customCurve_=curve; }
+
+	//! nFrameでのゲイン
+	float		gain(int64_t nFrame)const;
+
+	//! nFrameで変化が終わっているか
+	bool		is_end(int64_t nFrame)const{ return nFrame >= end_frame(); }
+	int64_t		end_frame()const{ return nStart_+nLength_; }
+	float		end_gain()const{ return fTo_; }
+
+	//! @brief PCMにゲインを掛けて書き込む
+	/*! @param[out] pDst 書き込み先。pSrcと同じでもよい
+	 *  @param[in] pSrc 元のPCM
+	 *  @param[in] nByte バイト数
+	 *  @param[in] fmt PCMのフォーマット。is_supportがtrueのもの
+	 *  @param[in] nFrame pSrcの先頭のフレーム */
+	void		apply(BYTE* pDst, const BYTE* pSrc, uint32_t nByte, const WAVEFORMATEX& fmt, int64_t nFrame)const;
+
+	//! ゲインを掛けられるフォーマットか。8bit/16bitのPCMのみ
+	static bool	is_support(const WAVEFORMATEX& fmt){ return fmt.wFormatTag==WAVE_FORMAT_PCM && (fmt.wBitsPerSample==8 || fmt.wBitsPerSample==16); }
+
+private:
+	curve						eCurve_;
+	float						fFrom_;
+	float						fTo_;
+	int64_t						nStart_;
+	uint32_t					nLength_;
+
+	function<float(float)>		customCurve_;
+};
+
+} // namespace sound end
+} // namespace mana end
+
+/*
+	// 1秒かけて等パワーでフェードアウトする
+	sound::gain_envelope env;
+	env.ramp(1.0f, 0.0f, nNowFrame, wvFmt.nSamplesPerSec, sound::gain_envelope::CURVE_EQUAL_POWER);
+	env.apply(pBuf, pBuf, nSize, wvFmt, nNowFrame);
+ */
@@ -0,0 +1,178 @@
+﻿#include "../mana_common.h"
+
+#include "sound_file_reader.h"
+#include "pcm_cache.h"
+
+namespace mana{
+namespace sound{
+
+void pcm_cache::fin()
+{
+#ifdef MANA_PCM_CACHE_COUNT
+	logger::infoln("[pcm_cache]キャッシュヒット数 : " + to_str_s(nHitCount_) + "デコード回数 : " + to_str_s(nDecodeCount_) + "時間(us) : " + to_str(nDecodeMicro_));
+	logger::infoln("[pcm_cache]破棄数 : " + to_str_s(nEvictCount_) + "使用サイズ : " + to_str(nUsedSize_));
+#endif
+
+	clear();
+}
+
+void pcm_cache::set_budget(uint32_t nBudget)
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	nBudget_ = nBudget;
+	evict(0);
+}
+
+uint32_t pcm_cache::budget()const
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+	return nBudget_;
+}
+
+void pcm_cache::set_threshold(uint32_t nThreshold)
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+	nThreshold_ = nThreshold;
+}
+
+uint32_t pcm_cache::threshold()const
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+	return nThreshold_;
+}
+
+uint32_t pcm_cache::used_size()const
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+	return nUsedSize_;
+}
+
+shared_ptr<const pcm_data> pcm_cache::load(const string& sFilePath)
+{
+	if(sound_file_reader::format(sFilePath)!=sound_file_reader::FMT_OGG)
+		return shared_ptr<const pcm_data>();
+
+	uint32_t nThreshold, nBudget;
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+
+		nThreshold	= nThreshold_;
+		nBudget		= nBudget_;
+
+		auto it = mapPcm_.find(sFilePath);
+		if(it!=mapPcm_.end())
+		{// 使ったので一番新しくする
+			listLRU_.splice(listLRU_.end(), listLRU_, it->second.it_);
+
+		#ifdef MANA_PCM_CACHE_COUNT
+			++nHitCount_;
+		#endif
+
+			return it->second.pData_;
+		}
+
+		// 前にサイズで弾いたものは、閾値か上限が広がっていなければ開かない
+		auto rej = mapReject_.find(sFilePath);
+		if(rej!=mapReject_.end())
+		{
+			if(rej->second>nThreshold || rej->second>nBudget)
+				return shared_ptr<const pcm_data>();
+
+			mapReject_.erase(rej);
+		}
+	}
+
+	// デコードは時間がかかるのでロックの外でやる
+#ifdef MANA_PCM_CACHE_COUNT
+	timer::elapsed_timer t;
+	t.start();
+#endif
+
+	sound_file_reader reader;
+	if(!reader.open(sFilePath, false))
+		return shared_ptr<const pcm_data>();
+
+	if(reader.data_size()>nThreshold || reader.data_size()>nBudget)
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+		mapReject_[sFilePath] = reader.data_size();
+		return shared_ptr<const pcm_data>();
+	}
+
+	shared_ptr<pcm_data> pData = make_shared<pcm_data>();
+	if(!reader.decode(*pData))
+		return shared_ptr<const pcm_data>();
+
+#ifdef MANA_PCM_CACHE_COUNT
+	t.end();
+#endif
+
+	std::lock_guard<std::mutex> lock(mtx_);
+
+#ifdef MANA_PCM_CACHE_COUNT
+	++nDecodeCount_;
+	nDecodeMicro_ += t.elasped_micro();
+#endif
+
+	// 他のスレッドが先に登録していたらそっちを使う
+	auto it = mapPcm_.find(sFilePath);
+	if(it!=mapPcm_.end()) return it->second.pData_;
+
+	uint32_t nSize = pData->vecData_.size();
+	evict(nSize);
+
+	entry& e = mapPcm_[sFilePath];
+	e.pData_ = pData;
+	e.it_	 = listLRU_.insert(listLRU_.end(), sFilePath);
+
+	nUsedSize_ += nSize;
+
+	return pData;
+}
+
+void pcm_cache::erase(const string& sFilePath)
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	mapReject_.erase(sFilePath);
+
+	auto it = mapPcm_.find(sFilePath);
+	if(it==mapPcm_.end()) return;
+
+	nUsedSize_ -= it->second.pData_->vecData_.size();
+	listLRU_.erase(it->second.it_);
+	mapPcm_.erase(it);
+}
+
+void pcm_cache::clear()
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	mapPcm_.clear();
+	listLRU_.clear();
+	mapReject_.clear();
+	nUsedSize_ = 0;
+}
+
+void pcm_cache::evict(uint32_t nNeed)
+{
+	while(!listLRU_.empty() && nUsedSize_+nNeed>nBudget_)
+	{
+		auto it = mapPcm_.find(listLRU_.front());
+		if(it!=mapPcm_.end())
+		{
+			nUsedSize_ -= it->second.pData_->vecData_.size();
+			mapPcm_.erase(it);
+
+		#ifdef MANA_PCM_CACHE_COUNT
+			++nEvictCount_;
+		#endif
+		}
+
+		listLRU_.pop_front();
+	}
+}
+
+} // namespace sound end
+} // namespace mana end
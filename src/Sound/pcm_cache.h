@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#ifdef MANA_DEBUG
+#define MANA_PCM_CACHE_COUNT
+#endif
+
+namespace mana{
+namespace sound{
+
+//! デコード済みPCMデータ
+struct pcm_data
+{
+public:
+	pcm_data(){ ::ZeroMemory(&wvFmt_, sizeof(wvFmt_)); wvFmt_.cbSize = sizeof(wvFmt_); }
+
+public:
+	WAVEFORMATEX	wvFmt_;
+	vector<BYTE>	vecData_;
+};
+
+/*! @brief デコード済みPCMキャッシュ
+ *
+ *  短いogg vorbisを一度だけPCMにデコードして、ファイルパスをキーに保持しておく。
+ *  SEのように何度もバッファを作り直すサウンドで、その度にデコードしなくて済む。
+ *
+ *  デコード後のサイズが閾値以下のものだけが対象。
+ *  合計サイズが上限を越えると、最後に使ってから一番時間が経ったものから捨てる。
+ *  捨てられても使用中のpcm_dataは解放されないので、使う側はshared_ptrを持っている間だけ使うこと
+ *
+ *  特定のサウンドバックエンドには依存しないので、ds_sound_player以外からも使える。
+ *  ロックしているので、複数スレッドから使ってもよい */
+class pcm_cache
+{
+public:
+	enum cache_const : uint32_t
+	{
+		DEFAULT_BUDGET		= 16*1024*1024,	//!< キャッシュ全体の上限(byte)
+		DEFAULT_THRESHOLD	= 1024*1024,	//!< キャッシュ対象にする1サウンドの上限(byte)。16bitステレオ44.1kHzで約6秒
+	};
+
+public:
+	pcm_cache():nBudget_(DEFAULT_BUDGET),nThreshold_(DEFAULT_THRESHOLD),nUsedSize_(0)
+	{
+#ifdef MANA_PCM_CACHE_COUNT
+		nHitCount_=0;
+		nDecodeCount_=0; nDecodeMicro_=0;
+		nEvictCount_=0;
+#endif
+	}
+	~pcm_cache(){ fin(); }
+
+	//! 終了処理
+	void fin();
+
+	//! @brief キャッシュ全体の上限を設定する
+	/*! 今のサイズが上限を越えていたら、古いものから捨てる */
+	void		set_budget(uint32_t nBudget);
+	uint32_t	budget()const;
+
+	//! キャッシュ対象にする、デコード後のサイズの上限を設定する
+	void		set_threshold(uint32_t nThreshold);
+	uint32_t	threshold()const;
+
+	//! 今キャッシュしているサイズ(byte)
+	uint32_t	used_size()const;
+
+	//! @brief デコード済みPCMを取得する
+	/*! キャッシュに無ければデコードして登録する。
+	 *  oggでない、サイズが閾値を越えている、デコードに失敗した時は空を返すので、
+	 *  その時は普通にファイルから読むこと。
+	 *  サイズで弾いたファイルは覚えておき、閾値か上限が変わるまで開き直さない */
+	shared_ptr<const pcm_data> load(const string& sFilePath);
+
+	//! キャッシュから削除する。ファイルが更新された時などに使う。サイズで弾いた記録も消す
+	void		erase(const string& sFilePath);
+
+	//! キャッシュを全部削除する
+	void		clear();
+
+private:
+	//! nNeedバイト入るまで古いものから捨てる。ロックしてから呼ぶこと
+	void		evict(uint32_t nNeed);
+
+private:
+	struct entry
+	{
+		shared_ptr<const pcm_data>	pData_;
+		list<string>::iterator		it_;	//!< listLRU_の対応iterator
+	};
+
+	mutable std::mutex				mtx_;
+
+	unordered_map<string, entry>	mapPcm_;
+	list<string>					listLRU_;	//!< 前にあるほど古い
+	unordered_map<string, uint32_t>	mapReject_;	//!< サイズで弾いたファイルと、そのデコード後のサイズ
+
+	uint32_t						nBudget_;
+	uint32_t						nThreshold_;
+	uint32_t						nUsedSize_;
+
+#ifdef MANA_PCM_CACHE_COUNT
+public:
+	//! キャッシュヒット数
+	uint32_t	hit_count()const{ return nHitCount_; }
+	//! デコードした回数と時間(マイクロ秒)
+	uint32_t	decode_count()const{ return nDecodeCount_; }
+	int64_t		decode_micro()const{ return nDecodeMicro_; }
+	//! 上限を越えて捨てた数
+	uint32_t	evict_count()const{ return nEvictCount_; }
+
+private:
+	uint32_t	nHitCount_;
+	uint32_t	nDecodeCount_;
+	int64_t		nDecodeMicro_;
+	uint32_t	nEvictCount_;
+#endif
+
+private:
+	NON_COPIABLE(pcm_cache);
+};
+
+} // namespace sound end
+} // namespace mana end
+
+/*
+	sound::pcm_cache cache;
+	cache.set_budget(8*1024*1024);
+
+	shared_ptr<const sound::pcm_data> pPcm = cache.load("se/jump.ogg");
+
+	sound::sound_file_reader reader;
+	if(pPcm) reader.open(pPcm);
+	else     reader.open("se/jump.ogg", false);
+ */
@@ -1,6 +1,7 @@
 ﻿#include "../mana_common.h"
 
 #include "sound_file_reader.h"
+#include "pcm_cache.h"
 
 namespace mana{
 namespace sound{
@@ -19,18 +20,14 @@ bool sound_file_reader::open(const string& sFilePath, bool bStream)
 
 	file_.set_filepath(sFilePath);
 
-	if(file_.filepath().ext()=="wav")
-		eFormat_ = FMT_WAV;
-	else if(file_.filepath().ext()=="ogg" || file_.filepath().ext()=="oga")
-		eFormat_ = FMT_OGG;
+	eFormat_ = format(sFilePath);
 
-	if(eFormat_==FMT_NONE)
+	if(eFormat_==FMT_NONE || eFormat_==FMT_PCM)
 	{
 		logger::warnln("[sound_file_reader]未対応サウンドフォーマットです。: " + to_str(file_.filepath().filename()));
 		file_.set_filepath("");
 		return false;
 	}
-	OV_EREAD;
 	bStream_ = bStream;
 
 	file::file_access::op_mode eOp;
@@ -75,10 +72,62 @@ bool sound_file_reader::open(const string& sFilePath, bool bStream)
 	return r;
 }
 
-BYTE* sound_file_reader::data()
+bool sound_file_reader::open(const shared_ptr<const pcm_data>& pPcm)
+{
+	fin();
+
+	if(!pPcm) return false;
+
+	pPcm_		= pPcm;
+	nPcmPos_	= 0;
+	bStream_	= false;
+	eFormat_	= FMT_PCM;
+	wvFmt_		= pPcm_->wvFmt_;
+	nDataSize_	= pPcm_->vecData_.size();
+
+	return true;
+}
+
+bool sound_file_reader::decode(pcm_data& pcm)
+{
+	if(bStream_ || eFormat_==FMT_NONE) return false;
+
+	pcm.wvFmt_ = wvFmt_;
+	pcm.vecData_.resize(nDataSize_);
+
+	if(nDataSize_==0) return true;
+
+	if(!seek_time(0.0f)) return false;
+
+	uint32_t rsize = read(pcm.vecData_.data(), nDataSize_, false);
+	if(rsize==0)
+	{
+		logger::warnln("[sound_file_reader]デコードできませんでした。: " + file_.filepath().filename());
+		return false;
+	}
+
+	pcm.vecData_.resize(rsize);
+	return true;
+}
+
+sound_file_reader::sound_format sound_file_reader::format(const string& sFilePath)
+{
+	string sExt = file::path(sFilePath).ext();
+
+	if(sExt=="wav")
+		return FMT_WAV;
+	else if(sExt=="ogg" || sExt=="oga")
+		return FMT_OGG;
+
+	return FMT_NONE;
+}
+
+const BYTE* sound_file_reader::data()const
 {
 	if(bStream_) return nullptr;
 
+	if(eFormat_==FMT_PCM) return pPcm_->vecData_.data();
+
 	if(eFormat_==FMT_WAV)
 	{
 		BYTE* pBuf = file_.buf().get();
@@ -95,7 +144,30 @@ uint32_t sound_file_reader::read(BYTE* pBuf, uint32_t nBufSize, bool bLoop, floa
 {
 	uint32_t rsize=0;
 
-	if(eFormat_==FMT_WAV)
+	if(eFormat_==FMT_PCM)
+	{
+		while(rsize<nBufSize)
+		{
+			uint32_t n = (std::min)(nBufSize-rsize, nDataSize_-nPcmPos_);
+			if(n>0)
+			{
+				::memcpy(&pBuf[rsize], &pPcm_->vecData_[nPcmPos_], n);
+				rsize	 += n;
+				nPcmPos_ += n;
+			}
+
+			if(nPcmPos_<nDataSize_) break;
+
+			// データ終端
+			bEndFile_=true;
+			if(!bLoop) break;
+
+			// ループ。戻った先にデータが無い時は無限ループになるので抜ける
+			if(!seek_time(fLoopSec) || nPcmPos_>=nDataSize_) break;
+			bEndFile_=false;
+		}
+	}
+	else if(eFormat_==FMT_WAV)
 	{
 		int32_t r = file_.read(rsize, pBuf, nBufSize);
 		if(!r) return 0;
@@ -161,7 +233,15 @@ bool sound_file_reader::seek_time(float fSec)
 {
 	bool ret=false;
 
-	if(eFormat_==FMT_WAV)
+	if(eFormat_==FMT_PCM)
+	{
+		uint32_t nSeek = static_cast<uint32_t>((std::max)(fSec,0.0f) * wvFmt_.nAvgBytesPerSec);
+		nSeek -= nSeek % wvFmt_.nBlockAlign; // Blockアライン
+
+		nPcmPos_ = (std::min)(nSeek, nDataSize_);
+		ret = true;
+	}
+	else if(eFormat_==FMT_WAV)
 	{
 		// wavの時は、バイト変換する
 		int32_t nSeek = static_cast<int32_t>(fSec * waveformat()->nAvgBytesPerSec);
@@ -205,6 +285,9 @@ void sound_file_reader::close()
 
 	if(eFormat_==FMT_OGG) ov_clear(&ovFile_);
 
+	pPcm_.reset();
+	nPcmPos_ = 0;
+
 	eFormat_= FMT_NONE;
 
 	bEndFile_	  = false;
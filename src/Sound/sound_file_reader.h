@@ -6,11 +6,12 @@
 
 namespace mana{
 namespace sound{
+struct pcm_data;
 
 /*! @brief サウンドファイルを読み込んでフォーマットを解析して必要な情報を取り出す
  *
  *  対応フォーマットは、waveとogg vorbis
- *  ogg vorbisはストリーム読みのみ対応
+ *  pcm_cacheでデコード済みのPCMを渡すと、ファイルの代わりにそれを読む
  */
 class sound_file_reader
 {
@@ -24,11 +25,12 @@ public:
 	{
 		FMT_WAV,
 		FMT_OGG,
+		FMT_PCM,	//!< デコード済みPCM
 		FMT_NONE,
 	};
 
 public:
-	sound_file_reader():bStream_(false),bEndFile_(false),eFormat_(FMT_NONE),nDataSize_(0),nDataFilePos_(0){ ::ZeroMemory(&wvFmt_,sizeof(wvFmt_)); wvFmt_.cbSize = sizeof(wvFmt_); }
+	sound_file_reader():bStream_(false),bEndFile_(false),eFormat_(FMT_NONE),nDataSize_(0),nDataFilePos_(0),nPcmPos_(0){ ::ZeroMemory(&wvFmt_,sizeof(wvFmt_)); wvFmt_.cbSize = sizeof(wvFmt_); }
 	~sound_file_reader(){ fin(); }
 
 	//! 終了処理
@@ -41,7 +43,18 @@ public:
 	 *  @return 未対応フォーマットだったり、WAVEフォーマットが上手く読めなかったら失敗する */
 	bool open(const string& sFilePath, bool bStream);
 
-	bool is_open()const{ return file_.is_open(); }
+	//! @brief デコード済みPCMを読むように初期化する
+	/*! @param[in] pPcm pcm_cacheから取得したPCM。closeするまで保持する */
+	bool open(const shared_ptr<const pcm_data>& pPcm);
+
+	bool is_open()const{ return file_.is_open() || pPcm_; }
+
+	//! @brief サウンドデータを全部PCMにデコードする
+	/*! 一括読みでopenした後に呼ぶこと。読み込み位置は末尾になる */
+	bool decode(pcm_data& pcm);
+
+	//! 拡張子からフォーマットを判定する
+	static sound_format format(const string& sFilePath);
 
 	//! 設定したファイルのWAVEフォーマットを取得する
 	//! このポインタはそのままDSBUFFERDESCに渡して良い
@@ -64,8 +77,8 @@ public:
 	//! ファイルを閉じる。読み込み済みのバッファも解放する
 	void		close();
 
-	//! サウンドデータを取得する。MODE_ALLの時のみ有効
-	BYTE*		data();
+	//! サウンドデータを取得する。一括読みのwavか、デコード済みPCMの時のみ有効
+	const BYTE*	data()const;
 	//! サウンドデータサイズ
 	uint32_t	data_size()const{ return nDataSize_; }
 	//! データの終わりに到達
@@ -90,6 +103,9 @@ private:
 	int32_t				nDataFilePos_;  //!< データへの先頭ファイル位置
 
 	OggVorbis_File		ovFile_;
+
+	shared_ptr<const pcm_data>	pPcm_;
+	uint32_t					nPcmPos_;	//!< デコード済みPCMの読み込み位置
 };
 
 } // namespace sound end
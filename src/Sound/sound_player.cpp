@@ -29,6 +29,11 @@ bool sound_player::init_driver(HWND hWnd, uint32_t nReserveSoundNum, bool bHighQ
 	return true;
 }
 
+void sound_player::set_stream_worker(const shared_ptr<concurrent::worker>& pWorker)
+{
+	pPlayer_->set_stream_worker(pWorker);
+}
+
 optional<uint32_t> sound_player::sound_id(const string& sID)
 {
 	return pPlayer_->sound_id(sID);
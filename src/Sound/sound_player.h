@@ -4,6 +4,10 @@
 #include "sound_player_cmd.h"
 
 namespace mana{
+namespace concurrent{
+class worker;
+} // namespace concurrent end
+
 namespace sound{
 
 class ds_sound_player;
@@ -30,6 +34,11 @@ public:
 									  0だと解放しない。 */
 	bool init_driver(HWND hWnd, uint32_t nReserveSoundNum=DEFAULT_MAX_INFO_NUM, bool bHighQuarity=true, uint32_t nMaxSoundBufferNum=DEFAULT_MAX_BUFFER_NUM);
 
+	//! @brief ストリーム再生の先読みに使うワーカーを設定する
+	/*! 設定すると、ストリーム再生のファイル読み込み・デコードがサウンドスレッドで行われなくなる。
+	 *  init_playerより前に呼ぶこと */
+	void set_stream_worker(const shared_ptr<concurrent::worker>& pWorker);
+
 	//! @brief プレイヤー初期化
 	/*! @param[in] fIntervalMs サウンド処理の実行間隔(ms)。非同期版の時のみ有効
 	 * @param[in] nReserveRequestNum 積むリクエストの推定数
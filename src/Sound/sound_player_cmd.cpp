@@ -84,7 +84,10 @@ void sound_player_exec::operator()(play_cmd_cmd& cmd)const
 
 void sound_player_exec::operator()(volume_fade_cmd& cmd)const
 {
-	player_.fade_volume(cmd.nID_,cmd.vol_,cmd.nFrame_);
+	if(cmd.fSec_>0.0f)
+		player_.fade_volume(cmd.nID_,cmd.vol_,cmd.fSec_,cmd.eCurve_);
+	else
+		player_.fade_volume(cmd.nID_,cmd.vol_,cmd.nFrame_);
 }
 
 void sound_player_exec::operator()(param_cmd& cmd)const
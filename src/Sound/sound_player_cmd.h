@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "sound_util.h"
+#include "gain_envelope.h"
 
 namespace mana{
 namespace sound{
@@ -90,12 +91,15 @@ public:
 struct volume_fade_cmd
 {
 public:
-	volume_fade_cmd():nID_(0),nFrame_(0){}
+	volume_fade_cmd():nID_(0),nFrame_(0),fSec_(0.0f),eCurve_(gain_envelope::CURVE_LINEAR){}
 
 public:
 	uint32_t nID_;
 	volume	 vol_;
-	uint32_t nFrame_;
+	uint32_t nFrame_;	//!< サウンドのupdate回数でフェードする
+	float	 fSec_;		//!< 0より大きいと、nFrame_の代わりに秒数でフェードする
+
+	gain_envelope::curve eCurve_;	//!< fSec_の時のフェードカーブ
 };
 
 // 各種パラメタ変更
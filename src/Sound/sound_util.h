@@ -35,6 +35,23 @@ enum const_param
 	DEFAULT_INTERVAL_MS		=	1000/30,//!< デフォルトインターバルms
 };
 
+///////////////////////////////
+//! @defgroup sound_voice_id ボイスID
+//! 同じサウンドを重ねて鳴らすために、サウンドIDの上位ビットにボイス番号を入れたID。
+//! ボイス番号ごとに別のサウンドバッファが作られる。ボイス番号0は元のサウンドIDと同じ
+//! @{
+enum voice_const : uint32_t
+{
+	VOICE_SHIFT		= 24,
+	VOICE_MAX_NUM	= 1<<(32-VOICE_SHIFT),		//!< 1サウンドあたりのボイス数の上限
+	SOUND_ID_MASK	= (1<<VOICE_SHIFT)-1,
+};
+
+inline uint32_t voice_id(uint32_t nSoundID, uint32_t nVoiceNo){ return (nSoundID & SOUND_ID_MASK) | (nVoiceNo<<VOICE_SHIFT); }
+inline uint32_t voice_sound_id(uint32_t nVoiceID){ return nVoiceID & SOUND_ID_MASK; }
+inline uint32_t voice_no(uint32_t nVoiceID){ return nVoiceID>>VOICE_SHIFT; }
+//! @}
+
 ///////////////////////////////
 /*! @brief ボリューム
  *
@@ -117,6 +134,22 @@ public:
 		}
 	}
 
+	//! 振幅での取得。0.0～1.0
+	float amp()const
+	{
+		if(nDB_<=DSBVOLUME_MIN) return 0.0f;
+		return std::pow(10.0f, nDB_/2000.0f);
+	}
+
+	//! 振幅での設定。0.0～1.0
+	void set_amp(float fAmp)
+	{
+		if(fAmp<=0.0f)
+			nDB_ = DSBVOLUME_MIN;
+		else
+			nDB_ = clamp(static_cast<int32_t>(2000.0f*std::log10(fAmp)), DSBVOLUME_MIN, DSBVOLUME_MAX);
+	}
+
 private:
 	int32_t nDB_;
 };
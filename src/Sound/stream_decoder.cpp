@@ -0,0 +1,273 @@
+﻿#include "../mana_common.h"
+
+#include "../Concurrent/worker.h"
+
+#include "sound_file_reader.h"
+#include "stream_decoder.h"
+
+namespace mana{
+namespace sound{
+
+/*! @brief ワーカーとサウンドスレッドで共有する先読み状態
+ *
+ *  書き込みはワーカー、読み出しはサウンドスレッドだけが行う。
+ *  nWrite_/nRead_は通算のバイト数で、リングの位置はnMask_でとる */
+struct stream_decoder::ring_state
+{
+public:
+	enum fill_state : uint32_t
+	{
+		IDLE,		//!< 何もしていない
+		QUEUED,		//!< ワーカーに積んだ
+		RUNNING,	//!< ワーカーで読み込み中
+	};
+
+public:
+	ring_state(sound_file_reader* pReader, uint32_t nSize):pReader_(pReader),nMask_(nSize-1),fLoopSec_(0.0f)
+	{
+		vecRing_.resize(nSize);
+
+		nWrite_.store(0, std::memory_order_relaxed);
+		nRead_.store(0, std::memory_order_relaxed);
+		nFill_.store(IDLE, std::memory_order_relaxed);
+		bEnd_.store(false, std::memory_order_relaxed);
+		bLoop_.store(false, std::memory_order_relaxed);
+
+	#ifdef MANA_STREAM_DECODER_COUNT
+		nUnderrunCount_=0;
+		nFillCount_=0; nMaxFillMicro_=0;
+		nMaxWaitMicro_=0;
+	#endif
+	}
+
+	uint32_t size()const{ return nMask_+1; }
+
+	//! ワーカーで実行される。リングバッファが一杯になるか終端まで読む
+	void fill();
+
+public:
+	sound_file_reader*		pReader_;
+	vector<BYTE>			vecRing_;
+	uint32_t				nMask_;
+
+	std::atomic_uint32_t	nWrite_;	//!< ワーカーが書き込んだ通算バイト数
+	std::atomic_uint32_t	nRead_;		//!< サウンドスレッドが読んだ通算バイト数
+	std::atomic_uint32_t	nFill_;		//!< fill_state
+	std::atomic_bool		bEnd_;		//!< リーダーが終端に到達した
+
+	std::atomic_bool		bLoop_;
+	float					fLoopSec_;	//!< bLoop_のreleaseで公開する
+
+#ifdef MANA_STREAM_DECODER_COUNT
+	uint32_t				nUnderrunCount_;
+	uint32_t				nFillCount_;	//!< ワーカー側。waitの後にだけ読む
+	int64_t					nMaxFillMicro_;	//!< ワーカー側。waitの後にだけ読む
+	int64_t					nMaxWaitMicro_;
+#endif
+};
+
+void stream_decoder::ring_state::fill()
+{
+#ifdef MANA_STREAM_DECODER_COUNT
+	timer::elapsed_timer t;
+	t.start();
+#endif
+
+	bool		bLoop	 = bLoop_.load(std::memory_order_acquire);
+	uint32_t	nWrite	 = nWrite_.load(std::memory_order_relaxed);
+
+	while(!bEnd_.load(std::memory_order_relaxed))
+	{
+		uint32_t nFree = size() - (nWrite - nRead_.load(std::memory_order_acquire));
+		if(nFree==0) break;
+
+		// リングの末尾をまたがないように読む
+		uint32_t nPos  = nWrite & nMask_;
+		uint32_t nSize = (std::min)(nFree, size()-nPos);
+
+		uint32_t rsize = pReader_->read(&vecRing_[nPos], nSize, bLoop, fLoopSec_);
+
+		nWrite += rsize;
+		nWrite_.store(nWrite, std::memory_order_release);
+
+		if(pReader_->is_data_file_end())
+			bEnd_.store(true, std::memory_order_release);
+		else if(rsize<nSize)
+			break; // 読み込みエラー。次のprefetchでやり直す
+	}
+
+#ifdef MANA_STREAM_DECODER_COUNT
+	t.end();
+	++nFillCount_;
+	nMaxFillMicro_ = (std::max)(nMaxFillMicro_, t.elasped_micro());
+#endif
+}
+
+///////////////////////////////////////
+
+bool stream_decoder::init(sound_file_reader* pReader, uint32_t nSize)
+{
+	fin();
+
+	if(!pWorker_ || pReader==nullptr || nSize==0) return false;
+
+	// 2の累乗に切り上げる
+	uint32_t nRingSize=1;
+	while(nRingSize<nSize) nRingSize<<=1;
+
+	pState_ = make_shared<ring_state>(pReader, nRingSize);
+
+	return true;
+}
+
+void stream_decoder::fin()
+{
+	if(!pState_) return;
+
+	wait();
+
+#ifdef MANA_STREAM_DECODER_COUNT
+	if(pState_->nFillCount_>0)
+	{
+		logger::infoln("[stream_decoder]先読み回数 : " + to_str_s(pState_->nFillCount_) + "最大時間(us) : " + to_str_s(pState_->nMaxFillMicro_)
+					 + "アンダーラン回数 : " + to_str_s(pState_->nUnderrunCount_) + "最大待ち時間(us) : " + to_str(pState_->nMaxWaitMicro_));
+	}
+#endif
+
+	pState_.reset();
+}
+
+void stream_decoder::wait()
+{
+	if(!pState_) return;
+
+#ifdef MANA_STREAM_DECODER_COUNT
+	timer::elapsed_timer t;
+	t.start();
+#endif
+
+	while(true)
+	{// 始まってなければ取り消す。実行中なら終わるまで待つ
+		uint32_t nFill = ring_state::QUEUED;
+		if(pState_->nFill_.compare_exchange_strong(nFill, ring_state::IDLE, std::memory_order_acq_rel))
+			break;
+
+		if(nFill==ring_state::IDLE) break;
+
+		std::this_thread::yield();
+	}
+
+#ifdef MANA_STREAM_DECODER_COUNT
+	t.end();
+	pState_->nMaxWaitMicro_ = (std::max)(pState_->nMaxWaitMicro_, t.elasped_micro());
+#endif
+}
+
+void stream_decoder::reset(bool bEnd)
+{
+	if(!pState_) return;
+
+	pState_->nRead_.store(pState_->nWrite_.load(std::memory_order_relaxed), std::memory_order_release);
+	pState_->bEnd_.store(bEnd, std::memory_order_release);
+}
+
+void stream_decoder::set_loop(bool bLoop, float fLoopSec)
+{
+	if(!pState_) return;
+
+	// 実行中のfillが読んでいるかもしれないので、待ってから書き換える
+	if(pState_->fLoopSec_!=fLoopSec)
+	{
+		wait();
+		pState_->fLoopSec_ = fLoopSec;
+	}
+
+	pState_->bLoop_.store(bLoop, std::memory_order_release);
+}
+
+uint32_t stream_decoder::read(BYTE* pBuf, uint32_t nSize)
+{
+	if(!pState_) return 0;
+
+	ring_state& s = *pState_;
+
+	uint32_t nRead	= s.nRead_.load(std::memory_order_relaxed);
+	uint32_t nReady	= s.nWrite_.load(std::memory_order_acquire) - nRead;
+	uint32_t nCopy	= (std::min)(nReady, nSize);
+
+	// リングの末尾をまたぐ時は2回に分けてコピー
+	uint32_t nPos	= nRead & s.nMask_;
+	uint32_t nFirst	= (std::min)(nCopy, s.size()-nPos);
+	if(nFirst>0)		::memcpy(pBuf, &s.vecRing_[nPos], nFirst);
+	if(nCopy>nFirst)	::memcpy(&pBuf[nFirst], &s.vecRing_[0], nCopy-nFirst);
+
+	s.nRead_.store(nRead+nCopy, std::memory_order_release);
+
+	if(nCopy<nSize && !s.bEnd_.load(std::memory_order_acquire))
+	{// 先読みが間に合わなかった
+		::memset(&pBuf[nCopy], 0, nSize-nCopy);
+		nCopy = nSize;
+
+	#ifdef MANA_STREAM_DECODER_COUNT
+		++s.nUnderrunCount_;
+	#endif
+	}
+
+	return nCopy;
+}
+
+bool stream_decoder::is_data_end()const
+{
+	if(!pState_) return false;
+
+	return pState_->bEnd_.load(std::memory_order_acquire)
+		&& pState_->nRead_.load(std::memory_order_relaxed)==pState_->nWrite_.load(std::memory_order_acquire);
+}
+
+void stream_decoder::prefetch()
+{
+	if(!pState_) return;
+
+	ring_state& s = *pState_;
+
+	if(s.bEnd_.load(std::memory_order_acquire)) return;
+	if(s.nFill_.load(std::memory_order_acquire)!=ring_state::IDLE) return;
+
+	uint32_t nFree = s.size() - (s.nWrite_.load(std::memory_order_acquire) - s.nRead_.load(std::memory_order_relaxed));
+	if(nFree < s.size()/2) return;
+
+	s.nFill_.store(ring_state::QUEUED, std::memory_order_release);
+
+	// 取り消されるかもしれないので、QUEUEDの時だけ実行する
+	shared_ptr<ring_state> pState = pState_;
+	auto job = [pState]()
+	{
+		uint32_t nFill = ring_state::QUEUED;
+		if(!pState->nFill_.compare_exchange_strong(nFill, ring_state::RUNNING, std::memory_order_acq_rel))
+			return;
+
+		pState->fill();
+		pState->nFill_.store(ring_state::IDLE, std::memory_order_release);
+	};
+
+	if(pWorker_->request(job).expired())
+	{// ワーカーが終了していたら、積めなかったので取り消す
+		uint32_t nFill = ring_state::QUEUED;
+		s.nFill_.compare_exchange_strong(nFill, ring_state::IDLE, std::memory_order_acq_rel);
+	}
+}
+
+#ifdef MANA_STREAM_DECODER_COUNT
+uint32_t stream_decoder::underrun_count()const
+{
+	return pState_ ? pState_->nUnderrunCount_ : 0;
+}
+
+int64_t stream_decoder::max_wait_micro()const
+{
+	return pState_ ? pState_->nMaxWaitMicro_ : 0;
+}
+#endif
+
+} // namespace sound end
+} // namespace mana end
@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#ifdef MANA_DEBUG
+#define MANA_STREAM_DECODER_COUNT
+#endif
+
+namespace mana{
+namespace concurrent{
+class worker;
+} // namespace concurrent end
+
+namespace sound{
+class sound_file_reader;
+
+/*! @brief ストリーム再生の先読みデコーダー
+ *
+ *  ストリーム再生のデータ読み込み・デコードをワーカーで行い、リングバッファに先読みしておく。
+ *  サウンドスレッドはreadで読み込み済みのPCMをコピーするだけになるので、
+ *  oggのデコードやファイル読み込みが遅くても、他のサウンドの処理が止まらない
+ *
+ *  先読みが間に合わなかった時はアンダーランとして数え、足りない分は無音にする。
+ *
+ *  リーダーはワーカーから触られるので、リーダーを直接使う前には必ずwaitを呼ぶこと。
+ *  ワーカーを設定していない時は何もしない(is_activeがfalse) */
+class stream_decoder
+{
+public:
+	stream_decoder(){}
+	~stream_decoder(){ fin(); }
+
+	//! ワーカー設定。initより前に呼ぶ
+	void		set_worker(const shared_ptr<concurrent::worker>& pWorker){ pWorker_=pWorker; }
+
+	//! @brief 初期化
+	/*! @param[in] pReader ストリームでopenしたリーダー。finするまで保持する
+	 *  @param[in] nSize 先読みするサイズ(byte)。2の累乗に切り上げる */
+	bool		init(sound_file_reader* pReader, uint32_t nSize);
+
+	//! 終了処理。ワーカーで読み込み中なら終わるまで待つ
+	void		fin();
+
+	//! 先読みしているか
+	bool		is_active()const{ return pState_!=nullptr; }
+
+	//! @brief ワーカーでの読み込みが終わるのを待つ
+	/*! まだ始まってない読み込みは取り消すので、待つのは実行中の1回分だけ */
+	void		wait();
+
+	//! @brief 先読み済みのデータを捨てる
+	/*! waitした後、リーダーをシークしてから呼ぶこと
+	 *  @param[in] bEnd リーダーがもう終端に到達しているか */
+	void		reset(bool bEnd);
+
+	//! ループ設定。先読み済みのデータには反映されない
+	void		set_loop(bool bLoop, float fLoopSec);
+
+	//! @brief 先読み済みのデータをコピーする
+	/*! 終端以外で足りない時はアンダーランなので、残りを無音で埋めてnSizeを返す
+	 *  @return コピーしたサイズ。終端に到達した時だけnSizeより小さくなる */
+	uint32_t	read(BYTE* pBuf, uint32_t nSize);
+
+	//! 終端まで読み込んで、先読み済みのデータも全部readした
+	bool		is_data_end()const;
+
+	//! リングバッファの空きが半分以上あったら、ワーカーに先読みを積む
+	void		prefetch();
+
+private:
+	struct ring_state;
+
+	shared_ptr<ring_state>				pState_;
+	shared_ptr<concurrent::worker>		pWorker_;
+
+#ifdef MANA_STREAM_DECODER_COUNT
+public:
+	//! アンダーランした回数
+	uint32_t	underrun_count()const;
+	//! waitで待った最大時間(マイクロ秒)
+	int64_t		max_wait_micro()const;
+#endif
+
+private:
+	NON_COPIABLE(stream_decoder);
+};
+
+} // namespace sound end
+} // namespace mana end
+
+/*
+	sound::sound_file_reader reader;
+	reader.open("bgm.ogg", true);
+
+	sound::stream_decoder decoder;
+	decoder.set_worker(pWorker);
+	decoder.init(&reader, 44100*4*2);
+	decoder.set_loop(true, 0.0f);
+	decoder.prefetch();
+
+	// サウンドスレッドで定期的に
+	decoder.read(pBuf, nSize);
+	decoder.prefetch();
+ */
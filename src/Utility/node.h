@@ -5,7 +5,13 @@ namespace utility{
 
 /*! @brief 親子関係操作を持つクラスベース
  *
- *	private継承して使う。子ノードはid昇順に追加される。追加後にidを変更した場合は、sort_childで正常化できる
+ *	private継承して使う。子ノードはpriority昇順に並ぶ。追加後にpriorityを変更した場合は、
+ *	change_child_priorityで変更するか、sort_childで正常化できる。
+ *	正常化するまでは、子の検索は全部を見るので遅くなる
+ *
+ *	子の追加は保留リストに積むだけで、子の並びを参照する時(childrenなど)にまとめて並びに混ぜる。
+ *	毎フレーム大量に子を出し入れしても、並びの作り直しは1回で済む。
+ *	子の検索・削除は、並びを二分探索する
  *
  *	@tparam T 親子関係を作りたいクラス */
 template<class T>
@@ -16,14 +22,14 @@ public:
 	typedef vector<T*>	child_vector;
 
 public:
-	node(uint32_t nReserve=16):nID_(0),nPriority_(0),pParent_(nullptr){ vecChildren_.reserve(nReserve); }
+	node(uint32_t nReserve=16):nID_(0),nPriority_(0),pParent_(nullptr),bChildUnsorted_(false){ vecChildren_.reserve(nReserve); }
 
 public:
 	uint32_t	id()const{ return nID_; }
 	void		set_id(uint32_t nID){ nID_=nID; }
 
 	uint32_t	priority()const{ return nPriority_; }
-	void		set_priority(uint32_t nPriority){ nPriority_=nPriority; }
+	void		set_priority(uint32_t nPriority){ nPriority_=nPriority; if(pParent_) static_cast<self_type*>(pParent_)->bChildUnsorted_=true; }
 	
 	T*			parent(){ return pParent_; }
 	const T*	parent()const{ return pParent_; }
@@ -43,10 +49,19 @@ public:
 	 *  @return				bDeleteがfalseの時は削除したTのポインタが返る。それ以外はnullptr */
 	T*			remove_child(uint32_t nPriority, bool bDelete);
 
+	//! @brief 子ノードを並びから外す。親は書き換えないし、deleteもしない。exec実行中に呼んではいけない
+	/*! @return 子が見つからなければfalse */
+	bool		erase_child(const T* pChild);
+
 	//! 子ノードを取得する
 	const T*	child(uint32_t nPriority)const;
 		  T*	child(uint32_t nPriority);
 
+	//! @brief 子ノードのpriorityを変更して、並び直す。exec実行中に呼んではいけない
+	/*! 同じpriorityの子の中では最後になる
+	 *  @return 子が見つからなければfalse */
+	bool		change_child_priority(uint32_t nPriority, uint32_t nNewPriority);
+
 	//! 子ノードをすべて削除する。deleteを呼ぶ。exec実行中に呼んではいけない
 	/*! @param[in] bDelete falseだと子をdeleteしない */
 	void		clear_child(bool bDelete=true);
@@ -55,18 +70,38 @@ public:
 	/*! @param[in] bChild trueだと再帰的にsort_childを呼ぶ */
 	void		sort_child(bool bChild=true);
 
+	//! 子ノードの並び。保留中の追加があれば、先に並びに混ぜる
+	child_vector&		children(){ flush_child(); return vecChildren_; }
+	const child_vector&	children()const{ flush_child(); return vecChildren_; }
+
 	//! 子ノードの数を取得する
-	uint32_t	count_children()const{ return vecChildren_.size(); }
+	uint32_t	count_children()const{ return vecChildren_.size()+vecPending_.size(); }
 	//! 子ノードリストをシュリンクする
-	void		shrink_children(){ vecChildren_.shrink_to_fit(); }
+	void		shrink_children(){ flush_child(); vecChildren_.shrink_to_fit(); vecPending_.shrink_to_fit(); }
 	//! @}
 
+private:
+	static bool	less_priority(const T* pL, const T* pR){ return pL->priority()<pR->priority(); }
+
+	//! 保留中の追加を並びに混ぜる
+	void		flush_child()const;
+
+	//! 並びから子を探す。見つからなければend
+	typename child_vector::iterator find_child(uint32_t nPriority)const;
+
 protected:
 	uint32_t		nID_;
 	uint32_t		nPriority_;
 
 	T*				pParent_;
-	child_vector	vecChildren_;
+
+	//! @defgroup node_child_list 子の並び。constなメソッドからも保留中の追加を混ぜるのでmutable
+	//! @{
+	mutable child_vector	vecChildren_;
+	mutable child_vector	vecPending_;	//!< 追加されて、まだ並びに混ぜていない子
+	//! @}
+
+	bool			bChildUnsorted_;	//!< 子のpriorityが直接変えられて、並びが崩れているかもしれない
 
 #ifdef MANA_DEBUG
 public:
@@ -88,78 +123,138 @@ inline bool node<T>::add_child(T* pChild, uint32_t nPriority, T* pParent)
 	pChild->set_priority(nPriority);
 	pChild->set_parent(pParent);
 
-	child_vector::iterator it;
-	for(it = vecChildren_.begin(); it!=vecChildren_.end(); ++it)
+	vecPending_.emplace_back(pChild);
+	return true;
+}
+
+template<class T>
+inline void node<T>::flush_child()const
+{
+	if(vecPending_.empty()) return;
+
+	// 同じpriorityの子をチェックする範囲
+	size_t nCheckBegin, nCheckEnd;
+
+	if(vecPending_.size()==1)
+	{// 1つなら、同じpriorityの最後に差し込む
+		auto range = std::equal_range(vecChildren_.begin(), vecChildren_.end(), vecPending_[0], &less_priority);
+		nCheckBegin = range.first-vecChildren_.begin();
+		nCheckEnd	= range.second-vecChildren_.begin()+1;
+
+		vecChildren_.insert(range.second, vecPending_[0]);
+	}
+	else
+	{// 追加順を保ったまま並べて、後ろから混ぜる。同じpriorityなら元からいた子が前
+		std::stable_sort(vecPending_.begin(), vecPending_.end(), &less_priority);
+
+		const size_t nSize = vecChildren_.size();
+		vecChildren_.insert(vecChildren_.end(), vecPending_.begin(), vecPending_.end());
+		std::inplace_merge(vecChildren_.begin(), vecChildren_.begin()+nSize, vecChildren_.end(), &less_priority);
+
+		nCheckBegin = 0;
+		nCheckEnd	= vecChildren_.size();
+	}
+
+	vecPending_.clear();
+
+	// 同じ子が2回追加されていたら1つにする
+	for(size_t i=nCheckBegin; i+1<nCheckEnd; )
 	{
-	#ifdef MANA_DEBUG
-		if((*it)->priority()==nPriority)
-		{
-			logger::warnln("[node]同priorityのnodeがすでに存在します。: " + to_str_s(nPriority) + (*it)->debug_name() + " " + pChild->debug_name());
+		T* pL = vecChildren_[i];
+		T* pR = vecChildren_[i+1];
+		if(pL->priority()!=pR->priority()){ ++i; continue; }
 
-			if((*it)==pChild) return true;
-			
+		if(pL==pR)
+		{
+			vecChildren_.erase(vecChildren_.begin()+i);
+			--nCheckEnd;
+			continue;
 		}
+
+	#ifdef MANA_DEBUG
+		logger::warnln("[node]同priorityのnodeがすでに存在します。: " + to_str_s(pL->priority()) + pL->debug_name() + " " + pR->debug_name());
 	#endif
+		++i;
+	}
+}
 
-		if((*it)->priority()>nPriority)
-		{
-			vecChildren_.insert(it, pChild);
-			return true;
-		}
+template<class T>
+inline typename node<T>::child_vector::iterator node<T>::find_child(uint32_t nPriority)const
+{
+	flush_child();
+
+	if(bChildUnsorted_)
+	{// sort_child前にpriorityが変えられていると並びが崩れているので、全部見る
+		return std::find_if(vecChildren_.begin(), vecChildren_.end(), [nPriority](const T* p){ return p->priority()==nPriority; });
 	}
 
-	vecChildren_.push_back(pChild);
-	return true;
+	auto it = std::lower_bound(vecChildren_.begin(), vecChildren_.end(), nPriority, [](const T* p, uint32_t n){ return p->priority()<n; });
+	return (it!=vecChildren_.end() && (*it)->priority()==nPriority) ? it : vecChildren_.end();
 }
 
 template<class T>
 inline T* node<T>::remove_child(uint32_t nPriority, bool bDelete)
 {
-	child_vector::iterator it;
-	for(it = vecChildren_.begin(); it!=vecChildren_.end(); ++it)
-	{
-		if((*it)->priority()==nPriority)
-		{
-			T* p = *it;
-			p->set_parent(nullptr);
-			vecChildren_.erase(it);
+	auto it = find_child(nPriority);
+	if(it==vecChildren_.end()) return nullptr;
 
+	T* p = *it;
+	p->set_parent(nullptr);
+	vecChildren_.erase(it);
 
-			if(bDelete)
-			{
-				delete p;
-				return nullptr;
-			}
-			else
-			{
-				return p;
-			}
-		}
+	if(bDelete)
+	{
+		delete p;
+		return nullptr;
+	}
+	else
+	{
+		return p;
 	}
+}
+
+template<class T>
+inline bool node<T>::erase_child(const T* pChild)
+{
+	flush_child();
 
-	return nullptr;
+	auto it = std::find(vecChildren_.begin(), vecChildren_.end(), pChild);
+	if(it==vecChildren_.end()) return false;
+
+	vecChildren_.erase(it);
+	return true;
 }
 
 template<class T>
 inline const T* node<T>::child(uint32_t nPriority)const
 {
-	for(auto& n : vecChildren_)
-	{
-		if(n->priority()==nPriority) return n;
-	}
-
-	return nullptr;
+	auto it = find_child(nPriority);
+	return it!=vecChildren_.end() ? *it : nullptr;
 }
 
 template<class T>
 inline T* node<T>::child(uint32_t nPriority)
 {
-	for(auto& n : vecChildren_)
-	{
-		if(n->priority()==nPriority) return n;
-	}
+	auto it = find_child(nPriority);
+	return it!=vecChildren_.end() ? *it : nullptr;
+}
 
-	return nullptr;
+template<class T>
+inline bool node<T>::change_child_priority(uint32_t nPriority, uint32_t nNewPriority)
+{
+	auto it = find_child(nPriority);
+	if(it==vecChildren_.end()) return false;
+
+	T* p = *it;
+	vecChildren_.erase(it);
+
+	// 並びからは外したので、並びが崩れた扱いにしない
+	const bool bUnsorted = bChildUnsorted_;
+	p->set_priority(nNewPriority);
+	bChildUnsorted_ = bUnsorted;
+
+	vecPending_.emplace_back(p);
+	return true;
 }
 
 template<class T>
@@ -167,23 +262,30 @@ inline void node<T>::clear_child(bool bDelete)
 {
 	if(bDelete)
 	{
-		child_vector::iterator it;
-		for(it = vecChildren_.begin(); it!=vecChildren_.end(); ++it)
-			delete *it;
+		for(auto p : vecChildren_) delete p;
+		for(auto p : vecPending_)  delete p;
 	}
 	
 	vecChildren_.clear();
+	vecPending_.clear();
 }
 
 template<class T>
 inline void node<T>::sort_child(bool bChild)
 {
+	flush_child();
+
 	if(bChild)
 	{
 		for(auto child : vecChildren_)
 			child->sort_child(bChild);
 	}
 
+	bChildUnsorted_ = false;
+
+	// 並びが崩れていなければ何もしない
+	if(std::is_sorted(vecChildren_.begin(), vecChildren_.end(), &less_priority)) return;
+
 	// 基数(1byte)ソート
 	array<vector<T*>, 256> buckets;
 	uint32_t radix = 0;
@@ -0,0 +1,255 @@
+﻿#include "stdafx.h"
+
+#include "bc_codec.h"
+
+namespace bc{
+
+namespace{
+
+inline uint16_t to_565(float r, float g, float b)
+{
+	uint32_t nR = static_cast<uint32_t>((std::min)((std::max)(r, 0.f), 255.f)*31.f/255.f+0.5f);
+	uint32_t nG = static_cast<uint32_t>((std::min)((std::max)(g, 0.f), 255.f)*63.f/255.f+0.5f);
+	uint32_t nB = static_cast<uint32_t>((std::min)((std::max)(b, 0.f), 255.f)*31.f/255.f+0.5f);
+	return static_cast<uint16_t>(nR<<11 | nG<<5 | nB);
+}
+
+inline void from_565(uint16_t c, uint8_t* pOut)
+{
+	uint32_t r = (c>>11)&0x1F, g = (c>>5)&0x3F, b = c&0x1F;
+	pOut[0] = static_cast<uint8_t>(r<<3 | r>>2);
+	pOut[1] = static_cast<uint8_t>(g<<2 | g>>4);
+	pOut[2] = static_cast<uint8_t>(b<<3 | b>>2);
+	pOut[3] = 255;
+}
+
+// 2色からパレットを作る。b4Colorがfalseだと3色+透明
+void make_palette(uint16_t c0, uint16_t c1, bool b4Color, uint8_t aPalette[4][4])
+{
+	from_565(c0, aPalette[0]);
+	from_565(c1, aPalette[1]);
+
+	for(uint32_t i=0; i<3; ++i)
+	{
+		if(b4Color)
+		{
+			aPalette[2][i] = static_cast<uint8_t>((2*aPalette[0][i]+aPalette[1][i])/3);
+			aPalette[3][i] = static_cast<uint8_t>((aPalette[0][i]+2*aPalette[1][i])/3);
+		}
+		else
+		{
+			aPalette[2][i] = static_cast<uint8_t>((aPalette[0][i]+aPalette[1][i])/2);
+			aPalette[3][i] = 0;
+		}
+	}
+	aPalette[2][3] = 255;
+	aPalette[3][3] = b4Color ? 255 : 0;
+}
+
+inline uint32_t color_dist(const uint8_t* a, const uint8_t* b)
+{
+	int32_t r=a[0]-b[0], g=a[1]-b[1], bl=a[2]-b[2];
+	return r*r+g*g+bl*bl;
+}
+
+// カラーブロック(8byte)をエンコードする
+// bAlphaがtrueの時、α128未満のピクセルは透明にする(3色モード)
+void encode_color(const uint8_t* pBlock, uint8_t* pOut, bool bAlpha)
+{
+	// 対象ピクセルの平均
+	float fMean[3] = {0,0,0};
+	uint32_t nNum=0;
+	bool bTransparent=false;
+
+	for(uint32_t i=0; i<16; ++i)
+	{
+		const uint8_t* p = pBlock+i*4;
+		if(bAlpha && p[3]<128){ bTransparent=true; continue; }
+
+		for(uint32_t c=0; c<3; ++c) fMean[c] += p[c];
+		++nNum;
+	}
+
+	if(nNum==0)
+	{// 全部透明
+		memset(pOut, 0, 4);
+		memset(pOut+4, 0xFF, 4);
+		return;
+	}
+
+	for(uint32_t c=0; c<3; ++c) fMean[c] /= nNum;
+
+	// 共分散から主軸を求める
+	float fCov[6] = {0,0,0,0,0,0}; // rr,rg,rb,gg,gb,bb
+	for(uint32_t i=0; i<16; ++i)
+	{
+		const uint8_t* p = pBlock+i*4;
+		if(bAlpha && p[3]<128) continue;
+
+		float r=p[0]-fMean[0], g=p[1]-fMean[1], b=p[2]-fMean[2];
+		fCov[0]+=r*r; fCov[1]+=r*g; fCov[2]+=r*b;
+		fCov[3]+=g*g; fCov[4]+=g*b; fCov[5]+=b*b;
+	}
+
+	float fAxis[3] = {1.f,1.f,1.f};
+	for(uint32_t n=0; n<8; ++n)
+	{// べき乗法
+		float x = fCov[0]*fAxis[0]+fCov[1]*fAxis[1]+fCov[2]*fAxis[2];
+		float y = fCov[1]*fAxis[0]+fCov[3]*fAxis[1]+fCov[4]*fAxis[2];
+		float z = fCov[2]*fAxis[0]+fCov[4]*fAxis[1]+fCov[5]*fAxis[2];
+
+		float fLen = sqrtf(x*x+y*y+z*z);
+		if(fLen<1e-6f) break;
+
+		fAxis[0]=x/fLen; fAxis[1]=y/fLen; fAxis[2]=z/fLen;
+	}
+
+	// 主軸に投影した両端を端点にする
+	float fMin=FLT_MAX, fMax=-FLT_MAX;
+	for(uint32_t i=0; i<16; ++i)
+	{
+		const uint8_t* p = pBlock+i*4;
+		if(bAlpha && p[3]<128) continue;
+
+		float t = (p[0]-fMean[0])*fAxis[0]+(p[1]-fMean[1])*fAxis[1]+(p[2]-fMean[2])*fAxis[2];
+		fMin = (std::min)(fMin, t);
+		fMax = (std::max)(fMax, t);
+	}
+
+	// 少し内側に寄せると誤差が減る
+	float fInset = (fMax-fMin)/16.f;
+	fMin += fInset;
+	fMax -= fInset;
+
+	uint16_t c0 = to_565(fMean[0]+fAxis[0]*fMax, fMean[1]+fAxis[1]*fMax, fMean[2]+fAxis[2]*fMax);
+	uint16_t c1 = to_565(fMean[0]+fAxis[0]*fMin, fMean[1]+fAxis[1]*fMin, fMean[2]+fAxis[2]*fMin);
+
+	// 4色モードはc0>c1、3色モードはc0<=c1
+	bool b4Color = !bTransparent;
+	if((b4Color && c0<c1) || (!b4Color && c0>c1)) std::swap(c0, c1);
+
+	uint8_t aPalette[4][4];
+	make_palette(c0, c1, b4Color, aPalette);
+
+	uint32_t nIndex=0;
+	for(uint32_t i=0; i<16; ++i)
+	{
+		const uint8_t* p = pBlock+i*4;
+
+		uint32_t nBest=0;
+		if(bTransparent && p[3]<128)
+		{
+			nBest=3;
+		}
+		else if(c0!=c1)
+		{
+			uint32_t nBestDist=UINT_MAX;
+			for(uint32_t n=0; n<(b4Color ? 4u : 3u); ++n)
+			{
+				uint32_t d = color_dist(p, aPalette[n]);
+				if(d<nBestDist){ nBestDist=d; nBest=n; }
+			}
+		}
+
+		nIndex |= nBest<<(i*2);
+	}
+
+	pOut[0] = static_cast<uint8_t>(c0&0xFF); pOut[1] = static_cast<uint8_t>(c0>>8);
+	pOut[2] = static_cast<uint8_t>(c1&0xFF); pOut[3] = static_cast<uint8_t>(c1>>8);
+	memcpy(pOut+4, &nIndex, 4);
+}
+
+void decode_color(const uint8_t* pIn, uint8_t* pBlock, bool bBC1)
+{
+	uint16_t c0 = static_cast<uint16_t>(pIn[0] | pIn[1]<<8);
+	uint16_t c1 = static_cast<uint16_t>(pIn[2] | pIn[3]<<8);
+
+	// BC3のカラーは常に4色
+	uint8_t aPalette[4][4];
+	make_palette(c0, c1, !bBC1 || c0>c1, aPalette);
+
+	uint32_t nIndex;
+	memcpy(&nIndex, pIn+4, 4);
+
+	for(uint32_t i=0; i<16; ++i)
+		memcpy(pBlock+i*4, aPalette[(nIndex>>(i*2))&3], 4);
+}
+
+} // namespace end
+
+void encode_bc1(const uint8_t* pBlock, uint8_t* pOut)
+{
+	encode_color(pBlock, pOut, true);
+}
+
+void encode_bc3(const uint8_t* pBlock, uint8_t* pOut)
+{
+	// αブロック。8段階モード(a0>a1)を使う
+	uint8_t a0=0, a1=255;
+	for(uint32_t i=0; i<16; ++i)
+	{
+		a0 = (std::max)(a0, pBlock[i*4+3]);
+		a1 = (std::min)(a1, pBlock[i*4+3]);
+	}
+
+	uint8_t aAlpha[8] = { a0, a1 };
+	for(uint32_t n=1; n<7; ++n)
+		aAlpha[n+1] = static_cast<uint8_t>(((7-n)*a0+n*a1)/7);
+
+	uint64_t nIndex=0;
+	if(a0!=a1)
+	{
+		for(uint32_t i=0; i<16; ++i)
+		{
+			uint32_t nBest=0, nBestDist=UINT_MAX;
+			for(uint32_t n=0; n<8; ++n)
+			{
+				uint32_t d = static_cast<uint32_t>(abs(static_cast<int32_t>(pBlock[i*4+3])-aAlpha[n]));
+				if(d<nBestDist){ nBestDist=d; nBest=n; }
+			}
+			nIndex |= static_cast<uint64_t>(nBest)<<(i*3);
+		}
+	}
+
+	pOut[0] = a0;
+	pOut[1] = a1;
+	for(uint32_t i=0; i<6; ++i)
+		pOut[2+i] = static_cast<uint8_t>((nIndex>>(i*8))&0xFF);
+
+	// カラーブロック
+	encode_color(pBlock, pOut+8, false);
+}
+
+void decode_bc1(const uint8_t* pIn, uint8_t* pBlock)
+{
+	decode_color(pIn, pBlock, true);
+}
+
+void decode_bc3(const uint8_t* pIn, uint8_t* pBlock)
+{
+	decode_color(pIn+8, pBlock, false);
+
+	uint8_t a0=pIn[0], a1=pIn[1];
+	uint8_t aAlpha[8] = { a0, a1 };
+	if(a0>a1)
+	{
+		for(uint32_t n=1; n<7; ++n)
+			aAlpha[n+1] = static_cast<uint8_t>(((7-n)*a0+n*a1)/7);
+	}
+	else
+	{
+		for(uint32_t n=1; n<5; ++n)
+			aAlpha[n+1] = static_cast<uint8_t>(((5-n)*a0+n*a1)/5);
+		aAlpha[6] = 0;
+		aAlpha[7] = 255;
+	}
+
+	uint64_t nIndex=0;
+	for(uint32_t i=0; i<6; ++i)
+		nIndex |= static_cast<uint64_t>(pIn[2+i])<<(i*8);
+
+	for(uint32_t i=0; i<16; ++i)
+		pBlock[i*4+3] = aAlpha[(nIndex>>(i*3))&7];
+}
+
+} // namespace bc end
@@ -0,0 +1,15 @@
+﻿#pragma once
+
+// BC1(DXT1)/BC3(DXT5)のブロックエンコーダーとデコーダー
+// ブロックは4x4ピクセルのRGBA8。[y*4+x]の順に64byte
+namespace bc{
+
+// BC1にエンコード。αが128未満のピクセルは透明として3色モードにする
+void encode_bc1(const uint8_t* pBlock, uint8_t* pOut);
+// BC3にエンコード
+void encode_bc3(const uint8_t* pBlock, uint8_t* pOut);
+
+void decode_bc1(const uint8_t* pIn, uint8_t* pBlock);
+void decode_bc3(const uint8_t* pIn, uint8_t* pBlock);
+
+} // namespace bc end
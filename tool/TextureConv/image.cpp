@@ -0,0 +1,98 @@
+﻿#include "stdafx.h"
+
+#include <png.h>
+
+#include "image.h"
+
+void image::create(uint32_t nWidth, uint32_t nHeight)
+{
+	nWidth_	 = nWidth;
+	nHeight_ = nHeight;
+	vecData_.assign(nWidth*nHeight*4, 0);
+}
+
+bool image::load_png(const string& sFilePath)
+{
+	png_image info;
+	memset(&info, 0, sizeof(info));
+	info.version = PNG_IMAGE_VERSION;
+
+	png_image_begin_read_from_file(&info, sFilePath.c_str());
+	if(PNG_IMAGE_FAILED(info))
+	{
+		cout << info.message << endl;
+		return false;
+	}
+
+	// 何で保存されていてもRGBAで読む
+	info.format = PNG_FORMAT_RGBA;
+	create(info.width, info.height);
+
+	png_image_finish_read(&info, NULL, vecData_.data(), nWidth_*4, NULL);
+	if(PNG_IMAGE_FAILED(info))
+	{
+		cout << info.message << endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool image::write_png(const string& sFilePath)const
+{
+	png_image info;
+	memset(&info, 0, sizeof(info));
+	info.version = PNG_IMAGE_VERSION;
+	info.width	 = nWidth_;
+	info.height	 = nHeight_;
+	info.format	 = PNG_FORMAT_RGBA;
+
+	png_image_write_to_file(&info, sFilePath.c_str(), 0, vecData_.data(), nWidth_*4, NULL);
+	if(PNG_IMAGE_FAILED(info))
+	{
+		cout << info.message << endl;
+		return false;
+	}
+
+	return true;
+}
+
+void image::copy_extend(const image& src, uint32_t nWidth, uint32_t nHeight)
+{
+	create(nWidth, nHeight);
+
+	for(uint32_t y=0; y<nHeight_; ++y)
+		for(uint32_t x=0; x<nWidth_; ++x)
+			memcpy(pixel(x,y), src.pixel(x,y), 4);
+}
+
+void image::half(const image& src)
+{
+	create((std::max)(src.width()/2, 1u), (std::max)(src.height()/2, 1u));
+
+	for(uint32_t y=0; y<nHeight_; ++y)
+	{
+		for(uint32_t x=0; x<nWidth_; ++x)
+		{
+			const uint8_t* p[4] = { src.pixel(x*2, y*2), src.pixel(x*2+1, y*2), src.pixel(x*2, y*2+1), src.pixel(x*2+1, y*2+1) };
+
+			uint8_t* pDest = pixel(x,y);
+			for(uint32_t c=0; c<4; ++c)
+				pDest[c] = static_cast<uint8_t>((p[0][c]+p[1][c]+p[2][c]+p[3][c]+2)/4);
+		}
+	}
+}
+
+const uint8_t* image::pixel(uint32_t x, uint32_t y)const
+{
+	x = (std::min)(x, nWidth_-1);
+	y = (std::min)(y, nHeight_-1);
+	return &vecData_[(y*nWidth_+x)*4];
+}
+
+uint8_t* image::pixel(uint32_t x, uint32_t y)
+{
+	x = (std::min)(x, nWidth_-1);
+	y = (std::min)(y, nHeight_-1);
+	return &vecData_[(y*nWidth_+x)*4];
+}
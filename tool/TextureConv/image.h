@@ -0,0 +1,31 @@
+﻿#pragma once
+
+// RGBA8の画像。座標は左上から右下
+class image
+{
+public:
+	image():nWidth_(0),nHeight_(0){}
+
+	void		create(uint32_t nWidth, uint32_t nHeight);
+
+	// PNGを読み込む。フォーマットに関わらずRGBAに展開される
+	bool		load_png(const string& sFilePath);
+	bool		write_png(const string& sFilePath)const;
+
+	// srcを左上に置いて、はみ出た部分は端のピクセルを伸ばす
+	void		copy_extend(const image& src, uint32_t nWidth, uint32_t nHeight);
+	// srcを縦横半分に縮小する(2x2平均)。1より小さくはならない
+	void		half(const image& src);
+
+	// 範囲外は端に丸める
+	const uint8_t*	pixel(uint32_t x, uint32_t y)const;
+	uint8_t*		pixel(uint32_t x, uint32_t y);
+
+	uint32_t	width()const{ return nWidth_; }
+	uint32_t	height()const{ return nHeight_; }
+
+private:
+	uint32_t		nWidth_;
+	uint32_t		nHeight_;
+	vector<uint8_t>	vecData_;
+};
@@ -0,0 +1,322 @@
+﻿/*!
+ *  テクスチャ変換ツール
+ *
+ *  PNGを読み込んで、ミップマップ生成・ブロック圧縮済みのテクスチャコンテナ(.mtex)を出力する。
+ *  フレームワーク側はデコードせずにテクスチャへコピーするだけで読み込める
+ *
+ *	[入力PNG] [出力mtex] [-f bc1|bc3|rgba] [-mip ミップ数] [-check 確認用PNG]
+ *
+ *  [-f]     出力フォーマット。省略時はbc3
+ *           bc1  : 1/8サイズ。αは1bit(128未満は透明)
+ *           bc3  : 1/4サイズ。αは8bit
+ *           rgba : 無圧縮
+ *  [-mip]   ミップレベル数。0で1x1まで作る。省略時は1(ミップマップ無し)
+ *  [-check] ミップレベル0をデコードし直したPNGを出力する。圧縮の劣化確認用
+ *
+ *  画像は2の累乗サイズに広げて格納される。広げた部分は端のピクセルで埋める
+ */
+
+#include "stdafx.h"
+
+#include "../../src/Draw/texture_container.h"
+
+#include "image.h"
+#include "bc_codec.h"
+
+typedef mana::draw::texture_container_header container_header;
+
+// 2の累乗に切り上げる
+uint32_t pow2(uint32_t n);
+// ミップレベルをフォーマットに合わせて変換してvecDataの後ろに足す
+void encode_level(const image& img, uint32_t nFormat, vector<uint8_t>& vecData);
+// 変換したミップレベル0をデコードし直す
+void decode_level(const uint8_t* pData, uint32_t nFormat, image& img);
+// 2つの画像のPSNR。RGBAの4チャンネルで計算する
+double psnr(const image& a, const image& b);
+
+//////////////////////////////////////
+// arg
+string		g_sInput;
+string		g_sOutput;
+string		g_sCheck;
+uint32_t	g_nFormat		= container_header::FORMAT_BC3;
+uint32_t	g_nMipLevels	= 1;
+
+
+//////////////////////////////////////
+// main
+int main(int argc, char* argv[])
+{
+	bool bFormat=false;
+	bool bMip=false;
+	bool bCheck=false;
+
+	////////////////////////
+	// 引数解析
+	for(int32_t i=1; i<argc; ++i)
+	{
+		string arg(argv[i]);
+		if(arg=="-h")
+		{
+			cout << "Usage:" << endl;
+			cout << "  [入力PNG] [出力mtex] [-f bc1|bc3|rgba] [-mip ミップ数(0で1x1まで)] [-check 確認用PNG]" << endl;
+			return 1;
+		}
+		else if(arg=="-f")
+		{
+			bFormat=true;
+		}
+		else if(arg=="-mip")
+		{
+			bMip=true;
+		}
+		else if(arg=="-check")
+		{
+			bCheck=true;
+		}
+		else
+		{
+			if(bFormat)
+			{
+				if(arg=="bc1")		 g_nFormat = container_header::FORMAT_BC1;
+				else if(arg=="bc3")	 g_nFormat = container_header::FORMAT_BC3;
+				else if(arg=="rgba") g_nFormat = container_header::FORMAT_RGBA8;
+				else
+				{
+					cout << "不明なフォーマット: " << arg << endl;
+					return 1;
+				}
+				bFormat=false;
+			}
+			else if(bMip)
+			{
+				g_nMipLevels = lexical_cast<uint32_t>(arg);
+				bMip=false;
+			}
+			else if(bCheck)
+			{
+				g_sCheck = arg;
+				bCheck=false;
+			}
+			else if(g_sInput.empty())
+			{
+				g_sInput = arg;
+			}
+			else if(g_sOutput.empty())
+			{
+				g_sOutput = arg;
+			}
+		}
+	}
+
+	if(g_sInput.empty() || g_sOutput.empty())
+	{
+		cout << "入力と出力を指定してください" << endl;
+		return 1;
+	}
+
+	////////////////////////
+	// 読み込み
+	image src;
+	if(!src.load_png(g_sInput))
+	{
+		cout << "読み込みに失敗しました: " << g_sInput << endl;
+		return 1;
+	}
+
+	container_header head;
+	memset(&head, 0, sizeof(head));
+	head.nMagic_		= container_header::MAGIC;
+	head.nVersion_		= container_header::VERSION;
+	head.nFormat_		= g_nFormat;
+	head.nImageWidth_	= src.width();
+	head.nImageHeight_	= src.height();
+	head.nWidth_		= pow2(src.width());
+	head.nHeight_		= pow2(src.height());
+
+	uint32_t nMaxLevels=1;
+	while((head.nWidth_>>nMaxLevels)>0 || (head.nHeight_>>nMaxLevels)>0) ++nMaxLevels;
+	head.nMipLevels_ = (g_nMipLevels==0 || g_nMipLevels>nMaxLevels) ? nMaxLevels : g_nMipLevels;
+
+	cout << "            入力: " << g_sInput << " (" << src.width() << "x" << src.height() << ")" << endl;
+	cout << "            出力: " << g_sOutput << " (" << head.nWidth_ << "x" << head.nHeight_ << ")" << endl;
+	cout << "        ミップ数: " << head.nMipLevels_ << endl;
+
+	////////////////////////
+	// ミップレベルごとに変換
+	vector<uint8_t> vecData;
+
+	image level;
+	level.copy_extend(src, head.nWidth_, head.nHeight_);
+
+	for(uint32_t i=0; i<head.nMipLevels_; ++i)
+	{
+		if(i>0)
+		{
+			image prev = level;
+			level.half(prev);
+		}
+
+		encode_level(level, head.nFormat_, vecData);
+	}
+
+	head.nDataSize_ = static_cast<uint32_t>(vecData.size());
+	if(head.nDataSize_!=head.calc_data_size())
+	{
+		cout << "データサイズが合いません" << endl;
+		return 1;
+	}
+
+	////////////////////////
+	// 書き出し
+	FILE* fp = fopen(g_sOutput.c_str(), "wb");
+	if(fp==nullptr)
+	{
+		cout << "出力ファイルを開けません: " << g_sOutput << endl;
+		return 1;
+	}
+
+	fwrite(&head, sizeof(head), 1, fp);
+	fwrite(vecData.data(), 1, vecData.size(), fp);
+	fclose(fp);
+
+	uint32_t nRawSize=0;
+	for(uint32_t i=0; i<head.nMipLevels_; ++i)
+		nRawSize += container_header::level_size(container_header::FORMAT_RGBA8, head.nWidth_, head.nHeight_, i);
+
+	cout << "          サイズ: " << sizeof(head)+vecData.size() << " byte (無圧縮RGBA8の "
+		 << fixed << setprecision(1) << 100.0*vecData.size()/nRawSize << "%)" << endl;
+
+	////////////////////////
+	// デコードし直して劣化を確認する
+	image base, decode;
+	base.copy_extend(src, head.nWidth_, head.nHeight_);
+	decode.create(head.nWidth_, head.nHeight_);
+	decode_level(vecData.data(), head.nFormat_, decode);
+
+	cout << "            PSNR: " << fixed << setprecision(2) << psnr(base, decode) << " dB" << endl;
+
+	if(!g_sCheck.empty())
+	{
+		image check;
+		check.copy_extend(decode, src.width(), src.height());
+		check.write_png(g_sCheck);
+	}
+
+	return 0;
+}
+
+uint32_t pow2(uint32_t n)
+{
+	uint32_t nPow=1;
+	while(nPow<n) nPow<<=1;
+	return nPow;
+}
+
+void encode_level(const image& img, uint32_t nFormat, vector<uint8_t>& vecData)
+{
+	if(!container_header::is_block(nFormat))
+	{// D3DFMT_A8R8G8B8に合わせてB,G,R,Aの順にする
+		for(uint32_t y=0; y<img.height(); ++y)
+		{
+			for(uint32_t x=0; x<img.width(); ++x)
+			{
+				const uint8_t* p = img.pixel(x,y);
+				vecData.push_back(p[2]);
+				vecData.push_back(p[1]);
+				vecData.push_back(p[0]);
+				vecData.push_back(p[3]);
+			}
+		}
+		return;
+	}
+
+	// 4x4ブロックを左上から行ごとに。画像からはみ出たピクセルは端の値を使う
+	const uint32_t nUnit = container_header::unit_byte(nFormat);
+
+	uint8_t aBlock[64];
+	uint8_t aOut[16];
+
+	for(uint32_t by=0; by<(img.height()+3)/4; ++by)
+	{
+		for(uint32_t bx=0; bx<(img.width()+3)/4; ++bx)
+		{
+			for(uint32_t i=0; i<16; ++i)
+				memcpy(aBlock+i*4, img.pixel(bx*4+i%4, by*4+i/4), 4);
+
+			if(nFormat==container_header::FORMAT_BC1) bc::encode_bc1(aBlock, aOut);
+			else									  bc::encode_bc3(aBlock, aOut);
+
+			vecData.insert(vecData.end(), aOut, aOut+nUnit);
+		}
+	}
+}
+
+void decode_level(const uint8_t* pData, uint32_t nFormat, image& img)
+{
+	if(!container_header::is_block(nFormat))
+	{
+		for(uint32_t y=0; y<img.height(); ++y)
+		{
+			for(uint32_t x=0; x<img.width(); ++x)
+			{
+				const uint8_t* p = pData+(y*img.width()+x)*4;
+				uint8_t* pDest = img.pixel(x,y);
+				pDest[0]=p[2]; pDest[1]=p[1]; pDest[2]=p[0]; pDest[3]=p[3];
+			}
+		}
+		return;
+	}
+
+	const uint32_t nUnit = container_header::unit_byte(nFormat);
+
+	uint8_t aBlock[64];
+
+	for(uint32_t by=0; by<(img.height()+3)/4; ++by)
+	{
+		for(uint32_t bx=0; bx<(img.width()+3)/4; ++bx)
+		{
+			if(nFormat==container_header::FORMAT_BC1) bc::decode_bc1(pData, aBlock);
+			else									  bc::decode_bc3(pData, aBlock);
+			pData += nUnit;
+
+			for(uint32_t i=0; i<16; ++i)
+			{
+				uint32_t x=bx*4+i%4, y=by*4+i/4;
+				if(x<img.width() && y<img.height()) memcpy(img.pixel(x,y), aBlock+i*4, 4);
+			}
+		}
+	}
+}
+
+double psnr(const image& a, const image& b)
+{
+	double fSum=0.0;
+	for(uint32_t y=0; y<a.height(); ++y)
+	{
+		for(uint32_t x=0; x<a.width(); ++x)
+		{
+			const uint8_t* pA = a.pixel(x,y);
+			const uint8_t* pB = b.pixel(x,y);
+			for(uint32_t c=0; c<4; ++c)
+			{
+				double d = static_cast<double>(pA[c])-pB[c];
+				fSum += d*d;
+			}
+		}
+	}
+
+	double fMse = fSum/(a.width()*a.height()*4);
+	if(fMse<=0.0) return 99.99;
+
+	return 10.0*log10(255.0*255.0/fMse);
+}
+
+namespace boost{
+// BOOST_NO_EXCEPTIONSの時は戻ってはいけないので、表示したら終了する
+void throw_exception(const std::exception& e)
+{
+	cerr << e.what() << endl;
+	std::abort();
+}
+}
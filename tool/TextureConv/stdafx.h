@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#define BOOST_RESULT_OF_USE_DECLTYPE
+#define BOOST_NO_EXCEPTIONS
+#define BOOST_AUTO_LINK_TAGGED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <climits>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include <boost/lexical_cast.hpp>
+using boost::lexical_cast;